@@ -5,9 +5,52 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <memory>
+#include "cellular_automaton.h"
+#include "radius2_automaton.h"
 
+//reusable buffers for repeated ac_hash calls from one thread (e.g. a mining worker)
+struct AcHashWorkspace {
+    std::vector<int> input_bits;
+    std::vector<std::vector<int>> history;
+    std::unique_ptr<CellularAutomaton> ca;
+    std::vector<uint64_t> packed_input;      //radius-2 mode
+    std::unique_ptr<Radius2Automaton> ca_r2;
+};
+
+//radius-2 defaults: l2 ^ r2 ^ l1 ^ (c | r1), i.e. rule 30 with the outer neighbors XORed in
+const uint32_t AC_HASH_R2_DEFAULT_RULE = 1453959510;
+const size_t AC_HASH_R2_DEFAULT_STEPS = 64;
+//rule 30 as a radius-2 rule (ignores l2 and r2): same hashes as ac_hash rule 30 for inputs up to 32 bytes
+const uint32_t AC_HASH_R2_RULE_30 = 66847740;
 
 std::string ac_hash(const std::string& input, uint32_t rule, size_t steps);
+std::string ac_hash(const std::string& input, uint32_t rule, size_t steps, AcHashWorkspace& workspace);
+std::string ac_hash(const uint8_t* input, size_t length, uint32_t rule, size_t steps, AcHashWorkspace& workspace);
+void ac_hash_digest(const uint8_t* input, size_t length, uint32_t rule, size_t steps,
+                    AcHashWorkspace& workspace, uint8_t* digest); //32 bytes, no hex
+//CellularAutomaton path only, skipping the fixed-configuration specializations (see ac_hash_fixed.h)
+void ac_hash_generic_digest(const uint8_t* input, size_t length, uint32_t rule, size_t steps,
+                            AcHashWorkspace& workspace, uint8_t* digest);
+//same construction over a bit-packed radius-2 automaton (32-bit rule, 5-cell neighborhood)
+std::string ac_hash_r2(const std::string& input, uint32_t rule, size_t steps);
+std::string ac_hash_r2(const uint8_t* input, size_t length, uint32_t rule, size_t steps, AcHashWorkspace& workspace);
+void ac_hash_r2_digest(const uint8_t* input, size_t length, uint32_t rule, size_t steps,
+                       AcHashWorkspace& workspace, uint8_t* digest);
+//fixed-width sponge over a 256-cell radius-2 automaton: constant cost per byte, for long payloads
+const size_t SPONGE_WIDTH = 256;        //cells
+const size_t SPONGE_RATE_BITS = 128;    //input bits absorbed per block
+const size_t SPONGE_FINAL_FACTOR = 4;   //generations after the last block, in multiples of rounds
+const size_t AC_HASH_SPONGE_DEFAULT_ROUNDS = 16;
+std::string ac_hash_sponge(const std::string& input, uint32_t rule, size_t rounds);
+std::string ac_hash_sponge(const uint8_t* input, size_t length, uint32_t rule, size_t rounds,
+                           AcHashWorkspace& workspace);
+void ac_hash_sponge_digest(const uint8_t* input, size_t length, uint32_t rule, size_t rounds,
+                           AcHashWorkspace& workspace, uint8_t* digest);
+//shared by the bit-packed variants
+void accumulate_folded(uint64_t* hash, const uint64_t* folded, size_t rotation); //hash ^= folded rotated by rotation bits
+void hash_words_to_digest(const uint64_t* hash, uint8_t* digest); //256 bits -> 32 bytes, ac_hash_digest layout
+std::string digest_to_hex(const uint8_t* digest);
 std::vector<int> string_to_bits(const std::string& inout);
 std::string bits_to_hex(const std::vector<int>& bits);
 std::vector<int> extract_hash_bits(const std::vector<int>& state, const std::vector<std::vector<int>>& history);
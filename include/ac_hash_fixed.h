@@ -0,0 +1,189 @@
+/**
+ * Compile-time specialized ac_hash for fixed production configurations.
+ *
+ * ac_hash_fixed<Rule, Steps, Width> computes exactly ac_hash(input, Rule,
+ * Steps) for inputs whose automaton is Width cells wide (max(256, 8 x
+ * input bytes)), on a bit-packed state held in fixed-size arrays. The rule
+ * kernel is built from compile-time truth masks (rule 30 reduces to
+ * l ^ (c | r)), the word loop is unrolled by template recursion (4 words
+ * for the 256-cell case), and the snapshot schedule (Steps / 16 + 1
+ * interval) and fold rotations (7 x snapshot mod 256) are template
+ * constants, so no loop in the hash depends on a runtime parameter.
+ *
+ * ac_hash and ac_hash_digest call ac_hash_fixed_dispatch first; it
+ * handles the configurations instantiated in ac_hash.cpp and returns
+ * false for everything else, which takes the generic path.
+ */
+
+#ifndef AC_HASH_FIXED_H
+#define AC_HASH_FIXED_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include "ac_hash.h"
+
+//computes the digest if (rule, steps, width of the input) has a specialization
+bool ac_hash_fixed_dispatch(const uint8_t* input, size_t length, uint32_t rule, size_t steps, uint8_t* digest);
+
+namespace ac_hash_fixed_detail {
+
+//rule bit k as an all-zeros / all-ones mask
+template<uint32_t Rule, int K>
+struct Truth {
+    static const uint64_t mask = ((Rule >> K) & 1) ? ~0ULL : 0ULL;
+};
+
+//new cells of a word from its left, center and right neighbors (multiplexer over the truth table)
+template<uint32_t Rule>
+inline uint64_t kernel(uint64_t l, uint64_t c, uint64_t r) {
+    uint64_t lc00 = Truth<Rule, 0>::mask ^ (r & (Truth<Rule, 0>::mask ^ Truth<Rule, 1>::mask));
+    uint64_t lc01 = Truth<Rule, 2>::mask ^ (r & (Truth<Rule, 2>::mask ^ Truth<Rule, 3>::mask));
+    uint64_t lc10 = Truth<Rule, 4>::mask ^ (r & (Truth<Rule, 4>::mask ^ Truth<Rule, 5>::mask));
+    uint64_t lc11 = Truth<Rule, 6>::mask ^ (r & (Truth<Rule, 6>::mask ^ Truth<Rule, 7>::mask));
+    uint64_t l0 = lc00 ^ (c & (lc00 ^ lc01));
+    uint64_t l1 = lc10 ^ (c & (lc10 ^ lc11));
+    return l0 ^ (l & (l0 ^ l1));
+}
+
+template<size_t Width>
+struct Layout {
+    static const size_t WORDS = (Width + 63) / 64;
+    static const size_t LAST = WORDS - 1;
+    static const size_t TAIL_BITS = Width - 64 * LAST; //cells in the last word, 1-64
+    static const uint64_t TAIL_MASK = TAIL_BITS == 64 ? ~0ULL : (1ULL << (TAIL_BITS % 64)) - 1;
+};
+
+//one generation of word W (cell i is bit i % 64 of word i / 64, the ring wraps at Width)
+template<uint32_t Rule, size_t Width, size_t W>
+struct EvolveWord {
+    static inline uint64_t run(const uint64_t* cur) {
+        typedef Layout<Width> L;
+        uint64_t c = cur[W];
+        uint64_t left = W == 0 ? (cur[L::LAST] >> (L::TAIL_BITS - 1)) & 1 : cur[(W + L::LAST) % L::WORDS] >> 63;
+        uint64_t right = W == L::LAST ? (cur[0] & 1) << (L::TAIL_BITS - 1) : cur[(W + 1) % L::WORDS] << 63;
+        uint64_t next = kernel<Rule>((c << 1) | left, c, (c >> 1) | right);
+        return W == L::LAST ? next & L::TAIL_MASK : next;
+    }
+};
+
+template<uint32_t Rule, size_t Width, size_t W, bool Done = (W == Layout<Width>::WORDS)>
+struct EvolveWords {
+    static inline void run(const uint64_t* cur, uint64_t* next) {
+        next[W] = EvolveWord<Rule, Width, W>::run(cur);
+        EvolveWords<Rule, Width, W + 1>::run(cur, next);
+    }
+};
+
+template<uint32_t Rule, size_t Width, size_t W>
+struct EvolveWords<Rule, Width, W, true> {
+    static inline void run(const uint64_t*, uint64_t*) {}
+};
+
+//hash ^= (state folded modulo 256 cells) rotated by Rotation positions
+template<size_t Width, size_t Rotation>
+inline void accumulate(uint64_t* hash, const uint64_t* state) {
+    uint64_t folded[4] = {0, 0, 0, 0};
+    for (size_t w = 0; w < Layout<Width>::WORDS; w++) {
+        folded[w % 4] ^= state[w];
+    }
+    const size_t q = Rotation / 64;
+    const size_t s = Rotation % 64;
+    for (size_t w = 0; w < 4; w++) {
+        uint64_t low = folded[(w + 4 - q) % 4];
+        uint64_t high = folded[(w + 3 - q) % 4];
+        hash[w] ^= s == 0 ? low : (low << s) | (high >> (63 - s) >> 1);
+    }
+}
+
+//history snapshots of compute_hash_bits: generation 0, 1, 1 + interval, ..., then Steps
+template<size_t Steps>
+struct Schedule {
+    static const size_t INTERVAL = Steps / 16 + 1;
+    static const size_t COUNT = 2 + (Steps + INTERVAL - 1) / INTERVAL;
+    static constexpr size_t generation(size_t h) {
+        return h == 0 ? 0 : (h == COUNT - 1 ? Steps : 1 + (h - 1) * INTERVAL);
+    }
+};
+
+//evolves to snapshot H, folds it in with rotation 7 x H, then recurses
+template<uint32_t Rule, size_t Steps, size_t Width, size_t H, bool Done = (H == Schedule<Steps>::COUNT)>
+struct Snapshots {
+    static inline void run(uint64_t* cur, uint64_t* next, uint64_t* hash) {
+        const size_t from = Schedule<Steps>::generation(H - 1);
+        const size_t to = Schedule<Steps>::generation(H);
+        for (size_t t = from; t < to; t++) {
+            EvolveWords<Rule, Width, 0>::run(cur, next);
+            uint64_t* swap = cur;
+            cur = next;
+            next = swap;
+        }
+        accumulate<Width, (H * 7) % 256>(hash, cur);
+        Snapshots<Rule, Steps, Width, H + 1>::run(cur, next, hash);
+    }
+};
+
+template<uint32_t Rule, size_t Steps, size_t Width, size_t H>
+struct Snapshots<Rule, Steps, Width, H, true> {
+    //cur holds the final state: extract_hash_bits starts from it, unrotated
+    static inline void run(uint64_t* cur, uint64_t*, uint64_t* hash) {
+        accumulate<Width, 0>(hash, cur);
+    }
+};
+
+} // namespace ac_hash_fixed_detail
+
+/**
+ * Binary ac_hash for a fixed configuration, same bytes as ac_hash_digest.
+ *
+ * @param input the bytes to be hashed, max(256, 8 x length) must equal Width
+ * @param length number of bytes
+ * @param digest receives 32 bytes
+ */
+template<uint32_t Rule, size_t Steps, size_t Width>
+void ac_hash_fixed_digest(const uint8_t* input, size_t length, uint8_t* digest) {
+    using namespace ac_hash_fixed_detail;
+    static_assert(Rule <= 255, "elementary rule");
+    static_assert(Width >= 256, "ac_hash pads the automaton to at least 256 cells");
+    static_assert(Schedule<Steps>::COUNT < 32, "extract_hash_bits samples every snapshot below 32");
+    if ((length * 8 > 256 ? length * 8 : 256) != Width) {
+        throw std::invalid_argument("Input length does not match the specialized width");
+    }
+    const size_t words = Layout<Width>::WORDS;
+    uint64_t a[words];
+    uint64_t b[words];
+    for (size_t w = 0; w < words; w++) {
+        a[w] = 0;
+    }
+    //most significant bit of each byte first, then alternating padding
+    for (size_t i = 0; i < length; i++) {
+        for (size_t j = 0; j < 8; j++) {
+            size_t cell = 8 * i + j;
+            a[cell / 64] |= static_cast<uint64_t>((input[i] >> (7 - j)) & 1) << (cell % 64);
+        }
+    }
+    for (size_t cell = length * 8; cell < Width; cell++) {
+        a[cell / 64] |= static_cast<uint64_t>(cell % 2) << (cell % 64);
+    }
+
+    uint64_t hash[4] = {0, 0, 0, 0};
+    accumulate<Width, 0>(hash, a);
+    Snapshots<Rule, Steps, Width, 1>::run(a, b, hash);
+    hash_words_to_digest(hash, digest);
+}
+
+/**
+ * ac_hash for a fixed configuration.
+ *
+ * @param input the string to be hashed, max(256, 8 x size) must equal Width
+ * @return the same 256-bit hash as ac_hash(input, Rule, Steps)
+ */
+template<uint32_t Rule, size_t Steps, size_t Width>
+std::string ac_hash_fixed(const std::string& input) {
+    uint8_t digest[32];
+    ac_hash_fixed_digest<Rule, Steps, Width>(reinterpret_cast<const uint8_t*>(input.data()), input.size(), digest);
+    return digest_to_hex(digest);
+}
+
+#endif
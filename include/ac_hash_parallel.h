@@ -0,0 +1,36 @@
+/**
+ * Domain-decomposed ac_hash for very large inputs.
+ *
+ * ac_hash runs an elementary automaton as wide as the input, so a
+ * multi-megabyte block payload is one huge state evolved on a single core.
+ * Here the state is bit-packed and cut into word-aligned domains, one task
+ * per domain on the ThreadPool. Every round, each domain copies its cells
+ * plus a halo of sync_steps cells (rounded up to whole words) on both sides,
+ * evolves that buffer alone for up to sync_steps generations (the halo
+ * absorbs the errors coming in from the buffer edges) and writes its own
+ * cells back. Rounds end on the history snapshot generations, where each
+ * domain also folds its cells into 256 bits, so the output is bit-identical
+ * to ac_hash for every rule, input, thread count and halo width.
+ */
+
+#ifndef AC_HASH_PARALLEL_H
+#define AC_HASH_PARALLEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "thread_pool.h"
+
+//inputs below this size are hashed serially by hashBytes
+const size_t AC_HASH_PARALLEL_MIN_BYTES = 64 * 1024;
+//generations between halo exchanges (the halo is this many cells, rounded up to words)
+const size_t AC_HASH_PARALLEL_SYNC_STEPS = 64;
+
+std::string ac_hash_parallel(const std::string& input, uint32_t rule, size_t steps); //ThreadPool::instance()
+std::string ac_hash_parallel(const uint8_t* input, size_t length, uint32_t rule, size_t steps,
+                             ThreadPool& pool, size_t sync_steps = AC_HASH_PARALLEL_SYNC_STEPS,
+                             size_t domains = 0); //0 = one domain per worker
+void ac_hash_parallel_digest(const uint8_t* input, size_t length, uint32_t rule, size_t steps,
+                             ThreadPool& pool, size_t sync_steps, size_t domains, uint8_t* digest);
+
+#endif
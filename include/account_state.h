@@ -0,0 +1,121 @@
+/**
+ * Account balances derived from the chain's transactions.
+ *
+ * A transaction "Sender->Receiver: amount" moves a whole, positive amount
+ * between two accounts. StateEngine applies each block's transfers in
+ * order as the block is appended and keeps the balances in a BalanceTable,
+ * an open-addressing hash table whose account names live in one arena, so
+ * a balance query is a single probe sequence. Every snapshotInterval
+ * blocks it copies the table (two flat arrays) aside; rebuilding the state
+ * at some height starts from the latest copy at or below it and replays
+ * only the blocks after that.
+ */
+
+#ifndef ACCOUNT_STATE_H
+#define ACCOUNT_STATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ChainSnapshot;
+
+//blocks between saved copies of the balances
+const size_t STATE_DEFAULT_SNAPSHOT_INTERVAL = 1024;
+//saved copies kept besides the genesis allocation (the oldest is dropped first)
+const size_t STATE_MAX_SNAPSHOTS = 8;
+
+struct Transfer {
+    std::string from;
+    std::string to;
+    uint64_t amount;
+};
+
+//parses "Sender->Receiver: amount"; false unless both names are non-empty and free of ';' (the payload's
+//transaction separator) and amount is a positive integer
+bool parseTransfer(const char* tx, size_t length, Transfer& transfer);
+inline bool parseTransfer(const std::string& tx, Transfer& transfer) {
+    return parseTransfer(tx.data(), tx.size(), transfer);
+}
+
+typedef std::vector<std::pair<std::string, uint64_t>> Balances;
+
+class BalanceTable {
+public:
+    BalanceTable();
+
+    uint64_t get(const std::string& account) const; //0 for accounts never seen
+    void set(const std::string& account, uint64_t balance);
+    size_t size() const { return count; }           //accounts
+    size_t memoryBytes() const;
+    Balances accounts() const;                      //sorted by name
+
+private:
+    struct Slot {
+        uint64_t hash;
+        uint32_t nameOffset;    //in names
+        uint32_t nameLength;    //EMPTY_SLOT if unused
+        uint64_t balance;
+    };
+    static const uint32_t EMPTY_SLOT = 0xFFFFFFFFu;
+
+    size_t find(const std::string& account, uint64_t hash) const; //its slot, or the empty slot ending the probe
+    void grow();
+
+    std::vector<Slot> slots;    //power-of-two size, at most 3/4 full
+    std::string names;          //account names back to back
+    size_t count;
+};
+
+//balances after one block, computed by StateEngine::validate and applied by commit
+struct BlockDelta {
+    Balances balances;          //new balance of every account the block touches
+    size_t transfers;
+};
+
+/**
+ * Balances after blocks [0, height()) of a chain. Block 0 is the genesis
+ * block; the allocation passed to the constructor is the state after it.
+ * Not thread safe: it belongs to the chain's writer thread.
+ */
+class StateEngine {
+public:
+    explicit StateEngine(const Balances& allocation,
+                         size_t snapshotInterval = STATE_DEFAULT_SNAPSHOT_INTERVAL);
+
+    /**
+     * Applies a block's transactions in order to a scratch copy of the
+     * accounts they touch, so a transfer may spend what an earlier one in
+     * the same block received.
+     * @throws std::invalid_argument naming the first malformed or overspending transaction
+     */
+    BlockDelta validate(const std::vector<std::string>& transactions) const;
+    BlockDelta validate(const std::string& data) const; //a block's ';'-separated payload
+    void commit(const BlockDelta& delta);               //the next block; saves a copy every interval
+
+    uint64_t balance(const std::string& account) const { return current.get(account); }
+    const BalanceTable& balances() const { return current; }
+    size_t height() const { return applied; }
+    size_t snapshots() const { return saved.size(); }   //including the allocation
+
+    /**
+     * Resets the state to blocks [0, height) of chain, from the latest
+     * saved copy at or below height; copies above height are dropped.
+     * @return Blocks replayed
+     * @throws std::invalid_argument if height is 0 or past the chain, or a replayed block is invalid
+     */
+    size_t rebuild(const ChainSnapshot& chain, size_t height);
+
+private:
+    template<typename F>
+    BlockDelta apply(F forEach) const;
+
+    BalanceTable current;
+    size_t applied;
+    size_t interval;
+    std::vector<std::pair<size_t, BalanceTable>> saved; //(height, balances), saved[0] is the allocation
+};
+
+#endif
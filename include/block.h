@@ -1,5 +1,10 @@
 /**
- * Abstract base class for block implementation
+ * Static (CRTP) interface for block types.
+ *
+ * A block type derives from Block<Itself> and defines the methods below;
+ * code that has to work with any block type takes a const Block<B>& as a
+ * template parameter and calls them without virtual dispatch. The hashes
+ * are returned by reference, so reading a block copies nothing.
  */
 
 #ifndef BLOCK_H
@@ -7,14 +12,24 @@
 
 #include <string>
 
+template<typename Derived>
 class Block {
 public:
-    virtual ~Block() = default;
-    virtual std::string getHash() const = 0;
-    virtual std::string getPreviousHash() const = 0;
-    virtual int getIndex() const = 0;
-    virtual std::string calculateHash() const = 0;
-    virtual void display() const = 0;
+    const std::string& getHash() const { return derived().getHash(); }
+    const std::string& getPreviousHash() const { return derived().getPreviousHash(); }
+    int getIndex() const { return derived().getIndex(); }
+    std::string calculateHash() const { return derived().calculateHash(); }
+    void display() const { derived().display(); }
+
+    //true if this block points at prev
+    template<typename Other>
+    bool linksTo(const Block<Other>& prev) const { return getPreviousHash() == prev.getHash(); }
+
+protected:
+    ~Block() = default; //not deleted through the base
+
+private:
+    const Derived& derived() const { return static_cast<const Derived&>(*this); }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,104 @@
+/**
+ * Canonical binary block header.
+ *
+ * Everything proof-of-work commits to is serialized into one fixed-layout,
+ * little-endian buffer: mining, verification and BlockPow::calculateHash
+ * all hash exactly these bytes. The timestamp is captured once when the
+ * block is mined and stored, so recomputing the hash later gives the same
+ * result. Human-readable time is only produced for display.
+ *
+ * Layout (little-endian), versions 1-2, 100 bytes:
+ *   offset  0  uint32 version
+ *   offset  4  uint32 index
+ *   offset  8  uint64 timestamp (ms since the Unix epoch)
+ *   offset 16  32 B   previous block hash
+ *   offset 48  32 B   SHA-256 of the payload (block data)
+ *   offset 80  uint32 hash mode
+ *   offset 84  uint32 CA rule
+ *   offset 88  uint32 CA steps
+ *   offset 92  uint32 difficulty (version 1: leading '0' hex characters,
+ *                                 version 2+: compact 256-bit target, see target.h)
+ *   offset 96  uint32 nonce
+ *
+ * Version 3, 112 bytes: the same fields, with a uint64 extra nonce at
+ * offset 16 and a uint64 nonce at offset 24 and everything from the
+ * previous hash on shifted 16 bytes later. The nonces sit near the front
+ * because with linear CA rules (e.g. 90) the trailing bytes of a 112-byte
+ * input barely reach the leading hash bits, so a nonce there could never
+ * meet a target.
+ *
+ * Version 3 widens the nonce to 64 bits and adds an extra nonce: when a
+ * template's nonce space is used up the extra nonce moves to the next
+ * value, and independent miners can search disjoint (extra nonce, nonce)
+ * ranges without coordinating. Older versions keep their own layout so
+ * existing blocks still verify.
+ */
+
+#ifndef BLOCK_HEADER_H
+#define BLOCK_HEADER_H
+
+#include "utils.h"
+#include "target.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//blocks created before the binary header hash "data + previousHash + nonce"
+const uint32_t LEGACY_HEADER_VERSION = 0;
+const uint32_t BINARY_HEADER_VERSION = 1;
+const uint32_t TARGET_HEADER_VERSION = 2;
+const uint32_t NONCE64_HEADER_VERSION = 3;
+
+struct BlockHeader {
+    static const size_t LEGACY_ENCODED_SIZE = 100; //versions 1-2
+    static const size_t MAX_ENCODED_SIZE = 112;    //version 3
+
+    uint32_t version;
+    uint32_t index;
+    uint64_t timestamp;                 //ms since epoch, captured once
+    uint8_t previousHash[DIGEST_SIZE];
+    uint8_t payloadHash[DIGEST_SIZE];   //SHA-256 of the block data
+    HashMode hashMode;
+    uint32_t rule;
+    uint32_t steps;
+    uint32_t difficulty;                //see target()
+    uint64_t extraNonce;                //version 3 only
+    uint64_t nonce;                     //32 bits wide before version 3
+
+    BlockHeader();
+
+    //builds a version 1 header; prevHash is hex ("0" for genesis)
+    static BlockHeader create(int index, uint64_t timestamp, const std::string& prevHash,
+                              const std::string& data, int difficulty,
+                              HashMode mode, uint32_t rule, size_t steps);
+
+    //builds a version 3 header mined against a 256-bit target
+    static BlockHeader create(int index, uint64_t timestamp, const std::string& prevHash,
+                              const std::string& data, const Target& target,
+                              HashMode mode, uint32_t rule, size_t steps);
+
+    //the proof-of-work target, whatever the version encodes
+    Target target() const;
+
+    size_t encodedSize() const;  //bytes written by encode for this version
+    uint64_t nonceLimit() const; //number of nonces per extra nonce value
+
+    //writes encodedSize() bytes (at most MAX_ENCODED_SIZE), no allocation
+    size_t encode(uint8_t* out) const;
+    //rewrite only the nonce / extra nonce of an encoded header
+    void encodeNonce(uint8_t* out, uint64_t value) const;
+    void encodeExtraNonce(uint8_t* out, uint64_t value) const;
+    //reads a header written by encode; false if the buffer is not a version 1-3 header
+    static bool decode(const uint8_t* in, size_t length, BlockHeader& header);
+
+    bool operator==(const BlockHeader& other) const;
+};
+
+//a received binary block as batch verification sees it: its header and the hash it claims,
+//flat and fixed-size so a batch is one contiguous array
+struct BlockHeaderView {
+    BlockHeader header;
+    uint8_t hash[DIGEST_SIZE];
+};
+
+#endif
@@ -2,43 +2,62 @@
 #define BLOCK_POW_H
 
 #include "block.h"
+#include "block_header.h"
+#include "bloom_filter.h"
 #include "utils.h"
 #include <string>
 #include <cstdint>
 
-class BlockPow : public Block {
+//final and non-virtual: getters return references into the block, nothing is copied
+class BlockPow final : public Block<BlockPow> {
 private:
     int index;
     std::string previousHash;
     std::string hash;
     std::string data;
-    int nonce;
-    int difficulty;
+    uint64_t nonce;
+    uint64_t extraNonce;    //version 3 headers only
+    int difficulty;         //header difficulty field (compact target for version 2 headers)
     HashMode hashMode;      //Hash mode selection
     uint32_t rule;          //CA rule (for AC_HASH mode)
     size_t steps;           //CA steps (for AC_HASH mode)
+    uint64_t timestamp;     //ms since epoch, captured when mined
+    uint32_t headerVersion; //LEGACY_HEADER_VERSION or BINARY_HEADER_VERSION
+    BloomFilter filter;     //transaction IDs in data, built by the chain before the block is published
 
 public:
-    //constructor
-    BlockPow(int idx, const std::string& prevHash, const std::string& h, 
-             const std::string& d, int n, int diff, 
+    //constructor for legacy blocks (hash over data + previousHash + nonce); the strings are
+    //taken by value so callers can move the payload in
+    BlockPow(int idx, std::string prevHash, std::string h, 
+             std::string d, uint64_t n, int diff, 
              HashMode mode = SHA256_MODE, uint32_t r = 30, size_t s = 128);
+
+    //constructor for blocks mined over a binary header
+    BlockPow(const BlockHeader& header, std::string prevHash, std::string h, std::string d);
     
-    ~BlockPow() override;
-    
-    std::string getHash() const override;
-    std::string getPreviousHash() const override;
-    int getIndex() const override;
-    std::string calculateHash() const override;
-    void display() const override;
+    const std::string& getHash() const;
+    const std::string& getPreviousHash() const;
+    int getIndex() const;
+    std::string calculateHash() const;
+    void display() const;          //describe() through the Logger, flushed before returning
+    std::string describe() const;
     
-    std::string getData() const;
-    int getNonce() const;
+    const std::string& getData() const;
+    uint64_t getNonce() const;
+    uint64_t getExtraNonce() const;
     int getDifficulty() const;
     //
     HashMode getHashMode() const;
     uint32_t getRule() const;
     size_t getSteps() const;
+    uint64_t getTimestamp() const;
+    uint32_t getHeaderVersion() const;
+    Target getTarget() const;
+    //rebuilds the binary header (payload digest recomputed from data)
+    BlockHeader getHeader() const;
+    BlockHeaderView getHeaderView() const; //binary blocks only, for ProofOfWork::verifyBlocks
+    const BloomFilter& getFilter() const;
+    void setFilter(BloomFilter f);  //before the block is published only
 };
 
 #endif
\ No newline at end of file
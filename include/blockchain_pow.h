@@ -3,37 +3,143 @@
 
 #include "block_pow.h"
 #include "utils.h"
+#include "target.h"
+#include "bloom_filter.h"
+#include "account_state.h"
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <string>
+#include <cstddef>
 #include <cstdint>
 
+//block slots allocated for a new chain (the slot array doubles when full)
+const size_t CHAIN_INITIAL_CAPACITY = 64;
+
+//a block the operator trusts: the chain up to it is assumed valid
+struct Checkpoint {
+    size_t height;
+    std::string hash;
+};
+
+enum ValidationMode {
+    VALIDATE_ASSUME_VALID,  //up to the latest checkpoint: linkage and header sanity only
+    VALIDATE_FULL           //recompute every block's proof of work
+};
+
+/**
+ * Immutable view of the first size() blocks of a chain: a pointer to the
+ * chain's slot array and the tip index, taken without locks. Published
+ * blocks never change and slot arrays are only freed with the chain, so a
+ * snapshot stays readable while the writer keeps appending (it just does
+ * not see the newer blocks). It must not outlive its BlockchainPow.
+ */
+class ChainSnapshot {
+public:
+    ChainSnapshot(BlockPow* const* blocks, size_t length) : blocks(blocks), length(length) {}
+
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    const BlockPow* operator[](size_t i) const { return blocks[i]; }
+    const BlockPow* front() const { return blocks[0]; }
+    const BlockPow* back() const { return blocks[length - 1]; }
+    BlockPow* const* begin() const { return blocks; }
+    BlockPow* const* end() const { return blocks + length; }
+
+    bool isValid() const; //proof of work and linkage of every block in the snapshot
+    //the same checks for blocks [first, last) only, each linked to its predecessor
+    bool isRangeValid(size_t first, size_t last) const;
+    //blocks [first, last): index, linkage and a well-formed hash meeting the target, no hashing
+    bool isLinked(size_t first, size_t last) const;
+
+private:
+    BlockPow* const* blocks;
+    size_t length;
+};
+
+/**
+ * Proof-of-work chain with one writer and any number of lock-free readers.
+ * addBlock, the configuration setters and the balance queries belong to
+ * a single writer thread; getChain, isChainValid, getLatestHash and
+ * displayChain may run on any thread at the same time. The writer fills the next slot and then
+ * publishes the new length with release semantics; readers load it with
+ * acquire semantics and see every block up to it fully constructed.
+ */
 class BlockchainPow {
 private:
-    std::vector<BlockPow*> chain;
+    //slot array of the published blocks; when full the writer publishes a copy twice as large
+    //and keeps the old one (readers may still hold it) until the chain is destroyed
+    std::atomic<BlockPow**> blocks;
+    std::atomic<size_t> length;   //published blocks
+    size_t capacity;              //slots in blocks, writer only
+    std::vector<BlockPow**> retired;
     int difficulty;
+    Target target;          //proof-of-work target new blocks are mined against
+    RetargetController retargeter;
     HashMode hashMode;      //Default hash mode for the blockchain
     uint32_t rule;          //CA rule (for AC_HASH mode)
     size_t steps;           //CA steps (for AC_HASH mode)
+    std::vector<Checkpoint> checkpoints;    //sorted by height
+    ValidationMode validationMode;
+    BloomGeometry bloomGeometry;   //of the transaction filter built for each new block
+    std::unique_ptr<StateEngine> state; //account balances, when tracked
 
 public:
     // Constructor with hash mode selection
     BlockchainPow(int diff = 2, HashMode mode = SHA256_MODE, 
                   uint32_t r = 30, size_t s = 128);
     
+    //a replica of another node's chain, starting from its genesis block (taken over, PoW checked)
+    explicit BlockchainPow(std::unique_ptr<BlockPow> genesis);
+    
     ~BlockchainPow();
+    BlockchainPow(const BlockchainPow&) = delete;
+    BlockchainPow& operator=(const BlockchainPow&) = delete;
     
+    //with balances tracked, throws std::invalid_argument before mining if a transaction is
+    //malformed or overspends
     void addBlock(const std::vector<std::string>& transactions);
-    bool isChainValid() const;
-    void displayChain() const;
-    void setDifficulty(int diff);
+    //appends a block mined elsewhere if it is the next index, links to the tip, uses the chain's
+    //hash mode, rule and steps with a target no easier than getTarget(), and has valid PoW
+    bool acceptBlock(std::unique_ptr<BlockPow> block);
+    static bool verifyProof(const BlockPow& block); //hash and target of one block, in its own mode
+    bool isChainValid() const;                      //in the configured validation mode
+    bool isChainValid(ValidationMode mode) const;
+    void displayChain() const;                      //through the Logger, flushed before returning
+    void setDifficulty(int diff);           //leading '0' hex characters
+    void setDifficultyBits(unsigned bits);  //leading zero bits
+    void setTarget(const Target& t);
+    const Target& getTarget() const;
+    //retarget after every block to hold the given block interval
+    void enableRetargeting(double blockMillis, size_t window = 8, double maxFactor = 4.0);
+    void disableRetargeting();
     void setHashMode(HashMode mode, uint32_t r = 30, size_t s = 128);
+    //trusted (height, hash) pairs; set them before readers validate the chain
+    void setCheckpoints(std::vector<Checkpoint> trusted);
+    const std::vector<Checkpoint>& getCheckpoints() const;
+    void setValidationMode(ValidationMode mode); //VALIDATE_ASSUME_VALID by default
+    ValidationMode getValidationMode() const;
+    //sizes the Bloom filters of blocks appended from now on; earlier blocks keep theirs
+    void setBloomFalsePositiveRate(double rate, size_t expectedTransactions = BLOOM_DEFAULT_EXPECTED_TRANSACTIONS);
+    const BloomGeometry& getBloomGeometry() const;
+    //interprets every transaction as "Sender->Receiver: amount" from now on, starting from the
+    //allocation and replaying the blocks after genesis (std::invalid_argument if one is invalid)
+    void trackBalances(const Balances& allocation, size_t snapshotInterval = STATE_DEFAULT_SNAPSHOT_INTERVAL);
+    bool tracksBalances() const;
+    uint64_t getBalance(const std::string& account) const; //std::runtime_error unless tracked
+    StateEngine* getState();                                //null unless tracked
     std::string getLatestHash() const;
     
     //getters for hash configuration
     HashMode getHashMode() const;
     uint32_t getRule() const;
     size_t getSteps() const;
-    const std::vector<BlockPow*>& getChain() const;//get the chain for analysis
+    ChainSnapshot getChain() const; //lock-free snapshot of the published blocks
+
+private:
+    void publish(BlockPow* block); //writer only; builds the block's transaction filter
+    //latest checkpoint below height limit, null if none (or in VALIDATE_FULL mode)
+    const Checkpoint* assumedCheckpoint(size_t limit, ValidationMode mode) const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,89 @@
+/**
+ * Per-block Bloom filters over transaction IDs.
+ *
+ * A block's data is its transactions, each followed by ';'. The filter
+ * holds every transaction string of the block; a transaction's ID is a
+ * 128-bit key (two 64-bit halves) hashed from its bytes, and the filter
+ * sets one bit per probe of the sequence h1 + i * h2, i < hashes. A
+ * negative answer is exact, a positive one has to be confirmed against
+ * the payload (blockHasTransaction).
+ *
+ * All filters of a chain share one BloomGeometry, chosen from the target
+ * false-positive rate and the expected transactions per block, so a query
+ * hits the same bit positions in every block and can be tested against
+ * many blocks at once (see TransactionIndex in tx_index.h).
+ */
+
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const double BLOOM_DEFAULT_FALSE_POSITIVE_RATE = 0.01;
+const size_t BLOOM_DEFAULT_EXPECTED_TRANSACTIONS = 16;
+const unsigned BLOOM_MAX_HASHES = 16;
+const size_t BLOOM_MAX_BITS = 1 << 20;
+
+struct BloomGeometry {
+    size_t bits;        //filter size, a multiple of 64
+    unsigned hashes;    //bits set per transaction
+
+    /**
+     * @param falsePositiveRate Target rate for a block holding expectedTransactions, in (0, 1)
+     * @param expectedTransactions Transactions per block the filter is sized for (> 0)
+     * @throws std::invalid_argument if either is out of range
+     */
+    static BloomGeometry forRate(double falsePositiveRate, size_t expectedTransactions);
+    size_t words() const { return bits / 64; }
+    //expected false-positive rate of a filter holding n transactions
+    double falsePositiveRate(size_t n) const;
+
+    bool operator==(const BloomGeometry& other) const { return bits == other.bits && hashes == other.hashes; }
+    bool operator!=(const BloomGeometry& other) const { return !(*this == other); }
+};
+
+BloomGeometry defaultBloomGeometry();
+
+struct BloomKey {
+    uint64_t h1;
+    uint64_t h2;    //odd, so the probe sequence does not collapse
+};
+
+BloomKey bloomKey(const char* tx, size_t length);
+inline BloomKey bloomKey(const std::string& tx) { return bloomKey(tx.data(), tx.size()); }
+
+class BloomFilter {
+public:
+    BloomFilter() : shape{0, 0} {} //empty: mayContain is always false
+    explicit BloomFilter(const BloomGeometry& geometry);
+
+    //a filter of every ';'-terminated transaction in a block's data (a trailing unterminated one counts too)
+    static BloomFilter forData(const std::string& data, const BloomGeometry& geometry);
+
+    void add(const BloomKey& key);
+    void add(const std::string& tx) { add(bloomKey(tx)); }
+    bool mayContain(const BloomKey& key) const;
+    bool mayContain(const std::string& tx) const { return mayContain(bloomKey(tx)); }
+
+    //the bit positions key maps to, in probe order; out holds geometry.hashes entries
+    static void positions(const BloomKey& key, const BloomGeometry& geometry, size_t* out);
+    bool test(size_t bit) const { return (bitWords[bit / 64] >> (bit % 64)) & 1; }
+    //mayContain with the positions already computed for this filter's geometry
+    bool testAll(const size_t* bits) const;
+
+    const BloomGeometry& geometry() const { return shape; }
+    const std::vector<uint64_t>& words() const { return bitWords; }
+    bool empty() const { return bitWords.empty(); }
+
+private:
+    BloomGeometry shape;
+    std::vector<uint64_t> bitWords;
+};
+
+//true if tx is one of the ';'-separated transactions in data (exact match)
+bool blockHasTransaction(const std::string& data, const std::string& tx);
+
+#endif
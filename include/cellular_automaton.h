@@ -5,18 +5,31 @@
 #include <vector>
 #include <cstdint>
 
+//temporal blocking: tiles of CA_TILE_CELLS cells advance up to CA_TILE_DEPTH generations per pass
+const size_t CA_TILE_CELLS = 8192;
+const size_t CA_TILE_DEPTH = 16;
+//evolve_steps tiles grids from this size on (state + scratch no longer fit a typical L2)
+const size_t CA_TILED_MIN_CELLS = 65536;
+
 class CellularAutomaton {
 private:
     std::vector<int> state;
     uint32_t rule;
     size_t size;
+    std::vector<int> next_state; //scratch buffer reused by every generation
+    std::vector<int> tile;       //evolve_tiled working buffers
+    std::vector<int> tile_next;
 public:
     CellularAutomaton(size_t grid_size, uint32_t rule_number);
     void init_state(const std::vector<int>& initial_state);//init a vector of bit
     void init_single_center(); //init state from a single center cell
     void evolve(); //evolve one generation
-    void evolve_steps(size_t steps); //run multiple
+    void evolve_steps(size_t steps); //run multiple (fast-forwards additive rules, tiles large grids)
+    void evolve_tiled(size_t steps, size_t tile_cells = CA_TILE_CELLS, size_t tile_depth = CA_TILE_DEPTH);
+    bool is_additive() const; //true if the rule is linear over GF(2) (0, 60, 90, 102, 150, ...)
     std::vector<int> get_state() const; 
+    void copy_state(std::vector<int>& out) const; //copy into a caller buffer, reusing its capacity
+    size_t get_size() const;
     int get_cell(size_t index) const;
     void set_rule(uint32_t rule_number);
     uint32_t get_rule() const;
@@ -25,6 +38,7 @@ public:
     void reset(); //all zeros
 private:
     int apply_rule(int left, int center, int right) const;//apply rule to a 3-cell neighborhood
+    void evolve_linear(size_t steps); //O(log steps) XOR-shift passes, additive rules only
 };
 
 
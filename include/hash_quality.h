@@ -0,0 +1,82 @@
+/**
+ * Parallel statistical quality analysis for 256-bit hash functions.
+ *
+ * Inputs are generated deterministically from a seed (so results do not
+ * depend on the thread count), hashed on the shared ThreadPool into binary
+ * digests and tallied with hardware popcount. The report covers:
+ *   - monobit: fraction of 1 bits, with a 95% confidence interval
+ *   - per-position bias of the 256 output bits (chi-square)
+ *   - runs: bit transitions inside each digest (NIST runs statistic)
+ *   - chi-square of the byte values at each of the 32 digest positions
+ *   - avalanche: mean fraction of output bits flipped by a 1-bit input
+ *     change, and the full input bit -> output bit flip matrix (strict
+ *     avalanche criterion)
+ */
+
+#ifndef HASH_QUALITY_H
+#define HASH_QUALITY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+//hashes length bytes into a 32-byte digest; called concurrently from pool workers
+typedef std::function<void(const uint8_t* input, size_t length, uint8_t* digest)> DigestFunction;
+
+//ac_hash_digest (and the r2 / sponge variants) with one AcHashWorkspace per thread
+DigestFunction ac_hash_digest_function(uint32_t rule, size_t steps);
+DigestFunction ac_hash_r2_digest_function(uint32_t rule, size_t steps);
+DigestFunction ac_hash_sponge_digest_function(uint32_t rule, size_t rounds);
+
+struct QualityConfig {
+    size_t samples;          //random inputs for monobit / runs / chi-square
+    size_t avalanche_inputs; //inputs for the avalanche matrix (each costs input bits + 1 hashes)
+    size_t input_bytes;      //length of the generated inputs
+    uint64_t seed;
+    bool serial;             //hash on the calling thread (the caller already runs configs in parallel)
+};
+
+struct Estimate {
+    double value;
+    double ci_low;  //95% confidence interval
+    double ci_high;
+};
+
+struct QualityReport {
+    std::string name;
+    size_t samples;
+    size_t hashes;               //digests computed in total
+    double seconds;
+    double hashes_per_sec;
+
+    Estimate ones_fraction;      //monobit
+    double monobit_p;
+    double bit_bias_max;         //max |P(bit j = 1) - 0.5| over the 256 positions
+    double bit_bias_p;           //chi-square over positions, 256 dof
+    Estimate transition_fraction; //runs: P(adjacent bits differ)
+    double runs_p;
+    std::vector<double> byte_chi_square; //per digest byte position, 255 dof
+    std::vector<double> byte_p;
+    double byte_p_min;
+
+    size_t avalanche_inputs;
+    size_t input_bits;
+    Estimate avalanche;          //mean fraction of output bits flipped
+    double sac_bias_max;         //max |P(flip) - 0.5| over the matrix
+    double sac_out_of_band;      //fraction of cells outside the 99% band (expect ~0.01)
+    double sac_deterministic;    //fraction of cells always or never flipped (affine hashes: 1.0)
+    std::vector<double> avalanche_matrix; //input_bits x 256, row-major P(flip)
+
+    std::string to_json(bool include_matrix = false) const;
+};
+
+QualityReport analyze_hash_quality(const std::string& name, const DigestFunction& digest,
+                                   const QualityConfig& config);
+
+//p-values: two-sided normal, and upper tail of chi-square (Wilson-Hilferty)
+double normal_p_value(double z);
+double chi_square_p_value(double chi_square, double dof);
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * Hot-path instrumentation: per-stage call counters and cycle timers for
+ * mining and hashing.
+ *
+ * Build with -DBLOCKCHAIN_INSTRUMENT (make INSTRUMENT=1) to enable the
+ * PROFILE_* macros. Without it they expand to nothing and the hot paths
+ * carry no instrumentation code at all; the dump functions still exist but
+ * report "enabled": false.
+ *
+ * Each thread writes only its own counters (no shared cache lines, no
+ * locks). The per-thread blocks are linked into a lock-free list so dumps
+ * can sum them while mining runs.
+ */
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+enum ProfileStage {
+    STAGE_MESSAGE,          //building the message to hash (prefix + nonce)
+    STAGE_CA_EVOLUTION,     //CellularAutomaton generations in ac_hash
+    STAGE_HISTORY_FOLD,     //extract_hash_bits over state + history
+    STAGE_SHA256,           //OpenSSL SHA-256 compression
+    STAGE_HEX_ENCODE,       //digest -> hex string
+    STAGE_TARGET_COMPARE,   //checking the hash against the difficulty target
+    STAGE_COUNT
+};
+
+struct StageTotals {
+    uint64_t calls;
+    uint64_t cycles;
+    double seconds;
+};
+
+class Profiler {
+public:
+    //raw timestamp: TSC cycles on x86, steady_clock nanoseconds elsewhere
+    static inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    static void record(ProfileStage stage, uint64_t cycles); //one timed call
+    static void count(ProfileStage stage, uint64_t n); //untimed events
+
+    static bool enabled(); //true when built with BLOCKCHAIN_INSTRUMENT
+    static StageTotals totals(ProfileStage stage); //summed over all threads
+    static void reset();
+    static const char* stage_name(ProfileStage stage);
+    static double cycles_per_second(); //timer frequency (calibrated once)
+
+    static std::string to_json();
+    static std::string to_prometheus();
+};
+
+//times the enclosing scope into one stage
+class ProfileScope {
+private:
+    ProfileStage stage;
+    uint64_t start;
+
+public:
+    explicit ProfileScope(ProfileStage s) : stage(s), start(Profiler::now()) {}
+    ~ProfileScope() { Profiler::record(stage, Profiler::now() - start); }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef BLOCKCHAIN_INSTRUMENT
+#define PROFILE_SCOPE(stage) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(stage)
+#define PROFILE_COUNT(stage, n) Profiler::count(stage, n)
+#else
+#define PROFILE_SCOPE(stage) ((void)0)
+#define PROFILE_COUNT(stage, n) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,121 @@
+/**
+ * Asynchronous structured logging for the mining path.
+ *
+ * Producers (any thread) move a LogRecord into a bounded lock-free ring
+ * and return; a background writer thread drains the ring every
+ * LOG_FLUSH_MILLIS while records arrive (and sleeps while it is empty),
+ * formats the batch as text or JSON lines and hands it to the output
+ * stream in one write. Mining never waits on console I/O:
+ * when the ring is full the record is dropped and counted. Records below
+ * the current level (everything in LOG_SILENT, the benchmark setting)
+ * return before touching the ring.
+ */
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "utils.h"
+
+//records the ring holds before producers start dropping (power of two)
+const size_t LOG_RING_CAPACITY = 4096;
+//longest the writer waits after a record arrives before draining the ring
+const int LOG_FLUSH_MILLIS = 2;
+
+enum LogLevel {
+    LOG_DEBUG,
+    LOG_INFO,
+    LOG_WARN,
+    LOG_ERROR,
+    LOG_SILENT  //as a level: drop everything
+};
+
+enum LogFormat {
+    LOG_TEXT,   //human-readable lines, as the console output has always looked
+    LOG_JSON    //one JSON object per line
+};
+
+enum LogEvent {
+    EVENT_MESSAGE,      //free text (text)
+    EVENT_BLOCK_MINED   //index, nonce, extraNonce, millis, mode, rule, steps
+};
+
+struct LogRecord {
+    LogEvent event;
+    LogLevel level;
+    uint64_t timestampMicros;   //wall clock, set by the producer
+    uint64_t index;
+    uint64_t nonce;
+    uint64_t extraNonce;
+    double millis;
+    HashMode mode;
+    uint32_t rule;
+    size_t steps;
+    std::string text;
+};
+
+class Logger {
+public:
+    Logger();
+    ~Logger(); //writes out everything queued, then stops the writer
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    static Logger& instance(); //library-wide logger writing to std::cout
+
+    void set_level(LogLevel level);
+    LogLevel level() const;
+    bool enabled(LogLevel level) const { return level >= min_level.load(std::memory_order_relaxed); }
+    void set_format(LogFormat format);
+    void set_output(std::ostream* out); //drains the ring to the old stream first
+
+    //log and block_mined only queue the record: it reaches the stream up to LOG_FLUSH_MILLIS
+    //later, so it can land after std::cout output written meanwhile unless the caller flush()es
+    void log(LogLevel level, std::string text);
+    void block_mined(uint64_t index, uint64_t nonce, uint64_t extraNonce, double millis,
+                     HashMode mode, uint32_t rule, size_t steps);
+
+    void flush(); //returns once every record queued before the call is written
+    uint64_t dropped() const; //records lost to a full ring
+
+    static std::string format_record(const LogRecord& record, LogFormat format);
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    bool push(LogRecord& record);
+    bool pop(LogRecord& record);
+    void writer_loop();
+    bool empty() const; //every claimed position has been popped
+    size_t drain(); //writes one batch, returns the number of records
+
+    std::unique_ptr<Slot[]> ring;
+    std::atomic<size_t> enqueue_pos;
+    std::atomic<size_t> dequeue_pos;
+    std::atomic<int> min_level;
+    std::atomic<int> format;
+    std::atomic<uint64_t> lost;
+    std::atomic<uint64_t> written;  //records taken off the ring and written
+
+    std::ostream* out;              //guarded by write_mutex
+    std::mutex write_mutex;         //held by the writer while it drains
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::condition_variable drained;
+    bool stopping;
+    std::thread writer;
+};
+
+#endif
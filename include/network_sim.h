@@ -0,0 +1,146 @@
+/**
+ * Deterministic in-process simulation of a proof-of-work network.
+ *
+ * N nodes, each with its own block tree (forks included), a miner and
+ * links to its peers, run in virtual time on a discrete event queue; no
+ * sockets or threads are involved beyond the shared mining ThreadPool.
+ * Mining is modeled statistically: a node mining at hashesPerSecond finds
+ * a block after a geometric number of attempts at the target's success
+ * probability (memoryless, so switching to a new tip just resamples).
+ * The winning block is then really mined and every receiving node really
+ * verifies its proof of work before relaying it, so the blocks are valid
+ * and validation throughput is measured on real hashing. Links add latency
+ * (plus fixed per-link jitter) and serialize blocks at their bandwidth.
+ * Nodes follow the longest chain, first seen wins ties. The same config
+ * and seed always give the same virtual-time results.
+ */
+
+#ifndef NETWORK_SIM_H
+#define NETWORK_SIM_H
+
+#include "block_pow.h"
+#include "target.h"
+#include "utils.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+struct NetworkConfig {
+    size_t nodes;
+    size_t peers;               //links per node, 0 = full mesh
+    double latencyMillis;       //one-way link latency
+    double jitterMillis;        //extra latency drawn once per link, uniform in [0, jitterMillis)
+    double bandwidthBytesPerMilli; //0 = unlimited
+    double hashesPerSecond;     //per node, in virtual time
+    double validateMillis;      //virtual time a node spends validating one block
+    unsigned difficultyBits;    //leading zero bits of the target
+    HashMode mode;
+    uint32_t rule;
+    size_t steps;
+    size_t payloadBytes;        //block data size
+    size_t blocks;              //stop mining after this many blocks in total
+    uint64_t seed;
+};
+
+NetworkConfig defaultNetworkConfig();
+
+struct NetworkStats {
+    size_t blocksMined;
+    size_t mainChainLength;     //blocks above genesis on node 0's best chain
+    size_t staleBlocks;         //mined but not on the final main chain
+    double orphanRate;          //staleBlocks / blocksMined
+    size_t nodesOnTip;          //nodes whose best tip is node 0's at the end
+    double propagationP50;      //ms from mining to acceptance at another node
+    double propagationP90;
+    double propagationP99;
+    double propagationMax;
+    double fullPropagationP50;  //ms until every node has accepted a block
+    double fullPropagationP99;
+    size_t validations;         //blocks verified on receipt (real hashing)
+    size_t invalidBlocks;       //blocks that failed verification
+    size_t messages;
+    uint64_t bytesSent;
+    double virtualMillis;       //simulated time until the network went quiet
+    double wallSeconds;
+    double validationSeconds;   //wall time spent verifying received blocks
+    double validatedPerSecond;  //validations / validationSeconds
+};
+
+class NetworkSimulator {
+public:
+    explicit NetworkSimulator(const NetworkConfig& config);
+
+    NetworkStats run(); //once per simulator: until config.blocks are mined and every relay is delivered
+
+private:
+    enum SimEventType {
+        SIM_MINED,      //a node's miner finds a block (stale if the node's epoch moved on)
+        SIM_ARRIVE,     //a block reaches a node over a link
+        SIM_VALIDATED   //a node finishes validating a block
+    };
+
+    struct SimEvent {
+        double time;
+        uint64_t seq;       //insertion order, breaks time ties deterministically
+        SimEventType type;
+        size_t node;
+        size_t block;
+        size_t from;        //sending node for SIM_ARRIVE
+        uint64_t epoch;     //mining epoch for SIM_MINED
+        bool operator>(const SimEvent& other) const {
+            return time != other.time ? time > other.time : seq > other.seq;
+        }
+    };
+
+    struct SimBlock {
+        std::unique_ptr<BlockPow> block;
+        size_t parent;
+        size_t height;
+        size_t miner;
+        double minedAt;
+        size_t bytes;       //header + payload on the wire
+        size_t acceptedBy;
+    };
+
+    struct Link {
+        size_t peer;
+        double latency;
+        double busyUntil;   //the link sends one block at a time
+    };
+
+    enum BlockStatus { UNKNOWN, VALIDATING, WAITING_PARENT, ACCEPTED, INVALID };
+
+    struct Node {
+        std::vector<uint8_t> status;    //BlockStatus per block id
+        std::vector<std::pair<size_t, size_t>> waiting; //(parent, block) received before their parent
+        std::vector<Link> links;
+        size_t tip;
+        uint64_t epoch;     //bumped whenever the miner switches to a new tip
+        double busyUntil;   //blocks are validated one at a time
+    };
+
+    void push(double time, SimEventType type, size_t node, size_t block, size_t from, uint64_t epoch);
+    void scheduleMining(size_t node, double now);
+    size_t mineBlock(size_t node, double now);
+    void receive(size_t node, size_t block, size_t from, double now);
+    void connect(size_t node, size_t block, size_t from, double now);
+    void relay(size_t node, size_t block, size_t from, double now);
+
+    NetworkConfig config;
+    Target target;
+    std::mt19937_64 rng;
+    std::vector<Node> nodes;
+    std::vector<SimBlock> blocks;
+    std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent>> events;
+    uint64_t nextSeq;
+    NetworkStats stats;
+    std::vector<double> propagation;
+    std::vector<double> fullPropagation;
+};
+
+#endif
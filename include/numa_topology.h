@@ -0,0 +1,45 @@
+/**
+ * NUMA topology discovery and node-local memory placement.
+ * On Linux the topology is read from /sys/devices/system/node, everywhere
+ * else (or when sysfs is missing) the machine is reported as a single node
+ * holding every hardware thread.
+ */
+
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct NumaNode {
+    int id;
+    std::vector<int> cpus;
+};
+
+class NumaTopology {
+private:
+    std::vector<NumaNode> nodes;
+
+public:
+    //read the topology from a sysfs node directory
+    static NumaTopology discover(const std::string& sysfs_root = "/sys/devices/system/node");
+    static const NumaTopology& system(); //discovered once, shared
+
+    size_t node_count() const;
+    bool is_numa() const; //more than one node
+    const std::vector<NumaNode>& get_nodes() const;
+    const NumaNode& node_for_worker(size_t worker) const; //round-robin across nodes
+    int node_of_cpu(int cpu) const;
+    int current_node() const; //node of the CPU the caller is running on
+
+    //memory placement (falls back to plain allocation if the kernel refuses)
+    static void* allocate_on_node(size_t bytes, int node);
+    static void* allocate_interleaved(size_t bytes);
+    static void release(void* ptr, size_t bytes);
+    static bool set_thread_interleaved(bool interleave); //policy for the caller's future heap pages
+
+    static std::vector<int> parse_cpu_list(const std::string& list); //"0-3,8-11"
+};
+
+#endif
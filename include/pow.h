@@ -3,29 +3,72 @@
 
 #include <string>
 #include <cstdint>
+#include <cstddef>
+#include <vector>
 #include "utils.h"
+#include "block_header.h"
+
+//one bit per block of a verified batch, set when the block is valid
+class BlockBitmap {
+private:
+    std::vector<uint64_t> words;
+    size_t count;
+
+public:
+    explicit BlockBitmap(size_t n = 0) : words((n + 63) / 64, 0), count(n) {}
+
+    size_t size() const { return count; }
+    bool test(size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+    void set(size_t i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+    size_t countValid() const {
+        size_t valid = 0;
+        for (uint64_t word : words) {
+            for (; word != 0; word &= word - 1) valid++;
+        }
+        return valid;
+    }
+    bool all() const { return countValid() == count; }
+    const std::vector<uint64_t>& data() const { return words; }
+};
 
 class ProofOfWork {
 public:
     //SHA256 mining
     static std::string mineBlock(const std::string& data, const std::string& previousHash, 
-                                int difficulty, int& nonce);
+                                int difficulty, uint64_t& nonce);
     
     //mine with hash mode selection
     static std::string mineBlock(const std::string& data, const std::string& previousHash, 
-                                int difficulty, int& nonce, HashMode mode, 
+                                int difficulty, uint64_t& nonce, HashMode mode, 
                                 uint32_t rule = 30, size_t steps = 128);
     
     //SHA256 verification
     static bool verifyBlock(const std::string& data, const std::string& previousHash, 
-                          const std::string& hash, int difficulty, int nonce);
+                          const std::string& hash, int difficulty, uint64_t nonce);
     
     //Verification with hash mode selection
     static bool verifyBlock(const std::string& data, const std::string& previousHash, 
-                          const std::string& hash, int difficulty, int nonce, 
+                          const std::string& hash, int difficulty, uint64_t nonce, 
                           HashMode mode, uint32_t rule = 30, size_t steps = 128);
 
-private:
+    //mines a binary header: searches from nonce 0, rolling the extra nonce over when the
+    //nonce space (nonceSpace per extra nonce, 0 = full range) runs out; stores the result in header
+    static std::string mineHeader(BlockHeader& header, uint64_t nonceSpace = 0);
+
+    //hash of the encoded header with its own hash mode
+    static std::string hashHeader(const BlockHeader& header);
+
+    //checks that the header hashes to hash and meets its difficulty
+    static bool verifyHeader(const BlockHeader& header, const std::string& hash);
+
+    //verifies a consecutive run of binary blocks at once (see pow.cpp); anchor is the hash
+    //digest of the block before views[0], or null to skip that link
+    static BlockBitmap verifyBlocks(const BlockHeaderView* views, size_t count,
+                                    const uint8_t* anchor = nullptr);
+
+    //message hashed by legacy blocks (data + previousHash + decimal nonce), built in one allocation
+    static std::string legacyMessage(const std::string& data, const std::string& previousHash, uint64_t nonce);
+
     //Compute hash based on mode
     static std::string computeHash(const std::string& data, HashMode mode, 
                                   uint32_t rule, size_t steps);
@@ -0,0 +1,220 @@
+/**
+ * Embedded query server for block explorers, and its client.
+ *
+ * QueryServer runs one epoll event loop on its own thread over
+ * non-blocking loopback sockets and answers getBlock(height),
+ * getBlock(hash), getTip() and validateRange() from lock-free chain
+ * snapshots, so a miner can keep appending while it serves. Clients may
+ * pipeline any number of requests; responses come back in request order.
+ *
+ * Two protocols share the port and may be mixed on one connection; the
+ * first byte of each request tells them apart:
+ *   binary  opcode byte (high bit set) and its arguments, answered with a
+ *           status byte and, for blocks, the relay frame (see relay.h)
+ *   text    "BLOCK <height>", "HASH <hex>", "TIP", "VALIDATE <first> <last>"
+ *           lines, answered with "OK ..." or "ERR <reason>" lines
+ *
+ * Responses are gathered into iovecs and written with sendmsg: block
+ * payloads of QUERY_ZERO_COPY_MIN_BYTES or more are sent straight from the
+ * chain's storage instead of being copied into a response buffer.
+ */
+
+#ifndef QUERY_SERVER_H
+#define QUERY_SERVER_H
+
+#include "block_pow.h"
+#include "blockchain_pow.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//binary request opcodes and their arguments
+const uint8_t QUERY_GET_HEIGHT = 0x81;  //varint height
+const uint8_t QUERY_GET_HASH = 0x82;    //32-byte block hash digest
+const uint8_t QUERY_GET_TIP = 0x83;     //no arguments
+const uint8_t QUERY_VALIDATE = 0x84;    //varint first, varint last (exclusive)
+
+//payloads at least this large are written from chain storage, smaller ones are copied
+const size_t QUERY_ZERO_COPY_MIN_BYTES = 256;
+//unsent response bytes at which a connection stops reading requests
+const size_t QUERY_MAX_PENDING_BYTES = 4 * 1024 * 1024;
+//longest text request line
+const size_t QUERY_MAX_LINE_BYTES = 256;
+//widest validateRange span; proof of work is recomputed on the event loop, so wider spans are refused
+const size_t QUERY_MAX_VALIDATE_BLOCKS = 256;
+
+enum QueryProtocol {
+    QUERY_BINARY,
+    QUERY_TEXT
+};
+
+enum QueryStatus {
+    QUERY_OK = 0,
+    QUERY_NOT_FOUND = 1,    //no block at that height / with that hash
+    QUERY_BAD_REQUEST = 2   //unknown or malformed request (binary: the connection is closed), a range
+                            //wider than QUERY_MAX_VALIDATE_BLOCKS, or a text request for a block whose
+                            //data has a '\n'
+};
+
+struct QueryServerStats {
+    size_t connections;     //accepted so far
+    uint64_t requests;
+    uint64_t errors;        //requests answered with a non-OK status
+    uint64_t bytesSent;
+    uint64_t writes;        //sendmsg calls
+    uint64_t zeroCopyBytes; //payload bytes sent from chain storage
+};
+
+class QueryServer {
+public:
+    //serves chain on 127.0.0.1:port (0 = any free port, see port()); stop() before chain is destroyed
+    explicit QueryServer(const BlockchainPow& chain, uint16_t port = 0);
+    ~QueryServer(); //stops the server
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    uint16_t port() const { return boundPort; }
+    void start();   //runs the event loop on a new thread
+    void stop();    //wakes the loop, closes every connection and joins the thread
+    QueryServerStats stats() const;
+
+private:
+    struct Segment {
+        const char* external;   //chain storage, or null for the connection's front owned piece
+        size_t length;
+        size_t offset;          //bytes already written
+    };
+
+    struct Connection {
+        int fd;
+        std::vector<uint8_t> input;
+        size_t inputStart;          //first unparsed byte
+        std::deque<std::string> owned; //response bytes built for this connection, in segment order
+        std::deque<Segment> segments;
+        size_t pendingBytes;
+        uint32_t interest;          //epoll events currently registered
+        bool closing;               //close once the responses are written
+    };
+
+    void run();
+    void accept();
+    bool readable(Connection& c);   //false when the connection should be closed now
+    bool writable(Connection& c);
+    void parse(Connection& c);
+    //handles the request at the start of data; returns its size, 0 if incomplete
+    size_t handleBinary(Connection& c, const uint8_t* data, size_t length);
+    size_t handleText(Connection& c, const uint8_t* data, size_t length);
+    const BlockPow* findHash(const uint8_t* digest);
+    void respondBlock(Connection& c, QueryProtocol protocol, const BlockPow* block);
+    void respondTip(Connection& c, QueryProtocol protocol);
+    void respondValid(Connection& c, QueryProtocol protocol, uint64_t first, uint64_t last);
+    void respondError(Connection& c, QueryProtocol protocol, QueryStatus status);
+    void appendOwned(Connection& c, const char* data, size_t length);
+    void appendExternal(Connection& c, const char* data, size_t length);
+    bool flush(Connection& c);      //false on a write error
+    void updateInterest(Connection& c);
+    void closeConnection(int fd);
+
+    const BlockchainPow& chain;
+    ChainSnapshot snapshot;         //refreshed once per event batch
+    std::unordered_map<std::string, size_t> heights; //hash digest -> height, for indexed blocks
+    size_t indexed;                 //blocks [0, indexed) are in heights
+    std::unordered_map<int, Connection> connections;
+    int listenFd;
+    int epollFd;
+    int wakeFd;                     //eventfd, signalled by stop()
+    uint16_t boundPort;
+    std::thread worker;
+    std::atomic<size_t> accepted;
+    std::atomic<uint64_t> requests;
+    std::atomic<uint64_t> errors;
+    std::atomic<uint64_t> bytesSent;
+    std::atomic<uint64_t> writes;
+    std::atomic<uint64_t> zeroCopyBytes;
+};
+
+struct QueryResponse {
+    QueryStatus status;
+    std::unique_ptr<BlockPow> block;    //getBlock, when decoded
+    uint64_t height;                    //getTip
+    std::string hash;                   //getTip, hex
+    bool valid;                         //validateRange
+    size_t bytes;                       //response size on the wire
+};
+
+/**
+ * Blocking client. The queue* calls only buffer requests; send() writes
+ * them all at once and receive() reads the responses in the same order,
+ * so any number of requests can be in flight.
+ */
+class QueryClient {
+public:
+    QueryClient(uint16_t port, QueryProtocol protocol); //connects to 127.0.0.1:port
+    ~QueryClient();
+
+    QueryClient(const QueryClient&) = delete;
+    QueryClient& operator=(const QueryClient&) = delete;
+
+    void queueGetBlock(uint64_t height);
+    void queueGetBlock(const std::string& hash); //hex
+    void queueGetTip();
+    void queueValidateRange(uint64_t first, uint64_t last);
+    void send();
+    //the next response; blocks are decoded only if decodeBlock, false if the connection failed
+    bool receive(QueryResponse& response, bool decodeBlock = true);
+    size_t outstanding() const { return kinds.size(); }
+
+    //one request per round trip; null / false / -1 on errors
+    std::unique_ptr<BlockPow> getBlock(uint64_t height);
+    std::unique_ptr<BlockPow> getBlock(const std::string& hash);
+    bool getTip(uint64_t& height, std::string& hash);
+    int validateRange(uint64_t first, uint64_t last); //1 valid, 0 invalid
+
+private:
+    bool fill(); //reads at least one more byte
+    bool receiveBinary(uint8_t kind, QueryResponse& response, bool decodeBlock);
+    bool receiveText(uint8_t kind, QueryResponse& response, bool decodeBlock);
+
+    int fd;
+    QueryProtocol protocol;
+    std::string out;
+    std::vector<uint8_t> in;
+    size_t inStart;
+    std::deque<uint8_t> kinds;  //opcodes of the requests still waiting for a response
+};
+
+struct QueryLoadConfig {
+    size_t connections;
+    size_t pipeline;            //requests in flight per connection
+    int millis;                 //measured duration
+    QueryProtocol protocol;
+    unsigned hashPercent;       //getBlock(hash) share, the rest of the mix is getBlock(height)
+    unsigned tipPercent;        //getTip share
+    unsigned validatePercent;   //validateRange share
+    size_t validateSpan;        //blocks per validateRange, at most QUERY_MAX_VALIDATE_BLOCKS
+    uint64_t seed;
+};
+
+QueryLoadConfig defaultQueryLoadConfig();
+
+struct QueryLoadStats {
+    uint64_t requests;
+    uint64_t errors;            //non-OK or missing responses
+    uint64_t bytes;             //response bytes received
+    double seconds;
+    double requestsPerSecond;
+    double batchP50Micros;      //round trip of one pipelined batch
+    double batchP99Micros;
+};
+
+//load generator: config.connections client threads sending random pipelined queries to port
+QueryLoadStats runQueryLoad(uint16_t port, const QueryLoadConfig& config);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef RADIUS2_AUTOMATON_H
+#define RADIUS2_AUTOMATON_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * One-dimensional cellular automaton with a 5-cell neighborhood (radius 2)
+ * and a 32-bit rule number: the new value of a cell is bit
+ * (l2 << 4 | l1 << 3 | c << 2 | r1 << 1 | r2) of the rule, with l2 the
+ * cell two to the left, as with elementary rules.
+ *
+ * Cells are bit-packed 64 per word (cell i is bit i % 64 of word i / 64)
+ * and a generation is computed 64 cells at a time with word shifts and a
+ * multiplexer tree over the rule's truth table. The grid wraps around and
+ * its size is rounded up to a multiple of 64.
+ */
+class Radius2Automaton {
+private:
+    std::vector<uint64_t> words;
+    std::vector<uint64_t> next_words; //scratch buffer reused by every generation
+    uint64_t truth[32];               //rule bit k as an all-zeros / all-ones mask
+    uint32_t rule;
+    size_t size;
+public:
+    Radius2Automaton(size_t grid_size, uint32_t rule_number);
+    void init_packed(const std::vector<uint64_t>& packed); //size() / 64 words
+    void absorb(const uint64_t* block, size_t count); //XOR count words into the first words of the state
+    void evolve(); //evolve one generation
+    void evolve_steps(size_t steps);
+    const std::vector<uint64_t>& get_words() const;
+    int get_cell(size_t index) const;
+    size_t get_size() const;
+    void set_rule(uint32_t rule_number);
+    uint32_t get_rule() const;
+    std::string state_to_string() const; //get state as binary string
+};
+
+#endif
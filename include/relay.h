@@ -0,0 +1,133 @@
+/**
+ * Block relay between nodes: wire encodings and a non-blocking socket layer.
+ *
+ * Binary frames are length-prefixed: varint(body size), then a type byte
+ * and the block with integers as LEB128 varints and both hashes as raw
+ * 32-byte digests; the payload follows as varint(size) + bytes. The text
+ * encoding (one '|'-separated line per block, hex hashes, decimal fields)
+ * is the naive baseline it is measured against.
+ *
+ * RelaySender batches frames into RELAY_BATCH_BYTES writes; RelayReceiver
+ * runs an epoll loop over a listening loopback socket, parses frames as
+ * they arrive, and validates and appends every block to its own
+ * BlockchainPow (block 0 becomes the replica's genesis). The socket layer
+ * needs Linux (epoll); elsewhere it throws std::runtime_error.
+ */
+
+#ifndef RELAY_H
+#define RELAY_H
+
+#include "block_pow.h"
+#include "blockchain_pow.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+//bytes of frames collected before one send
+const size_t RELAY_BATCH_BYTES = 64 * 1024;
+//largest frame a receiver accepts
+const size_t RELAY_MAX_FRAME_BYTES = 16 * 1024 * 1024;
+//most automaton steps a received block may ask a verifier to run per hash
+const uint64_t RELAY_MAX_STEPS = 4096;
+const uint8_t RELAY_MSG_BLOCK = 1;
+
+enum RelayEncoding {
+    RELAY_BINARY,   //length-prefixed frames, varints, 32-byte digests
+    RELAY_TEXT      //one text line per block, hex hashes
+};
+
+enum FrameStatus {
+    FRAME_OK,
+    FRAME_INCOMPLETE,   //more bytes needed
+    FRAME_MALFORMED
+};
+
+void putVarint(uint64_t value, std::string& out);
+//reads a varint at *pos, advancing it; false if truncated or longer than 10 bytes
+bool getVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value);
+//parses a decimal field of a text line; false unless it is all digits (no sign or spaces) and fits 64 bits
+bool parseNumber(const std::string& text, uint64_t& value);
+
+//appends one frame / line for the block
+void encodeBlockFrame(const BlockPow& block, std::string& out);
+void encodeBlockText(const BlockPow& block, std::string& out); //std::invalid_argument if the data has a '\n'
+//append everything before the payload, so it can be sent from the block itself:
+//frame = header + data, line = header + data + '\n'
+void encodeBlockFrameHeader(const BlockPow& block, std::string& out);
+void encodeBlockTextHeader(const BlockPow& block, std::string& out);
+//parses the frame / line at the start of data; consumed is set on FRAME_OK
+FrameStatus decodeBlockFrame(const uint8_t* data, size_t length, size_t& consumed,
+                             std::unique_ptr<BlockPow>& block);
+FrameStatus decodeBlockText(const uint8_t* data, size_t length, size_t& consumed,
+                            std::unique_ptr<BlockPow>& block);
+
+//loopback socket helpers shared with the query server (Linux only, std::runtime_error on failure)
+void setNonBlocking(int fd);
+void addToEpoll(int epollFd, int fd, uint32_t events);
+int listenLoopback(uint16_t port, uint16_t& boundPort); //non-blocking listener, port 0 = any free port
+int connectLoopback(uint16_t port);                     //blocking, TCP_NODELAY
+
+struct RelayStats {
+    size_t blocks;          //blocks sent / accepted
+    size_t rejected;        //received blocks that failed validation
+    uint64_t bytes;         //bytes on the wire
+    size_t writes;          //send() calls / reads
+    double seconds;         //first byte to last block
+};
+
+class RelaySender {
+public:
+    RelaySender(uint16_t port, RelayEncoding encoding); //connects to 127.0.0.1:port
+    ~RelaySender();
+
+    RelaySender(const RelaySender&) = delete;
+    RelaySender& operator=(const RelaySender&) = delete;
+
+    //sends blocks [first, snapshot.size()) in batches
+    void sendChain(const ChainSnapshot& snapshot, size_t first = 0);
+    void close(); //flushes and shuts the connection down
+    const RelayStats& stats() const { return totals; }
+
+private:
+    void flush();
+
+    int fd;
+    int epollFd;
+    RelayEncoding encoding;
+    std::string pending;
+    RelayStats totals;
+};
+
+class RelayReceiver {
+public:
+    //listens on 127.0.0.1:port (0 = any free port, see port())
+    RelayReceiver(uint16_t port, RelayEncoding encoding);
+    ~RelayReceiver();
+
+    RelayReceiver(const RelayReceiver&) = delete;
+    RelayReceiver& operator=(const RelayReceiver&) = delete;
+
+    uint16_t port() const { return boundPort; }
+    //serves connections until the sender closes or timeoutMillis passes without data
+    bool run(int timeoutMillis = 5000);
+    BlockchainPow* chain() const { return replica.get(); } //null until a genesis arrived
+    void setCheckpoints(std::vector<Checkpoint> trusted) { checkpoints = std::move(trusted); } //for the replica
+    const RelayStats& stats() const { return totals; }
+
+private:
+    size_t consume(const uint8_t* data, size_t length); //parses whole frames, returns bytes used
+
+    int listenFd;
+    int epollFd;
+    uint16_t boundPort;
+    RelayEncoding encoding;
+    std::unique_ptr<BlockchainPow> replica;
+    std::vector<Checkpoint> checkpoints;
+    RelayStats totals;
+    bool malformed;
+};
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * Rule x steps parameter sweep for AC_HASH.
+ *
+ * Every (rule, steps) combination is measured with the hash_quality
+ * engine: ns/hash, avalanche flip fraction and bit balance. Combinations
+ * run concurrently on the shared ThreadPool, each one on a single thread,
+ * so ns/hash is a per-core cost. From the results the sweep derives
+ *   - for each rule, the fewest steps that meet the quality bar (balanced
+ *     output, avalanche near 1/2, and an avalanche matrix that is not
+ *     made of always / never flipped cells as with affine rules like 60)
+ *   - the speed/quality Pareto frontier: configurations for which no other
+ *     one is both faster and closer to ideal avalanche
+ */
+
+#ifndef RULE_SWEEP_H
+#define RULE_SWEEP_H
+
+#include "hash_quality.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct SweepConfig {
+    std::vector<uint32_t> rules;
+    std::vector<size_t> steps;
+    size_t samples;             //random inputs per combination (bit balance)
+    size_t avalanche_inputs;    //inputs flipped at every bit per combination
+    size_t input_bytes;
+    double avalanche_tolerance; //max |flip fraction - 0.5|, CI included
+    double balance_tolerance;   //max |ones fraction - 0.5|, CI included
+    double max_deterministic;   //max fraction of avalanche cells always / never flipped
+    uint64_t seed;
+};
+
+struct SweepPoint {
+    uint32_t rule;
+    size_t steps;
+    double ns_per_hash;
+    Estimate avalanche;
+    Estimate ones_fraction;
+    double sac_bias_max;
+    double sac_deterministic;
+    bool meets_bar;
+
+    double avalanche_error() const; //|avalanche - 0.5|
+};
+
+//rules 0-255 and steps {8, 16, 32, 64, 128}, small samples
+SweepConfig default_sweep_config();
+
+//measures every rule x steps combination, ordered by rule then steps
+std::vector<SweepPoint> sweep_rules(const SweepConfig& config);
+
+//for each rule, the point with the fewest steps that meets the bar
+std::vector<SweepPoint> cheapest_passing(const std::vector<SweepPoint>& points);
+
+//non-dominated points in (ns/hash, avalanche error), fastest first
+std::vector<SweepPoint> pareto_frontier(const std::vector<SweepPoint>& points);
+
+std::string sweep_to_csv(const std::vector<SweepPoint>& points);
+std::string sweep_to_json(const std::vector<SweepPoint>& points, const std::vector<SweepPoint>& cheapest,
+                          const std::vector<SweepPoint>& frontier);
+
+#endif
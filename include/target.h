@@ -0,0 +1,83 @@
+/**
+ * 256-bit proof-of-work targets and difficulty retargeting.
+ *
+ * A hash meets a target when, read as a 256-bit big-endian number, it is
+ * less than or equal to the target. Targets are stored in compact form:
+ * target + 1 = mantissa * 2^exponent with a 24-bit mantissa, packed as
+ * (exponent << 24) | mantissa. This represents every power of two exactly,
+ * so "n leading zero bits" targets (and the legacy "d leading '0' hex
+ * characters" difficulty, which is 4d zero bits) round-trip without loss,
+ * while still allowing fine-grained steps in between.
+ */
+
+#ifndef TARGET_H
+#define TARGET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+
+class Target {
+private:
+    uint32_t mantissa;
+    uint32_t exponent;
+    uint8_t bytes[32];  //the threshold itself, big-endian
+    int zeroBits;       //n if the target is exactly 2^(256-n) - 1, else -1
+
+    Target(uint64_t m, int e);
+    void normalize(uint64_t m, int e);
+
+public:
+    Target(); //easiest target: every hash meets it
+
+    static Target fromLeadingZeroBits(unsigned bits);
+    static Target fromNibbles(int difficulty); //legacy difficulty (leading '0' hex characters)
+    static Target fromCompact(uint32_t compact);
+    uint32_t toCompact() const;
+
+    //true if the 64-character hex hash is <= the target
+    bool isMetBy(const std::string& hexHash) const;
+    //true if the 32-byte digest is <= the target
+    bool isMetBy(const uint8_t* digest) const;
+
+    double expectedHashes() const; //average attempts to find a valid nonce
+    double difficultyBits() const; //log2(expectedHashes), i.e. equivalent leading zero bits
+    Target scaled(double factor) const; //target + 1 multiplied by factor (easier if > 1)
+    std::string toHex() const;
+
+    bool isEasierThan(const Target& other) const;   //more hashes meet this target than other
+    bool operator==(const Target& other) const;
+    bool operator!=(const Target& other) const;
+};
+
+/**
+ * Adjusts the target so blocks take a configured time to mine. It keeps a
+ * moving window of (measured time, expected hashes) per block, estimates
+ * the hash rate from it and picks the target whose expected work takes one
+ * block interval at that rate, bounded per adjustment. Because the rate is
+ * measured rather than assumed, the interval holds when thread counts or
+ * hash modes change.
+ */
+class RetargetController {
+private:
+    double blockMillis;         //configured block interval, 0 = disabled
+    size_t window;              //number of recent blocks averaged
+    double maxAdjustment;       //largest factor applied in one retarget
+    std::deque<std::pair<double, double>> samples; //recent (ms, expected hashes)
+
+public:
+    RetargetController();
+    RetargetController(double targetBlockMillis, size_t windowSize = 8, double maxFactor = 4.0);
+
+    bool enabled() const;
+    double getBlockMillis() const;
+    void record(double millis, const Target& target); //last block's time and target
+    Target retarget(const Target& current) const;     //next target from the window
+    double averageMillis() const;
+    double hashesPerMilli() const;                    //measured rate over the window
+    void reset();
+};
+
+#endif
@@ -0,0 +1,83 @@
+/**
+ * Persistent work-stealing thread pool shared by mining, validation and
+ * the analysis tests.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+enum PinningMode {
+    NO_PINNING,     //let the OS scheduler place workers
+    PIN_COMPACT,    //worker i pinned to CPU i (mod hardware threads)
+    PIN_PER_NODE    //workers spread round-robin over NUMA nodes, pinned to their node's CPUs
+};
+
+class ThreadPool {
+public:
+    //num_threads = 0 uses all hardware threads
+    explicit ThreadPool(size_t num_threads = 0, PinningMode pinning = NO_PINNING);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //run a task on the pool, the future holds its result (or exception)
+    template<typename F>
+    std::future<typename std::result_of<F()>::type> submit(F func);
+
+    //run body(i) for every i in [begin, end), the calling thread helps until done
+    void parallel_for(size_t begin, size_t end, const std::function<void(size_t)>& body,
+                      size_t grain = 0);
+
+    size_t size() const;
+    PinningMode get_pinning() const;
+    int worker_node(size_t index) const; //NUMA node a worker is placed on
+
+    static ThreadPool& instance(); //library-wide pool (all hardware threads, per-node on NUMA hosts)
+    static int current_worker(); //index of the calling worker, -1 outside the pool
+
+private:
+    struct Worker {
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::thread thread;
+    };
+
+    void push(std::function<void()> task);
+    bool try_pop(size_t self, std::function<void()>& task);
+    bool run_pending_task(); //run one queued task on the calling thread, if any
+    void worker_loop(size_t index);
+    void pin_worker(size_t index);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    PinningMode pinning;
+    std::atomic<size_t> pending;
+    std::atomic<size_t> next_queue;
+    std::atomic<bool> stopping;
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+};
+
+template<typename F>
+std::future<typename std::result_of<F()>::type> ThreadPool::submit(F func) {
+    typedef typename std::result_of<F()>::type R;
+    std::shared_ptr<std::packaged_task<R()>> task =
+        std::make_shared<std::packaged_task<R()>>(std::move(func));
+    std::future<R> result = task->get_future();
+    push([task]() { (*task)(); });
+    return result;
+}
+
+#endif
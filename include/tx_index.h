@@ -0,0 +1,64 @@
+/**
+ * Finding the blocks that hold a transaction.
+ *
+ * scanTransaction is the baseline: it splits every block's payload.
+ * filterTransaction asks each block's Bloom filter first and only reads
+ * the payloads of the blocks it cannot rule out. TransactionIndex stores
+ * the filters bit-sliced, 64 blocks per group: for each filter bit there
+ * is one column of 64-bit words, word g holding that bit for blocks
+ * 64g .. 64g+63. A query computes its bit positions once and ANDs its
+ * columns word by word, so every word operation tests 64 blocks and the
+ * loop over a column's contiguous words is vectorized by the compiler;
+ * the set bits that survive are the candidate blocks.
+ */
+
+#ifndef TX_INDEX_H
+#define TX_INDEX_H
+
+#include "blockchain_pow.h"
+#include "bloom_filter.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//blocks per bit-sliced group, one per bit of a column word
+const size_t TX_INDEX_GROUP_BLOCKS = 64;
+//column words ANDed per pass, sized to stay in L1
+const size_t TX_INDEX_CHUNK_WORDS = 512;
+
+struct TxSearchResult {
+    std::vector<size_t> heights;    //blocks holding the transaction, ascending
+    size_t candidates;              //payloads read to confirm (filter hits, or every block for a scan)
+};
+
+TxSearchResult scanTransaction(const ChainSnapshot& snapshot, const std::string& tx);
+TxSearchResult filterTransaction(const ChainSnapshot& snapshot, const std::string& tx);
+
+/**
+ * Incremental bit-sliced index over the filters of one chain. Not thread
+ * safe: one owner updates and searches it, with snapshots of a chain that
+ * only grows. Blocks past the last complete group are tested through
+ * their own filters, as are blocks whose filter has another geometry
+ * (the chain's false-positive rate was changed).
+ */
+class TransactionIndex {
+public:
+    explicit TransactionIndex(const BloomGeometry& geometry = defaultBloomGeometry());
+
+    void update(const ChainSnapshot& snapshot);     //indexes the complete groups not indexed yet
+    TxSearchResult find(const ChainSnapshot& snapshot, const std::string& tx); //update, then search
+
+    const BloomGeometry& geometry() const { return shape; }
+    size_t indexedBlocks() const { return groups * TX_INDEX_GROUP_BLOCKS; }
+    size_t memoryBytes() const;     //column storage
+
+private:
+    BloomGeometry shape;
+    std::vector<std::vector<uint64_t>> columns; //[bit][group]
+    std::vector<size_t> loose;      //indexed heights whose filter has another geometry
+    size_t groups;
+    std::vector<uint64_t> scratch;  //AND accumulator, TX_INDEX_CHUNK_WORDS words
+};
+
+#endif
@@ -9,13 +9,24 @@
 
 enum HashMode {
     SHA256_MODE,
-    AC_HASH_MODE
+    AC_HASH_MODE,
+    AC_HASH_R2_MODE,     //radius-2 automaton, 32-bit rules (see ac_hash_r2)
+    AC_HASH_SPONGE_MODE  //fixed-width radius-2 sponge, steps = rounds per chunk (see ac_hash_sponge)
 };
 
+const size_t DIGEST_SIZE = 32; //bytes in a SHA-256 / AC_HASH digest
+
 std::string sha256(const std::string& input);
+std::string sha256(const uint8_t* input, size_t length);
+void sha256Digest(const uint8_t* input, size_t length, uint8_t* digest);
 std::string ac_hash(const std::string& input, uint32_t rule, size_t steps);
 std::string getCurrentTime();
 
+std::string digestToHex(const uint8_t* digest);
+bool hexToDigest(const std::string& hex, uint8_t* digest);
+uint64_t currentTimestampMillis();
+std::string formatTimestamp(uint64_t millis);
+
 // Template must be defined in header. Return microseconds for better granularity.
 template<typename F>
 long long measureTime(F func) {
@@ -25,13 +36,35 @@ long long measureTime(F func) {
     return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
 }
 
+//block data is transactions each followed by ';': calls f(begin, length) for each one (and a
+//trailing unterminated one) until f returns false
+template<typename F>
+void forEachTransaction(const std::string& data, F f) {
+    size_t start = 0;
+    while (start < data.size()) {
+        size_t end = data.find(';', start);
+        if (end == std::string::npos) {
+            end = data.size();
+        }
+        if (!f(data.data() + start, end - start)) {
+            return;
+        }
+        start = end + 1;
+    }
+}
+
 // Helper to convert microseconds to milliseconds (rounded)
 inline long long microsToMillis(long long micros) {
     return (micros + 500) / 1000;
 }
 
 inline std::string hashModeToString(HashMode mode){
-    return (mode == SHA256_MODE) ? "SHA-256" : "AC HASH";
+    switch (mode) {
+        case SHA256_MODE: return "SHA-256";
+        case AC_HASH_R2_MODE: return "AC HASH R2";
+        case AC_HASH_SPONGE_MODE: return "AC HASH SPONGE";
+        default: return "AC HASH";
+    }
 }
 
 #endif
\ No newline at end of file
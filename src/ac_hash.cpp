@@ -1,5 +1,7 @@
 #include "ac_hash.h"
+#include "ac_hash_fixed.h"
 #include "cellular_automaton.h"
+#include "instrumentation.h"
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
@@ -112,31 +114,433 @@ std::vector<int> extract_hash_bits(const std::vector<int>& state,
  * @return a 256-bit hash of the input string as a hexadecimal string
  */
 std::string ac_hash(const std::string& input, uint32_t rule, size_t steps) {
-    
-    std::vector<int> input_bits = string_to_bits(input);
+    AcHashWorkspace workspace;
+    return ac_hash(input, rule, steps, workspace);
+}
+
+/**
+ * Same as ac_hash(input, rule, steps), but reuses the buffers of the given
+ * workspace (input bits, automaton, history snapshots) so repeated calls
+ * with the same parameters do not allocate. The workspace must not be
+ * shared between threads.
+ * 
+ * @param input the string to be hashed
+ * @param rule the rule number of the cellular automaton to use
+ * @param steps the number of steps to run the automaton for
+ * @param workspace buffers kept between calls
+ * @return a 256-bit hash of the input string as a hexadecimal string
+ */
+std::string ac_hash(const std::string& input, uint32_t rule, size_t steps,
+                    AcHashWorkspace& workspace) {
+    return ac_hash(reinterpret_cast<const uint8_t*>(input.data()), input.size(), rule, steps, workspace);
+}
+
+/**
+ * Runs the automaton over the input bits and folds state + history into
+ * the 256 hash bits. Shared by the hex and binary variants.
+ */
+static std::vector<int> compute_hash_bits(const uint8_t* input, size_t length, uint32_t rule,
+                                          size_t steps, AcHashWorkspace& workspace) {
+    std::vector<int>& input_bits = workspace.input_bits;
+    input_bits.clear();
+    for (size_t b = 0; b < length; b++) {
+        for (int i = 7; i >= 0; i--) {
+            input_bits.push_back((input[b] >> i) & 1);
+        }
+    }
     
     size_t ca_size = std::max(size_t(256), input_bits.size());
 
     while (input_bits.size() < ca_size) {
         input_bits.push_back(input_bits.size() % 2);
     }
-    CellularAutomaton ca(ca_size, rule);
+    if (!workspace.ca || workspace.ca->get_size() != ca_size) {
+        workspace.ca.reset(new CellularAutomaton(ca_size, rule));
+    } else {
+        workspace.ca->set_rule(rule);
+    }
+    CellularAutomaton& ca = *workspace.ca;
     ca.init_state(input_bits);
-    
-    std::vector<std::vector<int>> history;
-    history.push_back(ca.get_state());
-    
-    for (size_t i = 0; i < steps; i++) {
-        ca.evolve();
-        if (i % (steps / 16 + 1) == 0) {
-            history.push_back(ca.get_state());
+
+    //snapshot after generations 1, 1 + interval, 1 + 2*interval, ...
+    //jumping straight between them lets additive rules fast-forward
+    size_t interval = steps / 16 + 1;
+    size_t snapshots = 2 + (steps + interval - 1) / interval;
+    std::vector<std::vector<int>>& history = workspace.history;
+    history.resize(snapshots);
+
+    {
+        PROFILE_SCOPE(STAGE_CA_EVOLUTION);
+        size_t h = 0;
+        ca.copy_state(history[h++]);
+        size_t generation = 0;
+        for (size_t i = 0; i < steps; i += interval) {
+            ca.evolve_steps(i + 1 - generation);
+            generation = i + 1;
+            ca.copy_state(history[h++]);
         }
+        ca.evolve_steps(steps - generation);
+        ca.copy_state(history[h++]);
     }
     
-    std::vector<int> final_state = ca.get_state();
-    history.push_back(final_state);
-    
-    std::vector<int> hash_bits = extract_hash_bits(final_state, history);
-    
+    PROFILE_SCOPE(STAGE_HISTORY_FOLD);
+    return extract_hash_bits(history.back(), history);
+}
+
+/**
+ * Byte-buffer variant of ac_hash, used for binary block headers. Hashing
+ * the bytes of a string gives the same result as hashing the string.
+ * 
+ * @param input the bytes to be hashed
+ * @param length number of bytes
+ * @param rule the rule number of the cellular automaton to use
+ * @param steps the number of steps to run the automaton for
+ * @param workspace buffers kept between calls
+ * @return a 256-bit hash of the input as a hexadecimal string
+ */
+std::string ac_hash(const uint8_t* input, size_t length, uint32_t rule, size_t steps,
+                    AcHashWorkspace& workspace) {
+    uint8_t digest[32];
+    if (ac_hash_fixed_dispatch(input, length, rule, steps, digest)) {
+        PROFILE_SCOPE(STAGE_HEX_ENCODE);
+        return digest_to_hex(digest);
+    }
+    std::vector<int> hash_bits = compute_hash_bits(input, length, rule, steps, workspace);
+    PROFILE_SCOPE(STAGE_HEX_ENCODE);
     return bits_to_hex(hash_bits);
-}
\ No newline at end of file
+}
+
+/**
+ * Binary variant of ac_hash: writes the 256-bit hash as 32 bytes, most
+ * significant bit first (the bytes of the hex string, without the hex).
+ * Used by the statistical analysis, which tallies bits with popcount.
+ * 
+ * @param input the bytes to be hashed
+ * @param length number of bytes
+ * @param rule the rule number of the cellular automaton to use
+ * @param steps the number of steps to run the automaton for
+ * @param workspace buffers kept between calls
+ * @param digest receives 32 bytes
+ */
+void ac_hash_digest(const uint8_t* input, size_t length, uint32_t rule, size_t steps,
+                    AcHashWorkspace& workspace, uint8_t* digest) {
+    if (!ac_hash_fixed_dispatch(input, length, rule, steps, digest)) {
+        ac_hash_generic_digest(input, length, rule, steps, workspace, digest);
+    }
+}
+
+/**
+ * ac_hash_digest without the fixed-configuration dispatch: always runs the
+ * CellularAutomaton path. Reference for the specializations in tests and
+ * benchmarks.
+ * 
+ * @param input the bytes to be hashed
+ * @param length number of bytes
+ * @param rule the rule number of the cellular automaton to use
+ * @param steps the number of steps to run the automaton for
+ * @param workspace buffers kept between calls
+ * @param digest receives 32 bytes
+ */
+void ac_hash_generic_digest(const uint8_t* input, size_t length, uint32_t rule, size_t steps,
+                            AcHashWorkspace& workspace, uint8_t* digest) {
+    std::vector<int> hash_bits = compute_hash_bits(input, length, rule, steps, workspace);
+    for (size_t i = 0; i < 32; i++) {
+        uint8_t byte = 0;
+        for (size_t j = 0; j < 8; j++) {
+            byte = static_cast<uint8_t>((byte << 1) | hash_bits[8 * i + j]);
+        }
+        digest[i] = byte;
+    }
+}
+
+//hash ^= folded (256 bits, bit k in word k / 64) rotated by `rotation` positions towards higher bits
+void accumulate_folded(uint64_t* hash, const uint64_t* folded, size_t rotation) {
+    size_t q = rotation / 64;
+    size_t s = rotation % 64;
+    for (size_t w = 0; w < 4; w++) {
+        uint64_t low = folded[(w + 4 - q) % 4];
+        uint64_t high = folded[(w + 3 - q) % 4];
+        hash[w] ^= s == 0 ? low : (low << s) | (high >> (64 - s));
+    }
+}
+
+//writes hash bit k as bit 7 - k % 8 of byte k / 8
+void hash_words_to_digest(const uint64_t* hash, uint8_t* digest) {
+    for (size_t i = 0; i < 32; i++) {
+        uint8_t byte = 0;
+        for (size_t j = 0; j < 8; j++) {
+            size_t k = 8 * i + j;
+            byte = static_cast<uint8_t>((byte << 1) | ((hash[k / 64] >> (k % 64)) & 1));
+        }
+        digest[i] = byte;
+    }
+}
+
+std::string digest_to_hex(const uint8_t* digest) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(64, '0');
+    for (size_t i = 0; i < 32; i++) {
+        hex[2 * i] = digits[digest[i] >> 4];
+        hex[2 * i + 1] = digits[digest[i] & 0xF];
+    }
+    return hex;
+}
+
+/**
+ * Runs the compile-time specialized ac_hash when (rule, steps, automaton
+ * width) is one of the production configurations: rule 30 / 128 steps on
+ * inputs up to 32 bytes (256 cells) and on the 100- and 112-byte block
+ * headers (800 and 896 cells).
+ * 
+ * @param input the bytes to be hashed
+ * @param length number of bytes
+ * @param rule the rule number of the cellular automaton to use
+ * @param steps the number of steps to run the automaton for
+ * @param digest receives 32 bytes when a specialization ran
+ * @return false if the generic path has to be used
+ */
+bool ac_hash_fixed_dispatch(const uint8_t* input, size_t length, uint32_t rule, size_t steps, uint8_t* digest) {
+    if (rule != 30 || steps != 128) {
+        return false;
+    }
+    PROFILE_SCOPE(STAGE_CA_EVOLUTION);
+    switch (std::max(size_t(256), length * 8)) {
+        case 256:
+            ac_hash_fixed_digest<30, 128, 256>(input, length, digest);
+            return true;
+        case 800:
+            ac_hash_fixed_digest<30, 128, 800>(input, length, digest);
+            return true;
+        case 896:
+            ac_hash_fixed_digest<30, 128, 896>(input, length, digest);
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Radius-2 variant of compute_hash_bits, on bit-packed words. The input
+ * bits (most significant bit of each byte first) fill cells 0, 1, ...,
+ * the rest is padded with alternating bits as in ac_hash, up to at least
+ * 256 cells rounded to a whole word. The 256 hash bits are the final state
+ * folded modulo 256, XORed with every snapshot folded and rotated by 7
+ * positions per snapshot, the same sampling as extract_hash_bits.
+ * Hash bit k is bit k % 64 of words[k / 64].
+ */
+static void compute_hash_words_r2(const uint8_t* input, size_t length, uint32_t rule, size_t steps,
+                                  AcHashWorkspace& workspace, uint64_t* hash) {
+    size_t input_bits = length * 8;
+    size_t ca_size = (std::max(size_t(256), input_bits) + 63) / 64 * 64;
+    std::vector<uint64_t>& packed = workspace.packed_input;
+    packed.assign(ca_size / 64, 0);
+    for (size_t i = 0; i < ca_size; i++) {
+        int bit = i < input_bits ? (input[i / 8] >> (7 - i % 8)) & 1 : static_cast<int>(i % 2);
+        packed[i / 64] |= static_cast<uint64_t>(bit) << (i % 64);
+    }
+    if (!workspace.ca_r2 || workspace.ca_r2->get_size() != ca_size) {
+        workspace.ca_r2.reset(new Radius2Automaton(ca_size, rule));
+    } else {
+        workspace.ca_r2->set_rule(rule);
+    }
+    Radius2Automaton& ca = *workspace.ca_r2;
+    ca.init_packed(packed);
+
+    //fold the state into 256 bits, rotate by 7 * snapshot and accumulate
+    for (size_t w = 0; w < 4; w++) {
+        hash[w] = 0;
+    }
+    size_t snapshot = 0;
+    auto accumulate = [&](size_t rotation) {
+        PROFILE_SCOPE(STAGE_HISTORY_FOLD);
+        uint64_t folded[4] = {0, 0, 0, 0};
+        const std::vector<uint64_t>& words = ca.get_words();
+        for (size_t w = 0; w < words.size(); w++) {
+            folded[w % 4] ^= words[w];
+        }
+        accumulate_folded(hash, folded, rotation);
+    };
+
+    size_t interval = steps / 16 + 1;
+    accumulate(0);
+    snapshot++;
+    size_t generation = 0;
+    for (size_t i = 0; i < steps; i += interval) {
+        {
+            PROFILE_SCOPE(STAGE_CA_EVOLUTION);
+            ca.evolve_steps(i + 1 - generation);
+        }
+        generation = i + 1;
+        accumulate((snapshot++ * 7) % 256);
+    }
+    {
+        PROFILE_SCOPE(STAGE_CA_EVOLUTION);
+        ca.evolve_steps(steps - generation);
+    }
+    accumulate((snapshot * 7) % 256);
+    accumulate(0); //the final state itself, as extract_hash_bits starts from it
+}
+
+/**
+ * Computes a hash of the given input string with a radius-2 (5-cell
+ * neighborhood) cellular automaton, see ac_hash_r2 below.
+ * 
+ * @param input the string to be hashed
+ * @param rule the 32-bit radius-2 rule number
+ * @param steps the number of steps to run the automaton for
+ * @return a 256-bit hash of the input string as a hexadecimal string
+ */
+std::string ac_hash_r2(const std::string& input, uint32_t rule, size_t steps) {
+    AcHashWorkspace workspace;
+    return ac_hash_r2(reinterpret_cast<const uint8_t*>(input.data()), input.size(), rule, steps, workspace);
+}
+
+/**
+ * Radius-2 variant of ac_hash. Information spreads two cells per
+ * generation instead of one, so the state is mixed in about half the
+ * steps, and a generation costs a few word operations per 64 cells.
+ * 
+ * @param input the bytes to be hashed
+ * @param length number of bytes
+ * @param rule the 32-bit radius-2 rule number
+ * @param steps the number of steps to run the automaton for
+ * @param workspace buffers kept between calls
+ * @return a 256-bit hash of the input as a hexadecimal string
+ */
+std::string ac_hash_r2(const uint8_t* input, size_t length, uint32_t rule, size_t steps,
+                       AcHashWorkspace& workspace) {
+    uint64_t hash[4];
+    compute_hash_words_r2(input, length, rule, steps, workspace, hash);
+    uint8_t digest[32];
+    hash_words_to_digest(hash, digest);
+    PROFILE_SCOPE(STAGE_HEX_ENCODE);
+    return digest_to_hex(digest);
+}
+
+/**
+ * Binary variant of ac_hash_r2, same layout as ac_hash_digest.
+ * 
+ * @param input the bytes to be hashed
+ * @param length number of bytes
+ * @param rule the 32-bit radius-2 rule number
+ * @param steps the number of steps to run the automaton for
+ * @param workspace buffers kept between calls
+ * @param digest receives 32 bytes
+ */
+void ac_hash_r2_digest(const uint8_t* input, size_t length, uint32_t rule, size_t steps,
+                       AcHashWorkspace& workspace, uint8_t* digest) {
+    uint64_t hash[4];
+    compute_hash_words_r2(input, length, rule, steps, workspace, hash);
+    hash_words_to_digest(hash, digest);
+}
+
+/**
+ * Computes a hash of the given input string with the fixed-width sponge,
+ * see ac_hash_sponge below.
+ * 
+ * @param input the string to be hashed
+ * @param rule the 32-bit radius-2 rule number
+ * @param rounds generations between absorbed blocks
+ * @return a 256-bit hash of the input string as a hexadecimal string
+ */
+std::string ac_hash_sponge(const std::string& input, uint32_t rule, size_t rounds) {
+    AcHashWorkspace workspace;
+    return ac_hash_sponge(reinterpret_cast<const uint8_t*>(input.data()), input.size(), rule, rounds, workspace);
+}
+
+/**
+ * Sponge construction over a fixed 256-cell radius-2 automaton, for long
+ * inputs: ac_hash sizes the automaton to the input, so its cost grows
+ * with length x steps and its working set with the length, while here
+ * every 16-byte block costs the same `rounds` generations of 4 words.
+ *
+ * The state starts from a fixed irregular constant. The input, padded
+ * with a 1 bit, zeros and a final 1 bit to whole 128-bit blocks, is
+ * XORed block by block into cells 0-127 (the rate), each
+ * followed by `rounds` generations; cells 128-255 (the capacity) are
+ * never written directly. After the last block, SPONGE_FINAL_FACTOR x
+ * rounds generations spread the final block over the whole state, then
+ * the 256 hash bits are squeezed as two 128-bit rate outputs separated by
+ * `rounds` generations.
+ * 
+ * @param input the bytes to be hashed
+ * @param length number of bytes
+ * @param rule the 32-bit radius-2 rule number
+ * @param rounds generations between absorbed blocks
+ * @param workspace buffers kept between calls
+ * @return a 256-bit hash of the input as a hexadecimal string
+ */
+std::string ac_hash_sponge(const uint8_t* input, size_t length, uint32_t rule, size_t rounds,
+                           AcHashWorkspace& workspace) {
+    uint8_t digest[32];
+    ac_hash_sponge_digest(input, length, rule, rounds, workspace, digest);
+    PROFILE_SCOPE(STAGE_HEX_ENCODE);
+    return digest_to_hex(digest);
+}
+
+/**
+ * Binary variant of ac_hash_sponge, same layout as ac_hash_digest.
+ * 
+ * @param input the bytes to be hashed
+ * @param length number of bytes
+ * @param rule the 32-bit radius-2 rule number
+ * @param rounds generations between absorbed blocks
+ * @param workspace buffers kept between calls
+ * @param digest receives 32 bytes
+ */
+void ac_hash_sponge_digest(const uint8_t* input, size_t length, uint32_t rule, size_t rounds,
+                           AcHashWorkspace& workspace, uint8_t* digest) {
+    const size_t rate_bytes = SPONGE_RATE_BITS / 8;
+    const size_t rate_words = SPONGE_RATE_BITS / 64;
+    //initial state: the first SHA-512 initial hash words (any irregular constant would do; a
+    //periodic state such as alternating bits can be a fixed point of the rule, and absorbing a
+    //zero block would then leave it unchanged)
+    static const uint64_t iv[SPONGE_WIDTH / 64] = {
+        0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL
+    };
+    std::vector<uint64_t>& packed = workspace.packed_input;
+    packed.assign(iv, iv + SPONGE_WIDTH / 64);
+    if (!workspace.ca_r2 || workspace.ca_r2->get_size() != SPONGE_WIDTH) {
+        workspace.ca_r2.reset(new Radius2Automaton(SPONGE_WIDTH, rule));
+    } else {
+        workspace.ca_r2->set_rule(rule);
+    }
+    Radius2Automaton& ca = *workspace.ca_r2;
+    ca.init_packed(packed);
+
+    //whole blocks, then the padded tail (one or two blocks)
+    size_t padded = (length * 8 + 2 + SPONGE_RATE_BITS - 1) / SPONGE_RATE_BITS * rate_bytes;
+    uint64_t block[SPONGE_RATE_BITS / 64];
+    for (size_t offset = 0; offset < padded; offset += rate_bytes) {
+        std::fill(block, block + rate_words, 0);
+        for (size_t b = 0; b < rate_bytes; b++) {
+            size_t position = offset + b;
+            uint8_t byte = position < length ? input[position] : 0;
+            if (position == length) {
+                byte = 0x80; //first padding bit
+            }
+            if (position + 1 == padded) {
+                byte |= 0x01; //last padding bit
+            }
+            //bit i of the block (most significant bit of each byte first) goes to cell i
+            for (size_t j = 0; j < 8; j++) {
+                size_t cell = 8 * b + j;
+                block[cell / 64] |= static_cast<uint64_t>((byte >> (7 - j)) & 1) << (cell % 64);
+            }
+        }
+        ca.absorb(block, rate_words);
+        PROFILE_SCOPE(STAGE_CA_EVOLUTION);
+        ca.evolve_steps(offset + rate_bytes == padded ? SPONGE_FINAL_FACTOR * rounds : rounds);
+    }
+
+    uint64_t hash[4];
+    {
+        PROFILE_SCOPE(STAGE_HISTORY_FOLD);
+        hash[0] = ca.get_words()[0];
+        hash[1] = ca.get_words()[1];
+        ca.evolve_steps(rounds);
+        hash[2] = ca.get_words()[0];
+        hash[3] = ca.get_words()[1];
+    }
+    hash_words_to_digest(hash, digest);
+}
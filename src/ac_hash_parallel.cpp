@@ -0,0 +1,232 @@
+#include "ac_hash_parallel.h"
+#include "ac_hash.h"
+#include "instrumentation.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+//64 cells of the ring starting at position pos: cell pos + j is bit j
+uint64_t read_cells(const std::vector<uint64_t>& ring, size_t size, size_t pos) {
+    pos %= size;
+    if (pos + 64 <= size) {
+        size_t w = pos / 64;
+        size_t s = pos % 64;
+        uint64_t cells = ring[w] >> s;
+        if (s != 0) {
+            cells |= ring[w + 1] << (64 - s);
+        }
+        return cells;
+    }
+    uint64_t cells = 0;
+    for (size_t j = 0; j < 64; j++) {
+        size_t cell = (pos + j) % size;
+        cells |= ((ring[cell / 64] >> (cell % 64)) & 1) << j;
+    }
+    return cells;
+}
+
+/**
+ * One generation of an elementary rule over a word buffer that does not
+ * wrap (the cells beyond both ends read as 0), 64 cells per iteration.
+ * truth[k] is rule bit k as an all-zeros / all-ones mask, k = l << 2 | c << 1 | r.
+ */
+void evolve_open(std::vector<uint64_t>& words, std::vector<uint64_t>& next, const uint64_t* truth) {
+    size_t n = words.size();
+    for (size_t w = 0; w < n; w++) {
+        uint64_t prev = w == 0 ? 0 : words[w - 1];
+        uint64_t cur = words[w];
+        uint64_t after = w + 1 == n ? 0 : words[w + 1];
+        uint64_t left = (cur << 1) | (prev >> 63);
+        uint64_t right = (cur >> 1) | (after << 63);
+        uint64_t lc00 = truth[0] ^ (right & (truth[0] ^ truth[1]));
+        uint64_t lc01 = truth[2] ^ (right & (truth[2] ^ truth[3]));
+        uint64_t lc10 = truth[4] ^ (right & (truth[4] ^ truth[5]));
+        uint64_t lc11 = truth[6] ^ (right & (truth[6] ^ truth[7]));
+        uint64_t l0 = lc00 ^ (cur & (lc00 ^ lc01));
+        uint64_t l1 = lc10 ^ (cur & (lc10 ^ lc11));
+        next[w] = l0 ^ (left & (l0 ^ l1));
+    }
+    words.swap(next);
+}
+
+/**
+ * Same state, snapshots and fold as compute_hash_bits in ac_hash.cpp:
+ * cell i of the CA is bit i % 64 of ring[i / 64], snapshots are folded
+ * modulo 256 and rotated by 7 positions per snapshot, and the final state
+ * is folded in once more without rotation.
+ */
+void compute_hash_words_parallel(const uint8_t* input, size_t length, uint32_t rule, size_t steps,
+                                 ThreadPool& pool, size_t sync_steps, size_t domains, uint64_t* hash) {
+    if (sync_steps == 0) {
+        throw std::invalid_argument("sync_steps must be positive");
+    }
+    size_t input_bits = length * 8;
+    size_t size = std::max(size_t(256), input_bits);
+    size_t total_words = (size + 63) / 64;
+    uint64_t tail_mask = size % 64 == 0 ? ~0ULL : (1ULL << (size % 64)) - 1;
+
+    std::vector<uint64_t> ring(total_words, 0);
+    std::vector<uint64_t> next_ring(total_words, 0);
+    uint8_t reversed[256];
+    for (int b = 0; b < 256; b++) {
+        uint8_t r = 0;
+        for (int j = 0; j < 8; j++) {
+            r = static_cast<uint8_t>(r | (((b >> j) & 1) << (7 - j)));
+        }
+        reversed[b] = r;
+    }
+    //most significant bit of each byte first, then alternating padding up to 256 cells
+    for (size_t b = 0; b < length; b++) {
+        ring[b / 8] |= static_cast<uint64_t>(reversed[input[b]]) << (8 * (b % 8));
+    }
+    for (size_t i = input_bits; i < size; i++) {
+        ring[i / 64] |= static_cast<uint64_t>(i % 2) << (i % 64);
+    }
+
+    uint64_t truth[8];
+    for (int k = 0; k < 8; k++) {
+        truth[k] = ((rule >> k) & 1) ? ~0ULL : 0ULL;
+    }
+
+    //generations of the history snapshots, as in compute_hash_bits
+    std::vector<size_t> snapshots(1, 0);
+    size_t interval = steps / 16 + 1;
+    for (size_t i = 0; i < steps; i += interval) {
+        snapshots.push_back(i + 1);
+    }
+    snapshots.push_back(steps);
+
+    if (domains == 0) {
+        domains = std::max<size_t>(1, pool.size());
+    }
+    size_t domain_words = (total_words + domains - 1) / std::min(domains, total_words);
+    domains = (total_words + domain_words - 1) / domain_words;
+    size_t halo_words = (sync_steps + 63) / 64;
+    size_t halo_offset = (halo_words * 64) % size;
+
+    uint64_t folded[4] = {0, 0, 0, 0};
+    for (size_t w = 0; w < total_words; w++) {
+        folded[w % 4] ^= ring[w];
+    }
+    for (size_t w = 0; w < 4; w++) {
+        hash[w] = 0;
+    }
+    size_t next_snapshot = 0;
+    auto accumulate_snapshots = [&](size_t generation) {
+        PROFILE_SCOPE(STAGE_HISTORY_FOLD);
+        while (next_snapshot < snapshots.size() && snapshots[next_snapshot] == generation) {
+            accumulate_folded(hash, folded, (next_snapshot * 7) % 256);
+            next_snapshot++;
+        }
+    };
+    accumulate_snapshots(0);
+
+    std::vector<uint64_t> partial(4 * domains);
+    size_t generation = 0;
+    while (generation < steps) {
+        size_t target = snapshots[next_snapshot];
+        size_t round = std::min(sync_steps, target - generation);
+        bool at_snapshot = generation + round == target;
+        {
+            PROFILE_SCOPE(STAGE_CA_EVOLUTION);
+            pool.parallel_for(0, domains, [&](size_t d) {
+                thread_local std::vector<uint64_t> local;
+                thread_local std::vector<uint64_t> scratch;
+                size_t first = d * domain_words;
+                size_t count = std::min(domain_words, total_words - first);
+                size_t n = halo_words + count + halo_words;
+                local.resize(n);
+                scratch.resize(n);
+                //the domain's cells with halo_words words of neighbors on each side (wrapping)
+                size_t origin = (first * 64 + size - halo_offset) % size;
+                for (size_t i = 0; i < n; i++) {
+                    local[i] = read_cells(ring, size, origin + 64 * i);
+                }
+                //errors from the open ends travel one cell per generation and stay in the halos
+                for (size_t t = 0; t < round; t++) {
+                    evolve_open(local, scratch, truth);
+                }
+                uint64_t* fold = &partial[4 * d];
+                std::fill(fold, fold + 4, 0);
+                for (size_t i = 0; i < count; i++) {
+                    size_t w = first + i;
+                    uint64_t word = local[halo_words + i];
+                    if (w + 1 == total_words) {
+                        word &= tail_mask;
+                    }
+                    next_ring[w] = word;
+                    fold[w % 4] ^= word;
+                }
+            }, 1);
+        }
+        ring.swap(next_ring);
+        generation += round;
+        if (at_snapshot) {
+            std::fill(folded, folded + 4, 0);
+            for (size_t d = 0; d < domains; d++) {
+                for (size_t w = 0; w < 4; w++) {
+                    folded[w] ^= partial[4 * d + w];
+                }
+            }
+            accumulate_snapshots(generation);
+        }
+    }
+    accumulate_folded(hash, folded, 0); //the final state itself, as extract_hash_bits starts from it
+}
+
+} // namespace
+
+/**
+ * Computes ac_hash(input, rule, steps) on ThreadPool::instance().
+ *
+ * @param input the string to be hashed
+ * @param rule the rule number of the cellular automaton to use
+ * @param steps the number of steps to run the automaton for
+ * @return the same 256-bit hash as ac_hash, as a hexadecimal string
+ */
+std::string ac_hash_parallel(const std::string& input, uint32_t rule, size_t steps) {
+    return ac_hash_parallel(reinterpret_cast<const uint8_t*>(input.data()), input.size(), rule, steps,
+                            ThreadPool::instance());
+}
+
+/**
+ * Computes ac_hash over a bit-packed state split into domains that
+ * evolve in parallel, exchanging halos every sync_steps generations.
+ *
+ * @param input the bytes to be hashed
+ * @param length number of bytes
+ * @param rule the rule number of the cellular automaton to use
+ * @param steps the number of steps to run the automaton for
+ * @param pool pool running one task per domain
+ * @param sync_steps generations between halo exchanges
+ * @param domains number of domains, 0 = one per pool worker
+ * @return the same 256-bit hash as ac_hash, as a hexadecimal string
+ */
+std::string ac_hash_parallel(const uint8_t* input, size_t length, uint32_t rule, size_t steps,
+                             ThreadPool& pool, size_t sync_steps, size_t domains) {
+    uint8_t digest[32];
+    ac_hash_parallel_digest(input, length, rule, steps, pool, sync_steps, domains, digest);
+    PROFILE_SCOPE(STAGE_HEX_ENCODE);
+    return digest_to_hex(digest);
+}
+
+/**
+ * Binary variant of ac_hash_parallel, same bytes as ac_hash_digest.
+ *
+ * @param input the bytes to be hashed
+ * @param length number of bytes
+ * @param rule the rule number of the cellular automaton to use
+ * @param steps the number of steps to run the automaton for
+ * @param pool pool running one task per domain
+ * @param sync_steps generations between halo exchanges
+ * @param domains number of domains, 0 = one per pool worker
+ * @param digest receives 32 bytes
+ */
+void ac_hash_parallel_digest(const uint8_t* input, size_t length, uint32_t rule, size_t steps,
+                             ThreadPool& pool, size_t sync_steps, size_t domains, uint8_t* digest) {
+    uint64_t hash[4];
+    compute_hash_words_parallel(input, length, rule, steps, pool, sync_steps, domains, hash);
+    hash_words_to_digest(hash, digest);
+}
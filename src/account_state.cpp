@@ -0,0 +1,224 @@
+#include "account_state.h"
+#include "blockchain_pow.h"
+#include "utils.h"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+//FNV-1a with a splitmix64 finalizer, so the low bits index the table well
+uint64_t accountHash(const std::string& account) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (char c : account) {
+        h ^= static_cast<uint8_t>(c);
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+} // namespace
+
+bool parseTransfer(const char* tx, size_t length, Transfer& transfer) {
+    const char* end = tx + length;
+    if (std::find(tx, end, ';') != end) {
+        return false; //the block payload joins transactions with ';', so this one would split in two
+    }
+    const char* arrow = std::search(tx, end, "->", "->" + 2);
+    if (arrow == tx || arrow == end) {
+        return false;
+    }
+    const char* colon = std::search(arrow + 2, end, ": ", ": " + 2);
+    if (colon == arrow + 2 || colon == end || colon + 2 == end) {
+        return false;
+    }
+    uint64_t amount = 0;
+    for (const char* pos = colon + 2; pos < end; pos++) {
+        if (*pos < '0' || *pos > '9' || amount > (UINT64_MAX - 9) / 10) {
+            return false;
+        }
+        amount = amount * 10 + static_cast<uint64_t>(*pos - '0');
+    }
+    if (amount == 0) {
+        return false;
+    }
+    transfer.from.assign(tx, arrow);
+    transfer.to.assign(arrow + 2, colon);
+    transfer.amount = amount;
+    return true;
+}
+
+BalanceTable::BalanceTable() : count(0) {
+    Slot empty = {0, 0, EMPTY_SLOT, 0};
+    slots.assign(16, empty);
+}
+
+size_t BalanceTable::find(const std::string& account, uint64_t hash) const {
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Slot& slot = slots[i];
+        if (slot.nameLength == EMPTY_SLOT ||
+            (slot.hash == hash && slot.nameLength == account.size() &&
+             names.compare(slot.nameOffset, slot.nameLength, account) == 0)) {
+            return i;
+        }
+    }
+}
+
+uint64_t BalanceTable::get(const std::string& account) const {
+    const Slot& slot = slots[find(account, accountHash(account))];
+    return slot.nameLength == EMPTY_SLOT ? 0 : slot.balance;
+}
+
+void BalanceTable::set(const std::string& account, uint64_t balance) {
+    uint64_t hash = accountHash(account);
+    size_t i = find(account, hash);
+    if (slots[i].nameLength == EMPTY_SLOT) {
+        if (names.size() + account.size() >= EMPTY_SLOT) {
+            throw std::invalid_argument("Too many account name bytes for the balance table");
+        }
+        if (4 * (count + 1) > 3 * slots.size()) {
+            grow();
+            i = find(account, hash);
+        }
+        slots[i].hash = hash;
+        slots[i].nameOffset = static_cast<uint32_t>(names.size());
+        slots[i].nameLength = static_cast<uint32_t>(account.size());
+        names.append(account);
+        count++;
+    }
+    slots[i].balance = balance;
+}
+
+//doubles the slot array; names stay where they are
+void BalanceTable::grow() {
+    std::vector<Slot> old;
+    old.swap(slots);
+    Slot empty = {0, 0, EMPTY_SLOT, 0};
+    slots.assign(2 * old.size(), empty);
+    size_t mask = slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.nameLength != EMPTY_SLOT) {
+            size_t i = slot.hash & mask;
+            while (slots[i].nameLength != EMPTY_SLOT) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = slot;
+        }
+    }
+}
+
+size_t BalanceTable::memoryBytes() const {
+    return slots.size() * sizeof(Slot) + names.size();
+}
+
+Balances BalanceTable::accounts() const {
+    Balances result;
+    result.reserve(count);
+    for (const Slot& slot : slots) {
+        if (slot.nameLength != EMPTY_SLOT) {
+            result.push_back(std::make_pair(names.substr(slot.nameOffset, slot.nameLength), slot.balance));
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+StateEngine::StateEngine(const Balances& allocation, size_t snapshotInterval)
+    : applied(1), interval(std::max<size_t>(1, snapshotInterval)) {
+    for (const auto& account : allocation) {
+        current.set(account.first, current.get(account.first) + account.second);
+    }
+    saved.push_back(std::make_pair(applied, current));
+}
+
+/**
+ * Runs the transfers that forEach yields against the current balances,
+ * tracking the accounts they touch in a scratch map.
+ * @param forEach Calls its argument with (tx, length) for each transaction
+ * @return The touched accounts' new balances, in first-touch order
+ */
+template<typename F>
+BlockDelta StateEngine::apply(F forEach) const {
+    std::unordered_map<std::string, size_t> touched; //account -> index in delta.balances
+    BlockDelta delta;
+    delta.transfers = 0;
+    auto slot = [&](const std::string& account) -> uint64_t& {
+        auto it = touched.find(account);
+        if (it == touched.end()) {
+            it = touched.insert(std::make_pair(account, delta.balances.size())).first;
+            delta.balances.push_back(std::make_pair(account, current.get(account)));
+        }
+        return delta.balances[it->second].second;
+    };
+    Transfer transfer;
+    forEach([&](const char* tx, size_t length) {
+        auto where = [&]() {
+            return "Transaction " + std::to_string(delta.transfers) + " (\"" + std::string(tx, length) + "\")";
+        };
+        if (!parseTransfer(tx, length, transfer)) {
+            throw std::invalid_argument(where() + " is not \"Sender->Receiver: amount\"");
+        }
+        uint64_t& from = slot(transfer.from);
+        if (from < transfer.amount) {
+            throw std::invalid_argument(where() + " overspends: " + transfer.from + " has " + std::to_string(from));
+        }
+        from -= transfer.amount;
+        uint64_t& to = slot(transfer.to); //may move from's storage, so from is not used after this
+        if (to > UINT64_MAX - transfer.amount) {
+            throw std::invalid_argument(where() + " overflows the balance of " + transfer.to);
+        }
+        to += transfer.amount;
+        delta.transfers++;
+        return true;
+    });
+    return delta;
+}
+
+BlockDelta StateEngine::validate(const std::vector<std::string>& transactions) const {
+    return apply([&](const std::function<bool(const char*, size_t)>& f) {
+        for (const std::string& tx : transactions) {
+            f(tx.data(), tx.size());
+        }
+    });
+}
+
+BlockDelta StateEngine::validate(const std::string& data) const {
+    return apply([&](const std::function<bool(const char*, size_t)>& f) {
+        forEachTransaction(data, f);
+    });
+}
+
+void StateEngine::commit(const BlockDelta& delta) {
+    for (const auto& account : delta.balances) {
+        current.set(account.first, account.second);
+    }
+    applied++;
+    if (applied % interval == 0) {
+        saved.push_back(std::make_pair(applied, current));
+        if (saved.size() > STATE_MAX_SNAPSHOTS + 1) {
+            saved.erase(saved.begin() + 1);
+        }
+    }
+}
+
+size_t StateEngine::rebuild(const ChainSnapshot& chain, size_t height) {
+    if (height == 0 || height > chain.size()) {
+        throw std::invalid_argument("No chain state at height " + std::to_string(height));
+    }
+    while (saved.size() > 1 && saved.back().first > height) {
+        saved.pop_back();
+    }
+    current = saved.back().second;
+    applied = saved.back().first;
+    size_t replayed = 0;
+    for (; applied < height; replayed++) {
+        commit(validate(chain[applied]->getData()));
+    }
+    return replayed;
+}
@@ -1,4 +0,0 @@
-#include "block.h"
-#include <iostream>
-
-// Empty implementation as Block is an abstract base class
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "block_header.h"
+#include <cstring>
+
+namespace {
+
+void putU32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void putU64(uint8_t* out, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint32_t getU32(const uint8_t* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t getU64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+}
+
+const size_t BlockHeader::LEGACY_ENCODED_SIZE;
+const size_t BlockHeader::MAX_ENCODED_SIZE;
+
+BlockHeader::BlockHeader()
+    : version(BINARY_HEADER_VERSION), index(0), timestamp(0), hashMode(SHA256_MODE),
+      rule(0), steps(0), difficulty(0), extraNonce(0), nonce(0) {
+    std::memset(previousHash, 0, DIGEST_SIZE);
+    std::memset(payloadHash, 0, DIGEST_SIZE);
+}
+
+/**
+ * Builds the header of a block about to be mined (nonce 0).
+ * @param index Height of the block
+ * @param timestamp Mining time in ms since the epoch
+ * @param prevHash Hex hash of the previous block ("0" for genesis)
+ * @param data Block payload, committed to through its SHA-256
+ * @param difficulty Number of leading '0' hex characters required
+ * @param mode Hash mode used for proof-of-work
+ * @param rule CA rule (AC_HASH_MODE)
+ * @param steps CA steps (AC_HASH_MODE)
+ * @return The header
+ */
+BlockHeader BlockHeader::create(int index, uint64_t timestamp, const std::string& prevHash,
+                                const std::string& data, int difficulty,
+                                HashMode mode, uint32_t rule, size_t steps) {
+    BlockHeader header;
+    header.index = static_cast<uint32_t>(index);
+    header.timestamp = timestamp;
+    hexToDigest(prevHash, header.previousHash);
+    sha256Digest(reinterpret_cast<const uint8_t*>(data.data()), data.size(), header.payloadHash);
+    header.hashMode = mode;
+    header.rule = rule;
+    header.steps = static_cast<uint32_t>(steps);
+    header.difficulty = static_cast<uint32_t>(difficulty);
+    return header;
+}
+
+/**
+ * Builds the header of a block about to be mined against a 256-bit target,
+ * with 64-bit nonces. The target is stored in compact form in the
+ * difficulty field.
+ * @param index Height of the block
+ * @param timestamp Mining time in ms since the epoch
+ * @param prevHash Hex hash of the previous block ("0" for genesis)
+ * @param data Block payload, committed to through its SHA-256
+ * @param target Proof-of-work target
+ * @param mode Hash mode used for proof-of-work
+ * @param rule CA rule (AC_HASH_MODE)
+ * @param steps CA steps (AC_HASH_MODE)
+ * @return The header
+ */
+BlockHeader BlockHeader::create(int index, uint64_t timestamp, const std::string& prevHash,
+                                const std::string& data, const Target& target,
+                                HashMode mode, uint32_t rule, size_t steps) {
+    BlockHeader header = create(index, timestamp, prevHash, data, 0, mode, rule, steps);
+    header.version = NONCE64_HEADER_VERSION;
+    header.difficulty = target.toCompact();
+    return header;
+}
+
+Target BlockHeader::target() const {
+    if (version >= TARGET_HEADER_VERSION) {
+        return Target::fromCompact(difficulty);
+    }
+    return Target::fromNibbles(static_cast<int>(difficulty));
+}
+
+size_t BlockHeader::encodedSize() const {
+    return version >= NONCE64_HEADER_VERSION ? MAX_ENCODED_SIZE : LEGACY_ENCODED_SIZE;
+}
+
+uint64_t BlockHeader::nonceLimit() const {
+    //nonces run over [0, limit); the all-ones value is left out so it can mean "none"
+    return version >= NONCE64_HEADER_VERSION ? UINT64_MAX : (1ULL << 32) - 1;
+}
+
+size_t BlockHeader::encode(uint8_t* out) const {
+    //version 3 inserts the two 64-bit nonces after the timestamp
+    size_t shift = version >= NONCE64_HEADER_VERSION ? 16 : 0;
+    putU32(out, version);
+    putU32(out + 4, index);
+    putU64(out + 8, timestamp);
+    std::memcpy(out + shift + 16, previousHash, DIGEST_SIZE);
+    std::memcpy(out + shift + 48, payloadHash, DIGEST_SIZE);
+    putU32(out + shift + 80, static_cast<uint32_t>(hashMode));
+    putU32(out + shift + 84, rule);
+    putU32(out + shift + 88, steps);
+    putU32(out + shift + 92, difficulty);
+    encodeExtraNonce(out, extraNonce);
+    encodeNonce(out, nonce);
+    return encodedSize();
+}
+
+void BlockHeader::encodeNonce(uint8_t* out, uint64_t value) const {
+    if (version >= NONCE64_HEADER_VERSION) {
+        putU64(out + 24, value);
+    } else {
+        putU32(out + 96, static_cast<uint32_t>(value));
+    }
+}
+
+void BlockHeader::encodeExtraNonce(uint8_t* out, uint64_t value) const {
+    if (version >= NONCE64_HEADER_VERSION) {
+        putU64(out + 16, value);
+    }
+}
+
+bool BlockHeader::decode(const uint8_t* in, size_t length, BlockHeader& header) {
+    uint32_t version = length >= LEGACY_ENCODED_SIZE ? getU32(in) : 0;
+    if (version < BINARY_HEADER_VERSION || version > NONCE64_HEADER_VERSION ||
+        (version == NONCE64_HEADER_VERSION && length < MAX_ENCODED_SIZE)) {
+        return false;
+    }
+    size_t shift = version >= NONCE64_HEADER_VERSION ? 16 : 0;
+    uint32_t mode = getU32(in + shift + 80);
+    if (mode > AC_HASH_SPONGE_MODE) {
+        return false;
+    }
+    header.version = version;
+    header.index = getU32(in + 4);
+    header.timestamp = getU64(in + 8);
+    std::memcpy(header.previousHash, in + shift + 16, DIGEST_SIZE);
+    std::memcpy(header.payloadHash, in + shift + 48, DIGEST_SIZE);
+    header.hashMode = static_cast<HashMode>(mode);
+    header.rule = getU32(in + shift + 84);
+    header.steps = getU32(in + shift + 88);
+    header.difficulty = getU32(in + shift + 92);
+    if (version >= NONCE64_HEADER_VERSION) {
+        header.extraNonce = getU64(in + 16);
+        header.nonce = getU64(in + 24);
+    } else {
+        header.extraNonce = 0;
+        header.nonce = getU32(in + 96);
+    }
+    return true;
+}
+
+bool BlockHeader::operator==(const BlockHeader& other) const {
+    return version == other.version && index == other.index && timestamp == other.timestamp &&
+           std::memcmp(previousHash, other.previousHash, DIGEST_SIZE) == 0 &&
+           std::memcmp(payloadHash, other.payloadHash, DIGEST_SIZE) == 0 &&
+           hashMode == other.hashMode && rule == other.rule && steps == other.steps &&
+           difficulty == other.difficulty && extraNonce == other.extraNonce && nonce == other.nonce;
+}
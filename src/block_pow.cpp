@@ -2,22 +2,29 @@
 #include "utils.h"
 #include "ac_hash.h"
 #include "pow.h"
-#include <iostream>
+#include "logger.h"
 #include <sstream>
+#include <utility>
 
-BlockPow::BlockPow(int idx, const std::string& prevHash, const std::string& h, 
-                   const std::string& d, int n, int diff, 
+BlockPow::BlockPow(int idx, std::string prevHash, std::string h, 
+                   std::string d, uint64_t n, int diff, 
                    HashMode mode, uint32_t r, size_t s)
-    : index(idx), previousHash(prevHash), hash(h), data(d), 
-      nonce(n), difficulty(diff), hashMode(mode), rule(r), steps(s) {}
+    : index(idx), previousHash(std::move(prevHash)), hash(std::move(h)), data(std::move(d)), 
+      nonce(n), extraNonce(0), difficulty(diff), hashMode(mode), rule(r), steps(s),
+      timestamp(0), headerVersion(LEGACY_HEADER_VERSION) {}
 
-BlockPow::~BlockPow() {}
+BlockPow::BlockPow(const BlockHeader& header, std::string prevHash, std::string h, std::string d)
+    : index(header.index), previousHash(std::move(prevHash)), hash(std::move(h)), data(std::move(d)),
+      nonce(header.nonce), extraNonce(header.extraNonce),
+      difficulty(static_cast<int>(header.difficulty)), hashMode(header.hashMode),
+      rule(header.rule), steps(header.steps), timestamp(header.timestamp),
+      headerVersion(header.version) {}
 
-std::string BlockPow::getHash() const {
+const std::string& BlockPow::getHash() const {
     return hash;
 }
 
-std::string BlockPow::getPreviousHash() const {
+const std::string& BlockPow::getPreviousHash() const {
     return previousHash;
 }
 
@@ -25,40 +32,66 @@ int BlockPow::getIndex() const {
     return index;
 }
 
+/**
+ * Recomputes the block hash from its stored fields, exactly as it was mined:
+ * over the binary header, or over data + previousHash + nonce for legacy blocks.
+ * @return The hash
+ */
 std::string BlockPow::calculateHash() const {
-    std::stringstream ss;
-    ss << index << getCurrentTime() << data << previousHash << nonce;
-    
-    if (hashMode == SHA256_MODE) {
-        return sha256(ss.str());
-    } else {
-        return ac_hash(ss.str(), rule, steps);
+    if (headerVersion == LEGACY_HEADER_VERSION) {
+        return ProofOfWork::computeHash(ProofOfWork::legacyMessage(data, previousHash, nonce), hashMode, rule, steps);
     }
+    return ProofOfWork::hashHeader(getHeader());
 }
 
 void BlockPow::display() const {
-    std::cout << "\n--- Block #" << index << " (PoW - " << hashModeToString(hashMode) << ") ---" << std::endl;
-    std::cout << "Timestamp: " << getCurrentTime() << std::endl;
-    std::cout << "Data: " << data << std::endl;
-    std::cout << "Previous Hash: " << previousHash.substr(0, 16) << "..." << std::endl;
-    std::cout << "Hash: " << hash.substr(0, 16) << "..." << std::endl;
-    std::cout << "Nonce: " << nonce << std::endl;
-    std::cout << "Difficulty: " << difficulty << std::endl;
-    std::cout << "Hash Mode: " << hashModeToString(hashMode);
-    if (hashMode == AC_HASH_MODE) {
-        std::cout << " (Rule " << rule << ", " << steps << " steps)";
+    Logger::instance().log(LOG_INFO, describe());
+    Logger::instance().flush(); //on the console before the caller's next std::cout line
+}
+
+/**
+ * Formats the block for display, built in one buffer.
+ * @return Multi-line description starting with a blank line
+ */
+std::string BlockPow::describe() const {
+    std::ostringstream out;
+    out << "\n--- Block #" << index << " (PoW - " << hashModeToString(hashMode) << ") ---\n";
+    out << "Timestamp: " << (headerVersion == LEGACY_HEADER_VERSION ? "n/a (legacy block)" : formatTimestamp(timestamp)) << "\n";
+    out << "Data: " << data << "\n";
+    out << "Previous Hash: " << previousHash.substr(0, 16) << "...\n";
+    out << "Hash: " << hash.substr(0, 16) << "...\n";
+    out << "Nonce: " << nonce;
+    if (extraNonce != 0) {
+        out << " (extra nonce " << extraNonce << ")";
+    }
+    out << "\n";
+    if (headerVersion >= TARGET_HEADER_VERSION) {
+        Target target = getTarget();
+        out << "Target: 0x" << std::hex << target.toCompact() << std::dec
+            << " (~" << target.difficultyBits() << " zero bits)\n";
+    } else {
+        out << "Difficulty: " << difficulty << "\n";
+    }
+    out << "Hash Mode: " << hashModeToString(hashMode);
+    if (hashMode != SHA256_MODE) {
+        out << " (Rule " << rule << ", " << steps << " steps)";
     }
-    std::cout << std::endl;
+    out << "\n";
+    return out.str();
 }
 
-std::string BlockPow::getData() const {
+const std::string& BlockPow::getData() const {
     return data;
 }
 
-int BlockPow::getNonce() const {
+uint64_t BlockPow::getNonce() const {
     return nonce;
 }
 
+uint64_t BlockPow::getExtraNonce() const {
+    return extraNonce;
+}
+
 int BlockPow::getDifficulty() const {
     return difficulty;
 }
@@ -73,4 +106,44 @@ uint32_t BlockPow::getRule() const {
 
 size_t BlockPow::getSteps() const {
     return steps;
+}
+
+uint64_t BlockPow::getTimestamp() const {
+    return timestamp;
+}
+
+uint32_t BlockPow::getHeaderVersion() const {
+    return headerVersion;
+}
+
+Target BlockPow::getTarget() const {
+    if (headerVersion >= TARGET_HEADER_VERSION) {
+        return Target::fromCompact(static_cast<uint32_t>(difficulty));
+    }
+    return Target::fromNibbles(difficulty);
+}
+
+BlockHeader BlockPow::getHeader() const {
+    BlockHeader header = BlockHeader::create(index, timestamp, previousHash, data, difficulty,
+                                             hashMode, rule, steps);
+    header.version = headerVersion;
+    header.difficulty = static_cast<uint32_t>(difficulty);
+    header.extraNonce = extraNonce;
+    header.nonce = nonce;
+    return header;
+}
+
+BlockHeaderView BlockPow::getHeaderView() const {
+    BlockHeaderView view;
+    view.header = getHeader();
+    hexToDigest(hash, view.hash);
+    return view;
+}
+
+const BloomFilter& BlockPow::getFilter() const {
+    return filter;
+}
+
+void BlockPow::setFilter(BloomFilter f) {
+    filter = std::move(f);
 }
\ No newline at end of file
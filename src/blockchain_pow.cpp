@@ -1,8 +1,13 @@
 #include "blockchain_pow.h"
 #include "utils.h"
 #include "pow.h"
-#include <iostream>
+#include "thread_pool.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <stdexcept>
+#include <utility>
 
 /**
  * Constructor for BlockchainPow
@@ -13,91 +18,344 @@
  * Initializes the blockchain with the given parameters and creates a genesis block
  */
 BlockchainPow::BlockchainPow(int diff, HashMode mode, uint32_t r, size_t s) 
-    : difficulty(diff), hashMode(mode), rule(r), steps(s) {
+    : blocks(nullptr), length(0), capacity(0),
+      difficulty(diff), target(Target::fromNibbles(diff)), hashMode(mode), rule(r), steps(s),
+      validationMode(VALIDATE_ASSUME_VALID), bloomGeometry(defaultBloomGeometry()) {
     
     //genesis block
     std::string genesisData = "Genesis Block";
-    int nonce = 0;
-    std::string genesisHash = ProofOfWork::mineBlock(genesisData, "0", difficulty, nonce, 
-                                                     hashMode, rule, steps);
-    chain.push_back(new BlockPow(0, "0", genesisHash, genesisData, nonce, difficulty, 
-                                 hashMode, rule, steps));
+    BlockHeader header = BlockHeader::create(0, currentTimestampMillis(), "0", genesisData,
+                                             target, hashMode, rule, steps);
+    std::string genesisHash = ProofOfWork::mineHeader(header);
+    publish(new BlockPow(header, "0", std::move(genesisHash), std::move(genesisData)));
+}
+
+/**
+ * Constructor for a replica: the chain starts from a genesis block
+ * received from another node and takes its hash configuration and target.
+ * @param genesis Block 0 of the chain being replicated
+ * @throws std::invalid_argument if genesis is missing, not block 0 or fails its proof of work
+ */
+BlockchainPow::BlockchainPow(std::unique_ptr<BlockPow> genesis)
+    : blocks(nullptr), length(0), capacity(0), validationMode(VALIDATE_ASSUME_VALID),
+      bloomGeometry(defaultBloomGeometry()) {
+    if (!genesis || genesis->getIndex() != 0 || !verifyProof(*genesis)) {
+        throw std::invalid_argument("Invalid genesis block");
+    }
+    difficulty = genesis->getDifficulty();
+    target = genesis->getTarget();
+    hashMode = genesis->getHashMode();
+    rule = genesis->getRule();
+    steps = genesis->getSteps();
+    publish(genesis.release());
 }
 
 BlockchainPow::~BlockchainPow() {
-    for (auto* block : chain) {
-        delete block;
+    BlockPow** slots = blocks.load();
+    for (size_t i = 0; i < length.load(); i++) {
+        delete slots[i];
+    }
+    delete[] slots;
+    for (auto* old : retired) {
+        delete[] old;
+    }
+}
+
+/**
+ * Appends a block for readers. The slot is written first and the new
+ * length is stored with release semantics, so a reader that sees the
+ * length also sees the block (and the slot array holding it). A full slot
+ * array is copied into one twice as large, which is published before the
+ * length; the old array stays allocated for readers still using it.
+ * The block's transaction filter is built here, before any reader can
+ * see it; filters are derived from the payload, so received blocks are
+ * not trusted to bring their own.
+ * @param block The new tip, owned by the chain from now on
+ */
+void BlockchainPow::publish(BlockPow* block) {
+    block->setFilter(BloomFilter::forData(block->getData(), bloomGeometry));
+    size_t n = length.load(std::memory_order_relaxed);
+    BlockPow** slots = blocks.load(std::memory_order_relaxed);
+    if (n == capacity) {
+        size_t grown = capacity == 0 ? CHAIN_INITIAL_CAPACITY : 2 * capacity;
+        BlockPow** larger = new BlockPow*[grown];
+        std::copy(slots, slots + n, larger);
+        larger[n] = block;
+        blocks.store(larger, std::memory_order_release);
+        if (slots != nullptr) {
+            retired.push_back(slots);
+        }
+        capacity = grown;
+    } else {
+        slots[n] = block;
     }
+    length.store(n + 1, std::memory_order_release);
 }
 
 /**
  * Adds a new block to the blockchain
  * @param transactions A vector of transaction strings to be added to the block
  * Mines a new block using the given transactions and adds it to the blockchain.
- * The block is mined using the ProofOfWork::mineBlock function with the given parameters.
- * The block is then added to the blockchain and the mining duration is printed to the console.
+ * The block is mined over its binary header against the current target.
+ * The block is then added to the blockchain, with a Bloom filter over its transactions,
+ * and a block-mined event goes to the Logger.
+ * With retargeting enabled, the measured duration then adjusts the target for the next block.
+ * With balances tracked, the transfers are checked against the balances before any work is
+ * spent on mining and applied once the block is published.
+ * @throws std::invalid_argument if balances are tracked and a transaction is malformed or overspends
  */
 void BlockchainPow::addBlock(const std::vector<std::string>& transactions) {
-    //combine transactions into a single data string
+    BlockDelta delta;
+    if (state) {
+        delta = state->validate(transactions);
+    }
+
+    //combine transactions into a single data string, sized once
+    size_t dataSize = 0;
+    for (const auto& tx : transactions) {
+        dataSize += tx.size() + 1;
+    }
     std::string data;
+    data.reserve(dataSize);
     for (const auto& tx : transactions) {
-        data += tx + ";";
+        data.append(tx).push_back(';');
     }
     
     std::string prevHash = getLatestHash();
-    int nonce = 0;
+    size_t height = length.load(std::memory_order_relaxed);
+    //the timestamp is captured once and committed to by the header
+    BlockHeader header = BlockHeader::create(height, currentTimestampMillis(), prevHash, data,
+                                             target, hashMode, rule, steps);
     
     auto start = std::chrono::high_resolution_clock::now();
-    std::string newHash = ProofOfWork::mineBlock(data, prevHash, difficulty, nonce, 
-                                                 hashMode, rule, steps);
+    std::string newHash = ProofOfWork::mineHeader(header);
     auto end = std::chrono::high_resolution_clock::now();
     
-    long long duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    double millis = std::chrono::duration<double, std::milli>(end - start).count();
     
-    chain.push_back(new BlockPow(chain.size(), prevHash, newHash, data, nonce, difficulty, 
-                                 hashMode, rule, steps));
+    publish(new BlockPow(header, std::move(prevHash), std::move(newHash), std::move(data)));
+    if (state) {
+        state->commit(delta);
+    }
     
-    std::cout << "Block #" << chain.size() - 1 << " mined in " << duration << " ms "
-              << "(" << hashModeToString(hashMode) << ", " << nonce << " iterations)" << std::endl;
+    if (retargeter.enabled()) {
+        retargeter.record(millis, target);
+        target = retargeter.retarget(target);
+    }
+    
+    Logger::instance().block_mined(height, header.nonce, header.extraNonce, millis,
+                                   header.hashMode, header.rule, header.steps);
 }
 
 /**
- * Verifies the integrity of the blockchain by checking that each block's
+ * Checks a block's proof of work with its own hash mode and encoding.
+ * @param block The block to check
+ * @return True if the block hashes to its stored hash and meets its target
+ */
+bool BlockchainPow::verifyProof(const BlockPow& block) {
+    if (block.getHeaderVersion() == LEGACY_HEADER_VERSION) {
+        return ProofOfWork::verifyBlock(block.getData(), block.getPreviousHash(), block.getHash(),
+                                        block.getDifficulty(), block.getNonce(), block.getHashMode(),
+                                        block.getRule(), block.getSteps());
+    }
+    //the payload digest is recomputed from the data, so this covers the payload too
+    return ProofOfWork::verifyHeader(block.getHeader(), block.getHash());
+}
+
+/**
+ * Appends a block mined by another node (writer thread only). The block
+ * must use the chain's hash mode, rule and steps, and its target may not
+ * be easier than the chain's current target (taken from genesis on a
+ * replica, the retargeted one when retargeting is on), so a peer cannot
+ * extend the chain with cheaper work. While syncing up to the latest
+ * checkpoint (VALIDATE_ASSUME_VALID) a block's proof of work is not
+ * recomputed: it only has to pass those checks, link, carry a
+ * well-formed hash meeting its target and, at a checkpoint height, be
+ * the checkpointed block.
+ * @param block The received block, owned by the chain if accepted
+ * @return True if the block was the next index, linked to the tip, matched
+ *         the chain's parameters, had valid (or assumed valid) proof of work
+ *         and, with balances tracked, valid transfers; false (block discarded) otherwise
+ */
+bool BlockchainPow::acceptBlock(std::unique_ptr<BlockPow> block) {
+    ChainSnapshot snapshot = getChain();
+    size_t height = snapshot.size();
+    if (!block || static_cast<size_t>(block->getIndex()) != height || !block->linksTo(*snapshot.back())) {
+        return false;
+    }
+    if (block->getHashMode() != hashMode || block->getRule() != rule || block->getSteps() != steps ||
+        block->getTarget().isEasierThan(target)) {
+        return false;
+    }
+    bool assumed = false;
+    if (validationMode == VALIDATE_ASSUME_VALID) {
+        for (const Checkpoint& checkpoint : checkpoints) {
+            if (checkpoint.height == height && checkpoint.hash != block->getHash()) {
+                return false; //a different chain than the trusted one
+            }
+            assumed = assumed || checkpoint.height >= height;
+        }
+    }
+    uint8_t digest[DIGEST_SIZE];
+    bool sane = hexToDigest(block->getHash(), digest) && block->getTarget().isMetBy(digest);
+    if (!sane || (!assumed && !verifyProof(*block))) {
+        return false;
+    }
+    BlockDelta delta;
+    if (state) {
+        try {
+            delta = state->validate(block->getData());
+        } catch (const std::invalid_argument&) {
+            return false; //spends funds its sender does not have
+        }
+    }
+    publish(block.release());
+    if (state) {
+        state->commit(delta);
+    }
+    return true;
+}
+
+/**
+ * Verifies the integrity of the snapshot by checking that each block's
  * hash is valid and that each block points to the previous block's hash.
- * @return True if the blockchain is valid, false otherwise.
+ * @return True if the snapshot is a valid chain, false otherwise.
  */
-bool BlockchainPow::isChainValid() const {
-    for (size_t i = 1; i < chain.size(); i++) {
-        BlockPow* currentBlock = chain[i];
+bool ChainSnapshot::isValid() const {
+    return isRangeValid(1, length);
+}
+
+/**
+ * Verifies blocks [first, last) of the snapshot: proof of work, and the
+ * link to the previous block for every block but the genesis. Blocks are
+ * independent of each other, so they are verified in parallel on the
+ * shared ThreadPool.
+ * @param first Index of the first block to check
+ * @param last One past the last block to check (clamped to size())
+ * @return True if every block in the range is valid
+ */
+bool ChainSnapshot::isRangeValid(size_t first, size_t last) const {
+    std::atomic<bool> valid(true);
+    ThreadPool::instance().parallel_for(first, std::min(last, length), [&](size_t i) {
+        if (!valid.load()) {
+            return;
+        }
+        const BlockPow* currentBlock = blocks[i];
         
-        //verify hash with the block's own hash mode
-        if (!ProofOfWork::verifyBlock(currentBlock->getData(), 
-                                     currentBlock->getPreviousHash(), 
-                                     currentBlock->getHash(), 
-                                     currentBlock->getDifficulty(), 
-                                     currentBlock->getNonce(),
-                                     currentBlock->getHashMode(),
-                                     currentBlock->getRule(),
-                                     currentBlock->getSteps())) {
-            return false;
+        bool verified = BlockchainPow::verifyProof(*currentBlock);
+        if (!verified) {
+            valid = false;
+            return;
         }
         
         //verify chain linkage
-        if (currentBlock->getPreviousHash() != chain[i-1]->getHash()) {
+        if (i > 0 && !currentBlock->linksTo(*blocks[i-1])) {
+            valid = false;
+        }
+    });
+    return valid.load();
+}
+
+/**
+ * Checks blocks [first, last) without hashing anything: each has its
+ * index, names its predecessor's hash, and claims a 64-digit hex hash that
+ * meets its own target.
+ * @return True if every block in the range passes
+ */
+bool ChainSnapshot::isLinked(size_t first, size_t last) const {
+    uint8_t digest[DIGEST_SIZE];
+    for (size_t i = first; i < std::min(last, length); i++) {
+        const BlockPow* block = blocks[i];
+        if (static_cast<size_t>(block->getIndex()) != i || (i > 0 && !block->linksTo(*blocks[i - 1])) ||
+            !hexToDigest(block->getHash(), digest) || !block->getTarget().isMetBy(digest)) {
             return false;
         }
     }
     return true;
 }
 
+/**
+ * Verifies the blocks published so far in the configured validation mode.
+ * Safe to call while the writer appends; later blocks are not checked.
+ * @return True if the blockchain is valid, false otherwise.
+ */
+bool BlockchainPow::isChainValid() const {
+    return isChainValid(validationMode);
+}
+
+/**
+ * Verifies the blocks published so far. In VALIDATE_ASSUME_VALID mode the
+ * blocks up to the latest checkpoint the chain has reached are only
+ * checked for linkage and header sanity (ChainSnapshot::isLinked), and the
+ * checkpointed block must have the trusted hash; proof of work is
+ * recomputed for the blocks after it only, so the cost scales with them
+ * rather than with the chain length.
+ * @param mode VALIDATE_FULL to recompute every block's proof of work
+ * @return True if the blockchain is valid, false otherwise.
+ */
+bool BlockchainPow::isChainValid(ValidationMode mode) const {
+    ChainSnapshot snapshot = getChain();
+    const Checkpoint* checkpoint = assumedCheckpoint(snapshot.size(), mode);
+    if (checkpoint == nullptr) {
+        return snapshot.isValid();
+    }
+    return snapshot[checkpoint->height]->getHash() == checkpoint->hash &&
+           snapshot.isLinked(0, checkpoint->height + 1) &&
+           snapshot.isRangeValid(checkpoint->height + 1, snapshot.size());
+}
+
+const Checkpoint* BlockchainPow::assumedCheckpoint(size_t limit, ValidationMode mode) const {
+    const Checkpoint* latest = nullptr;
+    if (mode == VALIDATE_ASSUME_VALID) {
+        for (const Checkpoint& checkpoint : checkpoints) {
+            if (checkpoint.height < limit) {
+                latest = &checkpoint;
+            }
+        }
+    }
+    return latest;
+}
+
+//the whole chain goes to the logger as one record
 void BlockchainPow::displayChain() const {
-    for (const auto* block : chain) {
-        block->display();
+    std::string text;
+    for (const auto* block : getChain()) {
+        text += block->describe();
     }
+    Logger::instance().log(LOG_INFO, std::move(text));
+    Logger::instance().flush();
 }
 
 void BlockchainPow::setDifficulty(int diff) {
     difficulty = diff;
+    target = Target::fromNibbles(diff);
+}
+
+void BlockchainPow::setDifficultyBits(unsigned bits) {
+    target = Target::fromLeadingZeroBits(bits);
+}
+
+void BlockchainPow::setTarget(const Target& t) {
+    target = t;
+}
+
+const Target& BlockchainPow::getTarget() const {
+    return target;
+}
+
+/**
+ * Turns on the retargeting controller: after each block the target is
+ * moved so blocks take blockMillis to mine at the measured hash rate.
+ * @param blockMillis Block interval to hold (ms)
+ * @param window Number of recent blocks the hash rate is measured over
+ * @param maxFactor Largest change of expected work per block
+ */
+void BlockchainPow::enableRetargeting(double blockMillis, size_t window, double maxFactor) {
+    retargeter = RetargetController(blockMillis, window, maxFactor);
+}
+
+void BlockchainPow::disableRetargeting() {
+    retargeter = RetargetController();
 }
 
 void BlockchainPow::setHashMode(HashMode mode, uint32_t r, size_t s) {
@@ -106,8 +364,72 @@ void BlockchainPow::setHashMode(HashMode mode, uint32_t r, size_t s) {
     steps = s;
 }
 
+void BlockchainPow::setCheckpoints(std::vector<Checkpoint> trusted) {
+    std::sort(trusted.begin(), trusted.end(), [](const Checkpoint& a, const Checkpoint& b) {
+        return a.height < b.height;
+    });
+    checkpoints = std::move(trusted);
+}
+
+const std::vector<Checkpoint>& BlockchainPow::getCheckpoints() const {
+    return checkpoints;
+}
+
+void BlockchainPow::setValidationMode(ValidationMode mode) {
+    validationMode = mode;
+}
+
+ValidationMode BlockchainPow::getValidationMode() const {
+    return validationMode;
+}
+
+/**
+ * Sets the target false-positive rate of the per-block transaction filters.
+ * @param rate False-positive rate for a block holding expectedTransactions
+ * @param expectedTransactions Typical transactions per block
+ * @throws std::invalid_argument if rate is not in (0, 1) or expectedTransactions is 0
+ */
+void BlockchainPow::setBloomFalsePositiveRate(double rate, size_t expectedTransactions) {
+    bloomGeometry = BloomGeometry::forRate(rate, expectedTransactions);
+}
+
+const BloomGeometry& BlockchainPow::getBloomGeometry() const {
+    return bloomGeometry;
+}
+
+/**
+ * Starts interpreting transactions as transfers between accounts. The
+ * state starts from the allocation (the balances after the genesis
+ * block) and the blocks published so far are replayed into it.
+ * @param allocation Initial balances
+ * @param snapshotInterval Blocks between saved copies of the balances
+ * @throws std::invalid_argument if a published block has an invalid transfer (nothing changes)
+ */
+void BlockchainPow::trackBalances(const Balances& allocation, size_t snapshotInterval) {
+    std::unique_ptr<StateEngine> engine(new StateEngine(allocation, snapshotInterval));
+    ChainSnapshot snapshot = getChain();
+    engine->rebuild(snapshot, snapshot.size());
+    state = std::move(engine);
+}
+
+bool BlockchainPow::tracksBalances() const {
+    return state != nullptr;
+}
+
+uint64_t BlockchainPow::getBalance(const std::string& account) const {
+    if (!state) {
+        throw std::runtime_error("Balances are not tracked (see trackBalances)");
+    }
+    return state->balance(account);
+}
+
+StateEngine* BlockchainPow::getState() {
+    return state.get();
+}
+
 std::string BlockchainPow::getLatestHash() const {
-    return chain.empty() ? "0" : chain.back()->getHash();
+    ChainSnapshot snapshot = getChain();
+    return snapshot.empty() ? std::string("0") : snapshot.back()->getHash();
 }
 
 HashMode BlockchainPow::getHashMode() const {
@@ -122,6 +444,13 @@ size_t BlockchainPow::getSteps() const {
     return steps;
 }
 
-const std::vector<BlockPow*>& BlockchainPow::getChain() const {
-    return chain;
+/**
+ * Takes a snapshot of the published blocks without locking: the length
+ * first (acquire), then the slot array, which holds at least that many
+ * blocks because the writer publishes a new array before a longer length.
+ * @return View of the chain as of this call
+ */
+ChainSnapshot BlockchainPow::getChain() const {
+    size_t n = length.load(std::memory_order_acquire);
+    return ChainSnapshot(blocks.load(std::memory_order_acquire), n);
 }
\ No newline at end of file
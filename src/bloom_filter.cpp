@@ -0,0 +1,130 @@
+#include "bloom_filter.h"
+#include "utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+//splitmix64 finalizer
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+} // namespace
+
+/**
+ * Sizes a filter with the standard formulas: bits = -n ln p / (ln 2)^2,
+ * rounded up to whole 64-bit words, and hashes = (bits / n) ln 2.
+ * @return The geometry
+ */
+BloomGeometry BloomGeometry::forRate(double falsePositiveRate, size_t expectedTransactions) {
+    if (!(falsePositiveRate > 0.0 && falsePositiveRate < 1.0) || expectedTransactions == 0) {
+        throw std::invalid_argument("Bloom filter needs a false-positive rate in (0, 1) and at least one transaction");
+    }
+    double ln2 = std::log(2.0);
+    double exact = -static_cast<double>(expectedTransactions) * std::log(falsePositiveRate) / (ln2 * ln2);
+    if (exact > static_cast<double>(BLOOM_MAX_BITS)) {
+        throw std::invalid_argument("Bloom filter would exceed BLOOM_MAX_BITS");
+    }
+    BloomGeometry geometry;
+    geometry.bits = std::max<size_t>(64, (static_cast<size_t>(std::ceil(exact)) + 63) / 64 * 64);
+    double hashes = std::round(static_cast<double>(geometry.bits) / expectedTransactions * ln2);
+    geometry.hashes = static_cast<unsigned>(std::min<double>(BLOOM_MAX_HASHES, std::max(1.0, hashes)));
+    return geometry;
+}
+
+double BloomGeometry::falsePositiveRate(size_t n) const {
+    if (bits == 0) {
+        return 0.0;
+    }
+    return std::pow(1.0 - std::exp(-static_cast<double>(hashes) * n / bits), hashes);
+}
+
+BloomGeometry defaultBloomGeometry() {
+    return BloomGeometry::forRate(BLOOM_DEFAULT_FALSE_POSITIVE_RATE, BLOOM_DEFAULT_EXPECTED_TRANSACTIONS);
+}
+
+/**
+ * Hashes a transaction to its 128-bit key: FNV-1a over the bytes, then two
+ * independent finalizer rounds. Stable across platforms and runs, so keys
+ * (and filters) can be stored.
+ * @return The key
+ */
+BloomKey bloomKey(const char* tx, size_t length) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        h ^= static_cast<uint8_t>(tx[i]);
+        h *= 0x100000001b3ULL;
+    }
+    BloomKey key;
+    key.h1 = mix64(h ^ length);
+    key.h2 = mix64(h + 0x9e3779b97f4a7c15ULL) | 1;
+    return key;
+}
+
+BloomFilter::BloomFilter(const BloomGeometry& geometry)
+    : shape(geometry), bitWords(geometry.words(), 0) {}
+
+BloomFilter BloomFilter::forData(const std::string& data, const BloomGeometry& geometry) {
+    BloomFilter filter(geometry);
+    forEachTransaction(data, [&](const char* tx, size_t length) {
+        filter.add(bloomKey(tx, length));
+        return true;
+    });
+    return filter;
+}
+
+/**
+ * Probe i is mix64(h1 + i * h2) mod bits. Plain double hashing
+ * (h1 + i * h2 mod bits) reuses the low bits of both halves, and with
+ * filters of a few hundred bits that raises the false-positive rate
+ * several times over the formula; mixing each probe keeps it there.
+ */
+void BloomFilter::positions(const BloomKey& key, const BloomGeometry& geometry, size_t* out) {
+    uint64_t h = key.h1;
+    for (unsigned i = 0; i < geometry.hashes; i++) {
+        out[i] = static_cast<size_t>(mix64(h) % geometry.bits);
+        h += key.h2;
+    }
+}
+
+void BloomFilter::add(const BloomKey& key) {
+    size_t bits[BLOOM_MAX_HASHES];
+    positions(key, shape, bits);
+    for (unsigned i = 0; i < shape.hashes; i++) {
+        bitWords[bits[i] / 64] |= 1ULL << (bits[i] % 64);
+    }
+}
+
+bool BloomFilter::mayContain(const BloomKey& key) const {
+    if (bitWords.empty()) {
+        return false;
+    }
+    size_t bits[BLOOM_MAX_HASHES];
+    positions(key, shape, bits);
+    return testAll(bits);
+}
+
+bool BloomFilter::testAll(const size_t* bits) const {
+    for (unsigned i = 0; i < shape.hashes; i++) {
+        if (!test(bits[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool blockHasTransaction(const std::string& data, const std::string& tx) {
+    bool found = false;
+    forEachTransaction(data, [&](const char* begin, size_t length) {
+        found = length == tx.size() && std::memcmp(begin, tx.data(), length) == 0;
+        return !found;
+    });
+    return found;
+}
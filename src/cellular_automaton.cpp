@@ -1,4 +1,5 @@
 #include "cellular_automaton.h"
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 
@@ -59,26 +60,156 @@ int CellularAutomaton::apply_rule(int left, int center, int right) const {
  * Evolves the CA by one generation.
  * 
  * This function applies the CA rule to each cell in the current state
- * and stores the result in a new state. The new state then replaces
- * the current state.
+ * and stores the result in the scratch buffer, which is then swapped
+ * with the current state (no allocation after the first generation).
  */
 void CellularAutomaton::evolve(){
-    std::vector<int> new_state(size);
+    next_state.resize(size);
     for (size_t i = 0; i < size; i++){
         int left = state[(i-1 + size) % size];//wraps around
         int center = state[i];
         int right = state[(i+1)%size];//wraps around
-        new_state[i] = apply_rule(left,center,right);
+        next_state[i] = apply_rule(left,center,right);
     }
-    state = new_state;
+    state.swap(next_state);
 }
 
 void CellularAutomaton::evolve_steps(size_t steps){
+    if (steps > 1 && is_additive()) {
+        evolve_linear(steps);
+        return;
+    }
+    if (steps > 1 && size >= CA_TILED_MIN_CELLS) {
+        evolve_tiled(steps);
+        return;
+    }
     for (size_t i=0;i<steps;i++){
         evolve();
     }
 }
 
+/**
+ * Evolves the CA by the given number of generations with temporal
+ * blocking, for grids larger than the cache.
+ *
+ * evolve() streams the whole state through memory once per generation.
+ * Here each pass cuts the grid into tiles of tile_cells cells; a tile is
+ * copied with tile_depth extra cells on each side (wrapping) into a small
+ * buffer and advanced up to tile_depth generations there. After t
+ * generations only cells [t, n - t) of the buffer are exact (the unknown
+ * neighbors beyond its ends spread one cell per generation), so each
+ * generation computes that shrinking trapezoid, and the tile's own cells
+ * in the middle are exact when they are written back. The state is thus
+ * read and written once per tile_depth generations, and the result is
+ * the same as calling evolve() steps times, so callers such as ac_hash
+ * still land exactly on the generations they sample.
+ *
+ * @param steps Number of generations to advance
+ * @param tile_cells Cells written back per tile
+ * @param tile_depth Maximum generations per pass (the halo width)
+ */
+void CellularAutomaton::evolve_tiled(size_t steps, size_t tile_cells, size_t tile_depth){
+    if (tile_cells == 0 || tile_depth == 0) {
+        throw std::invalid_argument("Tile width and depth must be positive");
+    }
+    if (size == 0) {
+        return;
+    }
+    int table[8];
+    for (int pattern = 0; pattern < 8; pattern++) {
+        table[pattern] = (rule >> pattern) & 1;
+    }
+
+    next_state.resize(size);
+    while (steps > 0) {
+        size_t depth = std::min(steps, tile_depth);
+        for (size_t start = 0; start < size; start += tile_cells) {
+            size_t width = std::min(tile_cells, size - start);
+            size_t n = width + 2 * depth;
+            tile.resize(n);
+            tile_next.resize(n);
+            size_t cell = (start + size - depth % size) % size;
+            for (size_t j = 0; j < n; j++) {
+                tile[j] = state[cell];
+                if (++cell == size) {
+                    cell = 0;
+                }
+            }
+            for (size_t t = 1; t <= depth; t++) {
+                for (size_t j = t; j < n - t; j++) {
+                    tile_next[j] = table[(tile[j - 1] << 2) | (tile[j] << 1) | tile[j + 1]];
+                }
+                tile.swap(tile_next);
+            }
+            std::copy(tile.begin() + depth, tile.begin() + depth + width, next_state.begin() + start);
+        }
+        state.swap(next_state);
+        steps -= depth;
+    }
+}
+
+/**
+ * Checks whether the rule is additive (linear over GF(2)), i.e. the new
+ * cell is a XOR of some subset of {left, center, right}. This is the case
+ * for rules 0, 60, 90, 102, 150, 170, 204 and 240.
+ *
+ * The rule is linear iff f(000) = 0 and every pattern's output equals the
+ * XOR of the outputs of its single-bit patterns (100, 010, 001).
+ * @return True if the rule is additive, false otherwise.
+ */
+bool CellularAutomaton::is_additive() const {
+    int left = apply_rule(1, 0, 0);
+    int center = apply_rule(0, 1, 0);
+    int right = apply_rule(0, 0, 1);
+    for (int pattern = 0; pattern < 8; pattern++) {
+        int expected = (((pattern >> 2) & 1) & left) ^
+                       (((pattern >> 1) & 1) & center) ^
+                       ((pattern & 1) & right);
+        if (static_cast<int>((rule >> pattern) & 1) != expected) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Fast-forwards an additive rule by the given number of generations.
+ *
+ * One generation applies the operator T = sum of the shifts selected by the
+ * rule (S^-1 for left, I for center, S^+1 for right). Over GF(2) the shifts
+ * commute, so (a + b + c)^2 = a^2 + b^2 + c^2 and T^(2^j) is the same XOR of
+ * shifts, only by 2^j cells (this is Lucas' theorem on the binomial
+ * coefficients). T^steps is the product of T^(2^j) over the set bits of
+ * steps, so the whole jump costs O(log steps) XOR-shift passes.
+ *
+ * @param steps Number of generations to advance
+ */
+void CellularAutomaton::evolve_linear(size_t steps){
+    if (size == 0) {
+        return;
+    }
+    bool left = apply_rule(1, 0, 0) != 0;
+    bool center = apply_rule(0, 1, 0) != 0;
+    bool right = apply_rule(0, 0, 1) != 0;
+
+    next_state.resize(size);
+    size_t shift = 1 % size; //2^j mod size
+    while (steps > 0) {
+        if (steps & 1) {
+            for (size_t i = 0; i < size; i++) {
+                int cell = 0;
+                if (left) cell ^= state[(i + size - shift) % size];
+                if (center) cell ^= state[i];
+                if (right) cell ^= state[(i + shift) % size];
+                next_state[i] = cell;
+            }
+            state.swap(next_state);
+        }
+        steps >>= 1;
+        shift = (shift * 2) % size;
+    }
+}
+
 
 /**
  * Returns the current state of the cellular automaton as a vector of
@@ -91,6 +222,14 @@ std::vector<int> CellularAutomaton::get_state() const {
     return state;
 };
 
+void CellularAutomaton::copy_state(std::vector<int>& out) const {
+    out.assign(state.begin(), state.end());
+}
+
+size_t CellularAutomaton::get_size() const {
+    return size;
+}
+
 int CellularAutomaton::get_cell(size_t index) const {
     if (index >= size){
         throw std::out_of_range("Cell index out of range");
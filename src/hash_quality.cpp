@@ -0,0 +1,368 @@
+#include "hash_quality.h"
+#include "ac_hash.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+const size_t DIGEST_BYTES = 32;
+const size_t DIGEST_BITS = 256;
+const size_t SAMPLE_CHUNK = 256; //random inputs claimed at a time
+const double Z95 = 1.959964;
+const double Z99 = 2.575829;
+
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+//input number index of a stream, independent of which thread generates it
+void generate_input(uint64_t seed, uint64_t stream, uint64_t index, uint8_t* out, size_t length) {
+    uint64_t state = seed ^ (stream * 0xD1B54A32D192ED03ULL) ^ (index * 0x9E3779B97F4A7C15ULL);
+    splitmix64(state);
+    for (size_t i = 0; i < length; i += 8) {
+        uint64_t word = splitmix64(state);
+        for (size_t b = 0; b < 8 && i + b < length; b++) {
+            out[i + b] = static_cast<uint8_t>(word >> (8 * b));
+        }
+    }
+}
+
+//digest as four words, bit 63 of word 0 = first (most significant) bit
+void load_words(const uint8_t* digest, uint64_t* words) {
+    for (size_t w = 0; w < 4; w++) {
+        uint64_t value = 0;
+        for (size_t b = 0; b < 8; b++) {
+            value = (value << 8) | digest[w * 8 + b];
+        }
+        words[w] = value;
+    }
+}
+
+struct SampleTally {
+    uint64_t ones;
+    uint64_t transitions;
+    std::vector<uint64_t> byte_counts; //32 positions x 256 values
+
+    SampleTally() : ones(0), transitions(0), byte_counts(DIGEST_BYTES * 256, 0) {}
+};
+
+struct AvalancheTally {
+    uint64_t flips;
+    double flip_sum;        //sum of per-flip fractions
+    double flip_sum_sq;
+    std::vector<uint64_t> matrix; //input bit x output bit
+
+    explicit AvalancheTally(size_t input_bits)
+        : flips(0), flip_sum(0), flip_sum_sq(0), matrix(input_bits * DIGEST_BITS, 0) {}
+};
+
+/**
+ * Runs body(chunk, tally) for every chunk in [0, chunks) on the shared
+ * pool. Each pool task keeps one private tally, claims chunks from an
+ * atomic counter and merges into the result once, so workers never share
+ * counters while hashing. Serial runs tally straight into the result.
+ */
+template<typename Tally, typename Body, typename Merge>
+void run_chunks(bool serial, size_t chunks, const Tally& prototype, Tally& result, Body body, Merge merge) {
+    if (serial) {
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            body(chunk, result);
+        }
+        return;
+    }
+    std::atomic<size_t> next_chunk(0);
+    std::mutex result_mutex;
+    ThreadPool& pool = ThreadPool::instance();
+    pool.parallel_for(0, pool.size(), [&](size_t) {
+        Tally tally(prototype);
+        bool claimed = false;
+        while (true) {
+            size_t chunk = next_chunk.fetch_add(1);
+            if (chunk >= chunks) {
+                break;
+            }
+            body(chunk, tally);
+            claimed = true;
+        }
+        if (claimed) {
+            std::lock_guard<std::mutex> lock(result_mutex);
+            merge(result, tally);
+        }
+    }, 1);
+}
+
+Estimate proportion(double successes, double trials) {
+    Estimate e;
+    e.value = trials > 0 ? successes / trials : 0.0;
+    double half = trials > 0 ? Z95 * std::sqrt(e.value * (1 - e.value) / trials) : 0.0;
+    e.ci_low = e.value - half;
+    e.ci_high = e.value + half;
+    return e;
+}
+
+void write_estimate(std::ostringstream& out, const Estimate& e) {
+    out << "{\"value\": " << e.value << ", \"ci95\": [" << e.ci_low << ", " << e.ci_high << "]}";
+}
+
+}
+
+DigestFunction ac_hash_digest_function(uint32_t rule, size_t steps) {
+    return [rule, steps](const uint8_t* input, size_t length, uint8_t* digest) {
+        thread_local AcHashWorkspace workspace;
+        ac_hash_digest(input, length, rule, steps, workspace, digest);
+    };
+}
+
+DigestFunction ac_hash_r2_digest_function(uint32_t rule, size_t steps) {
+    return [rule, steps](const uint8_t* input, size_t length, uint8_t* digest) {
+        thread_local AcHashWorkspace workspace;
+        ac_hash_r2_digest(input, length, rule, steps, workspace, digest);
+    };
+}
+
+DigestFunction ac_hash_sponge_digest_function(uint32_t rule, size_t rounds) {
+    return [rule, rounds](const uint8_t* input, size_t length, uint8_t* digest) {
+        thread_local AcHashWorkspace workspace;
+        ac_hash_sponge_digest(input, length, rule, rounds, workspace, digest);
+    };
+}
+
+double normal_p_value(double z) {
+    return std::erfc(std::fabs(z) / std::sqrt(2.0));
+}
+
+double chi_square_p_value(double chi_square, double dof) {
+    if (dof <= 0) return 1.0;
+    double k = 2.0 / (9.0 * dof);
+    double z = (std::cbrt(chi_square / dof) - (1.0 - k)) / std::sqrt(k);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+/**
+ * Hashes config.samples random inputs for the distribution tests and
+ * config.avalanche_inputs inputs (each flipped at every bit) for the
+ * avalanche matrix, in parallel on the shared thread pool unless
+ * config.serial is set.
+ * @param name Label of the hash in the report
+ * @param digest Thread-safe hash function producing 32-byte digests
+ * @param config Sample counts, input length and seed
+ * @return The report; identical for any thread count
+ */
+QualityReport analyze_hash_quality(const std::string& name, const DigestFunction& digest,
+                                   const QualityConfig& config) {
+    const size_t length = std::max<size_t>(1, config.input_bytes);
+    const size_t input_bits = length * 8;
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    //distribution tests: monobit and runs with popcount, byte histograms per position
+    SampleTally samples;
+    size_t sample_chunks = (config.samples + SAMPLE_CHUNK - 1) / SAMPLE_CHUNK;
+    run_chunks(config.serial, sample_chunks, SampleTally(), samples, [&](size_t chunk, SampleTally& tally) {
+        std::vector<uint8_t> input(length);
+        uint8_t out[DIGEST_BYTES];
+        uint64_t words[4];
+        size_t end = std::min(config.samples, (chunk + 1) * SAMPLE_CHUNK);
+        for (size_t i = chunk * SAMPLE_CHUNK; i < end; i++) {
+            generate_input(config.seed, 0, i, input.data(), length);
+            digest(input.data(), length, out);
+            load_words(out, words);
+            for (size_t w = 0; w < 4; w++) {
+                tally.ones += __builtin_popcountll(words[w]);
+                //adjacent pairs inside the word, then across the word boundary
+                tally.transitions += __builtin_popcountll((words[w] ^ (words[w] >> 1)) & 0x7FFFFFFFFFFFFFFFULL);
+                if (w + 1 < 4) {
+                    tally.transitions += (words[w] ^ (words[w + 1] >> 63)) & 1;
+                }
+            }
+            for (size_t b = 0; b < DIGEST_BYTES; b++) {
+                tally.byte_counts[b * 256 + out[b]]++;
+            }
+        }
+    }, [](SampleTally& result, const SampleTally& tally) {
+        result.ones += tally.ones;
+        result.transitions += tally.transitions;
+        for (size_t i = 0; i < result.byte_counts.size(); i++) {
+            result.byte_counts[i] += tally.byte_counts[i];
+        }
+    });
+
+    //avalanche: every input bit of every avalanche input is flipped once
+    AvalancheTally avalanche(input_bits);
+    run_chunks(config.serial, config.avalanche_inputs, AvalancheTally(input_bits), avalanche,
+               [&](size_t chunk, AvalancheTally& tally) {
+        std::vector<uint8_t> input(length);
+        uint8_t base[DIGEST_BYTES];
+        uint8_t flipped[DIGEST_BYTES];
+        uint64_t base_words[4];
+        uint64_t words[4];
+        generate_input(config.seed, 1, chunk, input.data(), length);
+        digest(input.data(), length, base);
+        load_words(base, base_words);
+        for (size_t bit = 0; bit < input_bits; bit++) {
+            uint8_t mask = static_cast<uint8_t>(0x80 >> (bit % 8));
+            input[bit / 8] ^= mask;
+            digest(input.data(), length, flipped);
+            input[bit / 8] ^= mask;
+            load_words(flipped, words);
+            int changed = 0;
+            uint64_t* row = &tally.matrix[bit * DIGEST_BITS];
+            for (size_t w = 0; w < 4; w++) {
+                uint64_t diff = base_words[w] ^ words[w];
+                changed += __builtin_popcountll(diff);
+                while (diff != 0) {
+                    int j = 63 - __builtin_ctzll(diff);
+                    row[w * 64 + j]++;
+                    diff &= diff - 1;
+                }
+            }
+            double fraction = static_cast<double>(changed) / DIGEST_BITS;
+            tally.flips++;
+            tally.flip_sum += fraction;
+            tally.flip_sum_sq += fraction * fraction;
+        }
+    }, [](AvalancheTally& result, const AvalancheTally& tally) {
+        result.flips += tally.flips;
+        result.flip_sum += tally.flip_sum;
+        result.flip_sum_sq += tally.flip_sum_sq;
+        for (size_t i = 0; i < result.matrix.size(); i++) {
+            result.matrix[i] += tally.matrix[i];
+        }
+    });
+
+    QualityReport report;
+    report.name = name;
+    report.samples = config.samples;
+    report.avalanche_inputs = config.avalanche_inputs;
+    report.input_bits = input_bits;
+    report.hashes = config.samples + config.avalanche_inputs * (input_bits + 1);
+    report.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    report.hashes_per_sec = report.seconds > 0 ? report.hashes / report.seconds : 0.0;
+
+    //monobit
+    double bits = static_cast<double>(config.samples) * DIGEST_BITS;
+    report.ones_fraction = proportion(static_cast<double>(samples.ones), bits);
+    report.monobit_p = bits > 0 ? normal_p_value((samples.ones - bits / 2) / std::sqrt(bits / 4)) : 1.0;
+
+    //runs: for independent fair bits each adjacent pair differs with probability 1/2
+    double pairs = static_cast<double>(config.samples) * (DIGEST_BITS - 1);
+    report.transition_fraction = proportion(static_cast<double>(samples.transitions), pairs);
+    report.runs_p = pairs > 0 ? normal_p_value((samples.transitions - pairs / 2) / std::sqrt(pairs / 4)) : 1.0;
+
+    //per-position bias, derived from the byte histograms
+    double n = static_cast<double>(config.samples);
+    double position_chi = 0;
+    report.bit_bias_max = 0;
+    for (size_t position = 0; position < DIGEST_BITS; position++) {
+        const uint64_t* counts = &samples.byte_counts[(position / 8) * 256];
+        int shift = 7 - static_cast<int>(position % 8);
+        double ones = 0;
+        for (int value = 0; value < 256; value++) {
+            if ((value >> shift) & 1) ones += counts[value];
+        }
+        if (n > 0) {
+            position_chi += (ones - n / 2) * (ones - n / 2) / (n / 4);
+            report.bit_bias_max = std::max(report.bit_bias_max, std::fabs(ones / n - 0.5));
+        }
+    }
+    report.bit_bias_p = n > 0 ? chi_square_p_value(position_chi, DIGEST_BITS) : 1.0;
+
+    //chi-square of byte values at each position
+    double expected = n / 256;
+    report.byte_p_min = 1.0;
+    for (size_t b = 0; b < DIGEST_BYTES; b++) {
+        double chi = 0;
+        for (int value = 0; value < 256; value++) {
+            double d = samples.byte_counts[b * 256 + value] - expected;
+            chi += expected > 0 ? d * d / expected : 0.0;
+        }
+        double p = n > 0 ? chi_square_p_value(chi, 255) : 1.0;
+        report.byte_chi_square.push_back(chi);
+        report.byte_p.push_back(p);
+        report.byte_p_min = std::min(report.byte_p_min, p);
+    }
+
+    //avalanche and strict avalanche criterion
+    double flips = static_cast<double>(avalanche.flips);
+    double mean = flips > 0 ? avalanche.flip_sum / flips : 0.0;
+    double variance = flips > 1 ? (avalanche.flip_sum_sq - flips * mean * mean) / (flips - 1) : 0.0;
+    double half = flips > 0 ? Z95 * std::sqrt(std::max(0.0, variance) / flips) : 0.0;
+    report.avalanche.value = mean;
+    report.avalanche.ci_low = mean - half;
+    report.avalanche.ci_high = mean + half;
+
+    double inputs = static_cast<double>(config.avalanche_inputs);
+    double band = inputs > 0 ? Z99 * 0.5 / std::sqrt(inputs) : 0.0;
+    size_t outside = 0;
+    size_t deterministic = 0;
+    report.sac_bias_max = 0;
+    report.avalanche_matrix.resize(avalanche.matrix.size());
+    for (size_t i = 0; i < avalanche.matrix.size(); i++) {
+        double p = inputs > 0 ? avalanche.matrix[i] / inputs : 0.0;
+        report.avalanche_matrix[i] = p;
+        report.sac_bias_max = std::max(report.sac_bias_max, std::fabs(p - 0.5));
+        if (std::fabs(p - 0.5) > band) outside++;
+        if (p == 0.0 || p == 1.0) deterministic++;
+    }
+    report.sac_out_of_band = avalanche.matrix.empty() || inputs == 0
+        ? 0.0 : static_cast<double>(outside) / avalanche.matrix.size();
+    report.sac_deterministic = avalanche.matrix.empty() || inputs == 0
+        ? 0.0 : static_cast<double>(deterministic) / avalanche.matrix.size();
+    return report;
+}
+
+/**
+ * Serializes the report as one JSON object.
+ * @param include_matrix Also write the input bit x output bit flip probabilities
+ * @return The JSON text
+ */
+std::string QualityReport::to_json(bool include_matrix) const {
+    std::ostringstream out;
+    out << std::setprecision(6) << std::fixed;
+    out << "{\"name\": \"" << name << "\", \"samples\": " << samples
+        << ", \"hashes\": " << hashes << ", \"seconds\": " << seconds
+        << ", \"hashes_per_sec\": " << hashes_per_sec << ",\n";
+    out << " \"monobit\": {\"ones_fraction\": ";
+    write_estimate(out, ones_fraction);
+    out << ", \"p\": " << monobit_p << "},\n";
+    out << " \"bit_bias\": {\"max\": " << bit_bias_max << ", \"p\": " << bit_bias_p << "},\n";
+    out << " \"runs\": {\"transition_fraction\": ";
+    write_estimate(out, transition_fraction);
+    out << ", \"p\": " << runs_p << "},\n";
+    out << " \"byte_chi_square\": {\"dof\": 255, \"p_min\": " << byte_p_min << ", \"chi_square\": [";
+    for (size_t i = 0; i < byte_chi_square.size(); i++) {
+        out << (i ? ", " : "") << byte_chi_square[i];
+    }
+    out << "], \"p\": [";
+    for (size_t i = 0; i < byte_p.size(); i++) {
+        out << (i ? ", " : "") << byte_p[i];
+    }
+    out << "]},\n";
+    out << " \"avalanche\": {\"inputs\": " << avalanche_inputs << ", \"input_bits\": " << input_bits
+        << ", \"flip_fraction\": ";
+    write_estimate(out, avalanche);
+    out << ", \"sac_bias_max\": " << sac_bias_max << ", \"sac_out_of_band_99\": " << sac_out_of_band
+        << ", \"sac_deterministic\": " << sac_deterministic;
+    if (include_matrix) {
+        out << ",\n  \"matrix\": [";
+        for (size_t i = 0; i < input_bits; i++) {
+            out << (i ? ",\n   [" : "\n   [");
+            for (size_t j = 0; j < DIGEST_BITS; j++) {
+                out << (j ? "," : "") << std::setprecision(4) << avalanche_matrix[i * DIGEST_BITS + j];
+            }
+            out << "]";
+        }
+        out << "]";
+    }
+    out << "}}";
+    return out.str();
+}
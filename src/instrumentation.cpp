@@ -0,0 +1,158 @@
+#include "instrumentation.h"
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+//one block per thread, only ever written by its owner
+struct ThreadCounters {
+    std::atomic<uint64_t> calls[STAGE_COUNT];
+    std::atomic<uint64_t> cycles[STAGE_COUNT];
+    ThreadCounters* next;
+};
+
+//lock-free list of every thread's counters (blocks are never freed, so
+//threads that already exited still show up in the totals)
+std::atomic<ThreadCounters*> allCounters(nullptr);
+
+ThreadCounters& localCounters() {
+    thread_local ThreadCounters* counters = nullptr;
+    if (counters == nullptr) {
+        counters = new ThreadCounters();
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            counters->calls[s].store(0, std::memory_order_relaxed);
+            counters->cycles[s].store(0, std::memory_order_relaxed);
+        }
+        counters->next = allCounters.load(std::memory_order_relaxed);
+        while (!allCounters.compare_exchange_weak(counters->next, counters,
+                                                  std::memory_order_release,
+                                                  std::memory_order_relaxed)) {
+        }
+    }
+    return *counters;
+}
+
+//single writer per counter: a relaxed load + store is enough, no RMW needed
+inline void bump(std::atomic<uint64_t>& counter, uint64_t n) {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+}
+
+void Profiler::record(ProfileStage stage, uint64_t cycles) {
+    ThreadCounters& counters = localCounters();
+    bump(counters.calls[stage], 1);
+    bump(counters.cycles[stage], cycles);
+}
+
+void Profiler::count(ProfileStage stage, uint64_t n) {
+    bump(localCounters().calls[stage], n);
+}
+
+bool Profiler::enabled() {
+#ifdef BLOCKCHAIN_INSTRUMENT
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Sums one stage over every thread that ever recorded into it.
+ * Safe to call while other threads are still recording.
+ */
+StageTotals Profiler::totals(ProfileStage stage) {
+    StageTotals result = {0, 0, 0.0};
+    for (ThreadCounters* c = allCounters.load(std::memory_order_acquire); c != nullptr; c = c->next) {
+        result.calls += c->calls[stage].load(std::memory_order_relaxed);
+        result.cycles += c->cycles[stage].load(std::memory_order_relaxed);
+    }
+    result.seconds = result.cycles / cycles_per_second();
+    return result;
+}
+
+/**
+ * Zeroes every counter. Intended between benchmark phases; increments
+ * racing with the reset may survive it.
+ */
+void Profiler::reset() {
+    for (ThreadCounters* c = allCounters.load(std::memory_order_acquire); c != nullptr; c = c->next) {
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            c->calls[s].store(0, std::memory_order_relaxed);
+            c->cycles[s].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+const char* Profiler::stage_name(ProfileStage stage) {
+    switch (stage) {
+        case STAGE_MESSAGE: return "message";
+        case STAGE_CA_EVOLUTION: return "ca_evolution";
+        case STAGE_HISTORY_FOLD: return "history_fold";
+        case STAGE_SHA256: return "sha256";
+        case STAGE_HEX_ENCODE: return "hex_encode";
+        case STAGE_TARGET_COMPARE: return "target_compare";
+        default: return "unknown";
+    }
+}
+
+/**
+ * Timer frequency. On x86 the TSC is calibrated once against steady_clock
+ * over ~20 ms; elsewhere now() already counts nanoseconds.
+ */
+double Profiler::cycles_per_second() {
+#if defined(__x86_64__) || defined(__i386__)
+    static const double hz = []() {
+        auto wall_start = std::chrono::steady_clock::now();
+        uint64_t tsc_start = now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t tsc_end = now();
+        auto wall_end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(wall_end - wall_start).count();
+        return (tsc_end - tsc_start) / seconds;
+    }();
+    return hz;
+#else
+    return 1e9;
+#endif
+}
+
+std::string Profiler::to_json() {
+    std::ostringstream out;
+    out << "{\"enabled\": " << (enabled() ? "true" : "false")
+        << ", \"timer_hz\": " << std::fixed << std::setprecision(0) << cycles_per_second()
+        << ", \"stages\": [";
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        ProfileStage stage = static_cast<ProfileStage>(s);
+        StageTotals t = totals(stage);
+        double ns_per_call = t.calls ? t.seconds * 1e9 / t.calls : 0.0;
+        out << (s ? ", " : "")
+            << "{\"stage\": \"" << stage_name(stage) << "\""
+            << ", \"calls\": " << t.calls
+            << ", \"cycles\": " << t.cycles
+            << ", \"seconds\": " << std::setprecision(6) << t.seconds
+            << ", \"ns_per_call\": " << std::setprecision(1) << ns_per_call << "}";
+    }
+    out << "]}";
+    return out.str();
+}
+
+std::string Profiler::to_prometheus() {
+    std::ostringstream out;
+    out << "# HELP blockchain_stage_calls_total Calls per mining/hashing stage.\n"
+        << "# TYPE blockchain_stage_calls_total counter\n";
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        ProfileStage stage = static_cast<ProfileStage>(s);
+        out << "blockchain_stage_calls_total{stage=\"" << stage_name(stage) << "\"} "
+            << totals(stage).calls << "\n";
+    }
+    out << "# HELP blockchain_stage_seconds_total Time spent per mining/hashing stage.\n"
+        << "# TYPE blockchain_stage_seconds_total counter\n";
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        ProfileStage stage = static_cast<ProfileStage>(s);
+        out << "blockchain_stage_seconds_total{stage=\"" << stage_name(stage) << "\"} "
+            << std::fixed << std::setprecision(9) << totals(stage).seconds << "\n";
+    }
+    return out.str();
+}
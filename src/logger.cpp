@@ -0,0 +1,278 @@
+#include "logger.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+const char* level_name(LogLevel level) {
+    switch (level) {
+        case LOG_DEBUG: return "debug";
+        case LOG_INFO: return "info";
+        case LOG_WARN: return "warn";
+        case LOG_ERROR: return "error";
+        default: return "silent";
+    }
+}
+
+uint64_t now_micros() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+void append_json_string(std::string& out, const std::string& text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+/**
+ * Starts the background writer. Every slot's sequence starts at its own
+ * position, meaning "free for the producer of that position".
+ */
+Logger::Logger()
+    : ring(new Slot[LOG_RING_CAPACITY]), enqueue_pos(0), dequeue_pos(0), min_level(LOG_INFO),
+      format(LOG_TEXT), lost(0), written(0), out(&std::cout), stopping(false) {
+    for (size_t i = 0; i < LOG_RING_CAPACITY; i++) {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    writer = std::thread(&Logger::writer_loop, this);
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    writer.join();
+    drain();
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+void Logger::set_level(LogLevel level) {
+    min_level.store(level, std::memory_order_relaxed);
+}
+
+LogLevel Logger::level() const {
+    return static_cast<LogLevel>(min_level.load(std::memory_order_relaxed));
+}
+
+void Logger::set_format(LogFormat f) {
+    format.store(f, std::memory_order_relaxed);
+}
+
+void Logger::set_output(std::ostream* stream) {
+    flush();
+    std::lock_guard<std::mutex> lock(write_mutex);
+    out = stream;
+}
+
+/**
+ * Queues a free-text record.
+ * @param level Severity, dropped below the current level
+ * @param text The message, moved into the record
+ */
+void Logger::log(LogLevel level, std::string text) {
+    if (!enabled(level)) {
+        return;
+    }
+    LogRecord record = LogRecord();
+    record.event = EVENT_MESSAGE;
+    record.level = level;
+    record.timestampMicros = now_micros();
+    record.text = std::move(text);
+    push(record);
+}
+
+/**
+ * Queues a block-mined event (INFO). Nothing is formatted here; the
+ * writer thread turns the fields into text or JSON.
+ */
+void Logger::block_mined(uint64_t index, uint64_t nonce, uint64_t extraNonce, double millis,
+                         HashMode mode, uint32_t rule, size_t steps) {
+    if (!enabled(LOG_INFO)) {
+        return;
+    }
+    LogRecord record = LogRecord();
+    record.event = EVENT_BLOCK_MINED;
+    record.level = LOG_INFO;
+    record.timestampMicros = now_micros();
+    record.index = index;
+    record.nonce = nonce;
+    record.extraNonce = extraNonce;
+    record.millis = millis;
+    record.mode = mode;
+    record.rule = rule;
+    record.steps = steps;
+    push(record);
+}
+
+/**
+ * Bounded multi-producer queue (per-slot sequence numbers): a producer
+ * claims a position with one CAS, fills the slot and publishes it by
+ * advancing the slot's sequence. A slot whose sequence lags its position
+ * still holds an unread record, so the ring is full and the record is
+ * dropped instead of blocking the producer. The producer that makes an
+ * empty ring non-empty wakes the writer, which sleeps while it is empty.
+ */
+bool Logger::push(LogRecord& record) {
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& slot = ring[pos & (LOG_RING_CAPACITY - 1)];
+        size_t seq = slot.sequence.load(std::memory_order_acquire);
+        if (seq == pos) {
+            //seq_cst pairs with the writer's dequeue_pos store and empty() check: either the
+            //writer sees this position claimed, or we see it caught up with us and wake it
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst,
+                                                  std::memory_order_relaxed)) {
+                slot.record = std::move(record);
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                if (dequeue_pos.load(std::memory_order_seq_cst) == pos) {
+                    std::lock_guard<std::mutex> lock(wake_mutex);
+                    wake.notify_one();
+                }
+                return true;
+            }
+        } else if (seq < pos) {
+            lost.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+//single consumer: only the thread holding write_mutex pops
+bool Logger::pop(LogRecord& record) {
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    Slot& slot = ring[pos & (LOG_RING_CAPACITY - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+        return false;
+    }
+    record = std::move(slot.record);
+    dequeue_pos.store(pos + 1, std::memory_order_seq_cst);
+    slot.sequence.store(pos + LOG_RING_CAPACITY, std::memory_order_release);
+    return true;
+}
+
+size_t Logger::drain() {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    LogFormat f = static_cast<LogFormat>(format.load(std::memory_order_relaxed));
+    std::string batch;
+    LogRecord record;
+    size_t count = 0;
+    while (pop(record)) {
+        batch += format_record(record, f);
+        batch += '\n';
+        count++;
+    }
+    if (count > 0) {
+        out->write(batch.data(), static_cast<std::streamsize>(batch.size()));
+        out->flush();
+        written.fetch_add(count, std::memory_order_release);
+    }
+    return count;
+}
+
+bool Logger::empty() const {
+    return enqueue_pos.load(std::memory_order_seq_cst) == dequeue_pos.load(std::memory_order_seq_cst);
+}
+
+/**
+ * Drains the ring, then sleeps until a producer makes it non-empty and
+ * another LOG_FLUSH_MILLIS, so a burst of records is written as one batch
+ * and an idle logger never wakes up.
+ */
+void Logger::writer_loop() {
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    while (!stopping) {
+        lock.unlock();
+        drain();
+        lock.lock();
+        drained.notify_all();
+        wake.wait(lock, [this]() { return stopping || !empty(); });
+        if (!stopping) {
+            wake.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_MILLIS));
+        }
+    }
+}
+
+/**
+ * Waits until the writer has written every record queued before this
+ * call (records dropped on a full ring are not waited for).
+ */
+void Logger::flush() {
+    //dropped records never claim a position, so every claimed position gets written
+    uint64_t target = enqueue_pos.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    while (written.load(std::memory_order_acquire) < target && !stopping) {
+        wake.notify_all();
+        drained.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_MILLIS));
+    }
+}
+
+uint64_t Logger::dropped() const {
+    return lost.load(std::memory_order_relaxed);
+}
+
+/**
+ * Formats one record as a line (without the newline).
+ * @param record The record to format
+ * @param format LOG_TEXT or LOG_JSON
+ * @return The formatted line
+ */
+std::string Logger::format_record(const LogRecord& record, LogFormat format) {
+    if (format == LOG_TEXT) {
+        if (record.event == EVENT_BLOCK_MINED) {
+            std::ostringstream line;
+            line << "Block #" << record.index << " mined in " << static_cast<long long>(record.millis) << " ms "
+                 << "(" << hashModeToString(record.mode) << ", " << record.nonce << " iterations";
+            if (record.extraNonce != 0) {
+                line << ", extra nonce " << record.extraNonce;
+            }
+            line << ")";
+            return line.str();
+        }
+        if (record.level >= LOG_WARN) {
+            return std::string(record.level == LOG_WARN ? "[WARN] " : "[ERROR] ") + record.text;
+        }
+        return record.text;
+    }
+
+    std::ostringstream json;
+    json << "{\"time_us\": " << record.timestampMicros << ", \"level\": \"" << level_name(record.level) << "\", ";
+    if (record.event == EVENT_BLOCK_MINED) {
+        json << "\"event\": \"block_mined\", \"index\": " << record.index << ", \"nonce\": " << record.nonce
+             << ", \"extra_nonce\": " << record.extraNonce << ", \"millis\": " << record.millis
+             << ", \"mode\": \"" << hashModeToString(record.mode) << "\", \"rule\": " << record.rule
+             << ", \"steps\": " << record.steps << "}";
+        return json.str();
+    }
+    std::string line = json.str() + "\"event\": \"message\", \"text\": ";
+    append_json_string(line, record.text);
+    return line + "}";
+}
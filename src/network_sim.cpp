@@ -0,0 +1,309 @@
+#include "network_sim.h"
+#include "block_header.h"
+#include "pow.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+const size_t NO_NODE = static_cast<size_t>(-1);
+
+//uniform in (0, 1], 53 random bits
+double uniformOpen(std::mt19937_64& rng) {
+    return static_cast<double>((rng() >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+//nearest-rank percentile of sorted samples (0 when there are none)
+double percentileOf(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+} // namespace
+
+/**
+ * Defaults: 8 fully meshed nodes, 50 ms links at 1 MB/s, 10 kH/s per
+ * node, 14-bit SHA-256 target (a block every ~200 ms network-wide), 1 KB
+ * blocks, 100 blocks.
+ */
+NetworkConfig defaultNetworkConfig() {
+    NetworkConfig config;
+    config.nodes = 8;
+    config.peers = 0;
+    config.latencyMillis = 50.0;
+    config.jitterMillis = 10.0;
+    config.bandwidthBytesPerMilli = 1000.0;
+    config.hashesPerSecond = 10000.0;
+    config.validateMillis = 0.5;
+    config.difficultyBits = 14;
+    config.mode = SHA256_MODE;
+    config.rule = 30;
+    config.steps = 128;
+    config.payloadBytes = 1024;
+    config.blocks = 100;
+    config.seed = 1;
+    return config;
+}
+
+/**
+ * Builds the topology: a full mesh, or a ring (so the graph is connected)
+ * plus random links until every node has config.peers of them. Each link
+ * gets its latency, including jitter, once; both directions share it.
+ * @param cfg The network to simulate
+ * @throws std::invalid_argument for fewer than 2 nodes or no hash rate
+ */
+NetworkSimulator::NetworkSimulator(const NetworkConfig& cfg)
+    : config(cfg), target(Target::fromLeadingZeroBits(cfg.difficultyBits)), rng(cfg.seed), nextSeq(0),
+      stats(NetworkStats()) {
+    if (config.nodes < 2) {
+        throw std::invalid_argument("A network needs at least 2 nodes");
+    }
+    if (config.hashesPerSecond <= 0) {
+        throw std::invalid_argument("hashesPerSecond must be positive");
+    }
+    size_t n = config.nodes;
+    nodes.resize(n);
+    std::vector<std::vector<char>> linked(n, std::vector<char>(n, 0));
+    auto addLink = [&](size_t a, size_t b) {
+        if (a == b || linked[a][b]) {
+            return;
+        }
+        linked[a][b] = linked[b][a] = 1;
+        double latency = config.latencyMillis + config.jitterMillis * (1.0 - uniformOpen(rng));
+        Link ab = {b, latency, 0.0};
+        Link ba = {a, latency, 0.0};
+        nodes[a].links.push_back(ab);
+        nodes[b].links.push_back(ba);
+    };
+    if (config.peers == 0 || config.peers >= n - 1) {
+        for (size_t a = 0; a < n; a++) {
+            for (size_t b = a + 1; b < n; b++) {
+                addLink(a, b);
+            }
+        }
+    } else {
+        for (size_t a = 0; a < n; a++) {
+            addLink(a, (a + 1) % n);
+        }
+        for (size_t a = 0; a < n; a++) {
+            for (size_t tries = 0; nodes[a].links.size() < config.peers && tries < 8 * n; tries++) {
+                addLink(a, static_cast<size_t>(rng() % n));
+            }
+        }
+    }
+}
+
+void NetworkSimulator::push(double time, SimEventType type, size_t node, size_t block, size_t from,
+                            uint64_t epoch) {
+    SimEvent event = {time, nextSeq++, type, node, block, from, epoch};
+    events.push(event);
+}
+
+/**
+ * Schedules the node's next block on its current tip: the number of
+ * attempts until a hash meets the target is geometric with p = 2^-bits.
+ */
+void NetworkSimulator::scheduleMining(size_t node, double now) {
+    double p = std::ldexp(1.0, -static_cast<int>(config.difficultyBits));
+    double attempts = p >= 1.0 ? 1.0 : std::floor(std::log(uniformOpen(rng)) / std::log1p(-p)) + 1.0;
+    push(now + attempts / config.hashesPerSecond * 1000.0, SIM_MINED, node, 0, NO_NODE, nodes[node].epoch);
+}
+
+/**
+ * Creates and really mines a block on the node's tip, stamped with the
+ * virtual time, and registers it with every node as unknown.
+ * @return The new block id
+ */
+size_t NetworkSimulator::mineBlock(size_t node, double now) {
+    size_t parent = node == NO_NODE ? 0 : nodes[node].tip;
+    std::string parentHash = blocks.empty() ? "0" : blocks[parent].block->getHash();
+    size_t height = blocks.empty() ? 0 : blocks[parent].height + 1;
+
+    std::string data = "node " + std::to_string(node == NO_NODE ? 0 : node) + " block " +
+                       std::to_string(blocks.size()) + ";";
+    if (data.size() < config.payloadBytes) {
+        data.resize(config.payloadBytes, 'x');
+    }
+    BlockHeader header = BlockHeader::create(static_cast<int>(height), static_cast<uint64_t>(now), parentHash,
+                                             data, target, config.mode, config.rule, config.steps);
+    std::string hash = ProofOfWork::mineHeader(header);
+
+    SimBlock sim;
+    sim.bytes = header.encodedSize() + data.size();
+    sim.block.reset(new BlockPow(header, std::move(parentHash), std::move(hash), std::move(data)));
+    sim.parent = parent;
+    sim.height = height;
+    sim.miner = node;
+    sim.minedAt = now;
+    sim.acceptedBy = 0;
+    blocks.push_back(std::move(sim));
+    for (auto& n : nodes) {
+        n.status.push_back(UNKNOWN);
+    }
+    return blocks.size() - 1;
+}
+
+/**
+ * A block arrives: duplicates are dropped, anything else is verified
+ * (real hashing, timed) and finishes validating validateMillis after the
+ * node is free.
+ */
+void NetworkSimulator::receive(size_t node, size_t block, size_t from, double now) {
+    Node& n = nodes[node];
+    if (n.status[block] != UNKNOWN) {
+        return;
+    }
+    const BlockPow& b = *blocks[block].block;
+    auto start = std::chrono::steady_clock::now();
+    bool valid = ProofOfWork::verifyHeader(b.getHeader(), b.getHash());
+    stats.validationSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.validations++;
+    if (!valid) {
+        n.status[block] = INVALID;
+        stats.invalidBlocks++;
+        return;
+    }
+    n.status[block] = VALIDATING;
+    n.busyUntil = std::max(now, n.busyUntil) + config.validateMillis;
+    push(n.busyUntil, SIM_VALIDATED, node, block, from, 0);
+}
+
+/**
+ * Accepts a validated block whose parent is known, then any blocks that
+ * were waiting for it. A longer chain becomes the tip (the miner restarts
+ * on it) and every accepted block is relayed to the other peers.
+ */
+void NetworkSimulator::connect(size_t node, size_t block, size_t from, double now) {
+    Node& n = nodes[node];
+    std::vector<std::pair<size_t, size_t>> ready(1, std::make_pair(block, from));
+    while (!ready.empty()) {
+        size_t id = ready.back().first;
+        size_t sender = ready.back().second;
+        ready.pop_back();
+        n.status[id] = ACCEPTED;
+
+        SimBlock& sim = blocks[id];
+        sim.acceptedBy++;
+        if (node != sim.miner) {
+            propagation.push_back(now - sim.minedAt);
+        }
+        if (sim.acceptedBy == nodes.size()) {
+            fullPropagation.push_back(now - sim.minedAt);
+        }
+        if (sim.height > blocks[n.tip].height) {
+            n.tip = id;
+            n.epoch++;
+            scheduleMining(node, now);
+        }
+        relay(node, id, sender, now);
+
+        for (size_t i = 0; i < n.waiting.size();) {
+            if (n.waiting[i].first == id) {
+                ready.push_back(std::make_pair(n.waiting[i].second, NO_NODE));
+                n.waiting[i] = n.waiting.back();
+                n.waiting.pop_back();
+            } else {
+                i++;
+            }
+        }
+    }
+}
+
+//sends the block on every link but the one it came from, each link one block at a time
+void NetworkSimulator::relay(size_t node, size_t block, size_t from, double now) {
+    const SimBlock& sim = blocks[block];
+    for (auto& link : nodes[node].links) {
+        if (link.peer == from) {
+            continue;
+        }
+        double transfer = config.bandwidthBytesPerMilli > 0 ? sim.bytes / config.bandwidthBytesPerMilli : 0.0;
+        double departure = std::max(now, link.busyUntil);
+        link.busyUntil = departure + transfer;
+        push(link.busyUntil + link.latency, SIM_ARRIVE, link.peer, block, node, 0);
+        stats.messages++;
+        stats.bytesSent += sim.bytes;
+    }
+}
+
+/**
+ * Mines a shared genesis block, starts every miner and processes events
+ * in virtual-time order. Mining stops after config.blocks blocks; the
+ * remaining relays are still delivered so the network settles.
+ * @return Orphan rate, propagation percentiles and validation throughput
+ */
+NetworkStats NetworkSimulator::run() {
+    auto wallStart = std::chrono::steady_clock::now();
+    size_t genesis = mineBlock(NO_NODE, 0.0);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodes[i].status[genesis] = ACCEPTED;
+        nodes[i].tip = genesis;
+        nodes[i].epoch = 0;
+        nodes[i].busyUntil = 0.0;
+    }
+    blocks[genesis].acceptedBy = nodes.size();
+    for (size_t i = 0; i < nodes.size(); i++) {
+        scheduleMining(i, 0.0);
+    }
+
+    double now = 0.0;
+    while (!events.empty()) {
+        SimEvent event = events.top();
+        events.pop();
+        if (event.type == SIM_MINED &&
+            (event.epoch != nodes[event.node].epoch || stats.blocksMined >= config.blocks)) {
+            continue; //the miner moved to another tip, or mining is over
+        }
+        now = event.time;
+        switch (event.type) {
+            case SIM_MINED: {
+                size_t id = mineBlock(event.node, now);
+                stats.blocksMined++;
+                nodes[event.node].status[id] = VALIDATING;
+                connect(event.node, id, NO_NODE, now);
+                break;
+            }
+            case SIM_ARRIVE:
+                receive(event.node, event.block, event.from, now);
+                break;
+            case SIM_VALIDATED: {
+                Node& n = nodes[event.node];
+                size_t parent = blocks[event.block].parent;
+                if (n.status[parent] == ACCEPTED) {
+                    connect(event.node, event.block, event.from, now);
+                } else {
+                    n.status[event.block] = WAITING_PARENT;
+                    n.waiting.push_back(std::make_pair(parent, event.block));
+                }
+                break;
+            }
+        }
+    }
+
+    stats.virtualMillis = now;
+    stats.mainChainLength = blocks[nodes[0].tip].height;
+    stats.staleBlocks = stats.blocksMined - stats.mainChainLength;
+    stats.orphanRate = stats.blocksMined == 0 ? 0.0 : static_cast<double>(stats.staleBlocks) / stats.blocksMined;
+    stats.nodesOnTip = 0;
+    for (const auto& n : nodes) {
+        if (n.tip == nodes[0].tip) {
+            stats.nodesOnTip++;
+        }
+    }
+    std::sort(propagation.begin(), propagation.end());
+    std::sort(fullPropagation.begin(), fullPropagation.end());
+    stats.propagationP50 = percentileOf(propagation, 50);
+    stats.propagationP90 = percentileOf(propagation, 90);
+    stats.propagationP99 = percentileOf(propagation, 99);
+    stats.propagationMax = propagation.empty() ? 0.0 : propagation.back();
+    stats.fullPropagationP50 = percentileOf(fullPropagation, 50);
+    stats.fullPropagationP99 = percentileOf(fullPropagation, 99);
+    stats.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    stats.validatedPerSecond = stats.validationSeconds > 0 ? stats.validations / stats.validationSeconds : 0.0;
+    return stats;
+}
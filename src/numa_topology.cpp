@@ -0,0 +1,231 @@
+#include "numa_topology.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+//memory policy modes from <linux/mempolicy.h> (not installed everywhere)
+const int MPOL_DEFAULT_MODE = 0;
+const int MPOL_PREFERRED_MODE = 1;
+const int MPOL_INTERLEAVE_MODE = 3;
+const unsigned long MAX_NODES = 8 * sizeof(unsigned long);
+
+unsigned long all_nodes_mask() {
+    unsigned long mask = 0;
+    for (const NumaNode& node : NumaTopology::system().get_nodes()) {
+        if (node.id >= 0 && static_cast<unsigned long>(node.id) < MAX_NODES) {
+            mask |= 1UL << node.id;
+        }
+    }
+    return mask;
+}
+
+}
+
+/**
+ * Parses a sysfs CPU list such as "0-3,8-11" into individual CPU ids.
+ * @param list The comma separated list of CPUs and CPU ranges
+ * @return The CPU ids, in the order they appear
+ */
+std::vector<int> NumaTopology::parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty() || item[0] == '\n') {
+            continue;
+        }
+        size_t dash = item.find('-');
+        int first = std::atoi(item.c_str());
+        int last = (dash == std::string::npos) ? first : std::atoi(item.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+/**
+ * Discovers the NUMA nodes and their CPUs from `<sysfs_root>/nodeN/cpulist`.
+ * Memory-only nodes (no CPUs) are skipped. If nothing usable is found the
+ * topology falls back to a single node 0 with all hardware threads.
+ * @param sysfs_root Directory holding the nodeN entries
+ * @return The discovered topology
+ */
+NumaTopology NumaTopology::discover(const std::string& sysfs_root) {
+    NumaTopology topology;
+#ifdef __linux__
+    DIR* dir = opendir(sysfs_root.c_str());
+    if (dir != nullptr) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            std::string name = entry->d_name;
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+                name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue;
+            }
+            std::ifstream file(sysfs_root + "/" + name + "/cpulist");
+            std::string list;
+            if (!std::getline(file, list)) {
+                continue;
+            }
+            NumaNode node;
+            node.id = std::atoi(name.c_str() + 4);
+            node.cpus = parse_cpu_list(list);
+            if (!node.cpus.empty()) {
+                topology.nodes.push_back(node);
+            }
+        }
+        closedir(dir);
+    }
+#else
+    (void)sysfs_root;
+#endif
+    if (topology.nodes.empty()) {
+        NumaNode node;
+        node.id = 0;
+        unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned cpu = 0; cpu < hw; cpu++) {
+            node.cpus.push_back(static_cast<int>(cpu));
+        }
+        topology.nodes.push_back(node);
+    }
+    std::sort(topology.nodes.begin(), topology.nodes.end(),
+              [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+    return topology;
+}
+
+const NumaTopology& NumaTopology::system() {
+    static NumaTopology topology = discover();
+    return topology;
+}
+
+size_t NumaTopology::node_count() const {
+    return nodes.size();
+}
+
+bool NumaTopology::is_numa() const {
+    return nodes.size() > 1;
+}
+
+const std::vector<NumaNode>& NumaTopology::get_nodes() const {
+    return nodes;
+}
+
+/**
+ * Spreads workers over the nodes round-robin (worker 0 on the first node,
+ * worker 1 on the second, ...), so every socket gets its share of workers.
+ */
+const NumaNode& NumaTopology::node_for_worker(size_t worker) const {
+    return nodes[worker % nodes.size()];
+}
+
+int NumaTopology::node_of_cpu(int cpu) const {
+    for (const NumaNode& node : nodes) {
+        if (std::find(node.cpus.begin(), node.cpus.end(), cpu) != node.cpus.end()) {
+            return node.id;
+        }
+    }
+    return nodes.front().id;
+}
+
+int NumaTopology::current_node() const {
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu >= 0) {
+        return node_of_cpu(cpu);
+    }
+#endif
+    return nodes.front().id;
+}
+
+/**
+ * Allocates page-aligned memory whose pages are preferably placed on the
+ * given node (MPOL_PREFERRED, so a full node still falls back elsewhere).
+ * On single-node machines or without mbind() support this is a plain
+ * anonymous mapping. Must be freed with release().
+ * @param bytes Size of the allocation
+ * @param node Node id to place the pages on
+ * @return Pointer to the memory, nullptr on failure
+ */
+void* NumaTopology::allocate_on_node(size_t bytes, int node) {
+#ifdef __linux__
+    void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return nullptr;
+    }
+    if (system().is_numa() && node >= 0 && static_cast<unsigned long>(node) < MAX_NODES) {
+        unsigned long mask = 1UL << node;
+        syscall(SYS_mbind, ptr, bytes, MPOL_PREFERRED_MODE, &mask, MAX_NODES + 1, 0);
+    }
+    return ptr;
+#else
+    (void)node;
+    return std::malloc(bytes);
+#endif
+}
+
+/**
+ * Allocates page-aligned memory whose pages are interleaved round-robin
+ * over all nodes. Must be freed with release().
+ */
+void* NumaTopology::allocate_interleaved(size_t bytes) {
+#ifdef __linux__
+    void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return nullptr;
+    }
+    if (system().is_numa()) {
+        unsigned long mask = all_nodes_mask();
+        syscall(SYS_mbind, ptr, bytes, MPOL_INTERLEAVE_MODE, &mask, MAX_NODES + 1, 0);
+    }
+    return ptr;
+#else
+    return std::malloc(bytes);
+#endif
+}
+
+void NumaTopology::release(void* ptr, size_t bytes) {
+    if (ptr == nullptr) {
+        return;
+    }
+#ifdef __linux__
+    munmap(ptr, bytes);
+#else
+    (void)bytes;
+    std::free(ptr);
+#endif
+}
+
+/**
+ * Sets the calling thread's memory policy for pages it touches from now on
+ * (heap growth, std::vector buffers, ...): interleaved over all nodes, or
+ * back to the default local first-touch policy.
+ * @param interleave True for interleaved, false for the default policy
+ * @return True if the kernel accepted the policy
+ */
+bool NumaTopology::set_thread_interleaved(bool interleave) {
+#ifdef __linux__
+    if (!system().is_numa()) {
+        return false;
+    }
+    if (interleave) {
+        unsigned long mask = all_nodes_mask();
+        return syscall(SYS_set_mempolicy, MPOL_INTERLEAVE_MODE, &mask, MAX_NODES + 1) == 0;
+    }
+    return syscall(SYS_set_mempolicy, MPOL_DEFAULT_MODE, nullptr, 0) == 0;
+#else
+    (void)interleave;
+    return false;
+#endif
+}
@@ -1,13 +1,219 @@
 #include "pow.h"
 #include "utils.h"
 #include "ac_hash.h"
+#include "ac_hash_parallel.h"
+#include "thread_pool.h"
+#include "numa_topology.h"
+#include "instrumentation.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <stdexcept>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <new>
 #include <sstream>
+#include <vector>
+
+namespace {
+
+//nonces handed to a worker at a time
+const uint64_t NONCE_CHUNK = 64;
+//"not found"; never a valid nonce since nonce ranges are exclusive of it
+const uint64_t NO_NONCE = UINT64_MAX;
+
+//per-thread mining state: message buffer, AC_HASH buffers and result slot
+struct MiningWorkspace {
+    std::string message;
+    uint8_t header[BlockHeader::MAX_ENCODED_SIZE];
+    AcHashWorkspace acHash;
+    unsigned long long search; //search the result slot belongs to
+    uint64_t foundNonce;
+    std::string foundHash;
+};
+
+std::atomic<unsigned long long> searchCounter(0);
+
+/**
+ * Owns the calling thread's MiningWorkspace. It is created lazily by the
+ * thread itself in memory placed on the NUMA node that thread runs on
+ * (pool workers are pinned per node on NUMA hosts). The buffers inside
+ * grow from that same thread, so first-touch keeps them node-local too.
+ */
+class WorkspaceHolder {
+private:
+    MiningWorkspace* workspace;
+
+public:
+    WorkspaceHolder() : workspace(nullptr) {}
+    ~WorkspaceHolder() {
+        if (workspace != nullptr) {
+            workspace->~MiningWorkspace();
+            NumaTopology::release(workspace, sizeof(MiningWorkspace));
+        }
+    }
+    MiningWorkspace& get() {
+        if (workspace == nullptr) {
+            int node = NumaTopology::system().current_node();
+            void* memory = NumaTopology::allocate_on_node(sizeof(MiningWorkspace), node);
+            if (memory == nullptr) {
+                throw std::bad_alloc();
+            }
+            workspace = new (memory) MiningWorkspace();
+            workspace->search = 0;
+        }
+        return *workspace;
+    }
+};
+
+thread_local WorkspaceHolder tlsWorkspace;
+
+//the proof-of-work hash of a message in the given mode; large AC_HASH
+//payloads are split across the pool (same hash, see ac_hash_parallel)
+std::string hashBytes(const uint8_t* input, size_t length, HashMode mode, uint32_t rule, size_t steps,
+                      AcHashWorkspace& workspace) {
+    switch (mode) {
+        case SHA256_MODE:
+            return sha256(input, length);
+        case AC_HASH_R2_MODE:
+            return ac_hash_r2(input, length, rule, steps, workspace);
+        case AC_HASH_SPONGE_MODE:
+            return ac_hash_sponge(input, length, rule, steps, workspace);
+        case AC_HASH_MODE:
+            if (length >= AC_HASH_PARALLEL_MIN_BYTES) {
+                return ac_hash_parallel(input, length, rule, steps, ThreadPool::instance());
+            }
+            return ac_hash(input, length, rule, steps, workspace);
+    }
+    throw std::invalid_argument("Unknown hash mode " + std::to_string(static_cast<int>(mode)));
+}
+
+//hashBytes into a 32-byte digest, for header-sized inputs (no hex, no pool)
+void digestBytes(const uint8_t* input, size_t length, HashMode mode, uint32_t rule, size_t steps,
+                 AcHashWorkspace& workspace, uint8_t* digest) {
+    switch (mode) {
+        case SHA256_MODE:
+            sha256Digest(input, length, digest);
+            break;
+        case AC_HASH_R2_MODE:
+            ac_hash_r2_digest(input, length, rule, steps, workspace, digest);
+            break;
+        case AC_HASH_SPONGE_MODE:
+            ac_hash_sponge_digest(input, length, rule, steps, workspace, digest);
+            break;
+        case AC_HASH_MODE:
+            ac_hash_digest(input, length, rule, steps, workspace, digest);
+            break;
+        default:
+            throw std::invalid_argument("Unknown hash mode " + std::to_string(static_cast<int>(mode)));
+    }
+}
+
+//branch-free 32-byte compare, four 64-bit words
+bool sameDigest(const uint8_t* a, const uint8_t* b) {
+    uint64_t diff = 0;
+    for (size_t w = 0; w < DIGEST_SIZE / 8; w++) {
+        uint64_t x, y;
+        std::memcpy(&x, a + 8 * w, 8);
+        std::memcpy(&y, b + 8 * w, 8);
+        diff |= x ^ y;
+    }
+    return diff == 0;
+}
+
+bool sameKernel(const BlockHeader& a, const BlockHeader& b) {
+    return a.hashMode == b.hashMode && a.rule == b.rule && a.steps == b.steps;
+}
+
+/**
+ * Searches [first, limit) for the smallest nonce whose hash meets the
+ * target, on the shared thread pool. Workers claim consecutive chunks of
+ * nonces from an atomic counter and stop claiming once a chunk starts past
+ * the best nonce found so far; since every earlier chunk is scanned to the
+ * end, the result is the same nonce a sequential search would return.
+ * @param hashAt Computes the hash for a given nonce using the worker's workspace
+ * @param target Hashes must be <= this 256-bit target
+ * @param first First nonce to try
+ * @param limit End of the nonce space (exclusive, below NO_NONCE)
+ * @param nonce Receives the winning nonce
+ * @param hash Receives the winning hash
+ * @return False if no nonce in the range meets the target
+ */
+bool searchNonce(const std::function<std::string(uint64_t, MiningWorkspace&)>& hashAt,
+                 const Target& target, uint64_t first, uint64_t limit,
+                 uint64_t& nonce, std::string& hash) {
+    if (first >= limit) {
+        return false;
+    }
+    unsigned long long search = ++searchCounter;
+    uint64_t span = limit - first;
+    uint64_t chunks = span / NONCE_CHUNK + (span % NONCE_CHUNK != 0);
+    std::atomic<uint64_t> nextChunk(0);
+    std::atomic<uint64_t> best(NO_NONCE);
+    std::mutex slotsMutex;
+    std::vector<MiningWorkspace*> slots;
+
+    ThreadPool& pool = ThreadPool::instance();
+    pool.parallel_for(0, pool.size(), [&](size_t) {
+        MiningWorkspace& workspace = tlsWorkspace.get();
+        if (workspace.search != search) {
+            //first task of this search on this thread: claim the result slot
+            workspace.search = search;
+            workspace.foundNonce = NO_NONCE;
+            std::lock_guard<std::mutex> lock(slotsMutex);
+            slots.push_back(&workspace);
+        }
+        while (true) {
+            uint64_t chunk = nextChunk.fetch_add(1);
+            if (chunk >= chunks) {
+                return;
+            }
+            uint64_t start = first + chunk * NONCE_CHUNK;
+            uint64_t end = limit - start > NONCE_CHUNK ? start + NONCE_CHUNK : limit;
+            if (start >= best.load()) {
+                return;
+            }
+            for (uint64_t n = start; n < end && n < best.load(); n++) {
+                std::string candidate = hashAt(n, workspace);
+                bool found;
+                {
+                    PROFILE_SCOPE(STAGE_TARGET_COMPARE);
+                    found = target.isMetBy(candidate);
+                }
+                if (found) {
+                    if (n < workspace.foundNonce) {
+                        workspace.foundNonce = n;
+                        workspace.foundHash = candidate;
+                    }
+                    uint64_t current = best.load();
+                    while (n < current && !best.compare_exchange_weak(current, n)) {
+                    }
+                    return;
+                }
+            }
+        }
+    }, 1);
+
+    if (best.load() == NO_NONCE) {
+        return false;
+    }
+    nonce = best.load();
+    for (MiningWorkspace* workspace : slots) {
+        if (workspace->foundNonce == nonce) {
+            hash = workspace->foundHash;
+        }
+    }
+    return true;
+}
+
+}
 
 /**
  * Computes a hash based on the given data and hash mode.
  * If the mode is SHA256_MODE, it uses the sha256 function
- * to compute the hash. If the mode is AC_HASH_MODE, it uses
- * the ac_hash function with the given rule and steps.
+ * to compute the hash. Otherwise it uses ac_hash, ac_hash_r2 or
+ * ac_hash_sponge with the given rule and steps.
  * @param data The data to be hashed
  * @param mode The hash mode to use (SHA256_MODE or AC_HASH_MODE)
  * @param rule The CA rule to use (only for AC_HASH_MODE)
@@ -18,11 +224,8 @@ std::string ProofOfWork::computeHash(
     const std::string& data, HashMode mode, 
     uint32_t rule, 
     size_t steps) {
-    if (mode == SHA256_MODE) {
-        return sha256(data);
-    } else {
-        return ac_hash(data, rule, steps);
-    }
+    AcHashWorkspace& workspace = tlsWorkspace.get().acHash;
+    return hashBytes(reinterpret_cast<const uint8_t*>(data.data()), data.size(), mode, rule, steps, workspace);
 }
 
 /**
@@ -30,26 +233,28 @@ std::string ProofOfWork::computeHash(
  * @param data The data to be added to the block
  * @param previousHash The hash of the previous block in the blockchain
  * @param difficulty The difficulty of the blockchain
- * @param nonce The nonce value to be used in the block
- * @return The newly mined block hash
+ * @param nonce The first nonce to try, receives the winning nonce
+ * @return The newly mined block hash (empty if the nonce space ran out)
  */
 
 std::string ProofOfWork::mineBlock(const std::string& data, const std::string& previousHash, 
-                                  int difficulty, int& nonce) {
-    std::string target(difficulty, '0');
-    std::string blockData = data + previousHash + std::to_string(nonce);
-    std::string hash = sha256(blockData);
-
-    while (hash.substr(0, difficulty) != target) {
-        nonce++;
-        blockData = data + previousHash + std::to_string(nonce);
-        hash = sha256(blockData);
-    }
+                                  int difficulty, uint64_t& nonce) {
+    std::string prefix = data + previousHash;
+    std::string hash;
+    searchNonce([&](uint64_t n, MiningWorkspace& workspace) {
+        {
+            PROFILE_SCOPE(STAGE_MESSAGE);
+            workspace.message.assign(prefix);
+            workspace.message += std::to_string(n);
+        }
+        return sha256(workspace.message);
+    }, Target::fromNibbles(difficulty), nonce, NO_NONCE, nonce, hash);
     return hash;
 }
 
 /**
- * Mines a block by incrementing the nonce until a hash with the given difficulty is found.
+ * Mines a block by searching nonces from 0 until a hash with the given difficulty is found.
+ * The search runs on the shared ThreadPool and returns the smallest valid nonce.
  * @param data The data to be hashed.
  * @param previousHash The previous hash in the blockchain.
  * @param difficulty The difficulty of the blockchain.
@@ -60,38 +265,189 @@ std::string ProofOfWork::mineBlock(const std::string& data, const std::string& p
  * @return The hash of the block.
  */
 std::string ProofOfWork::mineBlock(const std::string& data, const std::string& previousHash, 
-                                  int difficulty, int& nonce, HashMode mode, 
+                                  int difficulty, uint64_t& nonce, HashMode mode, 
                                   uint32_t rule, size_t steps) {
-    std::string target(difficulty, '0');
-    nonce = 0;
-    
-    std::string blockData = data + previousHash + std::to_string(nonce);
-    std::string hash = computeHash(blockData, mode, rule, steps);
-
-    while (hash.substr(0, difficulty) != target) {
-        nonce++;
-        blockData = data + previousHash + std::to_string(nonce);
-        hash = computeHash(blockData, mode, rule, steps);
-    }
-    
+    std::string prefix = data + previousHash;
+    std::string hash;
+    searchNonce([&](uint64_t n, MiningWorkspace& workspace) {
+        {
+            PROFILE_SCOPE(STAGE_MESSAGE);
+            workspace.message.assign(prefix);
+            workspace.message += std::to_string(n);
+        }
+        return hashBytes(reinterpret_cast<const uint8_t*>(workspace.message.data()),
+                         workspace.message.size(), mode, rule, steps, workspace.acHash);
+    }, Target::fromNibbles(difficulty), 0, NO_NONCE, nonce, hash);
     return hash;
 }
 
+/**
+ * Mines a binary block header. The header is encoded once; every worker
+ * copies the encoding into its own workspace and only rewrites the nonce
+ * bytes per attempt. Nonces are searched from 0; when the nonce space is
+ * used up without a solution the extra nonce is incremented and the search
+ * starts over. Miners working on the same template independently should
+ * start from disjoint extra nonces (e.g. minerId << 32) so their
+ * (extra nonce, nonce) ranges never overlap.
+ * @param header The header to mine, receives the winning extra nonce and nonce
+ * @param nonceSpace Nonces tried per extra nonce value (0 = the version's full range)
+ * @return The hash of the mined header
+ * @throws std::runtime_error if a header without an extra nonce (version < 3)
+ *         runs out of nonces
+ */
+std::string ProofOfWork::mineHeader(BlockHeader& header, uint64_t nonceSpace) {
+    uint64_t limit = header.nonceLimit();
+    if (nonceSpace != 0 && nonceSpace < limit) {
+        limit = nonceSpace;
+    }
+    uint8_t encoded[BlockHeader::MAX_ENCODED_SIZE];
+    size_t size = header.encode(encoded);
+    HashMode mode = header.hashMode;
+    uint32_t rule = header.rule;
+    size_t steps = header.steps;
+    Target target = header.target();
+
+    std::string hash;
+    while (true) {
+        header.encodeExtraNonce(encoded, header.extraNonce);
+        bool found = searchNonce([&](uint64_t n, MiningWorkspace& workspace) {
+            {
+                PROFILE_SCOPE(STAGE_MESSAGE);
+                std::memcpy(workspace.header, encoded, size);
+                header.encodeNonce(workspace.header, n);
+            }
+            return hashBytes(workspace.header, size, mode, rule, steps, workspace.acHash);
+        }, target, 0, limit, header.nonce, hash);
+        if (found) {
+            return hash;
+        }
+        if (header.version < NONCE64_HEADER_VERSION || header.extraNonce == UINT64_MAX) {
+            throw std::runtime_error("Nonce space exhausted for block " + std::to_string(header.index));
+        }
+        header.extraNonce++;
+    }
+}
+
+/**
+ * Hashes the canonical encoding of a header.
+ * @param header The header
+ * @return The hash, with the header's own hash mode and parameters
+ */
+std::string ProofOfWork::hashHeader(const BlockHeader& header) {
+    uint8_t encoded[BlockHeader::MAX_ENCODED_SIZE];
+    size_t size = header.encode(encoded);
+    if (header.hashMode == SHA256_MODE) {
+        return sha256(encoded, size);
+    }
+    AcHashWorkspace& workspace = tlsWorkspace.get().acHash;
+    return hashBytes(encoded, size, header.hashMode, header.rule, header.steps, workspace);
+}
+
+/**
+ * Verifies a binary block header.
+ * @param header The header, including its nonce
+ * @param hash The claimed block hash
+ * @return True if the header hashes to hash and hash meets the header's target
+ *         (false for an unknown hash mode)
+ */
+bool ProofOfWork::verifyHeader(const BlockHeader& header, const std::string& hash) {
+    return header.hashMode <= AC_HASH_SPONGE_MODE && header.target().isMetBy(hash) && hashHeader(header) == hash;
+}
+
+/**
+ * Verifies a consecutive run of binary blocks, e.g. a batch synced from a
+ * peer. The cheap checks run first in one pass over the batch: each block
+ * must follow its predecessor (next index, previous hash equal to the
+ * predecessor's claimed hash, or to anchor for the first block) and its
+ * claimed hash must meet its target. The remaining blocks are grouped by
+ * (mode, rule, steps) and every group is hashed on the shared ThreadPool
+ * with the digest kernels, each worker reusing its workspace and comparing
+ * 32-byte digests instead of hex strings.
+ * @param views The blocks, in chain order
+ * @param count Number of blocks
+ * @param anchor Hash digest of the block before views[0], null to accept any
+ * @return Bit i set if block i is valid; legacy (version 0) blocks never are,
+ *         they are verified from their data with verifyBlock, nor are unknown hash modes
+ */
+BlockBitmap ProofOfWork::verifyBlocks(const BlockHeaderView* views, size_t count, const uint8_t* anchor) {
+    std::vector<size_t> pending;
+    pending.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        const BlockHeader& header = views[i].header;
+        const uint8_t* parent = i > 0 ? views[i - 1].hash : anchor;
+        bool linked = (parent == nullptr || sameDigest(header.previousHash, parent)) &&
+                      (i == 0 || header.index == views[i - 1].header.index + 1);
+        if (linked && header.version != LEGACY_HEADER_VERSION && header.hashMode <= AC_HASH_SPONGE_MODE &&
+            header.target().isMetBy(views[i].hash)) {
+            pending.push_back(i);
+        }
+    }
+    //one kernel configuration per group, so the workers' automata keep their rule and size
+    std::stable_sort(pending.begin(), pending.end(), [views](size_t a, size_t b) {
+        const BlockHeader& x = views[a].header;
+        const BlockHeader& y = views[b].header;
+        if (x.hashMode != y.hashMode) return x.hashMode < y.hashMode;
+        if (x.rule != y.rule) return x.rule < y.rule;
+        return x.steps < y.steps;
+    });
+
+    std::vector<uint8_t> valid(count, 0); //one byte per block: workers never share a word
+    ThreadPool& pool = ThreadPool::instance();
+    for (size_t begin = 0; begin < pending.size();) {
+        size_t end = begin + 1;
+        while (end < pending.size() && sameKernel(views[pending[end]].header, views[pending[begin]].header)) {
+            end++;
+        }
+        pool.parallel_for(begin, end, [&](size_t k) {
+            const BlockHeaderView& view = views[pending[k]];
+            uint8_t encoded[BlockHeader::MAX_ENCODED_SIZE];
+            size_t size = view.header.encode(encoded);
+            uint8_t digest[DIGEST_SIZE];
+            digestBytes(encoded, size, view.header.hashMode, view.header.rule, view.header.steps,
+                        tlsWorkspace.get().acHash, digest);
+            valid[pending[k]] = sameDigest(digest, view.hash) ? 1 : 0;
+        });
+        begin = end;
+    }
+
+    BlockBitmap result(count);
+    for (size_t i = 0; i < count; i++) {
+        if (valid[i]) {
+            result.set(i);
+        }
+    }
+    return result;
+}
+
+/**
+ * Builds the message a legacy block hashes: its data, the previous hash and
+ * the nonce in decimal, concatenated into one buffer sized up front.
+ * @param data The block data
+ * @param previousHash The hash of the previous block
+ * @param nonce The block nonce
+ * @return data + previousHash + nonce
+ */
+std::string ProofOfWork::legacyMessage(const std::string& data, const std::string& previousHash, uint64_t nonce) {
+    std::string nonceText = std::to_string(nonce);
+    std::string message;
+    message.reserve(data.size() + previousHash.size() + nonceText.size());
+    message.append(data).append(previousHash).append(nonceText);
+    return message;
+}
+
 //SHA256 verification
 bool ProofOfWork::verifyBlock(const std::string& data, const std::string& previousHash, 
-                             const std::string& hash, int difficulty, int nonce) {
+                             const std::string& hash, int difficulty, uint64_t nonce) {
     std::string target(difficulty, '0');
-    std::string blockData = data + previousHash + std::to_string(nonce);
-    std::string calculatedHash = sha256(blockData);
+    std::string calculatedHash = sha256(legacyMessage(data, previousHash, nonce));
     return calculatedHash == hash && calculatedHash.substr(0, difficulty) == target;
 }
 
 //Verification with hash mode selection
 bool ProofOfWork::verifyBlock(const std::string& data, const std::string& previousHash, 
-                             const std::string& hash, int difficulty, int nonce, 
+                             const std::string& hash, int difficulty, uint64_t nonce, 
                              HashMode mode, uint32_t rule, size_t steps) {
     std::string target(difficulty, '0');
-    std::string blockData = data + previousHash + std::to_string(nonce);
-    std::string calculatedHash = computeHash(blockData, mode, rule, steps);
+    std::string calculatedHash = computeHash(legacyMessage(data, previousHash, nonce), mode, rule, steps);
     return calculatedHash == hash && calculatedHash.substr(0, difficulty) == target;
 }
\ No newline at end of file
@@ -0,0 +1,857 @@
+#include "query_server.h"
+#include "relay.h"
+#include "utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#ifdef __linux__
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t IOV_BATCH = 64;        //segments per sendmsg
+const size_t READ_CHUNK = 16 * 1024;
+
+const char* const ERR_NOT_FOUND = "ERR not found\n";
+const char* const ERR_BAD_REQUEST = "ERR bad request\n";
+
+//splits a request line at spaces
+std::vector<std::string> splitWords(const char* begin, const char* end) {
+    std::vector<std::string> words;
+    const char* pos = begin;
+    while (pos < end) {
+        const char* space = std::find(pos, end, ' ');
+        if (space != pos) {
+            words.push_back(std::string(pos, space));
+        }
+        pos = space + (space < end ? 1 : 0);
+    }
+    return words;
+}
+
+//nearest-rank percentile of sorted samples (0 when there are none)
+double percentileOf(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+} // namespace
+
+#ifdef __linux__
+
+/**
+ * Binds the listening socket; nothing is served until start().
+ * @param c The chain to serve (read through snapshots only)
+ * @param port Port on 127.0.0.1, 0 for any free port
+ * @throws std::runtime_error if the socket cannot be bound
+ */
+QueryServer::QueryServer(const BlockchainPow& c, uint16_t port)
+    : chain(c), snapshot(c.getChain()), indexed(0), listenFd(-1), epollFd(-1), wakeFd(-1), boundPort(0),
+      accepted(0), requests(0), errors(0), bytesSent(0), writes(0), zeroCopyBytes(0) {
+    listenFd = listenLoopback(port, boundPort);
+    epollFd = epoll_create1(0);
+    wakeFd = eventfd(0, EFD_NONBLOCK);
+    addToEpoll(epollFd, listenFd, EPOLLIN);
+    addToEpoll(epollFd, wakeFd, EPOLLIN);
+}
+
+QueryServer::~QueryServer() {
+    stop();
+    ::close(wakeFd);
+    ::close(epollFd);
+    ::close(listenFd);
+}
+
+void QueryServer::start() {
+    if (!worker.joinable()) {
+        worker = std::thread(&QueryServer::run, this);
+    }
+}
+
+void QueryServer::stop() {
+    if (worker.joinable()) {
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+        worker.join();
+    }
+}
+
+QueryServerStats QueryServer::stats() const {
+    QueryServerStats s;
+    s.connections = accepted.load(std::memory_order_relaxed);
+    s.requests = requests.load(std::memory_order_relaxed);
+    s.errors = errors.load(std::memory_order_relaxed);
+    s.bytesSent = bytesSent.load(std::memory_order_relaxed);
+    s.writes = writes.load(std::memory_order_relaxed);
+    s.zeroCopyBytes = zeroCopyBytes.load(std::memory_order_relaxed);
+    return s;
+}
+
+/**
+ * Event loop: one chain snapshot per batch of ready events, so every
+ * request in a batch sees the same chain and new blocks show up on the
+ * next batch.
+ */
+void QueryServer::run() {
+    epoll_event events[64];
+    bool stopping = false;
+    while (!stopping) {
+        int ready = epoll_wait(epollFd, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        snapshot = chain.getChain();
+        for (int e = 0; e < ready; e++) {
+            int fd = events[e].data.fd;
+            if (fd == wakeFd) {
+                stopping = true;
+                continue;
+            }
+            if (fd == listenFd) {
+                accept();
+                continue;
+            }
+            auto it = connections.find(fd);
+            if (it == connections.end()) {
+                continue;
+            }
+            Connection& c = it->second;
+            bool keep = true;
+            if (events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                keep = readable(c);
+            }
+            if (keep && (events[e].events & EPOLLOUT)) {
+                keep = writable(c);
+            }
+            if (keep) {
+                updateInterest(c);
+            } else {
+                closeConnection(fd);
+            }
+        }
+    }
+    while (!connections.empty()) {
+        closeConnection(connections.begin()->first);
+    }
+}
+
+void QueryServer::accept() {
+    int fd;
+    while ((fd = ::accept(listenFd, nullptr, nullptr)) >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setNonBlocking(fd);
+        addToEpoll(epollFd, fd, EPOLLIN);
+        Connection& c = connections[fd];
+        c.fd = fd;
+        c.inputStart = 0;
+        c.pendingBytes = 0;
+        c.interest = EPOLLIN;
+        c.closing = false;
+        accepted.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void QueryServer::closeConnection(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections.erase(fd);
+}
+
+/**
+ * Reads until the socket would block, answers every complete request and
+ * writes as much of the answers as the socket takes.
+ */
+bool QueryServer::readable(Connection& c) {
+    uint8_t chunk[READ_CHUNK];
+    for (;;) {
+        ssize_t n = recv(c.fd, chunk, sizeof(chunk), 0);
+        if (n > 0) {
+            c.input.insert(c.input.end(), chunk, chunk + n);
+        } else if (n == 0) {
+            c.closing = true; //the client is done sending; answer what it sent
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            return false;
+        }
+    }
+    parse(c);
+    if (!flush(c)) {
+        return false;
+    }
+    return !(c.closing && c.segments.empty());
+}
+
+bool QueryServer::writable(Connection& c) {
+    if (!flush(c)) {
+        return false;
+    }
+    parse(c); //requests left unparsed while the output was full
+    if (!flush(c)) {
+        return false;
+    }
+    return !(c.closing && c.segments.empty());
+}
+
+void QueryServer::parse(Connection& c) {
+    while (c.inputStart < c.input.size() && c.pendingBytes < QUERY_MAX_PENDING_BYTES) {
+        const uint8_t* data = c.input.data() + c.inputStart;
+        size_t length = c.input.size() - c.inputStart;
+        size_t used = (data[0] & 0x80) ? handleBinary(c, data, length) : handleText(c, data, length);
+        if (used == 0) {
+            break;
+        }
+        c.inputStart += used;
+        requests.fetch_add(1, std::memory_order_relaxed);
+    }
+    //drop parsed bytes once they are the larger part of the buffer
+    if (c.inputStart == c.input.size()) {
+        c.input.clear();
+        c.inputStart = 0;
+    } else if (c.inputStart > c.input.size() / 2) {
+        c.input.erase(c.input.begin(), c.input.begin() + c.inputStart);
+        c.inputStart = 0;
+    }
+}
+
+size_t QueryServer::handleBinary(Connection& c, const uint8_t* data, size_t length) {
+    const uint8_t* pos = data + 1;
+    const uint8_t* end = data + length;
+    switch (data[0]) {
+        case QUERY_GET_HEIGHT: {
+            uint64_t height;
+            if (!getVarint(pos, end, height)) {
+                if (pos == end && pos - data <= 10) {
+                    return 0; //truncated varint
+                }
+                break;
+            }
+            respondBlock(c, QUERY_BINARY, height < snapshot.size() ? snapshot[height] : nullptr);
+            return pos - data;
+        }
+        case QUERY_GET_HASH:
+            if (length < 1 + DIGEST_SIZE) {
+                return 0;
+            }
+            respondBlock(c, QUERY_BINARY, findHash(pos));
+            return 1 + DIGEST_SIZE;
+        case QUERY_GET_TIP:
+            respondTip(c, QUERY_BINARY);
+            return 1;
+        case QUERY_VALIDATE: {
+            uint64_t first, last;
+            if (!getVarint(pos, end, first) || !getVarint(pos, end, last)) {
+                if (pos == end && pos - data <= 21) {
+                    return 0;
+                }
+                break;
+            }
+            respondValid(c, QUERY_BINARY, first, last);
+            return pos - data;
+        }
+    }
+    //an unknown opcode or a bad varint leaves no way to find the next request
+    respondError(c, QUERY_BINARY, QUERY_BAD_REQUEST);
+    c.closing = true;
+    return length;
+}
+
+size_t QueryServer::handleText(Connection& c, const uint8_t* data, size_t length) {
+    const char* text = reinterpret_cast<const char*>(data);
+    const char* newline = static_cast<const char*>(std::memchr(text, '\n', std::min(length, QUERY_MAX_LINE_BYTES)));
+    if (newline == nullptr) {
+        if (length < QUERY_MAX_LINE_BYTES) {
+            return 0;
+        }
+        respondError(c, QUERY_TEXT, QUERY_BAD_REQUEST);
+        c.closing = true;
+        return length;
+    }
+    const char* lineEnd = newline > text && newline[-1] == '\r' ? newline - 1 : newline;
+    std::vector<std::string> words = splitWords(text, lineEnd);
+    uint64_t first, last;
+    uint8_t digest[DIGEST_SIZE];
+    if (words.size() == 2 && words[0] == "BLOCK" && parseNumber(words[1], first)) {
+        respondBlock(c, QUERY_TEXT, first < snapshot.size() ? snapshot[first] : nullptr);
+    } else if (words.size() == 2 && words[0] == "HASH" && hexToDigest(words[1], digest)) {
+        respondBlock(c, QUERY_TEXT, findHash(digest));
+    } else if (words.size() == 1 && words[0] == "TIP") {
+        respondTip(c, QUERY_TEXT);
+    } else if (words.size() == 3 && words[0] == "VALIDATE" && parseNumber(words[1], first) &&
+               parseNumber(words[2], last)) {
+        respondValid(c, QUERY_TEXT, first, last);
+    } else {
+        respondError(c, QUERY_TEXT, QUERY_BAD_REQUEST);
+    }
+    return newline + 1 - text;
+}
+
+//hash lookups index the snapshot lazily, so blocks that are never asked for by hash cost nothing
+const BlockPow* QueryServer::findHash(const uint8_t* digest) {
+    std::string key(reinterpret_cast<const char*>(digest), DIGEST_SIZE);
+    auto it = heights.find(key);
+    if (it == heights.end() && indexed < snapshot.size()) {
+        uint8_t blockDigest[DIGEST_SIZE];
+        for (; indexed < snapshot.size(); indexed++) {
+            hexToDigest(snapshot[indexed]->getHash(), blockDigest);
+            heights[std::string(reinterpret_cast<const char*>(blockDigest), DIGEST_SIZE)] = indexed;
+        }
+        it = heights.find(key);
+    }
+    return it == heights.end() ? nullptr : snapshot[it->second];
+}
+
+void QueryServer::respondBlock(Connection& c, QueryProtocol protocol, const BlockPow* block) {
+    if (block == nullptr) {
+        respondError(c, protocol, QUERY_NOT_FOUND);
+        return;
+    }
+    const std::string& payload = block->getData();
+    if (protocol == QUERY_TEXT && payload.find('\n') != std::string::npos) {
+        respondError(c, protocol, QUERY_BAD_REQUEST); //would end the line early; ask over binary
+        return;
+    }
+    std::string header;
+    if (protocol == QUERY_BINARY) {
+        header.push_back(static_cast<char>(QUERY_OK));
+        encodeBlockFrameHeader(*block, header);
+    } else {
+        header = "OK ";
+        encodeBlockTextHeader(*block, header);
+    }
+    appendOwned(c, header.data(), header.size());
+    if (payload.size() >= QUERY_ZERO_COPY_MIN_BYTES) {
+        appendExternal(c, payload.data(), payload.size());
+    } else {
+        appendOwned(c, payload.data(), payload.size());
+    }
+    if (protocol == QUERY_TEXT) {
+        appendOwned(c, "\n", 1);
+    }
+}
+
+void QueryServer::respondTip(Connection& c, QueryProtocol protocol) {
+    const BlockPow* tip = snapshot.back();
+    if (protocol == QUERY_BINARY) {
+        std::string out(1, static_cast<char>(QUERY_OK));
+        putVarint(static_cast<uint64_t>(tip->getIndex()), out);
+        uint8_t digest[DIGEST_SIZE];
+        hexToDigest(tip->getHash(), digest);
+        out.append(reinterpret_cast<const char*>(digest), DIGEST_SIZE);
+        appendOwned(c, out.data(), out.size());
+    } else {
+        std::string out = "OK " + std::to_string(tip->getIndex()) + " " + tip->getHash() + "\n";
+        appendOwned(c, out.data(), out.size());
+    }
+}
+
+void QueryServer::respondValid(Connection& c, QueryProtocol protocol, uint64_t first, uint64_t last) {
+    if (first >= last || last - first > QUERY_MAX_VALIDATE_BLOCKS) {
+        respondError(c, protocol, QUERY_BAD_REQUEST);
+        return;
+    }
+    if (last > snapshot.size()) {
+        respondError(c, protocol, QUERY_NOT_FOUND);
+        return;
+    }
+    bool valid = snapshot.isRangeValid(static_cast<size_t>(first), static_cast<size_t>(last));
+    if (protocol == QUERY_BINARY) {
+        char out[2] = {static_cast<char>(QUERY_OK), static_cast<char>(valid ? 1 : 0)};
+        appendOwned(c, out, 2);
+    } else {
+        appendOwned(c, valid ? "OK 1\n" : "OK 0\n", 5);
+    }
+}
+
+void QueryServer::respondError(Connection& c, QueryProtocol protocol, QueryStatus status) {
+    errors.fetch_add(1, std::memory_order_relaxed);
+    if (protocol == QUERY_BINARY) {
+        char out = static_cast<char>(status);
+        appendOwned(c, &out, 1);
+    } else {
+        const char* line = status == QUERY_NOT_FOUND ? ERR_NOT_FOUND : ERR_BAD_REQUEST;
+        appendOwned(c, line, std::strlen(line));
+    }
+}
+
+//small pieces are coalesced into the last owned piece, so pipelined answers share one iovec
+void QueryServer::appendOwned(Connection& c, const char* data, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    if (!c.segments.empty() && c.segments.back().external == nullptr) {
+        c.owned.back().append(data, length);
+        c.segments.back().length += length;
+    } else {
+        c.owned.push_back(std::string(data, length));
+        Segment segment = {nullptr, length, 0};
+        c.segments.push_back(segment);
+    }
+    c.pendingBytes += length;
+}
+
+void QueryServer::appendExternal(Connection& c, const char* data, size_t length) {
+    Segment segment = {data, length, 0};
+    c.segments.push_back(segment);
+    c.pendingBytes += length;
+    zeroCopyBytes.fetch_add(length, std::memory_order_relaxed);
+}
+
+/**
+ * Writes queued segments with scatter/gather writes until the socket
+ * would block; fully written owned pieces are released.
+ * @return False if the connection failed
+ */
+bool QueryServer::flush(Connection& c) {
+    while (!c.segments.empty()) {
+        iovec iov[IOV_BATCH];
+        size_t count = 0;
+        size_t ownedIndex = 0;
+        for (auto it = c.segments.begin(); it != c.segments.end() && count < IOV_BATCH; ++it) {
+            const char* base = it->external != nullptr ? it->external : c.owned[ownedIndex++].data();
+            iov[count].iov_base = const_cast<char*>(base + it->offset);
+            iov[count].iov_len = it->length - it->offset;
+            count++;
+        }
+        msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+        ssize_t n = sendmsg(c.fd, &message, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        writes.fetch_add(1, std::memory_order_relaxed);
+        bytesSent.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        size_t left = static_cast<size_t>(n);
+        c.pendingBytes -= left;
+        while (left > 0) {
+            Segment& front = c.segments.front();
+            size_t rest = front.length - front.offset;
+            if (left < rest) {
+                front.offset += left;
+                break;
+            }
+            left -= rest;
+            if (front.external == nullptr) {
+                c.owned.pop_front();
+            }
+            c.segments.pop_front();
+        }
+    }
+    return true;
+}
+
+//reads only while the unsent output is below QUERY_MAX_PENDING_BYTES, waits for EPOLLOUT while any is left
+void QueryServer::updateInterest(Connection& c) {
+    uint32_t wanted = 0;
+    if (!c.closing && c.pendingBytes < QUERY_MAX_PENDING_BYTES) {
+        wanted |= EPOLLIN;
+    }
+    if (!c.segments.empty()) {
+        wanted |= EPOLLOUT;
+    }
+    if (wanted != c.interest) {
+        epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = wanted;
+        event.data.fd = c.fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, c.fd, &event);
+        c.interest = wanted;
+    }
+}
+
+/**
+ * Connects to a query server; requests are buffered until send().
+ * @param port The server's port on 127.0.0.1
+ * @param p Protocol to speak
+ * @throws std::runtime_error if the connection fails
+ */
+QueryClient::QueryClient(uint16_t port, QueryProtocol p) : fd(connectLoopback(port)), protocol(p), inStart(0) {}
+
+QueryClient::~QueryClient() {
+    ::close(fd);
+}
+
+void QueryClient::send() {
+    size_t sent = 0;
+    while (sent < out.size()) {
+        ssize_t n = ::send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("send: ") + std::strerror(errno));
+        }
+        sent += n > 0 ? static_cast<size_t>(n) : 0;
+    }
+    out.clear();
+}
+
+bool QueryClient::fill() {
+    if (inStart == in.size()) {
+        in.clear();
+        inStart = 0;
+    } else if (inStart > in.size() / 2) {
+        in.erase(in.begin(), in.begin() + inStart);
+        inStart = 0;
+    }
+    uint8_t chunk[READ_CHUNK];
+    for (;;) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n > 0) {
+            in.insert(in.end(), chunk, chunk + n);
+            return true;
+        }
+        if (n == 0 || errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+#else
+
+QueryServer::QueryServer(const BlockchainPow& c, uint16_t)
+    : chain(c), snapshot(c.getChain()), indexed(0), listenFd(-1), epollFd(-1), wakeFd(-1), boundPort(0),
+      accepted(0), requests(0), errors(0), bytesSent(0), writes(0), zeroCopyBytes(0) {
+    throw std::runtime_error("The query server requires Linux (epoll)");
+}
+QueryServer::~QueryServer() {}
+void QueryServer::start() {}
+void QueryServer::stop() {}
+QueryServerStats QueryServer::stats() const { return QueryServerStats(); }
+
+QueryClient::QueryClient(uint16_t port, QueryProtocol p) : fd(connectLoopback(port)), protocol(p), inStart(0) {}
+QueryClient::~QueryClient() {}
+void QueryClient::send() {}
+bool QueryClient::fill() { return false; }
+
+#endif
+
+void QueryClient::queueGetBlock(uint64_t height) {
+    if (protocol == QUERY_BINARY) {
+        out.push_back(static_cast<char>(QUERY_GET_HEIGHT));
+        putVarint(height, out);
+    } else {
+        out += "BLOCK " + std::to_string(height) + "\n";
+    }
+    kinds.push_back(QUERY_GET_HEIGHT);
+}
+
+void QueryClient::queueGetBlock(const std::string& hash) {
+    if (protocol == QUERY_BINARY) {
+        uint8_t digest[DIGEST_SIZE];
+        hexToDigest(hash, digest); //anything but a hash becomes zeros, which no block has
+        out.push_back(static_cast<char>(QUERY_GET_HASH));
+        out.append(reinterpret_cast<const char*>(digest), DIGEST_SIZE);
+    } else {
+        out += "HASH " + hash + "\n";
+    }
+    kinds.push_back(QUERY_GET_HASH);
+}
+
+void QueryClient::queueGetTip() {
+    if (protocol == QUERY_BINARY) {
+        out.push_back(static_cast<char>(QUERY_GET_TIP));
+    } else {
+        out += "TIP\n";
+    }
+    kinds.push_back(QUERY_GET_TIP);
+}
+
+void QueryClient::queueValidateRange(uint64_t first, uint64_t last) {
+    if (protocol == QUERY_BINARY) {
+        out.push_back(static_cast<char>(QUERY_VALIDATE));
+        putVarint(first, out);
+        putVarint(last, out);
+    } else {
+        out += "VALIDATE " + std::to_string(first) + " " + std::to_string(last) + "\n";
+    }
+    kinds.push_back(QUERY_VALIDATE);
+}
+
+bool QueryClient::receive(QueryResponse& response, bool decodeBlock) {
+    if (kinds.empty()) {
+        return false;
+    }
+    uint8_t kind = kinds.front();
+    kinds.pop_front();
+    response.status = QUERY_OK;
+    response.block.reset();
+    response.height = 0;
+    response.hash.clear();
+    response.valid = false;
+    response.bytes = 0;
+    return protocol == QUERY_BINARY ? receiveBinary(kind, response, decodeBlock)
+                                    : receiveText(kind, response, decodeBlock);
+}
+
+bool QueryClient::receiveBinary(uint8_t kind, QueryResponse& response, bool decodeBlock) {
+    for (;;) {
+        const uint8_t* data = in.data() + inStart;
+        const uint8_t* end = in.data() + in.size();
+        size_t size = 0; //response size once complete
+        if (data < end && data[0] != QUERY_OK) {
+            size = 1;
+        } else if (data < end && (kind == QUERY_GET_HEIGHT || kind == QUERY_GET_HASH)) {
+            const uint8_t* pos = data + 1;
+            uint64_t frame;
+            if (getVarint(pos, end, frame) && static_cast<uint64_t>(end - pos) >= frame) {
+                size = (pos - data) + frame;
+            }
+        } else if (data < end && kind == QUERY_GET_TIP) {
+            const uint8_t* pos = data + 1;
+            if (getVarint(pos, end, response.height) && static_cast<size_t>(end - pos) >= DIGEST_SIZE) {
+                response.hash = digestToHex(pos);
+                size = (pos - data) + DIGEST_SIZE;
+            }
+        } else if (end - data >= 2) {
+            response.valid = data[1] != 0;
+            size = 2;
+        }
+        if (size > 0) {
+            response.status = static_cast<QueryStatus>(data[0]);
+            response.bytes = size;
+            if (decodeBlock && data[0] == QUERY_OK && (kind == QUERY_GET_HEIGHT || kind == QUERY_GET_HASH)) {
+                size_t consumed = 0;
+                if (decodeBlockFrame(data + 1, size - 1, consumed, response.block) != FRAME_OK) {
+                    return false;
+                }
+            }
+            inStart += size;
+            return true;
+        }
+        if (!fill()) {
+            return false;
+        }
+    }
+}
+
+bool QueryClient::receiveText(uint8_t kind, QueryResponse& response, bool decodeBlock) {
+    size_t scanned = 0; //relative to inStart, which fill() may move
+    const uint8_t* newline = nullptr;
+    for (;;) {
+        const uint8_t* from = in.data() + inStart + scanned;
+        newline = static_cast<const uint8_t*>(std::memchr(from, '\n', in.size() - inStart - scanned));
+        if (newline != nullptr) {
+            break;
+        }
+        scanned = in.size() - inStart;
+        if (!fill()) {
+            return false;
+        }
+    }
+    const char* line = reinterpret_cast<const char*>(in.data() + inStart);
+    size_t length = reinterpret_cast<const char*>(newline) - line + 1;
+    response.bytes = length;
+    inStart += length;
+    if (length >= 3 && std::memcmp(line, "ERR", 3) == 0) {
+        response.status = std::strncmp(line, ERR_NOT_FOUND, length) == 0 ? QUERY_NOT_FOUND : QUERY_BAD_REQUEST;
+        return true;
+    }
+    if (length < 4 || std::memcmp(line, "OK ", 3) != 0) {
+        return false;
+    }
+    if (kind == QUERY_GET_HEIGHT || kind == QUERY_GET_HASH) {
+        size_t consumed = 0;
+        return !decodeBlock || decodeBlockText(reinterpret_cast<const uint8_t*>(line + 3), length - 3, consumed,
+                                               response.block) == FRAME_OK;
+    }
+    std::vector<std::string> words = splitWords(line + 3, line + length - 1);
+    if (kind == QUERY_GET_TIP) {
+        if (words.size() != 2 || !parseNumber(words[0], response.height)) {
+            return false;
+        }
+        response.hash = words[1];
+        return true;
+    }
+    response.valid = words.size() == 1 && words[0] == "1";
+    return words.size() == 1;
+}
+
+std::unique_ptr<BlockPow> QueryClient::getBlock(uint64_t height) {
+    queueGetBlock(height);
+    send();
+    QueryResponse response;
+    return receive(response) && response.status == QUERY_OK ? std::move(response.block) : nullptr;
+}
+
+std::unique_ptr<BlockPow> QueryClient::getBlock(const std::string& hash) {
+    queueGetBlock(hash);
+    send();
+    QueryResponse response;
+    return receive(response) && response.status == QUERY_OK ? std::move(response.block) : nullptr;
+}
+
+bool QueryClient::getTip(uint64_t& height, std::string& hash) {
+    queueGetTip();
+    send();
+    QueryResponse response;
+    if (!receive(response) || response.status != QUERY_OK) {
+        return false;
+    }
+    height = response.height;
+    hash = response.hash;
+    return true;
+}
+
+int QueryClient::validateRange(uint64_t first, uint64_t last) {
+    queueValidateRange(first, last);
+    send();
+    QueryResponse response;
+    if (!receive(response) || response.status != QUERY_OK) {
+        return -1;
+    }
+    return response.valid ? 1 : 0;
+}
+
+/**
+ * Defaults: 4 connections, 16 requests in flight each, 500 ms, binary
+ * protocol, 70% getBlock(height), 20% getBlock(hash), 10% getTip.
+ */
+QueryLoadConfig defaultQueryLoadConfig() {
+    QueryLoadConfig config;
+    config.connections = 4;
+    config.pipeline = 16;
+    config.millis = 500;
+    config.protocol = QUERY_BINARY;
+    config.hashPercent = 20;
+    config.tipPercent = 10;
+    config.validatePercent = 0;
+    config.validateSpan = 16;
+    config.seed = 1;
+    return config;
+}
+
+/**
+ * Each client thread learns the tip and a sample of block hashes, waits
+ * for the others, then sends pipelined batches of random queries until
+ * config.millis have passed, timing every batch round trip.
+ * @param port The server's port on 127.0.0.1
+ * @param config Load shape
+ * @return Throughput, error count and batch latency percentiles
+ */
+QueryLoadStats runQueryLoad(uint16_t port, const QueryLoadConfig& config) {
+    size_t n = std::max<size_t>(1, config.connections);
+    size_t pipeline = std::max<size_t>(1, config.pipeline);
+    std::vector<QueryLoadStats> perClient(n, QueryLoadStats());
+    std::vector<std::vector<double>> latencies(n);
+    std::atomic<size_t> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    std::chrono::steady_clock::time_point start;
+    for (size_t t = 0; t < n; t++) {
+        threads.emplace_back([&, t]() {
+            QueryLoadStats& s = perClient[t];
+            std::mt19937_64 rng(config.seed + t);
+            std::vector<std::string> hashes;
+            uint64_t tip = 0;
+            std::unique_ptr<QueryClient> client;
+            try {
+                client.reset(new QueryClient(port, config.protocol));
+                std::string tipHash;
+                if (client->getTip(tip, tipHash)) {
+                    size_t samples = static_cast<size_t>(std::min<uint64_t>(64, tip + 1));
+                    for (size_t k = 0; k < samples; k++) {
+                        client->queueGetBlock((tip + 1) * k / samples);
+                    }
+                    client->send();
+                    QueryResponse response;
+                    for (size_t k = 0; k < samples && client->receive(response); k++) {
+                        if (response.block) hashes.push_back(response.block->getHash());
+                    }
+                }
+            } catch (const std::exception&) {
+                client.reset();
+            }
+            ready++;
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            if (!client || hashes.empty()) {
+                s.errors++;
+                return;
+            }
+            auto deadline = start + std::chrono::milliseconds(config.millis);
+            QueryResponse response;
+            while (std::chrono::steady_clock::now() < deadline) {
+                for (size_t p = 0; p < pipeline; p++) {
+                    unsigned pick = static_cast<unsigned>(rng() % 100);
+                    if (pick < config.validatePercent) {
+                        uint64_t span = std::min<uint64_t>(std::max<size_t>(1, config.validateSpan), tip + 1);
+                        span = std::min<uint64_t>(span, QUERY_MAX_VALIDATE_BLOCKS);
+                        uint64_t first = rng() % (tip + 2 - span);
+                        client->queueValidateRange(first, first + span);
+                    } else if (pick < config.validatePercent + config.tipPercent) {
+                        client->queueGetTip();
+                    } else if (pick < config.validatePercent + config.tipPercent + config.hashPercent) {
+                        client->queueGetBlock(hashes[rng() % hashes.size()]);
+                    } else {
+                        client->queueGetBlock(rng() % (tip + 1));
+                    }
+                }
+                auto batchStart = std::chrono::steady_clock::now();
+                try {
+                    client->send();
+                } catch (const std::exception&) {
+                    s.errors += pipeline;
+                    return;
+                }
+                for (size_t p = 0; p < pipeline; p++) {
+                    if (!client->receive(response, false)) {
+                        s.errors += pipeline - p;
+                        return;
+                    }
+                    s.requests++;
+                    s.bytes += response.bytes;
+                    if (response.status != QUERY_OK) s.errors++;
+                }
+                latencies[t].push_back(std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - batchStart).count());
+            }
+        });
+    }
+    while (ready.load() < n) {
+        std::this_thread::yield();
+    }
+    start = std::chrono::steady_clock::now();
+    go = true; //start is published to the clients with this store
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    QueryLoadStats total = QueryLoadStats();
+    std::vector<double> all;
+    for (size_t t = 0; t < n; t++) {
+        total.requests += perClient[t].requests;
+        total.errors += perClient[t].errors;
+        total.bytes += perClient[t].bytes;
+        all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+    }
+    std::sort(all.begin(), all.end());
+    total.seconds = seconds;
+    total.requestsPerSecond = seconds > 0 ? total.requests / seconds : 0.0;
+    total.batchP50Micros = percentileOf(all, 50);
+    total.batchP99Micros = percentileOf(all, 99);
+    return total;
+}
@@ -0,0 +1,107 @@
+#include "radius2_automaton.h"
+#include <stdexcept>
+
+//constructor, the grid is rounded up to whole words
+Radius2Automaton::Radius2Automaton(size_t grid_size, uint32_t rule_number)
+    : rule(0), size((grid_size + 63) / 64 * 64) {
+    if (size == 0) {
+        throw std::invalid_argument("Grid size must be positive");
+    }
+    words.assign(size / 64, 0);
+    next_words.assign(size / 64, 0);
+    set_rule(rule_number);
+}
+
+void Radius2Automaton::init_packed(const std::vector<uint64_t>& packed) {
+    if (packed.size() != words.size()) {
+        throw std::invalid_argument("Initial state size must match grid size");
+    }
+    words = packed;
+}
+
+void Radius2Automaton::absorb(const uint64_t* block, size_t count) {
+    if (count > words.size()) {
+        throw std::invalid_argument("Absorbed block is wider than the state");
+    }
+    for (size_t w = 0; w < count; w++) {
+        words[w] ^= block[w];
+    }
+}
+
+/**
+ * Evolves the CA by one generation, 64 cells per iteration.
+ *
+ * The four neighbors of every cell of a word are gathered with shifts
+ * (borrowing the edge bits of the adjacent words), then the rule's truth
+ * table is reduced by a multiplexer tree: each level picks between pairs
+ * of candidate outputs using one neighbor, r2 first and l2 last.
+ */
+void Radius2Automaton::evolve() {
+    size_t n = words.size();
+    for (size_t w = 0; w < n; w++) {
+        uint64_t prev = words[w == 0 ? n - 1 : w - 1];
+        uint64_t cur = words[w];
+        uint64_t next = words[w + 1 == n ? 0 : w + 1];
+        uint64_t l2 = (cur << 2) | (prev >> 62);
+        uint64_t l1 = (cur << 1) | (prev >> 63);
+        uint64_t r1 = (cur >> 1) | (next << 63);
+        uint64_t r2 = (cur >> 2) | (next << 62);
+
+        uint64_t level[16];
+        for (int k = 0; k < 16; k++) {
+            level[k] = truth[2 * k] ^ (r2 & (truth[2 * k] ^ truth[2 * k + 1]));
+        }
+        for (int k = 0; k < 8; k++) {
+            level[k] = level[2 * k] ^ (r1 & (level[2 * k] ^ level[2 * k + 1]));
+        }
+        for (int k = 0; k < 4; k++) {
+            level[k] = level[2 * k] ^ (cur & (level[2 * k] ^ level[2 * k + 1]));
+        }
+        for (int k = 0; k < 2; k++) {
+            level[k] = level[2 * k] ^ (l1 & (level[2 * k] ^ level[2 * k + 1]));
+        }
+        next_words[w] = level[0] ^ (l2 & (level[0] ^ level[1]));
+    }
+    words.swap(next_words);
+}
+
+void Radius2Automaton::evolve_steps(size_t steps) {
+    for (size_t i = 0; i < steps; i++) {
+        evolve();
+    }
+}
+
+const std::vector<uint64_t>& Radius2Automaton::get_words() const {
+    return words;
+}
+
+int Radius2Automaton::get_cell(size_t index) const {
+    if (index >= size) {
+        throw std::out_of_range("Cell index out of range");
+    }
+    return static_cast<int>((words[index / 64] >> (index % 64)) & 1);
+}
+
+size_t Radius2Automaton::get_size() const {
+    return size;
+}
+
+void Radius2Automaton::set_rule(uint32_t rule_number) {
+    rule = rule_number;
+    for (int k = 0; k < 32; k++) {
+        truth[k] = ((rule >> k) & 1) ? ~0ULL : 0ULL;
+    }
+}
+
+uint32_t Radius2Automaton::get_rule() const {
+    return rule;
+}
+
+std::string Radius2Automaton::state_to_string() const {
+    std::string result;
+    result.reserve(size);
+    for (size_t i = 0; i < size; i++) {
+        result += get_cell(i) ? '1' : '0';
+    }
+    return result;
+}
@@ -0,0 +1,593 @@
+#include "relay.h"
+#include "block_header.h"
+#include "utils.h"
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t TEXT_FIELDS = 11; //fields before the data in a text line
+
+void putDigest(const std::string& hex, std::string& out) {
+    uint8_t digest[DIGEST_SIZE];
+    hexToDigest(hex, digest); //"0" (genesis parent) becomes all zeros
+    out.append(reinterpret_cast<const char*>(digest), DIGEST_SIZE);
+}
+
+bool isZeroDigest(const uint8_t* digest) {
+    for (size_t i = 0; i < DIGEST_SIZE; i++) {
+        if (digest[i] != 0) return false;
+    }
+    return true;
+}
+
+//rebuilds a block from its wire fields; null if the fields cannot describe a block, or
+//describe one that would be too expensive to verify
+std::unique_ptr<BlockPow> buildBlock(uint64_t version, uint64_t index, uint64_t timestamp, uint64_t mode,
+                                     uint64_t rule, uint64_t steps, uint64_t difficulty, uint64_t extraNonce,
+                                     uint64_t nonce, std::string prevHash, std::string hash, std::string data) {
+    if (version > NONCE64_HEADER_VERSION || mode > AC_HASH_SPONGE_MODE || index > UINT32_MAX ||
+        rule > UINT32_MAX || steps > RELAY_MAX_STEPS || difficulty > UINT32_MAX ||
+        (mode == AC_HASH_MODE && rule > 255)) { //radius-1 rules are 8 bits, the radius-2 modes take 32
+        return std::unique_ptr<BlockPow>();
+    }
+    if (version == LEGACY_HEADER_VERSION) {
+        return std::unique_ptr<BlockPow>(new BlockPow(static_cast<int>(index), std::move(prevHash), std::move(hash),
+                                                      std::move(data), nonce, static_cast<int>(difficulty),
+                                                      static_cast<HashMode>(mode), static_cast<uint32_t>(rule),
+                                                      static_cast<size_t>(steps)));
+    }
+    BlockHeader header;
+    header.version = static_cast<uint32_t>(version);
+    header.index = static_cast<uint32_t>(index);
+    header.timestamp = timestamp;
+    hexToDigest(prevHash, header.previousHash);
+    sha256Digest(reinterpret_cast<const uint8_t*>(data.data()), data.size(), header.payloadHash);
+    header.hashMode = static_cast<HashMode>(mode);
+    header.rule = static_cast<uint32_t>(rule);
+    header.steps = static_cast<uint32_t>(steps);
+    header.difficulty = static_cast<uint32_t>(difficulty);
+    header.extraNonce = extraNonce;
+    header.nonce = nonce;
+    return std::unique_ptr<BlockPow>(new BlockPow(header, std::move(prevHash), std::move(hash), std::move(data)));
+}
+
+} // namespace
+
+/**
+ * Appends value as an unsigned LEB128 varint (7 bits per byte, low first).
+ * @param value The integer to encode
+ * @param out Receives 1-10 bytes
+ */
+void putVarint(uint64_t value, std::string& out) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool getVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 70 && pos < end; shift += 7) {
+        uint8_t byte = *pos++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseNumber(const std::string& text, uint64_t& value) {
+    if (text.empty()) {
+        return false;
+    }
+    value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        uint64_t digit = static_cast<uint64_t>(c - '0');
+        if (value > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    return true;
+}
+
+/**
+ * Appends a binary block frame: varint(body size), then the body
+ * (message type, varint header fields, previous hash and hash as
+ * 32-byte digests, varint(data size) and the data).
+ * @param block The block to encode
+ * @param out Receives the frame
+ */
+void encodeBlockFrame(const BlockPow& block, std::string& out) {
+    encodeBlockFrameHeader(block, out);
+    out.append(block.getData());
+}
+
+/**
+ * Appends the frame up to and including varint(data size); the length
+ * prefix already counts the data that has to follow.
+ * @param block The block to encode
+ * @param out Receives the frame header
+ */
+void encodeBlockFrameHeader(const BlockPow& block, std::string& out) {
+    std::string body;
+    body.reserve(96);
+    body.push_back(static_cast<char>(RELAY_MSG_BLOCK));
+    putVarint(block.getHeaderVersion(), body);
+    putVarint(static_cast<uint64_t>(block.getIndex()), body);
+    putVarint(block.getTimestamp(), body);
+    putVarint(static_cast<uint64_t>(block.getHashMode()), body);
+    putVarint(block.getRule(), body);
+    putVarint(block.getSteps(), body);
+    putVarint(static_cast<uint32_t>(block.getDifficulty()), body);
+    putVarint(block.getExtraNonce(), body);
+    putVarint(block.getNonce(), body);
+    putDigest(block.getPreviousHash(), body);
+    putDigest(block.getHash(), body);
+    putVarint(block.getData().size(), body);
+
+    putVarint(body.size() + block.getData().size(), out);
+    out.append(body);
+}
+
+/**
+ * Appends the naive text encoding: version|index|timestamp|previous
+ * hash|hash|mode|rule|steps|difficulty|extra nonce|nonce|data and a
+ * newline.
+ * @param block The block to encode
+ * @param out Receives the line
+ * @throws std::invalid_argument if the data contains a newline, which would end the line early
+ */
+void encodeBlockText(const BlockPow& block, std::string& out) {
+    if (block.getData().find('\n') != std::string::npos) {
+        throw std::invalid_argument("Block " + std::to_string(block.getIndex()) +
+                                    " has a newline in its data; send it with RELAY_BINARY");
+    }
+    encodeBlockTextHeader(block, out);
+    out += block.getData();
+    out += '\n';
+}
+
+void encodeBlockTextHeader(const BlockPow& block, std::string& out) {
+    out += std::to_string(block.getHeaderVersion()) + "|" + std::to_string(block.getIndex()) + "|" +
+           std::to_string(block.getTimestamp()) + "|" + block.getPreviousHash() + "|" + block.getHash() + "|" +
+           std::to_string(static_cast<int>(block.getHashMode())) + "|" + std::to_string(block.getRule()) + "|" +
+           std::to_string(block.getSteps()) + "|" + std::to_string(static_cast<uint32_t>(block.getDifficulty())) +
+           "|" + std::to_string(block.getExtraNonce()) + "|" + std::to_string(block.getNonce()) + "|";
+}
+
+/**
+ * Decodes the binary frame at the start of data.
+ * @param data Received bytes
+ * @param length Number of received bytes
+ * @param consumed Set to the frame size on FRAME_OK
+ * @param block Receives the decoded block on FRAME_OK
+ * @return FRAME_OK, FRAME_INCOMPLETE (wait for more bytes) or FRAME_MALFORMED
+ */
+FrameStatus decodeBlockFrame(const uint8_t* data, size_t length, size_t& consumed,
+                             std::unique_ptr<BlockPow>& block) {
+    const uint8_t* pos = data;
+    const uint8_t* end = data + length;
+    uint64_t size;
+    if (!getVarint(pos, end, size)) {
+        return pos - data >= 10 ? FRAME_MALFORMED : FRAME_INCOMPLETE;
+    }
+    if (size == 0 || size > RELAY_MAX_FRAME_BYTES) {
+        return FRAME_MALFORMED;
+    }
+    if (static_cast<uint64_t>(end - pos) < size) {
+        return FRAME_INCOMPLETE;
+    }
+    const uint8_t* frameEnd = pos + size;
+    if (*pos++ != RELAY_MSG_BLOCK) {
+        return FRAME_MALFORMED;
+    }
+    uint64_t fields[9]; //version, index, timestamp, mode, rule, steps, difficulty, extra nonce, nonce
+    for (uint64_t& field : fields) {
+        if (!getVarint(pos, frameEnd, field)) {
+            return FRAME_MALFORMED;
+        }
+    }
+    if (frameEnd - pos < static_cast<ptrdiff_t>(2 * DIGEST_SIZE)) {
+        return FRAME_MALFORMED;
+    }
+    const uint8_t* prevDigest = pos;
+    const uint8_t* hashDigest = pos + DIGEST_SIZE;
+    pos += 2 * DIGEST_SIZE;
+    uint64_t dataSize;
+    if (!getVarint(pos, frameEnd, dataSize) || static_cast<uint64_t>(frameEnd - pos) != dataSize) {
+        return FRAME_MALFORMED;
+    }
+    std::string prevHash = fields[1] == 0 && isZeroDigest(prevDigest) ? std::string("0") : digestToHex(prevDigest);
+    block = buildBlock(fields[0], fields[1], fields[2], fields[3], fields[4], fields[5], fields[6], fields[7],
+                       fields[8], std::move(prevHash), digestToHex(hashDigest),
+                       std::string(reinterpret_cast<const char*>(pos), dataSize));
+    if (!block) {
+        return FRAME_MALFORMED;
+    }
+    consumed = frameEnd - data;
+    return FRAME_OK;
+}
+
+/**
+ * Decodes the text line at the start of data (see encodeBlockText).
+ * @return FRAME_OK, FRAME_INCOMPLETE (no newline yet) or FRAME_MALFORMED
+ */
+FrameStatus decodeBlockText(const uint8_t* data, size_t length, size_t& consumed,
+                            std::unique_ptr<BlockPow>& block) {
+    const char* text = reinterpret_cast<const char*>(data);
+    const char* newline = static_cast<const char*>(std::memchr(text, '\n', length));
+    if (newline == nullptr) {
+        return length > RELAY_MAX_FRAME_BYTES ? FRAME_MALFORMED : FRAME_INCOMPLETE;
+    }
+    std::string fields[TEXT_FIELDS];
+    const char* pos = text;
+    for (size_t f = 0; f < TEXT_FIELDS; f++) {
+        const char* bar = static_cast<const char*>(std::memchr(pos, '|', newline - pos));
+        if (bar == nullptr) {
+            return FRAME_MALFORMED;
+        }
+        fields[f].assign(pos, bar);
+        pos = bar + 1;
+    }
+    uint64_t numbers[TEXT_FIELDS];
+    for (size_t f = 0; f < TEXT_FIELDS; f++) {
+        if (f == 3 || f == 4) continue; //the hashes stay hex
+        if (!parseNumber(fields[f], numbers[f])) {
+            return FRAME_MALFORMED;
+        }
+    }
+    block = buildBlock(numbers[0], numbers[1], numbers[2], numbers[5], numbers[6], numbers[7], numbers[8],
+                       numbers[9], numbers[10], fields[3], fields[4], std::string(pos, newline));
+    if (!block) {
+        return FRAME_MALFORMED;
+    }
+    consumed = newline + 1 - text;
+    return FRAME_OK;
+}
+
+#ifdef __linux__
+
+namespace {
+
+sockaddr_in loopbackAddress(uint16_t port) {
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return address;
+}
+
+} // namespace
+
+void setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        throw std::runtime_error(std::string("fcntl: ") + std::strerror(errno));
+    }
+}
+
+void addToEpoll(int epollFd, int fd, uint32_t events) {
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        throw std::runtime_error(std::string("epoll_ctl: ") + std::strerror(errno));
+    }
+}
+
+/**
+ * Opens a non-blocking listening socket on 127.0.0.1.
+ * @param port Port to listen on, 0 for any free port
+ * @param boundPort Set to the port actually bound
+ * @return The listening socket
+ * @throws std::runtime_error if the socket cannot be bound
+ */
+int listenLoopback(uint16_t port, uint16_t& boundPort) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    sockaddr_in address = loopbackAddress(port);
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+        bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(fd, 128) < 0) {
+        std::string error = std::strerror(errno);
+        if (fd >= 0) ::close(fd);
+        throw std::runtime_error("listen: " + error);
+    }
+    socklen_t size = sizeof(address);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&address), &size);
+    boundPort = ntohs(address.sin_port);
+    setNonBlocking(fd);
+    return fd;
+}
+
+/**
+ * Connects to 127.0.0.1:port with Nagle's algorithm off.
+ * @return The connected (blocking) socket
+ * @throws std::runtime_error if the connection fails
+ */
+int connectLoopback(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = loopbackAddress(port);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::string error = std::strerror(errno);
+        if (fd >= 0) ::close(fd);
+        throw std::runtime_error("connect: " + error);
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+/**
+ * Connects to a receiver on the loopback interface; the socket is then
+ * switched to non-blocking mode and waited on with epoll when full.
+ * @param port The receiver's port
+ * @param enc Encoding the receiver expects
+ * @throws std::runtime_error if the connection fails
+ */
+RelaySender::RelaySender(uint16_t port, RelayEncoding enc)
+    : fd(-1), epollFd(-1), encoding(enc), totals(RelayStats()) {
+    fd = connectLoopback(port);
+    setNonBlocking(fd);
+    epollFd = epoll_create1(0);
+    addToEpoll(epollFd, fd, EPOLLOUT);
+}
+
+RelaySender::~RelaySender() {
+    close();
+}
+
+/**
+ * Encodes the blocks into batches of about RELAY_BATCH_BYTES and sends
+ * each batch with as few send() calls as the socket buffer allows.
+ * @param snapshot The chain to send
+ * @param first Index of the first block to send
+ */
+void RelaySender::sendChain(const ChainSnapshot& snapshot, size_t first) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = first; i < snapshot.size(); i++) {
+        if (encoding == RELAY_BINARY) {
+            encodeBlockFrame(*snapshot[i], pending);
+        } else {
+            encodeBlockText(*snapshot[i], pending);
+        }
+        totals.blocks++;
+        if (pending.size() >= RELAY_BATCH_BYTES) {
+            flush();
+        }
+    }
+    flush();
+    totals.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RelaySender::flush() {
+    size_t sent = 0;
+    while (sent < pending.size()) {
+        ssize_t n = send(fd, pending.data() + sent, pending.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+            totals.bytes += static_cast<uint64_t>(n);
+            totals.writes++;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            epoll_event event;
+            epoll_wait(epollFd, &event, 1, -1); //until the socket is writable again
+        } else if (n < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("send: ") + std::strerror(errno));
+        }
+    }
+    pending.clear();
+}
+
+void RelaySender::close() {
+    if (fd < 0) {
+        return;
+    }
+    if (!pending.empty()) {
+        flush();
+    }
+    shutdown(fd, SHUT_WR);
+    ::close(fd);
+    ::close(epollFd);
+    fd = -1;
+    epollFd = -1;
+}
+
+/**
+ * Opens a non-blocking listening socket on 127.0.0.1 and an epoll set.
+ * @param port Port to listen on, 0 for any free port
+ * @param enc Encoding senders use
+ * @throws std::runtime_error if the socket cannot be bound
+ */
+RelayReceiver::RelayReceiver(uint16_t port, RelayEncoding enc)
+    : listenFd(-1), epollFd(-1), boundPort(0), encoding(enc), totals(RelayStats()), malformed(false) {
+    listenFd = listenLoopback(port, boundPort);
+    epollFd = epoll_create1(0);
+    addToEpoll(epollFd, listenFd, EPOLLIN);
+}
+
+RelayReceiver::~RelayReceiver() {
+    ::close(listenFd);
+    ::close(epollFd);
+}
+
+/**
+ * Event loop: accepts connections, reads every readable socket until it
+ * would block and feeds whole frames to the replica chain. Returns when
+ * all accepted connections have closed.
+ * @param timeoutMillis Longest wait for any event
+ * @return True if the senders closed cleanly and no frame was malformed
+ */
+bool RelayReceiver::run(int timeoutMillis) {
+    struct Connection {
+        int fd;
+        std::vector<uint8_t> buffer;
+        size_t start; //first unparsed byte
+    };
+    std::vector<Connection> connections;
+    bool accepted = false;
+    bool started = false;
+    std::chrono::steady_clock::time_point first;
+    std::chrono::steady_clock::time_point last;
+    std::vector<uint8_t> chunk(RELAY_BATCH_BYTES);
+    epoll_event events[16];
+
+    while (!accepted || !connections.empty()) {
+        int ready = epoll_wait(epollFd, events, 16, timeoutMillis);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            break; //timed out
+        }
+        for (int e = 0; e < ready; e++) {
+            int fd = events[e].data.fd;
+            if (fd == listenFd) {
+                int client;
+                while ((client = accept(listenFd, nullptr, nullptr)) >= 0) {
+                    setNonBlocking(client);
+                    addToEpoll(epollFd, client, EPOLLIN);
+                    Connection connection = {client, std::vector<uint8_t>(), 0};
+                    connections.push_back(connection);
+                    accepted = true;
+                }
+                continue;
+            }
+            size_t c = 0;
+            while (c < connections.size() && connections[c].fd != fd) c++;
+            if (c == connections.size()) {
+                continue;
+            }
+            Connection& connection = connections[c];
+            bool closed = false;
+            for (;;) {
+                ssize_t n = recv(fd, chunk.data(), chunk.size(), 0);
+                if (n > 0) {
+                    if (!started) {
+                        first = std::chrono::steady_clock::now();
+                        started = true;
+                    }
+                    totals.bytes += static_cast<uint64_t>(n);
+                    totals.writes++;
+                    connection.buffer.insert(connection.buffer.end(), chunk.begin(), chunk.begin() + n);
+                } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                    closed = true;
+                    break;
+                } else if (errno != EINTR) {
+                    break;
+                }
+            }
+            connection.start += consume(connection.buffer.data() + connection.start,
+                                        connection.buffer.size() - connection.start);
+            last = std::chrono::steady_clock::now();
+            //drop parsed bytes once they are the larger part of the buffer
+            if (connection.start > connection.buffer.size() / 2) {
+                connection.buffer.erase(connection.buffer.begin(), connection.buffer.begin() + connection.start);
+                connection.start = 0;
+            }
+            if (closed || malformed) {
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+                ::close(fd);
+                if (connection.start != connection.buffer.size()) {
+                    malformed = true; //the stream ended inside a frame
+                }
+                connections.erase(connections.begin() + c);
+            }
+        }
+    }
+    for (auto& connection : connections) {
+        ::close(connection.fd);
+    }
+    if (started) {
+        totals.seconds += std::chrono::duration<double>(last - first).count();
+    }
+    return accepted && connections.empty() && !malformed;
+}
+
+#else
+
+void setNonBlocking(int) {}
+void addToEpoll(int, int, uint32_t) {}
+int listenLoopback(uint16_t, uint16_t&) {
+    throw std::runtime_error("Loopback sockets require Linux (epoll)");
+}
+int connectLoopback(uint16_t) {
+    throw std::runtime_error("Loopback sockets require Linux (epoll)");
+}
+
+RelaySender::RelaySender(uint16_t, RelayEncoding enc) : fd(-1), epollFd(-1), encoding(enc), totals(RelayStats()) {
+    throw std::runtime_error("The relay socket layer requires Linux (epoll)");
+}
+RelaySender::~RelaySender() {}
+void RelaySender::sendChain(const ChainSnapshot&, size_t) {}
+void RelaySender::flush() {}
+void RelaySender::close() {}
+
+RelayReceiver::RelayReceiver(uint16_t, RelayEncoding enc)
+    : listenFd(-1), epollFd(-1), boundPort(0), encoding(enc), totals(RelayStats()), malformed(false) {
+    throw std::runtime_error("The relay socket layer requires Linux (epoll)");
+}
+RelayReceiver::~RelayReceiver() {}
+bool RelayReceiver::run(int) { return false; }
+
+#endif
+
+/**
+ * Decodes every complete frame in data and hands the blocks to the
+ * replica: the first one becomes its genesis (with the checkpoints set
+ * here), the rest must extend it.
+ * @return Bytes of data that were parsed
+ */
+size_t RelayReceiver::consume(const uint8_t* data, size_t length) {
+    size_t used = 0;
+    while (used < length && !malformed) {
+        std::unique_ptr<BlockPow> block;
+        size_t consumed = 0;
+        FrameStatus status = encoding == RELAY_BINARY
+            ? decodeBlockFrame(data + used, length - used, consumed, block)
+            : decodeBlockText(data + used, length - used, consumed, block);
+        if (status == FRAME_INCOMPLETE) {
+            break;
+        }
+        if (status == FRAME_MALFORMED) {
+            malformed = true;
+            return length;
+        }
+        used += consumed;
+        //whatever a peer's block makes verification throw, it is that block's problem, not the loop's
+        try {
+            if (!replica) {
+                replica.reset(new BlockchainPow(std::move(block)));
+                replica->setCheckpoints(checkpoints);
+                totals.blocks++;
+            } else if (replica->acceptBlock(std::move(block))) {
+                totals.blocks++;
+            } else {
+                totals.rejected++;
+            }
+        } catch (const std::exception&) {
+            totals.rejected++;
+        }
+    }
+    return used;
+}
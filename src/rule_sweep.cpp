@@ -0,0 +1,146 @@
+#include "rule_sweep.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+bool within(const Estimate& e, double tolerance) {
+    return e.ci_low >= 0.5 - tolerance && e.ci_high <= 0.5 + tolerance;
+}
+
+void write_point(std::ostringstream& out, const SweepPoint& p) {
+    out << "{\"rule\": " << p.rule << ", \"steps\": " << p.steps << ", \"ns_per_hash\": " << p.ns_per_hash
+        << ", \"avalanche\": " << p.avalanche.value << ", \"avalanche_ci95\": [" << p.avalanche.ci_low
+        << ", " << p.avalanche.ci_high << "], \"ones_fraction\": " << p.ones_fraction.value
+        << ", \"ones_ci95\": [" << p.ones_fraction.ci_low << ", " << p.ones_fraction.ci_high
+        << "], \"sac_bias_max\": " << p.sac_bias_max << ", \"sac_deterministic\": " << p.sac_deterministic
+        << ", \"meets_bar\": " << (p.meets_bar ? "true" : "false")
+        << "}";
+}
+
+void write_points(std::ostringstream& out, const char* key, const std::vector<SweepPoint>& points, bool last) {
+    out << " \"" << key << "\": [";
+    for (size_t i = 0; i < points.size(); i++) {
+        out << (i ? ",\n  " : "\n  ");
+        write_point(out, points[i]);
+    }
+    out << "]" << (last ? "\n" : ",\n");
+}
+
+}
+
+double SweepPoint::avalanche_error() const {
+    return std::fabs(avalanche.value - 0.5);
+}
+
+SweepConfig default_sweep_config() {
+    SweepConfig config;
+    for (uint32_t rule = 0; rule < 256; rule++) {
+        config.rules.push_back(rule);
+    }
+    config.steps = {8, 16, 32, 64, 128};
+    config.samples = 64;
+    config.avalanche_inputs = 2;
+    config.input_bytes = 16;
+    config.avalanche_tolerance = 0.02;
+    config.balance_tolerance = 0.02;
+    config.max_deterministic = 0.9; //random hashes: 2^(1 - avalanche_inputs)
+    config.seed = 0x5EED;
+    return config;
+}
+
+/**
+ * Measures every rule x steps combination. Each combination is one pool
+ * task running the quality engine serially, so tasks never compete for
+ * the pool they run on and the timing is a single-core cost.
+ * @param config Rules, steps values, sample sizes and the quality bar
+ * @return One point per combination, ordered by rule then steps
+ */
+std::vector<SweepPoint> sweep_rules(const SweepConfig& config) {
+    std::vector<SweepPoint> points(config.rules.size() * config.steps.size());
+    QualityConfig quality = {config.samples, config.avalanche_inputs, config.input_bytes, config.seed, true};
+
+    ThreadPool::instance().parallel_for(0, points.size(), [&](size_t i) {
+        SweepPoint& point = points[i];
+        point.rule = config.rules[i / config.steps.size()];
+        point.steps = config.steps[i % config.steps.size()];
+        QualityReport report = analyze_hash_quality("", ac_hash_digest_function(point.rule, point.steps),
+                                                    quality);
+        point.ns_per_hash = report.hashes > 0 ? report.seconds * 1e9 / report.hashes : 0.0;
+        point.avalanche = report.avalanche;
+        point.ones_fraction = report.ones_fraction;
+        point.sac_bias_max = report.sac_bias_max;
+        point.sac_deterministic = report.sac_deterministic;
+        point.meets_bar = within(point.avalanche, config.avalanche_tolerance) &&
+                          within(point.ones_fraction, config.balance_tolerance) &&
+                          point.sac_deterministic <= config.max_deterministic;
+    }, 1);
+    return points;
+}
+
+std::vector<SweepPoint> cheapest_passing(const std::vector<SweepPoint>& points) {
+    std::vector<SweepPoint> best;
+    for (const SweepPoint& p : points) {
+        if (!p.meets_bar) continue;
+        std::vector<SweepPoint>::iterator it = std::find_if(best.begin(), best.end(),
+            [&](const SweepPoint& b) { return b.rule == p.rule; });
+        if (it == best.end()) {
+            best.push_back(p);
+        } else if (p.steps < it->steps) {
+            *it = p;
+        }
+    }
+    std::sort(best.begin(), best.end(), [](const SweepPoint& a, const SweepPoint& b) {
+        return a.ns_per_hash < b.ns_per_hash;
+    });
+    return best;
+}
+
+/**
+ * Pareto frontier over (ns/hash, avalanche error): sorted by speed, a
+ * point is kept when it is strictly closer to 0.5 than every faster one.
+ * @param points Sweep results
+ * @return The non-dominated points, fastest first
+ */
+std::vector<SweepPoint> pareto_frontier(const std::vector<SweepPoint>& points) {
+    std::vector<SweepPoint> sorted(points);
+    std::sort(sorted.begin(), sorted.end(), [](const SweepPoint& a, const SweepPoint& b) {
+        if (a.ns_per_hash != b.ns_per_hash) return a.ns_per_hash < b.ns_per_hash;
+        return a.avalanche_error() < b.avalanche_error();
+    });
+    std::vector<SweepPoint> frontier;
+    for (const SweepPoint& p : sorted) {
+        if (frontier.empty() || p.avalanche_error() < frontier.back().avalanche_error()) {
+            frontier.push_back(p);
+        }
+    }
+    return frontier;
+}
+
+std::string sweep_to_csv(const std::vector<SweepPoint>& points) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(5);
+    out << "rule,steps,ns_per_hash,avalanche,avalanche_ci95_low,avalanche_ci95_high,"
+           "ones_fraction,ones_ci95_low,ones_ci95_high,sac_bias_max,sac_deterministic,meets_bar\n";
+    for (const SweepPoint& p : points) {
+        out << p.rule << "," << p.steps << "," << std::setprecision(1) << p.ns_per_hash << std::setprecision(5)
+            << "," << p.avalanche.value << "," << p.avalanche.ci_low << "," << p.avalanche.ci_high << ","
+            << p.ones_fraction.value << "," << p.ones_fraction.ci_low << "," << p.ones_fraction.ci_high
+            << "," << p.sac_bias_max << "," << p.sac_deterministic << "," << (p.meets_bar ? 1 : 0) << "\n";
+    }
+    return out.str();
+}
+
+std::string sweep_to_json(const std::vector<SweepPoint>& points, const std::vector<SweepPoint>& cheapest,
+                          const std::vector<SweepPoint>& frontier) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(5) << "{\n";
+    write_points(out, "points", points, false);
+    write_points(out, "cheapest_passing", cheapest, false);
+    write_points(out, "pareto_frontier", frontier, true);
+    out << "}\n";
+    return out.str();
+}
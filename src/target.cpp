@@ -0,0 +1,274 @@
+#include "target.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const uint32_t MANTISSA_BITS = 24;
+const uint64_t MANTISSA_MIN = 1ULL << (MANTISSA_BITS - 1);
+const uint64_t MANTISSA_LIMIT = 1ULL << MANTISSA_BITS;
+const int MAX_EXPONENT = 256 - (MANTISSA_BITS - 1); //2^23 * 2^233 = 2^256
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+}
+
+Target::Target() {
+    normalize(MANTISSA_MIN, MAX_EXPONENT);
+}
+
+Target::Target(uint64_t m, int e) {
+    normalize(m, e);
+}
+
+/**
+ * Brings target + 1 = m * 2^e into canonical form (24-bit mantissa with
+ * its top bit set, unless the value is tiny) and precomputes the threshold
+ * bytes. Values above 2^256 are clamped, precision beyond 24 bits is
+ * truncated (which only makes the target slightly harder).
+ */
+void Target::normalize(uint64_t m, int e) {
+    if (m == 0) {
+        m = 1;
+        e = 0;
+    }
+    while (m >= MANTISSA_LIMIT) {
+        m >>= 1;
+        e++;
+    }
+    while (m < MANTISSA_MIN && e > 0) {
+        m <<= 1;
+        e--;
+    }
+    while (e < 0) {
+        m = std::max<uint64_t>(m >> 1, 1);
+        e++;
+    }
+    if (e > MAX_EXPONENT || (e == MAX_EXPONENT && m > MANTISSA_MIN)) {
+        m = MANTISSA_MIN;
+        e = MAX_EXPONENT;
+    }
+    mantissa = static_cast<uint32_t>(m);
+    exponent = static_cast<uint32_t>(e);
+
+    //threshold = m * 2^e - 1, built in 33 bytes so 2^256 fits before the subtraction
+    uint8_t value[33];
+    std::memset(value, 0, sizeof(value));
+    for (uint32_t i = 0; i < MANTISSA_BITS; i++) {
+        if (mantissa & (1u << i)) {
+            uint32_t bit = exponent + i;
+            value[32 - bit / 8] |= static_cast<uint8_t>(1u << (bit % 8));
+        }
+    }
+    for (int i = 32; i >= 0; i--) {
+        if (value[i]-- != 0) {
+            break;
+        }
+    }
+    std::memcpy(bytes, value + 1, 32);
+
+    zeroBits = -1;
+    if ((mantissa & (mantissa - 1)) == 0) {
+        int log2m = 0;
+        while ((1u << log2m) != mantissa) {
+            log2m++;
+        }
+        zeroBits = 256 - static_cast<int>(exponent) - log2m;
+    }
+}
+
+/**
+ * Target met by hashes with at least `bits` leading zero bits.
+ * @param bits Number of leading zero bits (0-256)
+ * @return The target 2^(256-bits) - 1
+ */
+Target Target::fromLeadingZeroBits(unsigned bits) {
+    bits = std::min(bits, 256u);
+    return Target(1, 256 - static_cast<int>(bits));
+}
+
+/**
+ * Target equivalent to the legacy difficulty: a hash with `difficulty`
+ * leading '0' hex characters is exactly a hash with 4 * difficulty
+ * leading zero bits.
+ * @param difficulty Number of leading '0' hex characters
+ * @return The target
+ */
+Target Target::fromNibbles(int difficulty) {
+    return fromLeadingZeroBits(static_cast<unsigned>(std::max(difficulty, 0)) * 4);
+}
+
+Target Target::fromCompact(uint32_t compact) {
+    return Target(compact & (MANTISSA_LIMIT - 1), static_cast<int>(compact >> MANTISSA_BITS));
+}
+
+uint32_t Target::toCompact() const {
+    return (exponent << MANTISSA_BITS) | mantissa;
+}
+
+/**
+ * Compares a hex hash against the target. Leading-zero-bit targets only
+ * look at the first few characters; other targets compare byte by byte
+ * from the most significant end and usually stop at the first byte.
+ * @param hexHash 64-character hex hash
+ * @return True if the hash is <= the target
+ */
+bool Target::isMetBy(const std::string& hexHash) const {
+    if (hexHash.size() != 64) {
+        return false;
+    }
+    if (zeroBits >= 0) {
+        size_t nibbles = static_cast<size_t>(zeroBits) / 4;
+        for (size_t i = 0; i < nibbles; i++) {
+            if (hexHash[i] != '0') {
+                return false;
+            }
+        }
+        int rest = zeroBits % 4;
+        if (rest == 0) {
+            return true;
+        }
+        int value = hexValue(hexHash[nibbles]);
+        return value >= 0 && value < (16 >> rest);
+    }
+    for (size_t i = 0; i < 32; i++) {
+        int high = hexValue(hexHash[2 * i]);
+        int low = hexValue(hexHash[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        int byte = (high << 4) | low;
+        if (byte != bytes[i]) {
+            return byte < bytes[i];
+        }
+    }
+    return true;
+}
+
+bool Target::isMetBy(const uint8_t* digest) const {
+    return std::memcmp(digest, bytes, 32) <= 0;
+}
+
+double Target::expectedHashes() const {
+    //2^256 / (mantissa * 2^exponent)
+    return std::ldexp(1.0 / mantissa, 256 - static_cast<int>(exponent));
+}
+
+double Target::difficultyBits() const {
+    return 256.0 - exponent - std::log2(static_cast<double>(mantissa));
+}
+
+/**
+ * Scales target + 1 by a factor: > 1 makes mining easier, < 1 harder.
+ * @param factor Scale factor (expected work is divided by it)
+ * @return The scaled target, clamped to the valid range
+ */
+Target Target::scaled(double factor) const {
+    double value = mantissa * std::max(factor, 0.0);
+    if (value <= 0.0) {
+        return Target(1, 0);
+    }
+    int shift;
+    double fraction = std::frexp(value, &shift); //value = fraction * 2^shift, fraction in [0.5, 1)
+    uint64_t m = static_cast<uint64_t>(std::ldexp(fraction, MANTISSA_BITS));
+    return Target(m, static_cast<int>(exponent) + shift - static_cast<int>(MANTISSA_BITS));
+}
+
+std::string Target::toHex() const {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(64, '0');
+    for (size_t i = 0; i < 32; i++) {
+        hex[2 * i] = digits[bytes[i] >> 4];
+        hex[2 * i + 1] = digits[bytes[i] & 0x0f];
+    }
+    return hex;
+}
+
+bool Target::isEasierThan(const Target& other) const {
+    return std::memcmp(bytes, other.bytes, 32) > 0;
+}
+
+bool Target::operator==(const Target& other) const {
+    return mantissa == other.mantissa && exponent == other.exponent;
+}
+
+bool Target::operator!=(const Target& other) const {
+    return !(*this == other);
+}
+
+RetargetController::RetargetController()
+    : blockMillis(0), window(8), maxAdjustment(4.0) {}
+
+/**
+ * @param targetBlockMillis Block interval to hold, in milliseconds
+ * @param windowSize Number of recent blocks the hash rate is measured over
+ * @param maxFactor Largest change of expected work in a single retarget
+ */
+RetargetController::RetargetController(double targetBlockMillis, size_t windowSize, double maxFactor)
+    : blockMillis(targetBlockMillis), window(std::max<size_t>(windowSize, 1)),
+      maxAdjustment(std::max(maxFactor, 1.0)) {}
+
+bool RetargetController::enabled() const {
+    return blockMillis > 0;
+}
+
+double RetargetController::getBlockMillis() const {
+    return blockMillis;
+}
+
+void RetargetController::record(double millis, const Target& target) {
+    samples.push_back(std::make_pair(std::max(millis, 0.0), target.expectedHashes()));
+    while (samples.size() > window) {
+        samples.pop_front();
+    }
+}
+
+double RetargetController::averageMillis() const {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    double total = 0;
+    for (const auto& sample : samples) {
+        total += sample.first;
+    }
+    return total / samples.size();
+}
+
+double RetargetController::hashesPerMilli() const {
+    double millis = 0;
+    double hashes = 0;
+    for (const auto& sample : samples) {
+        millis += sample.first;
+        hashes += sample.second;
+    }
+    return millis > 0 ? hashes / millis : 0.0;
+}
+
+/**
+ * Next target: the one whose expected work takes blockMillis at the hash
+ * rate measured over the window, moved by at most maxAdjustment.
+ * @param current The target blocks are currently mined at
+ * @return The new target (current if disabled or nothing was recorded)
+ */
+Target RetargetController::retarget(const Target& current) const {
+    if (!enabled() || samples.empty()) {
+        return current;
+    }
+    double rate = hashesPerMilli();
+    double factor = 1.0 / maxAdjustment; //blocks faster than the clock can measure
+    if (rate > 0) {
+        factor = current.expectedHashes() / (rate * blockMillis);
+    }
+    factor = std::min(std::max(factor, 1.0 / maxAdjustment), maxAdjustment);
+    return current.scaled(factor);
+}
+
+void RetargetController::reset() {
+    samples.clear();
+}
@@ -0,0 +1,244 @@
+#include "thread_pool.h"
+#include "numa_topology.h"
+#include <algorithm>
+#include <exception>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+//which pool/worker the current thread belongs to
+thread_local const ThreadPool* tls_pool = nullptr;
+thread_local int tls_worker = -1;
+}
+
+/**
+ * Starts the worker threads.
+ * @param num_threads Number of workers (0 = std::thread::hardware_concurrency())
+ * @param pinning CPU affinity policy applied to each worker
+ */
+ThreadPool::ThreadPool(size_t num_threads, PinningMode pinning)
+    : pinning(pinning), pending(0), next_queue(0), stopping(false) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < num_threads; i++) {
+        workers.emplace_back(new Worker());
+    }
+    for (size_t i = 0; i < num_threads; i++) {
+        workers[i]->thread = std::thread(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+/**
+ * Drains the queued tasks and joins every worker.
+ */
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool(0, NumaTopology::system().is_numa() ? PIN_PER_NODE : NO_PINNING);
+    return pool;
+}
+
+int ThreadPool::current_worker() {
+    return tls_worker;
+}
+
+size_t ThreadPool::size() const {
+    return workers.size();
+}
+
+PinningMode ThreadPool::get_pinning() const {
+    return pinning;
+}
+
+int ThreadPool::worker_node(size_t index) const {
+    const NumaTopology& topology = NumaTopology::system();
+    if (pinning == PIN_PER_NODE) {
+        return topology.node_for_worker(index).id;
+    }
+    if (pinning == PIN_COMPACT) {
+        unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+        return topology.node_of_cpu(static_cast<int>(index % hw));
+    }
+    return topology.current_node();
+}
+
+/**
+ * Queues a task. Tasks submitted from a worker go to the back of that
+ * worker's own deque (LIFO, cache-warm), others are spread round-robin.
+ */
+void ThreadPool::push(std::function<void()> task) {
+    size_t target = (tls_pool == this) ? static_cast<size_t>(tls_worker)
+                                       : next_queue.fetch_add(1) % workers.size();
+    {
+        //count it before it is visible, or a thief could pop it and wrap pending below 0
+        std::lock_guard<std::mutex> lock(workers[target]->mutex);
+        pending.fetch_add(1);
+        workers[target]->tasks.push_back(std::move(task));
+    }
+    {
+        //taking the lock orders the notify after a sleeper's predicate check
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+    }
+    wake.notify_one();
+}
+
+/**
+ * Pops from the back of our own deque, otherwise steals from the front of
+ * another worker's deque (oldest task, usually the biggest piece of work).
+ * @param self Index of the deque to try first
+ * @param task Receives the task
+ * @return True if a task was found
+ */
+bool ThreadPool::try_pop(size_t self, std::function<void()>& task) {
+    size_t n = workers.size();
+    {
+        Worker& own = *workers[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+    for (size_t k = 1; k < n; k++) {
+        Worker& victim = *workers[(self + k) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::run_pending_task() {
+    if (pending.load() == 0) {
+        return false;
+    }
+    size_t self = (tls_pool == this) ? static_cast<size_t>(tls_worker)
+                                     : next_queue.load() % workers.size();
+    std::function<void()> task;
+    if (!try_pop(self, task)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::worker_loop(size_t index) {
+    tls_pool = this;
+    tls_worker = static_cast<int>(index);
+    pin_worker(index);
+
+    while (true) {
+        std::function<void()> task;
+        if (try_pop(index, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [this]() { return stopping.load() || pending.load() > 0; });
+        if (stopping.load() && pending.load() == 0) {
+            return;
+        }
+    }
+}
+
+/**
+ * Applies the pool's pinning policy to the calling worker.
+ * Only implemented on Linux, a no-op elsewhere.
+ */
+void ThreadPool::pin_worker(size_t index) {
+#ifdef __linux__
+    if (pinning == NO_PINNING) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pinning == PIN_PER_NODE) {
+        for (int cpu : NumaTopology::system().node_for_worker(index).cpus) {
+            CPU_SET(cpu, &set);
+        }
+    } else {
+        unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+        CPU_SET(index % hw, &set);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)index;
+#endif
+}
+
+/**
+ * Runs body(i) for every i in [begin, end) on the pool and blocks until all
+ * iterations are done. The range is cut into chunks of `grain` iterations
+ * (default: about 4 chunks per worker). The calling thread executes queued
+ * tasks while it waits, so nested parallel_for calls from inside a worker
+ * cannot deadlock; once nothing is left to steal it blocks on a latch
+ * instead of spinning. The first exception thrown by body is rethrown here.
+ */
+void ThreadPool::parallel_for(size_t begin, size_t end, const std::function<void(size_t)>& body,
+                              size_t grain) {
+    if (begin >= end) {
+        return;
+    }
+    size_t count = end - begin;
+    if (grain == 0) {
+        grain = std::max<size_t>(1, count / (workers.size() * 4));
+    }
+    size_t chunks = (count + grain - 1) / grain;
+
+    std::atomic<size_t> remaining(chunks);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    std::mutex done_mutex;
+    std::condition_variable done;
+
+    for (size_t c = 0; c < chunks; c++) {
+        size_t lo = begin + c * grain;
+        size_t hi = std::min(end, lo + grain);
+        push([&, lo, hi]() {
+            try {
+                for (size_t i = lo; i < hi; i++) {
+                    body(i);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            //count down under the lock: once the waiter holds it and sees 0, no chunk touches these locals again
+            std::lock_guard<std::mutex> lock(done_mutex);
+            if (remaining.fetch_sub(1) == 1) {
+                done.notify_all();
+            }
+        });
+    }
+
+    //help while there is anything to steal, then sleep until the last chunk finishes
+    while (remaining.load() > 0 && run_pending_task()) {
+    }
+    {
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done.wait(lock, [&]() { return remaining.load() == 0; });
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,151 @@
+#include "tx_index.h"
+#include <algorithm>
+
+namespace {
+
+//confirms a candidate against its payload
+void confirm(const BlockPow* block, size_t height, const std::string& tx, TxSearchResult& result) {
+    result.candidates++;
+    if (blockHasTransaction(block->getData(), tx)) {
+        result.heights.push_back(height);
+    }
+}
+
+//tests blocks [first, last) through their own filters; positions are recomputed only when the geometry changes
+void filterRange(const ChainSnapshot& snapshot, size_t first, size_t last, const std::string& tx,
+                 const BloomKey& key, TxSearchResult& result) {
+    BloomGeometry geometry = {0, 0};
+    size_t bits[BLOOM_MAX_HASHES];
+    for (size_t i = first; i < last; i++) {
+        const BloomFilter& filter = snapshot[i]->getFilter();
+        if (filter.empty()) {
+            continue;
+        }
+        if (filter.geometry() != geometry) {
+            geometry = filter.geometry();
+            BloomFilter::positions(key, geometry, bits);
+        }
+        if (filter.testAll(bits)) {
+            confirm(snapshot[i], i, tx, result);
+        }
+    }
+}
+
+} // namespace
+
+TxSearchResult scanTransaction(const ChainSnapshot& snapshot, const std::string& tx) {
+    TxSearchResult result;
+    result.candidates = 0;
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        confirm(snapshot[i], i, tx, result);
+    }
+    return result;
+}
+
+TxSearchResult filterTransaction(const ChainSnapshot& snapshot, const std::string& tx) {
+    TxSearchResult result;
+    result.candidates = 0;
+    filterRange(snapshot, 0, snapshot.size(), tx, bloomKey(tx), result);
+    return result;
+}
+
+TransactionIndex::TransactionIndex(const BloomGeometry& geometry)
+    : shape(geometry), columns(geometry.bits), groups(0), scratch(TX_INDEX_CHUNK_WORDS) {}
+
+/**
+ * Transposes the filters of every complete group of 64 blocks not yet
+ * indexed into the columns: bit b of block 64g + j becomes bit j of
+ * columns[b][g]. A block whose filter has another geometry contributes
+ * all ones, so it is always a candidate and is tested on its own.
+ * @param snapshot The chain, at least as long as at the previous update
+ */
+void TransactionIndex::update(const ChainSnapshot& snapshot) {
+    size_t complete = snapshot.size() / TX_INDEX_GROUP_BLOCKS;
+    if (complete <= groups) {
+        return;
+    }
+    for (std::vector<uint64_t>& column : columns) {
+        column.resize(complete, 0);
+    }
+    for (; groups < complete; groups++) {
+        for (size_t j = 0; j < TX_INDEX_GROUP_BLOCKS; j++) {
+            size_t height = groups * TX_INDEX_GROUP_BLOCKS + j;
+            const BloomFilter& filter = snapshot[height]->getFilter();
+            uint64_t bit = 1ULL << j;
+            if (filter.geometry() != shape) {
+                loose.push_back(height);
+                for (std::vector<uint64_t>& column : columns) {
+                    column[groups] |= bit;
+                }
+                continue;
+            }
+            const std::vector<uint64_t>& words = filter.words();
+            for (size_t w = 0; w < words.size(); w++) {
+                //visit the set bits only
+                for (uint64_t rest = words[w]; rest != 0; rest &= rest - 1) {
+                    columns[w * 64 + __builtin_ctzll(rest)][groups] |= bit;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Finds the blocks holding tx. The indexed groups are searched a chunk of
+ * TX_INDEX_CHUNK_WORDS groups at a time: the first column of the query's
+ * bit positions is copied into the accumulator and the others are ANDed
+ * in, stopping early once the whole chunk is zero. Loose blocks are
+ * always candidates and get their own filter test before the payload.
+ * @param snapshot The chain to search (it is indexed first)
+ * @param tx The transaction string, without the ';' terminator
+ * @return Heights holding tx and the number of payloads read
+ */
+TxSearchResult TransactionIndex::find(const ChainSnapshot& snapshot, const std::string& tx) {
+    update(snapshot);
+    TxSearchResult result;
+    result.candidates = 0;
+    BloomKey key = bloomKey(tx);
+    size_t bits[BLOOM_MAX_HASHES];
+    BloomFilter::positions(key, shape, bits);
+    //a column hit by two probes is ANDed once
+    std::sort(bits, bits + shape.hashes);
+    unsigned probes = static_cast<unsigned>(std::unique(bits, bits + shape.hashes) - bits);
+
+    size_t nextLoose = 0;
+    uint64_t* acc = scratch.data();
+    for (size_t first = 0; first < groups; first += TX_INDEX_CHUNK_WORDS) {
+        size_t count = std::min(TX_INDEX_CHUNK_WORDS, groups - first);
+        const uint64_t* column = columns[bits[0]].data() + first;
+        std::copy(column, column + count, acc);
+        uint64_t any = 1;
+        for (unsigned p = 1; p < probes && any != 0; p++) {
+            column = columns[bits[p]].data() + first;
+            any = 0;
+            for (size_t g = 0; g < count; g++) {
+                acc[g] &= column[g];
+                any |= acc[g];
+            }
+        }
+        if (any == 0) {
+            continue;
+        }
+        for (size_t g = 0; g < count; g++) {
+            for (uint64_t rest = acc[g]; rest != 0; rest &= rest - 1) {
+                size_t height = (first + g) * TX_INDEX_GROUP_BLOCKS + __builtin_ctzll(rest);
+                while (nextLoose < loose.size() && loose[nextLoose] < height) {
+                    nextLoose++;
+                }
+                bool isLoose = nextLoose < loose.size() && loose[nextLoose] == height;
+                if (!isLoose || snapshot[height]->getFilter().mayContain(key)) {
+                    confirm(snapshot[height], height, tx, result);
+                }
+            }
+        }
+    }
+    filterRange(snapshot, indexedBlocks(), snapshot.size(), tx, key, result);
+    return result;
+}
+
+size_t TransactionIndex::memoryBytes() const {
+    return columns.size() * groups * sizeof(uint64_t);
+}
@@ -1,25 +1,88 @@
 #include "utils.h"
+#include "instrumentation.h"
 #include <openssl/sha.h>
 #include <sstream>
 #include <iomanip>
 #include <chrono>
+#include <cstring>
 
+namespace {
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+}
 
 std::string sha256(const std::string& input) {
+    return sha256(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+}
+
+std::string sha256(const uint8_t* input, size_t length) {
     unsigned char hash[SHA256_DIGEST_LENGTH];
-    SHA256((unsigned char*)input.c_str(), input.length(), hash);
-    std::stringstream ss;
-    for(int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-        ss << std::hex << std::setw(2) << std::setfill('0') << (int)hash[i];
+    sha256Digest(input, length, hash);
+    PROFILE_SCOPE(STAGE_HEX_ENCODE);
+    return digestToHex(hash);
+}
+
+void sha256Digest(const uint8_t* input, size_t length, uint8_t* digest) {
+    PROFILE_SCOPE(STAGE_SHA256);
+    SHA256(input, length, digest);
+}
+
+/**
+ * Lowercase hex encoding of a 32-byte digest (64 characters).
+ */
+std::string digestToHex(const uint8_t* digest) {
+    std::string hex(DIGEST_SIZE * 2, '0');
+    for (size_t i = 0; i < DIGEST_SIZE; i++) {
+        hex[2 * i] = HEX_DIGITS[digest[i] >> 4];
+        hex[2 * i + 1] = HEX_DIGITS[digest[i] & 0x0f];
     }
-    return ss.str();
+    return hex;
 }
 
-std::string getCurrentTime() {
+/**
+ * Decodes a 64-character hex hash into 32 bytes.
+ * @param hex The hex string
+ * @param digest Receives the bytes; zeroed when hex is not a full digest
+ *               (e.g. the genesis block's "0" previous hash)
+ * @return True if hex was a valid 64-character digest
+ */
+bool hexToDigest(const std::string& hex, uint8_t* digest) {
+    std::memset(digest, 0, DIGEST_SIZE);
+    if (hex.size() != DIGEST_SIZE * 2) {
+        return false;
+    }
+    for (size_t i = 0; i < DIGEST_SIZE; i++) {
+        int high = hexValue(hex[2 * i]);
+        int low = hexValue(hex[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            std::memset(digest, 0, DIGEST_SIZE);
+            return false;
+        }
+        digest[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+    return true;
+}
+
+uint64_t currentTimestampMillis() {
     using namespace std::chrono;
-    auto now = system_clock::now();
-    auto ms = duration_cast<milliseconds>(now.time_since_epoch()) % 1000;
-    std::time_t t = system_clock::to_time_t(now);
+    return static_cast<uint64_t>(
+        duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * Formats milliseconds since the Unix epoch as local time,
+ * e.g. "Mon Jan 05 14:03:27.412".
+ */
+std::string formatTimestamp(uint64_t millis) {
+    std::time_t t = static_cast<std::time_t>(millis / 1000);
     std::tm bt;
 #ifdef _WIN32
     localtime_s(&bt, &t);
@@ -28,6 +91,10 @@ std::string getCurrentTime() {
 #endif
     std::ostringstream oss;
     oss << std::put_time(&bt, "%a %b %d %H:%M:%S");
-    oss << "." << std::setw(3) << std::setfill('0') << ms.count();
+    oss << "." << std::setw(3) << std::setfill('0') << millis % 1000;
     return oss.str();
-}
\ No newline at end of file
+}
+
+std::string getCurrentTime() {
+    return formatTimestamp(currentTimestampMillis());
+}
@@ -0,0 +1,219 @@
+/**
+ * Minimal statistically sound benchmark harness for the test programs.
+ *
+ * Every benchmark is warmed up, then timed over repeated trials. A trial
+ * runs the measured function enough times to last at least
+ * `min_trial_ms` (so timer resolution is irrelevant), and records the
+ * ns/op of that trial. Results report median, p95, p99 and a 95%
+ * confidence interval of the mean over the trials.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct BenchmarkConfig {
+    int warmup;          //untimed calls before the trials
+    int trials;          //timed trials
+    double min_trial_ms; //minimum duration of one trial
+};
+
+struct BenchmarkStats {
+    std::string name;
+    std::string params;
+    int trials;
+    double median_ns;    //per operation
+    double mean_ns;
+    double p95_ns;
+    double p99_ns;
+    double ci_low_ns;    //95% CI of the mean
+    double ci_high_ns;
+    double ops_per_sec;  //from the median
+};
+
+//student t quantile (two-sided 95%) for df degrees of freedom
+inline double tQuantile95(int df) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+                                   2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+                                   2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+                                   2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df < 1) return 0.0;
+    return (df <= 30) ? table[df - 1] : 1.96;
+}
+
+//nearest-rank percentile of sorted samples
+inline double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+inline BenchmarkStats summarize(const std::string& name, const std::string& params,
+                                std::vector<double> samples) {
+    BenchmarkStats stats;
+    stats.name = name;
+    stats.params = params;
+    stats.trials = static_cast<int>(samples.size());
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0;
+    for (double s : samples) sum += s;
+    stats.mean_ns = samples.empty() ? 0.0 : sum / samples.size();
+    double var = 0;
+    for (double s : samples) var += (s - stats.mean_ns) * (s - stats.mean_ns);
+    double stddev = samples.size() > 1 ? std::sqrt(var / (samples.size() - 1)) : 0.0;
+    double half = samples.size() > 1
+        ? tQuantile95(static_cast<int>(samples.size()) - 1) * stddev / std::sqrt(samples.size())
+        : 0.0;
+
+    size_t n = samples.size();
+    stats.median_ns = n == 0 ? 0.0 : (n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2);
+    stats.p95_ns = percentile(samples, 95);
+    stats.p99_ns = percentile(samples, 99);
+    stats.ci_low_ns = stats.mean_ns - half;
+    stats.ci_high_ns = stats.mean_ns + half;
+    stats.ops_per_sec = stats.median_ns > 0 ? 1e9 / stats.median_ns : 0.0;
+    return stats;
+}
+
+/**
+ * Benchmarks func(), which performs `ops` operations per call (e.g. one
+ * call = one hash, or one block validation of N blocks = N ops).
+ */
+template<typename F>
+BenchmarkStats runBenchmark(const std::string& name, const std::string& params,
+                            const BenchmarkConfig& config, double ops, F func) {
+    typedef std::chrono::steady_clock Clock;
+    for (int i = 0; i < config.warmup; i++) {
+        func();
+    }
+
+    //size a trial so it lasts at least min_trial_ms
+    size_t calls = 1;
+    while (true) {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < calls; i++) func();
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (ms >= config.min_trial_ms || calls >= (1u << 24)) break;
+        calls *= 2;
+    }
+
+    std::vector<double> samples;
+    samples.reserve(config.trials);
+    for (int t = 0; t < config.trials; t++) {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < calls; i++) func();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        samples.push_back(ns / (calls * ops));
+    }
+    return summarize(name, params, samples);
+}
+
+/**
+ * Same as runBenchmark, for functions whose amount of work varies between
+ * calls (e.g. mining, where the nonce count depends on the data): func()
+ * returns the number of operations it performed.
+ */
+template<typename F>
+BenchmarkStats runCountedBenchmark(const std::string& name, const std::string& params,
+                                   const BenchmarkConfig& config, F func) {
+    typedef std::chrono::steady_clock Clock;
+    for (int i = 0; i < config.warmup; i++) {
+        func();
+    }
+
+    std::vector<double> samples;
+    samples.reserve(config.trials);
+    for (int t = 0; t < config.trials; t++) {
+        double ops = 0;
+        double ms = 0;
+        Clock::time_point start = Clock::now();
+        while (ms < config.min_trial_ms) {
+            ops += func();
+            ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+        samples.push_back(ms * 1e6 / std::max(ops, 1.0));
+    }
+    return summarize(name, params, samples);
+}
+
+inline void printStatsHeader() {
+    std::cout << std::left
+              << std::setw(16) << "Benchmark"
+              << std::setw(26) << "Params"
+              << std::setw(14) << "Median(ns)"
+              << std::setw(14) << "p95(ns)"
+              << std::setw(14) << "p99(ns)"
+              << std::setw(24) << "95% CI mean(ns)"
+              << std::setw(14) << "ops/s" << std::endl;
+    std::cout << std::string(122, '-') << std::endl;
+}
+
+inline void printStatsRow(const BenchmarkStats& s) {
+    std::ostringstream ci;
+    ci << std::fixed << std::setprecision(1) << s.ci_low_ns << "-" << s.ci_high_ns;
+    std::cout << std::left
+              << std::setw(16) << s.name
+              << std::setw(26) << s.params
+              << std::setw(14) << std::fixed << std::setprecision(1) << s.median_ns
+              << std::setw(14) << s.p95_ns
+              << std::setw(14) << s.p99_ns
+              << std::setw(24) << ci.str()
+              << std::setw(14) << std::setprecision(0) << s.ops_per_sec << std::endl;
+}
+
+inline bool writeCsv(const std::string& path, const std::vector<BenchmarkStats>& results) {
+    std::ofstream out(path.c_str());
+    if (!out) return false;
+    out << "benchmark,params,trials,median_ns,mean_ns,p95_ns,p99_ns,ci95_low_ns,ci95_high_ns,ops_per_sec\n";
+    out << std::fixed << std::setprecision(2);
+    for (const BenchmarkStats& s : results) {
+        out << s.name << ",\"" << s.params << "\"," << s.trials << "," << s.median_ns << ","
+            << s.mean_ns << "," << s.p95_ns << "," << s.p99_ns << "," << s.ci_low_ns << ","
+            << s.ci_high_ns << "," << s.ops_per_sec << "\n";
+    }
+    return true;
+}
+
+inline bool writeJson(const std::string& path, const std::vector<BenchmarkStats>& results) {
+    std::ofstream out(path.c_str());
+    if (!out) return false;
+    out << std::fixed << std::setprecision(2) << "[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkStats& s = results[i];
+        out << "  {\"benchmark\": \"" << s.name << "\", \"params\": \"" << s.params
+            << "\", \"trials\": " << s.trials << ", \"median_ns\": " << s.median_ns
+            << ", \"mean_ns\": " << s.mean_ns << ", \"p95_ns\": " << s.p95_ns
+            << ", \"p99_ns\": " << s.p99_ns << ", \"ci95_ns\": [" << s.ci_low_ns << ", "
+            << s.ci_high_ns << "], \"ops_per_sec\": " << s.ops_per_sec << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+    return true;
+}
+
+//puts the Logger in silent mode for its lifetime (setup code that logs, e.g. addBlock)
+class ScopedSilence {
+private:
+    LogLevel saved;
+
+public:
+    ScopedSilence() : saved(Logger::instance().level()) {
+        Logger::instance().flush();
+        Logger::instance().set_level(LOG_SILENT);
+    }
+    ~ScopedSilence() { Logger::instance().set_level(saved); }
+};
+
+#endif
@@ -26,7 +26,7 @@ mkdir -p "$BUILD_DIR"
 
 # Compiler settings
 CXX="g++"
-CXXFLAGS="-std=c++11 -I$INCLUDE_DIR"
+CXXFLAGS="-std=c++11 -pthread -I$INCLUDE_DIR"
 LIBS=""
 
 # Detect OS and set library paths
@@ -45,10 +45,26 @@ fi
 # Source files
 CA_SRC="$SRC_DIR/cellular_automaton.cpp"
 AC_HASH_SRC="$SRC_DIR/ac_hash.cpp"
+AC_HASH_PARALLEL_SRC="$SRC_DIR/ac_hash_parallel.cpp"
+R2_SRC="$SRC_DIR/radius2_automaton.cpp"
 UTILS_SRC="$SRC_DIR/utils.cpp"
 POW_SRC="$SRC_DIR/pow.cpp"
+BLOCK_HEADER_SRC="$SRC_DIR/block_header.cpp"
+TARGET_SRC="$SRC_DIR/target.cpp"
 BLOCK_POW_SRC="$SRC_DIR/block_pow.cpp"
 BLOCKCHAIN_POW_SRC="$SRC_DIR/blockchain_pow.cpp"
+BLOOM_SRC="$SRC_DIR/bloom_filter.cpp"
+STATE_SRC="$SRC_DIR/account_state.cpp"
+THREAD_POOL_SRC="$SRC_DIR/thread_pool.cpp"
+NUMA_SRC="$SRC_DIR/numa_topology.cpp"
+INSTRUMENT_SRC="$SRC_DIR/instrumentation.cpp"
+LOGGER_SRC="$SRC_DIR/logger.cpp"
+QUALITY_SRC="$SRC_DIR/hash_quality.cpp"
+SWEEP_SRC="$SRC_DIR/rule_sweep.cpp"
+NETWORK_SIM_SRC="$SRC_DIR/network_sim.cpp"
+RELAY_SRC="$SRC_DIR/relay.cpp"
+QUERY_SERVER_SRC="$SRC_DIR/query_server.cpp"
+TX_INDEX_SRC="$SRC_DIR/tx_index.cpp"
 
 echo -e "${BLUE}================================================================${NC}"
 echo -e "${BLUE}=          BLOCKCHAIN CA - AUTOMATED TEST SUITE                =${NC}"
@@ -92,34 +108,104 @@ run_test "1" "Cellular Automaton Implementation" \
 
 # Test 2: AC Hash Function
 run_test "2" "AC Hash Function" \
-    "$CA_SRC $AC_HASH_SRC" \
+    "$CA_SRC $R2_SRC $AC_HASH_SRC" \
     false
 
 # Test 3: Blockchain Integration
 run_test "3" "Blockchain Integration (SHA256 vs AC_HASH)" \
-    "$CA_SRC $AC_HASH_SRC $UTILS_SRC $POW_SRC $BLOCK_POW_SRC $BLOCKCHAIN_POW_SRC" \
+    "$CA_SRC $R2_SRC $AC_HASH_SRC $AC_HASH_PARALLEL_SRC $UTILS_SRC $POW_SRC $BLOCK_HEADER_SRC $TARGET_SRC $BLOCK_POW_SRC $BLOCKCHAIN_POW_SRC $BLOOM_SRC $STATE_SRC $THREAD_POOL_SRC $NUMA_SRC $INSTRUMENT_SRC $LOGGER_SRC" \
     true
 
 # Test 4: Performance Benchmark
 run_test "4_benchmark" "Performance Benchmarking" \
-    "$CA_SRC $AC_HASH_SRC $UTILS_SRC $POW_SRC $BLOCK_POW_SRC $BLOCKCHAIN_POW_SRC" \
+    "$CA_SRC $R2_SRC $AC_HASH_SRC $AC_HASH_PARALLEL_SRC $UTILS_SRC $POW_SRC $BLOCK_HEADER_SRC $TARGET_SRC $BLOCK_POW_SRC $BLOCKCHAIN_POW_SRC $BLOOM_SRC $STATE_SRC $THREAD_POOL_SRC $NUMA_SRC $INSTRUMENT_SRC $LOGGER_SRC" \
     true
 
 # Test 5: Avalanche Effect
 run_test "5" "Avalanche Effect Analysis" \
-    "$CA_SRC $AC_HASH_SRC" \
+    "$CA_SRC $R2_SRC $AC_HASH_SRC $THREAD_POOL_SRC $NUMA_SRC $INSTRUMENT_SRC" \
     false
 
 # Test 6: Bit Distribution
 run_test "6" "Bit Distribution Analysis" \
-    "$CA_SRC $AC_HASH_SRC" \
+    "$CA_SRC $R2_SRC $AC_HASH_SRC $THREAD_POOL_SRC $NUMA_SRC $INSTRUMENT_SRC" \
     false
 
 # Test 7: Rule Comparison
 run_test "7" "CA Rules Comparison (30, 90, 110)" \
-    "$CA_SRC $AC_HASH_SRC" \
+    "$CA_SRC $R2_SRC $AC_HASH_SRC $THREAD_POOL_SRC $NUMA_SRC $INSTRUMENT_SRC" \
     false
 
+# Test 8: Thread Pool Benchmark
+run_test "8_threadpool_benchmark" "Thread Pool Microbenchmark" \
+    "$CA_SRC $R2_SRC $AC_HASH_SRC $THREAD_POOL_SRC $NUMA_SRC $INSTRUMENT_SRC" \
+    false
+
+# Test 9: NUMA Placement Benchmark
+run_test "9_numa_benchmark" "NUMA Placement Benchmark" \
+    "$CA_SRC $R2_SRC $AC_HASH_SRC $THREAD_POOL_SRC $NUMA_SRC $INSTRUMENT_SRC" \
+    false
+
+# Test 10: Mining Instrumentation (instrumented build)
+CXXFLAGS="$CXXFLAGS -DBLOCKCHAIN_INSTRUMENT" run_test "10_profile" "Mining Hot-Path Instrumentation" \
+    "$CA_SRC $R2_SRC $AC_HASH_SRC $AC_HASH_PARALLEL_SRC $UTILS_SRC $POW_SRC $BLOCK_HEADER_SRC $TARGET_SRC $BLOCK_POW_SRC $BLOCKCHAIN_POW_SRC $BLOOM_SRC $STATE_SRC $THREAD_POOL_SRC $NUMA_SRC $INSTRUMENT_SRC $LOGGER_SRC" \
+    true
+
+# Test 11: Parallel Hash Quality Suite
+CXXFLAGS="$CXXFLAGS -O2" run_test "11_hash_quality" "Parallel Hash Quality Suite" \
+    "$QUALITY_SRC $CA_SRC $R2_SRC $AC_HASH_SRC $AC_HASH_PARALLEL_SRC $UTILS_SRC $POW_SRC $BLOCK_HEADER_SRC $TARGET_SRC $BLOCK_POW_SRC $BLOCKCHAIN_POW_SRC $BLOOM_SRC $STATE_SRC $THREAD_POOL_SRC $NUMA_SRC $INSTRUMENT_SRC $LOGGER_SRC" \
+    true
+
+# Test 12: Rule x Steps Sweep
+CXXFLAGS="$CXXFLAGS -O2" run_test "12_rule_sweep" "Rule x Steps Sweep" \
+    "$SWEEP_SRC $QUALITY_SRC $CA_SRC $R2_SRC $AC_HASH_SRC $AC_HASH_PARALLEL_SRC $UTILS_SRC $POW_SRC $BLOCK_HEADER_SRC $TARGET_SRC $BLOCK_POW_SRC $BLOCKCHAIN_POW_SRC $BLOOM_SRC $STATE_SRC $THREAD_POOL_SRC $NUMA_SRC $INSTRUMENT_SRC $LOGGER_SRC" \
+    true
+
+# Test 13: Parallel AC_HASH
+CXXFLAGS="$CXXFLAGS -O2" run_test "13_parallel_hash" "Parallel AC_HASH" \
+    "$CA_SRC $R2_SRC $AC_HASH_SRC $AC_HASH_PARALLEL_SRC $UTILS_SRC $POW_SRC $BLOCK_HEADER_SRC $TARGET_SRC $BLOCK_POW_SRC $BLOCKCHAIN_POW_SRC $BLOOM_SRC $STATE_SRC $THREAD_POOL_SRC $NUMA_SRC $INSTRUMENT_SRC $LOGGER_SRC" \
+    true
+
+# Test 14: Lock-free Chain Snapshots
+CXXFLAGS="$CXXFLAGS -O2" run_test "14_concurrent_reads" "Lock-free Chain Snapshots" \
+    "$BLOCKCHAIN_SRCS" \
+    true
+
+# Test 15: Network Simulator
+CXXFLAGS="$CXXFLAGS -O2" run_test "15_network_sim" "Network Simulator" \
+    "$NETWORK_SIM_SRC $BLOCKCHAIN_SRCS" \
+    true
+
+# Test 16: Block Relay Between Processes
+CXXFLAGS="$CXXFLAGS -O2" run_test "16_relay" "Block Relay Between Processes" \
+    "$RELAY_SRC $BLOCKCHAIN_SRCS" \
+    true
+
+# Test 17: Epoll Query Server
+CXXFLAGS="$CXXFLAGS -O2" run_test "17_query_server" "Epoll Query Server" \
+    "$QUERY_SERVER_SRC $RELAY_SRC $BLOCKCHAIN_SRCS" \
+    true
+
+# Test 18: Batch Verification
+CXXFLAGS="$CXXFLAGS -O2" run_test "18_batch_verify" "Batch Verification" \
+    "$BLOCKCHAIN_SRCS" \
+    true
+
+# Test 19: Assume-Valid Checkpoints
+CXXFLAGS="$CXXFLAGS -O2" run_test "19_checkpoints" "Assume-Valid Checkpoints" \
+    "$RELAY_SRC $BLOCKCHAIN_SRCS" \
+    true
+
+# Test 20: Transaction Search
+CXXFLAGS="$CXXFLAGS -O2" run_test "20_tx_search" "Transaction Search" \
+    "$TX_INDEX_SRC $BLOCKCHAIN_SRCS" \
+    true
+
+# Test 21: Balance State Engine
+CXXFLAGS="$CXXFLAGS -O2" run_test "21_balances" "Balance State Engine" \
+    "$BLOCKCHAIN_SRCS" \
+    true
+
 echo -e "${BLUE}================================================================${NC}"
 echo -e "${GREEN}ALL TESTS COMPLETED${NC}"
 echo -e "${BLUE}================================================================${NC}"
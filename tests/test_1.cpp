@@ -11,6 +11,101 @@
 
 #include "cellular_automaton.h"
 #include <iostream>
+#include <chrono>
+
+/**
+ * Checks that evolve_steps() on additive rules (fast-forward) lands on the
+ * same state as stepping one generation at a time.
+ */
+void test_linear_fast_forward() {
+    std::cout << "\n--- Additive rules fast-forward ---" << std::endl;
+    uint32_t rules[] = {60, 90, 102, 150};
+    size_t steps[] = {1, 2, 7, 64, 100, 257};
+    for (uint32_t rule : rules) {
+        bool ok = true;
+        for (size_t s : steps) {
+            CellularAutomaton fast(97, rule);
+            CellularAutomaton slow(97, rule);
+            fast.init_single_center();
+            slow.init_single_center();
+            fast.evolve_steps(s);
+            for (size_t i = 0; i < s; i++) {
+                slow.evolve();
+            }
+            ok = ok && fast.get_state() == slow.get_state();
+        }
+        std::cout << "Rule " << rule << " (additive: " << (CellularAutomaton(1, rule).is_additive() ? "yes" : "no")
+                  << ") fast-forward matches stepping: " << (ok ? "PASS" : "FAIL") << std::endl;
+    }
+
+    CellularAutomaton ca(256, 90);
+    ca.init_single_center();
+    auto start = std::chrono::high_resolution_clock::now();
+    ca.evolve_steps(1000000000);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Rule 90, 10^9 steps on 256 cells: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
+              << " us" << std::endl;
+}
+
+/**
+ * Checks that temporal blocking (evolve_tiled, and evolve_steps on grids
+ * past CA_TILED_MIN_CELLS) lands on the same state as stepping one
+ * generation at a time, for tiles that do and do not divide the grid.
+ */
+void test_tiled_evolution() {
+    std::cout << "\n--- Temporal blocking (tiled evolution) ---" << std::endl;
+    uint32_t rules[] = {30, 45, 110};
+    size_t sizes[] = {5, 97, 1000, 4099};
+    size_t tileCells[] = {1, 13, 64, 8192};
+    size_t tileDepths[] = {1, 3, 16, 200};
+    bool ok = true;
+    for (uint32_t rule : rules) {
+        for (size_t size : sizes) {
+            std::vector<int> initial(size);
+            for (size_t i = 0; i < size; i++) {
+                initial[i] = static_cast<int>((i * 2654435761u >> 7) & 1);
+            }
+            CellularAutomaton slow(size, rule);
+            slow.init_state(initial);
+            for (size_t i = 0; i < 37; i++) {
+                slow.evolve();
+            }
+            for (size_t cells : tileCells) {
+                for (size_t depth : tileDepths) {
+                    CellularAutomaton tiled(size, rule);
+                    tiled.init_state(initial);
+                    tiled.evolve_tiled(37, cells, depth);
+                    ok = ok && tiled.get_state() == slow.get_state();
+                }
+            }
+        }
+    }
+    std::cout << "evolve_tiled matches stepping (rules 30/45/110, odd sizes, tiles, depths): "
+              << (ok ? "PASS" : "FAIL") << std::endl;
+
+    //a grid past the threshold goes through evolve_steps' tiled path
+    size_t big = CA_TILED_MIN_CELLS + 123;
+    std::vector<int> initial(big);
+    for (size_t i = 0; i < big; i++) {
+        initial[i] = static_cast<int>((i * 40503u >> 5) & 1);
+    }
+    CellularAutomaton slow(big, 30);
+    CellularAutomaton fast(big, 30);
+    slow.init_state(initial);
+    fast.init_state(initial);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < 64; i++) {
+        slow.evolve();
+    }
+    auto mid = std::chrono::high_resolution_clock::now();
+    fast.evolve_steps(64);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Rule 30, 64 steps on " << big << " cells: evolve() x 64 "
+              << std::chrono::duration_cast<std::chrono::microseconds>(mid - start).count() << " us, evolve_steps "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - mid).count() << " us, same state: "
+              << (fast.get_state() == slow.get_state() ? "PASS" : "FAIL") << std::endl;
+}
 
 int main() {
     CellularAutomaton ca(100, 30);//Rule 30 & size 9
@@ -35,6 +130,9 @@ int main() {
     //     std::getline(std::cin, input);
     //     if (input == "q") break;
     // }
+
+    test_linear_fast_forward();
+    test_tiled_evolution();
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+/**
+ * Test 10 - Where does mining time go?
+ * Mines a few blocks with SHA-256 and AC_HASH and dumps the per-stage
+ * counters (message construction, CA evolution, history folding, SHA-256,
+ * hex encoding, target comparison) as a table, JSON and Prometheus text.
+ *
+ * Needs the instrumented build (the Makefile rule always adds the flag):
+ * g++ -std=c++11 -pthread -DBLOCKCHAIN_INSTRUMENT -I./include src/[a-z]*.cpp tests/test_10_profile.cpp -lssl -lcrypto -o ./build/test_10_profile.exe ; ./build/test_10_profile.exe
+ */
+
+#include "blockchain_pow.h"
+#include "instrumentation.h"
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+void printStageTable(const std::string& title) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << title << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+    std::cout << std::left
+              << std::setw(18) << "Stage"
+              << std::setw(14) << "Calls"
+              << std::setw(14) << "Time(ms)"
+              << std::setw(14) << "ns/call"
+              << std::setw(10) << "Share" << std::endl;
+    std::cout << std::string(70, '-') << std::endl;
+
+    double total = 0;
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        total += Profiler::totals(static_cast<ProfileStage>(s)).seconds;
+    }
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        ProfileStage stage = static_cast<ProfileStage>(s);
+        StageTotals t = Profiler::totals(stage);
+        std::cout << std::left
+                  << std::setw(18) << Profiler::stage_name(stage)
+                  << std::setw(14) << t.calls
+                  << std::setw(14) << std::fixed << std::setprecision(2) << t.seconds * 1e3
+                  << std::setw(14) << std::fixed << std::setprecision(1)
+                  << (t.calls ? t.seconds * 1e9 / t.calls : 0.0)
+                  << std::fixed << std::setprecision(1)
+                  << (total > 0 ? t.seconds / total * 100.0 : 0.0) << "%" << std::endl;
+    }
+}
+
+void profileMining(HashMode mode, int difficulty, int numBlocks) {
+    Profiler::reset();
+    std::vector<std::string> transactions = {"Alice->Bob: 50", "Bob->Charlie: 30"};
+    BlockchainPow chain(difficulty, mode, 30, 128);
+    for (int i = 0; i < numBlocks; i++) {
+        chain.addBlock(transactions);
+    }
+    printStageTable("Stage breakdown: " + hashModeToString(mode) + ", difficulty " +
+                    std::to_string(difficulty) + ", " + std::to_string(numBlocks) + " blocks");
+}
+
+int main() {
+    std::cout << "\n";
+    std::cout << "==============================================================\n";
+    std::cout << "=          TEST 10: MINING HOT-PATH INSTRUMENTATION          =\n";
+    std::cout << "==============================================================\n";
+
+    if (!Profiler::enabled()) {
+        std::cout << "\nInstrumentation is compiled out, rebuild with -DBLOCKCHAIN_INSTRUMENT." << std::endl;
+        return 0;
+    }
+
+    profileMining(SHA256_MODE, 3, 5);
+    profileMining(AC_HASH_MODE, 2, 3);
+
+    std::cout << "\n--- JSON ---\n" << Profiler::to_json() << std::endl;
+    std::cout << "\n--- Prometheus ---\n" << Profiler::to_prometheus() << std::endl;
+    return 0;
+}
@@ -0,0 +1,127 @@
+/**
+ * Test 11 - Parallel statistical quality suite
+ * Runs the hash_quality engine (monobit, per-position bias, runs, byte
+ * chi-square, avalanche / strict avalanche matrix) on AC_HASH, on the
+ * radius-2 AC_HASH_R2 defaults and on a SHA-256 baseline, with binary digests and popcount tallies spread over
+ * the shared thread pool. Tests 5 and 6 remain the small hex-based
+ * versions of the avalanche and bit balance checks.
+ *
+ * Usage: test_11_hash_quality [--samples N] [--avalanche N] [--rule R] [--steps S]
+ *                             [--sha-samples N] [--json report.json] [--matrix]
+ *
+ * g++ -std=c++11 -O2 -pthread -I./include src/[a-z]*.cpp tests/test_11_hash_quality.cpp -lssl -lcrypto -o ./build/test_11_hash_quality.exe ; ./build/test_11_hash_quality.exe
+ */
+
+#include "ac_hash.h"
+#include "hash_quality.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+const double ALPHA = 0.001; //a p-value below this fails the test
+
+std::string verdict(double p) {
+    return p >= ALPHA ? "pass" : "FAIL";
+}
+
+void printReport(const QualityReport& r) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << r.name << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+    std::cout << std::fixed << std::setprecision(0)
+              << "Hashes: " << r.hashes << " in " << std::setprecision(2) << r.seconds << " s ("
+              << std::setprecision(0) << r.hashes_per_sec << " hashes/s on "
+              << ThreadPool::instance().size() << " workers)" << std::endl;
+    std::cout << std::setprecision(5)
+              << "Monobit:      ones = " << r.ones_fraction.value << " [" << r.ones_fraction.ci_low
+              << ", " << r.ones_fraction.ci_high << "]  p = " << std::setprecision(4) << r.monobit_p
+              << "  " << verdict(r.monobit_p) << std::endl;
+    std::cout << std::setprecision(5)
+              << "Bit bias:     max |P(1)-0.5| = " << r.bit_bias_max << "  p = " << std::setprecision(4)
+              << r.bit_bias_p << "  " << verdict(r.bit_bias_p) << std::endl;
+    std::cout << std::setprecision(5)
+              << "Runs:         transitions = " << r.transition_fraction.value << " ["
+              << r.transition_fraction.ci_low << ", " << r.transition_fraction.ci_high << "]  p = "
+              << std::setprecision(4) << r.runs_p << "  " << verdict(r.runs_p) << std::endl;
+    //32 tests, so the smallest p is Bonferroni-corrected
+    std::cout << "Byte chi2:    min p over 32 positions = " << r.byte_p_min << "  "
+              << verdict(r.byte_p_min * r.byte_p.size()) << std::endl;
+    std::cout << std::setprecision(5)
+              << "Avalanche:    flipped = " << r.avalanche.value << " [" << r.avalanche.ci_low << ", "
+              << r.avalanche.ci_high << "] over " << r.avalanche_inputs << " inputs x "
+              << r.input_bits << " bits" << std::endl;
+    std::cout << "SAC matrix:   max |P(flip)-0.5| = " << r.sac_bias_max
+              << ", cells outside 99% band = " << std::setprecision(2) << r.sac_out_of_band * 100
+              << "% (ideal ~1%), always/never flipped = " << r.sac_deterministic * 100 << "%" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    QualityConfig acConfig = {20000, 32, 32, 0x5EED, false};
+    QualityConfig shaConfig = {1000000, 2000, 32, 0x5EED, false};
+    uint32_t rule = 30;
+    size_t steps = 128;
+    std::string jsonPath;
+    bool matrix = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            acConfig.samples = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--avalanche") == 0 && i + 1 < argc) {
+            acConfig.avalanche_inputs = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--sha-samples") == 0 && i + 1 < argc) {
+            shaConfig.samples = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--rule") == 0 && i + 1 < argc) {
+            rule = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            steps = static_cast<size_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--matrix") == 0) {
+            matrix = true;
+        }
+    }
+
+    std::cout << "\n";
+    std::cout << "==============================================================\n";
+    std::cout << "=          TEST 11: PARALLEL HASH QUALITY ANALYSIS           =\n";
+    std::cout << "==============================================================\n";
+    std::cout << "Inputs: " << acConfig.input_bytes << " random bytes, significance level " << ALPHA << std::endl;
+
+    try {
+        std::vector<QualityReport> reports;
+        reports.push_back(analyze_hash_quality(
+            "AC_HASH rule " + std::to_string(rule) + ", " + std::to_string(steps) + " steps",
+            ac_hash_digest_function(rule, steps), acConfig));
+        printReport(reports.back());
+
+        reports.push_back(analyze_hash_quality(
+            "AC_HASH_R2 rule " + std::to_string(AC_HASH_R2_DEFAULT_RULE) + ", " +
+            std::to_string(AC_HASH_R2_DEFAULT_STEPS) + " steps (radius 2)",
+            ac_hash_r2_digest_function(AC_HASH_R2_DEFAULT_RULE, AC_HASH_R2_DEFAULT_STEPS), acConfig));
+        printReport(reports.back());
+
+        reports.push_back(analyze_hash_quality("SHA-256 (baseline)", [](const uint8_t* input, size_t length,
+                                                                        uint8_t* digest) {
+            sha256Digest(input, length, digest);
+        }, shaConfig));
+        printReport(reports.back());
+
+        if (!jsonPath.empty()) {
+            std::ofstream out(jsonPath.c_str());
+            out << "[\n";
+            for (size_t i = 0; i < reports.size(); i++) {
+                out << reports[i].to_json(matrix) << (i + 1 < reports.size() ? ",\n" : "\n");
+            }
+            out << "]\n";
+            std::cout << (out ? "\nJSON written to " : "\n[ERROR] cannot write ") << jsonPath << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "\n[ERROR] Quality analysis failed: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
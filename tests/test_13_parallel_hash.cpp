@@ -0,0 +1,188 @@
+/**
+ * Test 13 - Domain-decomposed ac_hash for large payloads
+ * 13.1. Bit-identical to ac_hash over input sizes, rules, steps, halo widths and domain counts
+ * 13.2. Large-block validation through ProofOfWork (AC_HASH payloads >= 64 KB take the parallel path)
+ * 13.3. Scaling of one multi-megabyte hash from 1 thread up to all hardware threads
+ *
+ * Usage: test_13_parallel_hash [--mb N] [--steps S] [--sync K]
+ *
+ * g++ -std=c++11 -O2 -pthread -I./include src/[a-z]*.cpp tests/test_13_parallel_hash.cpp -lssl -lcrypto -o ./build/test_13_parallel_hash.exe
+ */
+
+#include "benchmark.h"
+#include "ac_hash.h"
+#include "ac_hash_parallel.h"
+#include "blockchain_pow.h"
+#include "pow.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+//deterministic pseudo-random payload
+std::string makePayload(size_t length, uint32_t seed) {
+    std::string payload(length, '\0');
+    uint32_t x = seed * 2654435761u + 1;
+    for (size_t i = 0; i < length; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        payload[i] = static_cast<char>(x);
+    }
+    return payload;
+}
+
+bool test_bit_identical() {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "13.1: Bit-identical to ac_hash" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    ThreadPool pool(3);
+    size_t lengths[] = {0, 5, 31, 32, 33, 100, 1000, 4097};
+    uint32_t rules[] = {30, 45, 90, 110, 150};
+    size_t stepValues[] = {0, 1, 9, 17, 128, 200};
+    size_t syncValues[] = {1, 7, 64, 100};
+    size_t domainValues[] = {0, 1, 5, 64};
+    size_t checked = 0;
+    size_t mismatches = 0;
+    for (size_t length : lengths) {
+        std::string input = makePayload(length, static_cast<uint32_t>(length));
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(input.data());
+        for (uint32_t rule : rules) {
+            for (size_t steps : stepValues) {
+                std::string expected = ac_hash(input, rule, steps);
+                for (size_t sync : syncValues) {
+                    for (size_t domains : domainValues) {
+                        checked++;
+                        if (ac_hash_parallel(bytes, length, rule, steps, pool, sync, domains) != expected) {
+                            if (mismatches++ < 5) {
+                                std::cout << "MISMATCH: " << length << " bytes, rule " << rule << ", " << steps
+                                          << " steps, sync " << sync << ", " << domains << " domains" << std::endl;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    std::cout << checked << " configurations, " << mismatches << " mismatches: "
+              << (mismatches == 0 ? "PASS" : "FAIL") << std::endl;
+    return mismatches == 0;
+}
+
+bool test_large_block_validation() {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "13.2: Large-block validation (AC_HASH rule 30, 128 steps)" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    //just above the threshold: computeHash takes the parallel path, ac_hash is the reference
+    std::string message = makePayload(AC_HASH_PARALLEL_MIN_BYTES + 1000, 7);
+    std::string reference;
+    long long serialUs = measureTime([&]() { reference = ac_hash(message, 30, 128); });
+    std::string parallel;
+    long long parallelUs = measureTime([&]() { parallel = ProofOfWork::computeHash(message, AC_HASH_MODE, 30, 128); });
+    bool same = parallel == reference;
+    std::cout << message.size() << "-byte message: serial " << serialUs << " us, parallel path " << parallelUs
+              << " us, same hash: " << (same ? "PASS" : "FAIL") << std::endl;
+
+    //a chain holding a block above the threshold mines and validates
+    BlockchainPow chain(1, AC_HASH_MODE, 30, 128);
+    std::vector<std::string> transactions;
+    size_t bytes = 0;
+    for (int i = 0; bytes <= AC_HASH_PARALLEL_MIN_BYTES; i++) {
+        transactions.push_back("Payer" + std::to_string(i) + "->Payee" + std::to_string(i) + ": " +
+                               std::to_string(i % 1000));
+        bytes += transactions.back().size();
+    }
+    {
+        ScopedSilence silence;
+        chain.addBlock(transactions);
+    }
+    bool valid = chain.isChainValid();
+    std::cout << "Chain with a " << transactions.size() << "-transaction block valid: "
+              << (valid ? "PASS" : "FAIL") << std::endl;
+    return same && valid;
+}
+
+void test_scaling(size_t megabytes, size_t steps, size_t sync) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "13.3: Scaling (" << megabytes << " MB, rule 30, " << steps << " steps, halo exchange every "
+              << sync << " generations)" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts;
+    for (unsigned t = 1; t < hw; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(hw);
+
+    std::string payload = makePayload(megabytes << 20, 13);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(payload.data());
+
+    std::cout << std::left
+              << std::setw(10) << "Threads"
+              << std::setw(15) << "Time(us)"
+              << std::setw(15) << "MB/s"
+              << std::setw(12) << "Speedup"
+              << std::setw(12) << "Efficiency" << std::endl;
+    std::cout << std::string(70, '-') << std::endl;
+
+    std::string first;
+    bool consistent = true;
+    long long baseline = 0;
+    for (unsigned t : threadCounts) {
+        ThreadPool pool(t, PIN_COMPACT);
+        std::string hash;
+        long long us = measureTime([&]() {
+            hash = ac_hash_parallel(bytes, payload.size(), 30, steps, pool, sync, 0);
+        });
+        if (first.empty()) first = hash;
+        consistent = consistent && hash == first;
+        if (us == 0) us = 1;
+        if (baseline == 0) baseline = us;
+        double speedup = static_cast<double>(baseline) / us;
+        std::cout << std::left
+                  << std::setw(10) << t
+                  << std::setw(15) << us
+                  << std::setw(15) << std::fixed << std::setprecision(1) << (megabytes * 1e6 / us)
+                  << std::setw(12) << std::fixed << std::setprecision(2) << speedup
+                  << std::setw(12) << std::fixed << std::setprecision(2) << (speedup / t * 100.0)
+                  << std::endl;
+    }
+    std::cout << "Same hash for every thread count: " << (consistent ? "PASS" : "FAIL") << std::endl;
+    std::cout << "\nNOTE: the calling thread helps in parallel_for, so T threads use up to T+1 cores." << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = 4;
+    size_t steps = 128;
+    size_t sync = AC_HASH_PARALLEL_SYNC_STEPS;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--mb") == 0 && i + 1 < argc) {
+            megabytes = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            steps = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--sync") == 0 && i + 1 < argc) {
+            sync = std::strtoul(argv[++i], nullptr, 10);
+        }
+    }
+
+    std::cout << "\n";
+    std::cout << "==============================================================\n";
+    std::cout << "=          TEST 13: DOMAIN-DECOMPOSED PARALLEL AC_HASH       =\n";
+    std::cout << "==============================================================\n";
+
+    bool identical = test_bit_identical();
+    bool validation = test_large_block_validation();
+    test_scaling(megabytes, steps, sync);
+
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << (identical && validation ? "ALL CHECKS PASSED" : "SOME CHECKS FAILED") << std::endl;
+    std::cout << std::string(70, '=') << "\n" << std::endl;
+    return identical && validation ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+/**
+ * Test 15 - In-process network simulator
+ * 15.1. Determinism: the same config and seed give the same results, another seed does not
+ * 15.2. Sanity: instant links leave no stale blocks; slow links create forks that still resolve
+ * 15.3. Orphan rate, propagation latency and validation throughput vs nodes, difficulty and hash mode
+ *
+ * Usage: test_15_network_sim [--blocks N] [--latency MS] [--bandwidth BYTES_PER_MS] [--peers K]
+ *                            [--hashrate H_PER_S] [--seed S]
+ *
+ * g++ -std=c++11 -O2 -pthread -I./include src/[a-z]*.cpp tests/test_15_network_sim.cpp -lssl -lcrypto -o ./build/test_15_network_sim.exe
+ */
+
+#include "network_sim.h"
+#include "utils.h"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+bool sameVirtualResults(const NetworkStats& a, const NetworkStats& b) {
+    return a.blocksMined == b.blocksMined && a.mainChainLength == b.mainChainLength &&
+           a.staleBlocks == b.staleBlocks && a.nodesOnTip == b.nodesOnTip &&
+           a.propagationP50 == b.propagationP50 && a.propagationP99 == b.propagationP99 &&
+           a.messages == b.messages && a.bytesSent == b.bytesSent && a.virtualMillis == b.virtualMillis;
+}
+
+bool test_determinism(const NetworkConfig& base) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "15.1: Determinism" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    NetworkConfig config = base;
+    config.blocks = 40;
+    NetworkStats first = NetworkSimulator(config).run();
+    NetworkStats second = NetworkSimulator(config).run();
+    config.seed = base.seed + 1;
+    NetworkStats other = NetworkSimulator(config).run();
+    bool same = sameVirtualResults(first, second);
+    bool differs = !sameVirtualResults(first, other);
+    std::cout << "Same seed, same results: " << (same ? "YES" : "NO") << std::endl;
+    std::cout << "Other seed, other results: " << (differs ? "YES" : "NO") << std::endl;
+    bool pass = same && differs;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Simulation is deterministic" << std::endl;
+    return pass;
+}
+
+bool test_sanity(const NetworkConfig& base) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "15.2: Instant vs slow links" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    NetworkConfig instant = base;
+    instant.blocks = 40;
+    instant.latencyMillis = 0;
+    instant.jitterMillis = 0;
+    instant.bandwidthBytesPerMilli = 0;
+    instant.validateMillis = 0;
+    NetworkStats fast = NetworkSimulator(instant).run();
+    bool noStale = fast.staleBlocks == 0 && fast.mainChainLength == instant.blocks &&
+                   fast.nodesOnTip == instant.nodes && fast.invalidBlocks == 0;
+    std::cout << "Instant links: " << fast.blocksMined << " mined, " << fast.staleBlocks << " stale, "
+              << fast.nodesOnTip << "/" << instant.nodes << " nodes on the tip" << std::endl;
+
+    NetworkConfig slow = instant;
+    slow.latencyMillis = 500;
+    slow.peers = 2;
+    NetworkStats forked = NetworkSimulator(slow).run();
+    bool forks = forked.staleBlocks > 0 && forked.invalidBlocks == 0 &&
+                 forked.mainChainLength + forked.staleBlocks == forked.blocksMined;
+    std::cout << "500 ms ring-like links: " << forked.blocksMined << " mined, " << forked.staleBlocks
+              << " stale, " << forked.nodesOnTip << "/" << slow.nodes << " nodes on the tip, p99 propagation "
+              << std::fixed << std::setprecision(1) << forked.propagationP99 << " ms" << std::endl;
+
+    bool pass = noStale && forks;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Forks only appear when propagation is slow" << std::endl;
+    return pass;
+}
+
+void test_sweep(const NetworkConfig& base) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "15.3: Sweep (" << base.blocks << " blocks, " << base.latencyMillis << " ms links, "
+              << base.hashesPerSecond / 1000 << " kH/s per node)" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    std::cout << std::left
+              << std::setw(7) << "Nodes"
+              << std::setw(6) << "Bits"
+              << std::setw(10) << "Mode"
+              << std::setw(9) << "Orphan%"
+              << std::setw(8) << "P50ms"
+              << std::setw(8) << "P99ms"
+              << std::setw(9) << "AllP99"
+              << std::setw(12) << "Valid/s"
+              << "Wall(s)" << std::endl;
+    std::cout << std::string(70, '-') << std::endl;
+
+    size_t nodeCounts[] = {4, 8, 16};
+    unsigned bitValues[] = {10, 14};
+    HashMode modes[] = {SHA256_MODE, AC_HASH_MODE};
+    for (HashMode mode : modes) {
+        for (unsigned bits : bitValues) {
+            for (size_t n : nodeCounts) {
+                NetworkConfig config = base;
+                config.nodes = n;
+                config.difficultyBits = bits;
+                config.mode = mode;
+                NetworkStats s = NetworkSimulator(config).run();
+                std::cout << std::left
+                          << std::setw(7) << n
+                          << std::setw(6) << bits
+                          << std::setw(10) << (mode == SHA256_MODE ? "SHA-256" : "AC_HASH")
+                          << std::setw(9) << std::fixed << std::setprecision(1) << s.orphanRate * 100
+                          << std::setw(8) << std::fixed << std::setprecision(1) << s.propagationP50
+                          << std::setw(8) << std::fixed << std::setprecision(1) << s.propagationP99
+                          << std::setw(9) << std::fixed << std::setprecision(1) << s.fullPropagationP99
+                          << std::setw(12) << std::fixed << std::setprecision(0) << s.validatedPerSecond
+                          << std::fixed << std::setprecision(2) << s.wallSeconds << std::endl;
+            }
+        }
+    }
+    std::cout << "\nOrphan% rises as the block interval (2^bits / total hash rate) approaches the" << std::endl;
+    std::cout << "propagation time; Valid/s is real verification throughput on this machine." << std::endl;
+}
+
+int main(int argc, char** argv) {
+    NetworkConfig config = defaultNetworkConfig();
+    config.blocks = 60;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--blocks") == 0 && i + 1 < argc) {
+            config.blocks = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            config.latencyMillis = std::strtod(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--bandwidth") == 0 && i + 1 < argc) {
+            config.bandwidthBytesPerMilli = std::strtod(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--peers") == 0 && i + 1 < argc) {
+            config.peers = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--hashrate") == 0 && i + 1 < argc) {
+            config.hashesPerSecond = std::strtod(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            config.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+    }
+
+    std::cout << "\n";
+    std::cout << "==============================================================\n";
+    std::cout << "=          TEST 15: IN-PROCESS NETWORK SIMULATOR             =\n";
+    std::cout << "==============================================================\n";
+
+    bool deterministic = test_determinism(config);
+    bool sane = test_sanity(config);
+    test_sweep(config);
+
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << (deterministic && sane ? "ALL CHECKS PASSED" : "SOME CHECKS FAILED") << std::endl;
+    std::cout << std::string(70, '=') << "\n" << std::endl;
+    return deterministic && sane ? 0 : 1;
+}
@@ -0,0 +1,327 @@
+/**
+ * Test 16 - Block relay between processes
+ * 16.1. Varint and frame codecs: round trips, incomplete and malformed input
+ * 16.2. A replica chain built from decoded blocks accepts the chain in order and rejects tampering
+ *       and blocks with less work or other hash parameters than the chain
+ * 16.3. Two-process loopback relay: blocks/s and bytes per block, binary frames vs text lines
+ *
+ * Usage: test_16_relay [--blocks N] [--payload BYTES]
+ *
+ * g++ -std=c++11 -O2 -pthread -I./include src/[a-z]*.cpp tests/test_16_relay.cpp -lssl -lcrypto -o ./build/test_16_relay.exe
+ */
+
+#include "benchmark.h"
+#include "blockchain_pow.h"
+#include "pow.h"
+#include "relay.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+bool sameBlock(const BlockPow& a, const BlockPow& b) {
+    return a.getIndex() == b.getIndex() && a.getHash() == b.getHash() &&
+           a.getPreviousHash() == b.getPreviousHash() && a.getData() == b.getData() &&
+           a.getNonce() == b.getNonce() && a.getExtraNonce() == b.getExtraNonce() &&
+           a.getDifficulty() == b.getDifficulty() && a.getHashMode() == b.getHashMode() &&
+           a.getRule() == b.getRule() && a.getSteps() == b.getSteps() &&
+           a.getHeaderVersion() == b.getHeaderVersion() &&
+           (a.getHeaderVersion() == LEGACY_HEADER_VERSION || a.getTimestamp() == b.getTimestamp());
+}
+
+void buildChain(BlockchainPow& chain, size_t blocks, size_t payload) {
+    ScopedSilence silence;
+    for (size_t i = 1; i <= blocks; i++) {
+        std::string tx = "Alice->Bob: " + std::to_string(i) + " ";
+        tx.resize(std::max(tx.size(), payload), 'x');
+        chain.addBlock({tx, "Bob->Charlie: " + std::to_string(i % 7)});
+    }
+}
+
+const uint8_t* bytes(const std::string& s) {
+    return reinterpret_cast<const uint8_t*>(s.data());
+}
+
+bool test_codecs(const BlockchainPow& chain) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "16.1: Varint and frame codecs" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    bool varints = true;
+    uint64_t values[] = {0, 1, 127, 128, 300, 16384, 0xFFFFFFFFull, 0x100000000ull, UINT64_MAX};
+    for (uint64_t v : values) {
+        std::string out;
+        putVarint(v, out);
+        const uint8_t* pos = bytes(out);
+        uint64_t back = 0;
+        varints = varints && getVarint(pos, bytes(out) + out.size(), back) && back == v &&
+                  pos == bytes(out) + out.size();
+        const uint8_t* cut = bytes(out);
+        varints = varints && (out.size() == 1 || !getVarint(cut, bytes(out) + out.size() - 1, back));
+    }
+    std::cout << "Varint round trips and truncation: " << (varints ? "OK" : "FAILED") << std::endl;
+
+    ChainSnapshot snapshot = chain.getChain();
+    BlockPow legacy(1, snapshot[0]->getHash(), std::string(64, 'a'), "legacy|data", 42, 2, AC_HASH_MODE, 90, 64);
+    std::vector<const BlockPow*> samples = {snapshot[0], snapshot[1], snapshot.back(), &legacy};
+    bool roundTrips = true;
+    size_t binaryBytes = 0;
+    size_t textBytes = 0;
+    for (const BlockPow* block : samples) {
+        std::string frame, line;
+        encodeBlockFrame(*block, frame);
+        encodeBlockText(*block, line);
+        binaryBytes += frame.size();
+        textBytes += line.size();
+        std::unique_ptr<BlockPow> fromFrame, fromLine;
+        size_t frameUsed = 0, lineUsed = 0;
+        roundTrips = roundTrips &&
+                     decodeBlockFrame(bytes(frame), frame.size(), frameUsed, fromFrame) == FRAME_OK &&
+                     frameUsed == frame.size() && sameBlock(*block, *fromFrame) &&
+                     decodeBlockText(bytes(line), line.size(), lineUsed, fromLine) == FRAME_OK &&
+                     lineUsed == line.size() && sameBlock(*block, *fromLine);
+    }
+    std::cout << "Binary and text round trips (genesis, block 1, tip, legacy): "
+              << (roundTrips ? "OK" : "FAILED") << std::endl;
+    std::cout << "Bytes for those 4 blocks: binary " << binaryBytes << ", text " << textBytes << std::endl;
+
+    std::string frame, line;
+    encodeBlockFrame(*snapshot[1], frame);
+    encodeBlockText(*snapshot[1], line);
+    std::unique_ptr<BlockPow> block;
+    size_t used = 0;
+    bool incomplete = true;
+    for (size_t cut = 0; cut < frame.size(); cut += 7) {
+        incomplete = incomplete && decodeBlockFrame(bytes(frame), cut, used, block) == FRAME_INCOMPLETE;
+    }
+    incomplete = incomplete && decodeBlockText(bytes(line), line.size() - 1, used, block) == FRAME_INCOMPLETE;
+    std::string badType = frame;
+    const uint8_t* body = bytes(frame);
+    uint64_t size = 0;
+    getVarint(body, bytes(frame) + frame.size(), size);
+    badType[body - bytes(frame)] = 0x7F; //the message type follows the length
+    std::string badField = "3|x" + line.substr(line.find('|', 2));
+    bool malformed = decodeBlockFrame(bytes(badType), badType.size(), used, block) == FRAME_MALFORMED &&
+                     decodeBlockText(bytes(badField), badField.size(), used, block) == FRAME_MALFORMED;
+    //numeric fields are digits only: strtoull would take a sign or leading spaces ("-1" wraps)
+    size_t indexStart = line.find('|') + 1;
+    size_t indexEnd = line.find('|', indexStart);
+    for (const char* index : {"-1", "+1", " 1", "18446744073709551616"}) {
+        std::string badNumber = line.substr(0, indexStart) + index + line.substr(indexEnd);
+        malformed = malformed && decodeBlockText(bytes(badNumber), badNumber.size(), used, block) == FRAME_MALFORMED;
+    }
+    //parameters a verifier could not run (8-bit AC_HASH rules) or could only run at great cost
+    std::string prev = snapshot[0]->getHash(), hash(64, 'a');
+    BlockPow badRule(1, prev, hash, "x", 42, 2, AC_HASH_MODE, 300, 64);
+    BlockPow manySteps(1, prev, hash, "x", 42, 2, AC_HASH_MODE, 30, RELAY_MAX_STEPS + 1);
+    BlockPow wideRule(1, prev, hash, "x", 42, 2, AC_HASH_R2_MODE, 300, 64);
+    bool limits = true;
+    for (const BlockPow* sample : {&badRule, &manySteps, &wideRule}) {
+        std::string bad;
+        encodeBlockFrame(*sample, bad);
+        FrameStatus expected = sample == &wideRule ? FRAME_OK : FRAME_MALFORMED;
+        limits = limits && decodeBlockFrame(bytes(bad), bad.size(), used, block) == expected;
+    }
+    std::cout << "Truncated input reported incomplete: " << (incomplete ? "YES" : "NO") << std::endl;
+    std::cout << "Bad type byte / bad field / signed number reported malformed: " << (malformed ? "YES" : "NO")
+              << std::endl;
+    std::cout << "AC_HASH rule > 255 / steps > RELAY_MAX_STEPS refused: " << (limits ? "YES" : "NO") << std::endl;
+
+    //a newline in the data would end the text line early
+    BlockPow multiline(1, snapshot[0]->getHash(), std::string(64, 'a'), "two\nlines", 42, 2, AC_HASH_MODE, 90, 64);
+    bool newlineRejected = false;
+    std::string rejected;
+    try {
+        encodeBlockText(multiline, rejected);
+    } catch (const std::invalid_argument&) {
+        newlineRejected = rejected.empty();
+    }
+    std::cout << "Text encoding refuses data with a newline: " << (newlineRejected ? "YES" : "NO") << std::endl;
+
+    bool pass = varints && roundTrips && incomplete && malformed && limits && newlineRejected &&
+                binaryBytes < textBytes;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Codecs round-trip and reject bad input" << std::endl;
+    return pass;
+}
+
+std::unique_ptr<BlockPow> relayed(const BlockPow& block) {
+    std::string frame;
+    encodeBlockFrame(block, frame);
+    std::unique_ptr<BlockPow> copy;
+    size_t used = 0;
+    decodeBlockFrame(bytes(frame), frame.size(), used, copy);
+    return copy;
+}
+
+//a correctly mined block on top of tip, with parameters of the sender's choosing
+std::unique_ptr<BlockPow> forged(const BlockPow& tip, const Target& target, HashMode mode) {
+    std::string data = "forged";
+    BlockHeader header = BlockHeader::create(tip.getIndex() + 1, currentTimestampMillis(), tip.getHash(), data,
+                                             target, mode, tip.getRule(), tip.getSteps());
+    std::string hash = ProofOfWork::mineHeader(header);
+    return relayed(BlockPow(header, tip.getHash(), std::move(hash), std::move(data)));
+}
+
+bool test_replica(const BlockchainPow& chain) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "16.2: Replica validation" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    ChainSnapshot snapshot = chain.getChain();
+    BlockchainPow replica(relayed(*snapshot[0]));
+    bool outOfOrder = !replica.acceptBlock(relayed(*snapshot[2]));
+    bool replayed = !replica.acceptBlock(relayed(*snapshot[0]));
+
+    //same header, different payload: the payload hash no longer matches the proof of work
+    std::string line;
+    encodeBlockText(*snapshot[1], line);
+    line.insert(line.size() - 1, "!");
+    std::unique_ptr<BlockPow> tampered;
+    size_t used = 0;
+    decodeBlockText(bytes(line), line.size(), used, tampered);
+    bool tamperRejected = tampered && !replica.acceptBlock(std::move(tampered));
+
+    //valid proof of work, but less of it than the chain asks for, or in another hash mode
+    bool zeroWork = !replica.acceptBlock(forged(*snapshot[0], Target::fromLeadingZeroBits(0), SHA256_MODE));
+    bool otherMode = !replica.acceptBlock(forged(*snapshot[0], replica.getTarget(), AC_HASH_MODE));
+    bool cheapRejected = zeroWork && otherMode && replica.getChain().size() == 1;
+
+    bool inOrder = true;
+    for (size_t i = 1; i < snapshot.size(); i++) {
+        inOrder = inOrder && replica.acceptBlock(relayed(*snapshot[i]));
+    }
+    bool same = replica.getChain().size() == snapshot.size() && replica.getLatestHash() == chain.getLatestHash() &&
+                replica.isChainValid();
+
+    bool badGenesis = false;
+    try {
+        BlockchainPow notGenesis(relayed(*snapshot[1]));
+    } catch (const std::invalid_argument&) {
+        badGenesis = true;
+    }
+    std::cout << "Out-of-order / replayed / tampered block rejected: " << (outOfOrder ? "YES" : "NO") << " / "
+              << (replayed ? "YES" : "NO") << " / " << (tamperRejected ? "YES" : "NO") << std::endl;
+    std::cout << "Zero-work / other-mode block rejected: " << (zeroWork ? "YES" : "NO") << " / "
+              << (otherMode ? "YES" : "NO") << std::endl;
+    std::cout << "Replica of " << replica.getChain().size() << " blocks matches the source: "
+              << (inOrder && same ? "YES" : "NO") << std::endl;
+    std::cout << "Non-genesis block refused as genesis: " << (badGenesis ? "YES" : "NO") << std::endl;
+    bool pass = outOfOrder && replayed && tamperRejected && cheapRejected && inOrder && same && badGenesis;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Replica validates every relayed block" << std::endl;
+    return pass;
+}
+
+struct RelayRun {
+    bool ok;
+    RelayStats stats;
+};
+
+//the parent receives, a forked child sends the chain and exits
+RelayRun relayOverLoopback(const BlockchainPow& chain, RelayEncoding encoding) {
+    RelayRun result = {false, RelayStats()};
+    RelayReceiver receiver(0, encoding);
+    std::cout.flush();
+    pid_t child = fork();
+    if (child == 0) {
+        int code = 0;
+        try {
+            RelaySender sender(receiver.port(), encoding);
+            sender.sendChain(chain.getChain());
+            sender.close();
+        } catch (const std::exception& e) {
+            std::cerr << "sender: " << e.what() << std::endl;
+            code = 1;
+        }
+        _exit(code); //skip destructors: the logger thread does not exist in the child
+    }
+    if (child < 0) {
+        std::cout << "fork failed" << std::endl;
+        return result;
+    }
+    bool clean = receiver.run(10000);
+    int status = 0;
+    waitpid(child, &status, 0);
+    result.stats = receiver.stats();
+    BlockchainPow* replica = receiver.chain();
+    result.ok = clean && WIFEXITED(status) && WEXITSTATUS(status) == 0 && replica != nullptr &&
+                result.stats.rejected == 0 && replica->getChain().size() == chain.getChain().size() &&
+                replica->getLatestHash() == chain.getLatestHash() && replica->isChainValid();
+    return result;
+}
+
+bool test_loopback(const BlockchainPow& chain, size_t payload) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "16.3: Two-process loopback relay (" << chain.getChain().size() << " blocks, ~" << payload
+              << "-byte payloads)" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    std::cout << std::left
+              << std::setw(10) << "Encoding"
+              << std::setw(10) << "Blocks"
+              << std::setw(14) << "Bytes"
+              << std::setw(12) << "B/block"
+              << std::setw(10) << "Reads"
+              << std::setw(14) << "Blocks/s"
+              << "Replica" << std::endl;
+    std::cout << std::string(70, '-') << std::endl;
+
+    RelayEncoding encodings[] = {RELAY_TEXT, RELAY_BINARY};
+    bool pass = true;
+    double perBlock[2] = {0.0, 0.0};
+    for (int e = 0; e < 2; e++) {
+        RelayRun run = relayOverLoopback(chain, encodings[e]);
+        const RelayStats& s = run.stats;
+        perBlock[e] = s.blocks == 0 ? 0.0 : static_cast<double>(s.bytes) / s.blocks;
+        std::cout << std::left
+                  << std::setw(10) << (encodings[e] == RELAY_BINARY ? "binary" : "text")
+                  << std::setw(10) << s.blocks
+                  << std::setw(14) << s.bytes
+                  << std::setw(12) << std::fixed << std::setprecision(1) << perBlock[e]
+                  << std::setw(10) << s.writes
+                  << std::setw(14) << std::fixed << std::setprecision(0)
+                  << (s.seconds > 0 ? s.blocks / s.seconds : 0.0)
+                  << (run.ok ? "valid" : "MISMATCH") << std::endl;
+        pass = pass && run.ok;
+    }
+    std::cout << "\nBinary frames use " << std::fixed << std::setprecision(1)
+              << (perBlock[0] > 0 ? 100.0 * (1.0 - perBlock[1] / perBlock[0]) : 0.0)
+              << "% fewer bytes per block; Blocks/s includes validating every block." << std::endl;
+    pass = pass && perBlock[1] < perBlock[0];
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Both encodings rebuild an identical, valid chain" << std::endl;
+    return pass;
+}
+
+int main(int argc, char** argv) {
+    size_t blocks = 500;
+    size_t payload = 64;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--blocks") == 0 && i + 1 < argc) {
+            blocks = std::max<size_t>(2, std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--payload") == 0 && i + 1 < argc) {
+            payload = std::strtoul(argv[++i], nullptr, 10);
+        }
+    }
+
+    std::cout << "\n";
+    std::cout << "==============================================================\n";
+    std::cout << "=            TEST 16: BLOCK RELAY BETWEEN PROCESSES          =\n";
+    std::cout << "==============================================================\n";
+
+    BlockchainPow chain(1, SHA256_MODE);
+    buildChain(chain, blocks, payload);
+
+    bool codecs = test_codecs(chain);
+    bool replica = test_replica(chain);
+    bool loopback = test_loopback(chain, payload);
+
+    bool pass = codecs && replica && loopback;
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << (pass ? "ALL CHECKS PASSED" : "SOME CHECKS FAILED") << std::endl;
+    std::cout << std::string(70, '=') << "\n" << std::endl;
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,229 @@
+/**
+ * Test 17 - Epoll query server
+ * 17.1. getBlock(height), getBlock(hash), getTip and validateRange over both protocols, pipelined
+ * 17.2. Queries served while the miner appends blocks
+ * 17.3. Load generator: requests/s and batch latency vs protocol, pipeline depth and connections
+ *
+ * Usage: test_17_query_server [--blocks N] [--payload BYTES] [--millis M] [--connections C]
+ *
+ * g++ -std=c++11 -O2 -pthread -I./include src/[a-z]*.cpp tests/test_17_query_server.cpp -lssl -lcrypto -o ./build/test_17_query_server.exe
+ */
+
+#include "benchmark.h"
+#include "blockchain_pow.h"
+#include "query_server.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+bool sameBlock(const BlockPow* a, const BlockPow* b) {
+    return a != nullptr && b != nullptr && a->getIndex() == b->getIndex() && a->getHash() == b->getHash() &&
+           a->getPreviousHash() == b->getPreviousHash() && a->getData() == b->getData() &&
+           a->getNonce() == b->getNonce() && a->getTimestamp() == b->getTimestamp();
+}
+
+void addBlocks(BlockchainPow& chain, size_t first, size_t count, size_t payload) {
+    ScopedSilence silence;
+    for (size_t i = first; i < first + count; i++) {
+        std::string tx = "Alice->Bob: " + std::to_string(i) + " ";
+        tx.resize(std::max(tx.size(), payload), 'x');
+        chain.addBlock({tx, "Bob->Charlie: " + std::to_string(i % 7)});
+    }
+}
+
+const char* protocolName(QueryProtocol protocol) {
+    return protocol == QUERY_BINARY ? "binary" : "text";
+}
+
+bool test_queries(const BlockchainPow& chain, QueryServer& server) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "17.1: Queries over both protocols" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    ChainSnapshot snapshot = chain.getChain();
+    size_t size = snapshot.size();
+    bool pass = true;
+    QueryProtocol protocols[] = {QUERY_BINARY, QUERY_TEXT};
+    for (QueryProtocol protocol : protocols) {
+        QueryClient client(server.port(), protocol);
+        uint64_t height = 0;
+        std::string hash;
+        bool tip = client.getTip(height, hash) && height == size - 1 && hash == snapshot.back()->getHash();
+
+        bool byHeight = true, byHash = true;
+        for (size_t h : {size_t(0), size_t(1), size / 2, size - 1}) {
+            byHeight = byHeight && sameBlock(client.getBlock(h).get(), snapshot[h]);
+            byHash = byHash && sameBlock(client.getBlock(snapshot[h]->getHash()).get(), snapshot[h]);
+        }
+        bool missing = !client.getBlock(size) && !client.getBlock(std::string(64, 'f'));
+        size_t widest = std::min(size, QUERY_MAX_VALIDATE_BLOCKS);
+        bool ranges = client.validateRange(size - widest, size) == 1 && client.validateRange(10, 20) == 1 &&
+                      client.validateRange(5, 5) == -1 && client.validateRange(0, size + 1) == -1;
+
+        //100 mixed requests in one write, answered in order
+        for (size_t i = 0; i < 100; i++) {
+            switch (i % 4) {
+                case 0: client.queueGetBlock(i % size); break;
+                case 1: client.queueGetBlock(snapshot[(i * 7) % size]->getHash()); break;
+                case 2: client.queueGetTip(); break;
+                default: client.queueValidateRange(i % size, i % size + 1); break;
+            }
+        }
+        client.send();
+        bool pipelined = true;
+        QueryResponse response;
+        for (size_t i = 0; i < 100; i++) {
+            pipelined = pipelined && client.receive(response) && response.status == QUERY_OK;
+            if (!pipelined) break;
+            switch (i % 4) {
+                case 0: pipelined = sameBlock(response.block.get(), snapshot[i % size]); break;
+                case 1: pipelined = sameBlock(response.block.get(), snapshot[(i * 7) % size]); break;
+                case 2: pipelined = response.height == size - 1; break;
+                default: pipelined = response.valid; break;
+            }
+        }
+        bool ok = tip && byHeight && byHash && missing && ranges && pipelined;
+        std::cout << std::left << std::setw(8) << protocolName(protocol)
+                  << "tip " << (tip ? "OK" : "FAIL") << ", by height " << (byHeight ? "OK" : "FAIL")
+                  << ", by hash " << (byHash ? "OK" : "FAIL") << ", not found " << (missing ? "OK" : "FAIL")
+                  << ", ranges " << (ranges ? "OK" : "FAIL") << ", 100 pipelined " << (pipelined ? "OK" : "FAIL")
+                  << std::endl;
+        pass = pass && ok;
+    }
+
+    //a bad text line or too wide a range gets an error and the connection keeps serving
+    QueryClient text(server.port(), QUERY_TEXT);
+    text.queueGetBlock("not-a-hash");
+    text.queueValidateRange(0, QUERY_MAX_VALIDATE_BLOCKS + 1);
+    text.queueGetTip();
+    text.send();
+    QueryResponse bad, wide, after;
+    bool recovers = text.receive(bad) && bad.status == QUERY_BAD_REQUEST && text.receive(wide) &&
+                    wide.status == QUERY_BAD_REQUEST && text.receive(after) && after.status == QUERY_OK;
+    std::cout << "Malformed request / too wide a range answered with ERR, connection kept: " << (recovers ? "YES" : "NO")
+              << std::endl;
+    QueryServerStats stats = server.stats();
+    std::cout << "Server: " << stats.connections << " connections, " << stats.requests << " requests, "
+              << stats.writes << " writes, " << stats.zeroCopyBytes << " of " << stats.bytesSent
+              << " bytes sent from chain storage" << std::endl;
+    pass = pass && recovers && stats.zeroCopyBytes > 0;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Every query answered correctly" << std::endl;
+    return pass;
+}
+
+bool test_live_chain(BlockchainPow& chain, QueryServer& server, size_t payload) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "17.2: Serving while the miner appends" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    QueryClient client(server.port(), QUERY_BINARY);
+    size_t appended = 20;
+    bool follows = true;
+    for (size_t i = 0; i < appended && follows; i++) {
+        addBlocks(chain, chain.getChain().size(), 1, payload);
+        ChainSnapshot snapshot = chain.getChain();
+        uint64_t height = 0;
+        std::string hash;
+        follows = client.getTip(height, hash) && height == snapshot.size() - 1 && hash == snapshot.back()->getHash() &&
+                  sameBlock(client.getBlock(hash).get(), snapshot.back());
+    }
+    std::cout << "Tip and hash lookup followed " << appended << " new blocks: " << (follows ? "YES" : "NO")
+              << std::endl;
+    std::cout << (follows ? "[PASS]" : "[FAIL]") << " New blocks are served as soon as they are published"
+              << std::endl;
+    return follows;
+}
+
+bool test_load(const QueryServer& server, int millis, size_t maxConnections) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "17.3: Load generator (" << millis << " ms per run, 70% by height, 20% by hash, 10% tip)"
+              << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    std::cout << std::left
+              << std::setw(10) << "Protocol"
+              << std::setw(7) << "Conns"
+              << std::setw(10) << "Pipeline"
+              << std::setw(12) << "Requests"
+              << std::setw(12) << "Req/s"
+              << std::setw(11) << "P50(us)"
+              << std::setw(11) << "P99(us)"
+              << "Errors" << std::endl;
+    std::cout << std::string(70, '-') << std::endl;
+
+    bool pass = true;
+    double best = 0.0;
+    QueryProtocol protocols[] = {QUERY_BINARY, QUERY_TEXT};
+    size_t pipelines[] = {1, 16, 64};
+    std::vector<size_t> connectionCounts = {1};
+    if (maxConnections > 1) connectionCounts.push_back(maxConnections);
+    for (QueryProtocol protocol : protocols) {
+        for (size_t connections : connectionCounts) {
+            for (size_t pipeline : pipelines) {
+                QueryLoadConfig config = defaultQueryLoadConfig();
+                config.protocol = protocol;
+                config.connections = connections;
+                config.pipeline = pipeline;
+                config.millis = millis;
+                QueryLoadStats s = runQueryLoad(server.port(), config);
+                std::cout << std::left
+                          << std::setw(10) << protocolName(protocol)
+                          << std::setw(7) << connections
+                          << std::setw(10) << pipeline
+                          << std::setw(12) << s.requests
+                          << std::setw(12) << std::fixed << std::setprecision(0) << s.requestsPerSecond
+                          << std::setw(11) << std::fixed << std::setprecision(1) << s.batchP50Micros
+                          << std::setw(11) << std::fixed << std::setprecision(1) << s.batchP99Micros
+                          << s.errors << std::endl;
+                pass = pass && s.errors == 0 && s.requests > 0;
+                best = std::max(best, s.requestsPerSecond);
+            }
+        }
+    }
+    std::cout << "\nPeak: " << std::fixed << std::setprecision(0) << best
+              << " requests/s; pipelining amortizes one round trip over the batch." << std::endl;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Load runs completed without errors" << std::endl;
+    return pass;
+}
+
+int main(int argc, char** argv) {
+    size_t blocks = 300;
+    size_t payload = 512;
+    int millis = 300;
+    size_t connections = 4;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--blocks") == 0 && i + 1 < argc) {
+            blocks = std::max<size_t>(30, std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--payload") == 0 && i + 1 < argc) {
+            payload = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--millis") == 0 && i + 1 < argc) {
+            millis = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--connections") == 0 && i + 1 < argc) {
+            connections = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        }
+    }
+
+    std::cout << "\n";
+    std::cout << "==============================================================\n";
+    std::cout << "=              TEST 17: EPOLL QUERY SERVER                   =\n";
+    std::cout << "==============================================================\n";
+
+    BlockchainPow chain(1, SHA256_MODE);
+    addBlocks(chain, 1, blocks, payload);
+    QueryServer server(chain);
+    server.start();
+
+    bool queries = test_queries(chain, server);
+    bool live = test_live_chain(chain, server, payload);
+    bool load = test_load(server, millis, connections);
+    server.stop();
+
+    bool pass = queries && live && load;
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << (pass ? "ALL CHECKS PASSED" : "SOME CHECKS FAILED") << std::endl;
+    std::cout << std::string(70, '=') << "\n" << std::endl;
+    return pass ? 0 : 1;
+}
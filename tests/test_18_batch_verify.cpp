@@ -0,0 +1,215 @@
+/**
+ * Test 18 - Batch verification of received blocks
+ * 18.1. verifyBlocks agrees with verifyHeader on a mixed-mode batch and flags exactly the tampered blocks
+ * 18.2. Blocks/s: one verifyHeader call per block vs verifyBlocks vs the raw hash kernel on the pool
+ *
+ * Usage: test_18_batch_verify [--blocks N] [--trials T]
+ *
+ * g++ -std=c++11 -O2 -pthread -I./include src/[a-z]*.cpp tests/test_18_batch_verify.cpp -lssl -lcrypto -o ./build/test_18_batch_verify.exe
+ */
+
+#include "ac_hash.h"
+#include "pow.h"
+#include "target.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <vector>
+
+struct KernelConfig {
+    HashMode mode;
+    uint32_t rule;
+    size_t steps;
+    const char* name;
+};
+
+const KernelConfig KERNELS[] = {
+    {SHA256_MODE, 30, 128, "SHA-256"},
+    {AC_HASH_MODE, 30, 128, "AC_HASH r30/128"},
+    {AC_HASH_R2_MODE, AC_HASH_R2_DEFAULT_RULE, AC_HASH_R2_DEFAULT_STEPS, "AC_HASH_R2"},
+    {AC_HASH_SPONGE_MODE, AC_HASH_R2_DEFAULT_RULE, AC_HASH_SPONGE_DEFAULT_ROUNDS, "SPONGE"},
+};
+
+//mines a consecutive run of blocks, cycling through the given kernels
+std::vector<BlockHeaderView> mineBatch(size_t count, const std::vector<KernelConfig>& kernels, unsigned bits) {
+    std::vector<BlockHeaderView> views(count);
+    Target target = Target::fromLeadingZeroBits(bits);
+    std::string previous = "0";
+    for (size_t i = 0; i < count; i++) {
+        const KernelConfig& k = kernels[i % kernels.size()];
+        std::string data = "batch block " + std::to_string(i);
+        BlockHeader header = BlockHeader::create(static_cast<int>(i), 1700000000000ull + i, previous, data, target,
+                                                 k.mode, k.rule, k.steps);
+        previous = ProofOfWork::mineHeader(header);
+        views[i].header = header;
+        hexToDigest(previous, views[i].hash);
+    }
+    return views;
+}
+
+bool test_correctness() {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "18.1: verifyBlocks vs verifyHeader" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    std::vector<KernelConfig> kernels(std::begin(KERNELS), std::end(KERNELS));
+    std::vector<BlockHeaderView> views = mineBatch(64, kernels, 6);
+    BlockBitmap clean = ProofOfWork::verifyBlocks(views.data(), views.size());
+    bool agrees = clean.all();
+    for (size_t i = 0; i < views.size(); i++) {
+        agrees = agrees && ProofOfWork::verifyHeader(views[i].header, digestToHex(views[i].hash)) == clean.test(i);
+    }
+    std::cout << "Untouched batch of " << views.size() << " (4 kernels): " << clean.countValid() << " valid, "
+              << (agrees ? "matches" : "DIFFERS FROM") << " verifyHeader" << std::endl;
+
+    std::vector<BlockHeaderView> tampered = views;
+    std::set<size_t> expected;
+    tampered[5].header.nonce++;                 //hash no longer matches
+    expected.insert(5);
+    tampered[10].header.previousHash[0] ^= 1;   //broken link (and hash)
+    expected.insert(10);
+    tampered[20].hash[31] ^= 1;                 //claimed hash wrong, so block 21 no longer links either
+    expected.insert(20);
+    expected.insert(21);
+    tampered[41].header.index += 7;             //index gap: 41 does not follow 40, 42 does not follow 41
+    expected.insert(41);
+    expected.insert(42);
+    BlockBitmap result = ProofOfWork::verifyBlocks(tampered.data(), tampered.size());
+    bool exact = result.size() == tampered.size();
+    for (size_t i = 0; i < tampered.size(); i++) {
+        exact = exact && result.test(i) == (expected.count(i) == 0);
+    }
+    std::cout << "Tampered blocks {5, 10, 20 (+21), 41 (+42)} flagged exactly: " << (exact ? "YES" : "NO")
+              << " (" << result.countValid() << " valid)" << std::endl;
+
+    uint8_t wrongAnchor[DIGEST_SIZE] = {1};
+    uint8_t rightAnchor[DIGEST_SIZE];
+    std::memcpy(rightAnchor, views[31].hash, DIGEST_SIZE);
+    BlockBitmap anchored = ProofOfWork::verifyBlocks(views.data() + 32, 32, rightAnchor);
+    BlockBitmap misanchored = ProofOfWork::verifyBlocks(views.data() + 32, 32, wrongAnchor);
+    bool anchors = anchored.all() && !misanchored.test(0) && misanchored.countValid() == 31;
+    std::cout << "Anchor checked against the first block: " << (anchors ? "YES" : "NO") << std::endl;
+
+    bool pass = agrees && exact && anchors;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Batch results match per-block verification" << std::endl;
+    return pass;
+}
+
+template<typename F>
+double bestSeconds(int trials, F body) {
+    double best = 1e30;
+    for (int t = 0; t < trials; t++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+bool test_throughput(size_t blocks, int trials) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "18.2: Throughput (" << ThreadPool::instance().size() << " pool workers, best of " << trials
+              << ")" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    std::cout << std::left
+              << std::setw(18) << "Kernel"
+              << std::setw(8) << "Blocks"
+              << std::setw(14) << "PerCall/s"
+              << std::setw(14) << "Batch/s"
+              << std::setw(14) << "Kernel/s"
+              << std::setw(9) << "Speedup"
+              << "Batch/Kernel" << std::endl;
+    std::cout << std::string(70, '-') << std::endl;
+
+    bool pass = true;
+    for (const KernelConfig& k : KERNELS) {
+        size_t count = k.mode == SHA256_MODE ? blocks : std::max<size_t>(64, blocks / 8);
+        std::vector<BlockHeaderView> views = mineBatch(count, std::vector<KernelConfig>(1, k), 2);
+        std::vector<std::string> hexHashes(count);
+        std::vector<std::vector<uint8_t>> encoded(count, std::vector<uint8_t>(BlockHeader::MAX_ENCODED_SIZE));
+        for (size_t i = 0; i < count; i++) {
+            hexHashes[i] = digestToHex(views[i].hash);
+            encoded[i].resize(views[i].header.encode(encoded[i].data()));
+        }
+
+        size_t perCallValid = 0;
+        double perCall = bestSeconds(trials, [&]() {
+            perCallValid = 0;
+            for (size_t i = 0; i < count; i++) {
+                perCallValid += ProofOfWork::verifyHeader(views[i].header, hexHashes[i]) ? 1 : 0;
+            }
+        });
+        BlockBitmap result;
+        double batch = bestSeconds(trials, [&]() {
+            result = ProofOfWork::verifyBlocks(views.data(), count);
+        });
+        //the floor: hash the pre-encoded headers on the pool, nothing else
+        std::vector<uint8_t> digests(count * DIGEST_SIZE);
+        double kernel = bestSeconds(trials, [&]() {
+            ThreadPool::instance().parallel_for(0, count, [&](size_t i) {
+                thread_local AcHashWorkspace workspace;
+                uint8_t* out = &digests[i * DIGEST_SIZE];
+                switch (k.mode) {
+                    case SHA256_MODE: sha256Digest(encoded[i].data(), encoded[i].size(), out); break;
+                    case AC_HASH_R2_MODE:
+                        ac_hash_r2_digest(encoded[i].data(), encoded[i].size(), k.rule, k.steps, workspace, out);
+                        break;
+                    case AC_HASH_SPONGE_MODE:
+                        ac_hash_sponge_digest(encoded[i].data(), encoded[i].size(), k.rule, k.steps, workspace, out);
+                        break;
+                    default:
+                        ac_hash_digest(encoded[i].data(), encoded[i].size(), k.rule, k.steps, workspace, out);
+                        break;
+                }
+            });
+        });
+        bool valid = perCallValid == count && result.all();
+        std::cout << std::left
+                  << std::setw(18) << k.name
+                  << std::setw(8) << count
+                  << std::setw(14) << std::fixed << std::setprecision(0) << count / perCall
+                  << std::setw(14) << std::fixed << std::setprecision(0) << count / batch
+                  << std::setw(14) << std::fixed << std::setprecision(0) << count / kernel
+                  << std::setw(9) << std::fixed << std::setprecision(2) << perCall / batch
+                  << std::fixed << std::setprecision(0) << 100.0 * kernel / batch << "%"
+                  << (valid ? "" : "  INVALID") << std::endl;
+        pass = pass && valid;
+    }
+    std::cout << "\nKernel/s hashes pre-encoded headers only; Batch/s adds encoding, linkage and" << std::endl;
+    std::cout << "target checks; PerCall/s is verifyHeader with hex hashes, one block at a time." << std::endl;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Every batch verified" << std::endl;
+    return pass;
+}
+
+int main(int argc, char** argv) {
+    size_t blocks = 4000;
+    int trials = 3;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--blocks") == 0 && i + 1 < argc) {
+            blocks = std::max<size_t>(64, std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--trials") == 0 && i + 1 < argc) {
+            trials = std::max(1, std::atoi(argv[++i]));
+        }
+    }
+
+    std::cout << "\n";
+    std::cout << "==============================================================\n";
+    std::cout << "=          TEST 18: BATCH VERIFICATION OF BLOCKS             =\n";
+    std::cout << "==============================================================\n";
+
+    bool correct = test_correctness();
+    bool throughput = test_throughput(blocks, trials);
+
+    bool pass = correct && throughput;
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << (pass ? "ALL CHECKS PASSED" : "SOME CHECKS FAILED") << std::endl;
+    std::cout << std::string(70, '=') << "\n" << std::endl;
+    return pass ? 0 : 1;
+}
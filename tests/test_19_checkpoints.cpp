@@ -0,0 +1,215 @@
+/**
+ * Test 19 - Assume-valid checkpoints
+ * 19.1. Below the latest checkpoint only linkage and header sanity are checked; full mode still recomputes
+ * 19.2. Sync (acceptBlock) rejects a chain that contradicts a checkpoint
+ * 19.3. Validation and sync time vs checkpoint height on an AC_HASH chain
+ *
+ * Usage: test_19_checkpoints [--blocks N] [--steps S]
+ *
+ * g++ -std=c++11 -O2 -pthread -I./include src/[a-z]*.cpp tests/test_19_checkpoints.cpp -lssl -lcrypto -o ./build/test_19_checkpoints.exe
+ */
+
+#include "benchmark.h"
+#include "blockchain_pow.h"
+#include "relay.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+const uint8_t* bytes(const std::string& s) {
+    return reinterpret_cast<const uint8_t*>(s.data());
+}
+
+//a received copy of the block; tamper appends to its payload but keeps the claimed hash
+std::unique_ptr<BlockPow> received(const BlockPow& block, bool tamper = false) {
+    std::string line;
+    encodeBlockText(block, line);
+    if (tamper) {
+        line.insert(line.size() - 1, "!");
+    }
+    std::unique_ptr<BlockPow> copy;
+    size_t used = 0;
+    decodeBlockText(bytes(line), line.size(), used, copy);
+    return copy;
+}
+
+//replays the chain into a new replica; tamperAt (if below size) is altered on the way
+std::unique_ptr<BlockchainPow> sync(const ChainSnapshot& source, const std::vector<Checkpoint>& checkpoints,
+                                    size_t tamperAt, size_t& accepted) {
+    std::unique_ptr<BlockchainPow> replica(new BlockchainPow(received(*source[0])));
+    replica->setCheckpoints(checkpoints);
+    accepted = 1;
+    for (size_t i = 1; i < source.size(); i++) {
+        if (!replica->acceptBlock(received(*source[i], i == tamperAt))) {
+            break;
+        }
+        accepted++;
+    }
+    return replica;
+}
+
+void buildChain(BlockchainPow& chain, size_t blocks) {
+    ScopedSilence silence;
+    for (size_t i = 1; i <= blocks; i++) {
+        chain.addBlock({"Alice->Bob: " + std::to_string(i), "Bob->Charlie: " + std::to_string(i % 7)});
+    }
+}
+
+bool test_assume_valid(const BlockchainPow& chain) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "19.1: Assume-valid vs full validation" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    ChainSnapshot source = chain.getChain();
+    size_t height = source.size() * 3 / 4;
+    std::vector<Checkpoint> checkpoints = {{source.size() / 4, source[source.size() / 4]->getHash()},
+                                           {height, source[height]->getHash()}};
+
+    //a payload changed below the checkpoint is not noticed in assume-valid mode
+    size_t accepted = 0;
+    std::unique_ptr<BlockchainPow> replica = sync(source, checkpoints, height / 2, accepted);
+    bool belowAccepted = accepted == source.size() && replica->isChainValid() &&
+                         !replica->isChainValid(VALIDATE_FULL);
+    std::cout << "Block " << height / 2 << " altered below checkpoint " << height << ": synced "
+              << accepted << "/" << source.size() << ", assume-valid " << (replica->isChainValid() ? "VALID" : "INVALID")
+              << ", full " << (replica->isChainValid(VALIDATE_FULL) ? "VALID" : "INVALID") << std::endl;
+
+    //above the checkpoint every block's proof of work is recomputed
+    std::unique_ptr<BlockchainPow> above = sync(source, checkpoints, height + 1, accepted);
+    bool aboveRejected = accepted == height + 1;
+    std::cout << "Block " << height + 1 << " altered above the checkpoint: rejected at sync: "
+              << (aboveRejected ? "YES" : "NO") << std::endl;
+
+    //full mode on the replica also recomputes below the checkpoint
+    replica->setValidationMode(VALIDATE_FULL);
+    size_t fullAccepted = 0;
+    std::unique_ptr<BlockchainPow> strict(new BlockchainPow(received(*source[0])));
+    strict->setCheckpoints(checkpoints);
+    strict->setValidationMode(VALIDATE_FULL);
+    for (size_t i = 1; i < source.size() && strict->acceptBlock(received(*source[i], i == height / 2)); i++) {
+        fullAccepted++;
+    }
+    bool fullRejects = !replica->isChainValid() && fullAccepted + 1 == height / 2;
+    std::cout << "VALIDATE_FULL mode: altered block rejected at sync and on validation: "
+              << (fullRejects ? "YES" : "NO") << std::endl;
+
+    bool clean = chain.isChainValid() && chain.isChainValid(VALIDATE_FULL);
+    bool pass = belowAccepted && aboveRejected && fullRejects && clean;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Proof of work is skipped only up to the checkpoint" << std::endl;
+    return pass;
+}
+
+bool test_wrong_checkpoint(const BlockchainPow& chain) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "19.2: Checkpoint mismatches" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    ChainSnapshot source = chain.getChain();
+    size_t height = source.size() / 2;
+    std::vector<Checkpoint> wrong = {{height, std::string(64, '0')}};
+    size_t accepted = 0;
+    std::unique_ptr<BlockchainPow> replica = sync(source, wrong, source.size(), accepted);
+    bool stops = accepted == height;
+    std::cout << "Sync against a checkpoint for another chain stops at height " << accepted << ": "
+              << (stops ? "YES" : "NO") << std::endl;
+
+    //a fully synced replica given a wrong checkpoint afterwards fails assume-valid validation
+    std::unique_ptr<BlockchainPow> synced = sync(source, {}, source.size(), accepted);
+    synced->setCheckpoints(wrong);
+    bool invalid = !synced->isChainValid() && synced->isChainValid(VALIDATE_FULL);
+    std::cout << "Existing chain that contradicts a checkpoint reported invalid: " << (invalid ? "YES" : "NO")
+              << std::endl;
+    bool pass = stops && invalid;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Checkpoints pin the trusted chain" << std::endl;
+    return pass;
+}
+
+template<typename F>
+double millisOf(F body) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool test_timing(const BlockchainPow& chain, size_t steps) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "19.3: Cost vs checkpoint height (" << chain.getChain().size() << " AC_HASH blocks, rule 30, "
+              << steps << " steps)" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    std::cout << std::left
+              << std::setw(14) << "Checkpoint"
+              << std::setw(12) << "After"
+              << std::setw(16) << "isValid(ms)"
+              << std::setw(16) << "Sync(ms)"
+              << "Valid" << std::endl;
+    std::cout << std::string(70, '-') << std::endl;
+
+    ChainSnapshot source = chain.getChain();
+    size_t n = source.size();
+    double fractions[] = {0.0, 0.5, 0.9, 1.0};
+    double fullMillis = 0.0;
+    double lastMillis = 0.0;
+    bool pass = true;
+    for (double f : fractions) {
+        std::vector<Checkpoint> checkpoints;
+        size_t height = std::min(n - 1, static_cast<size_t>(f * (n - 1)));
+        if (f > 0.0) {
+            checkpoints.push_back(Checkpoint{height, source[height]->getHash()});
+        }
+        size_t accepted = 0;
+        std::unique_ptr<BlockchainPow> replica;
+        double syncMillis = millisOf([&]() { replica = sync(source, checkpoints, n, accepted); });
+        bool valid = false;
+        double validMillis = millisOf([&]() { valid = replica->isChainValid(); });
+        size_t after = f > 0.0 ? n - 1 - height : n - 1;
+        std::cout << std::left
+                  << std::setw(14) << (f > 0.0 ? std::to_string(height) : std::string("none"))
+                  << std::setw(12) << after
+                  << std::setw(16) << std::fixed << std::setprecision(2) << validMillis
+                  << std::setw(16) << std::fixed << std::setprecision(2) << syncMillis
+                  << (valid && accepted == n ? "YES" : "NO") << std::endl;
+        pass = pass && valid && accepted == n;
+        if (f == 0.0) fullMillis = validMillis + syncMillis;
+        lastMillis = validMillis + syncMillis;
+    }
+    std::cout << "\nWith the checkpoint at the tip, validation + sync is " << std::fixed << std::setprecision(1)
+              << (lastMillis > 0 ? fullMillis / lastMillis : 0.0) << "x faster than full." << std::endl;
+    pass = pass && lastMillis < fullMillis;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Cost follows the blocks after the checkpoint" << std::endl;
+    return pass;
+}
+
+int main(int argc, char** argv) {
+    size_t blocks = 400;
+    size_t steps = 128;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--blocks") == 0 && i + 1 < argc) {
+            blocks = std::max<size_t>(16, std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            steps = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        }
+    }
+
+    std::cout << "\n";
+    std::cout << "==============================================================\n";
+    std::cout << "=             TEST 19: ASSUME-VALID CHECKPOINTS              =\n";
+    std::cout << "==============================================================\n";
+
+    BlockchainPow chain(1, AC_HASH_MODE, 30, steps);
+    buildChain(chain, blocks);
+
+    bool assume = test_assume_valid(chain);
+    bool wrong = test_wrong_checkpoint(chain);
+    bool timing = test_timing(chain, steps);
+
+    bool pass = assume && wrong && timing;
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << (pass ? "ALL CHECKS PASSED" : "SOME CHECKS FAILED") << std::endl;
+    std::cout << std::string(70, '=') << "\n" << std::endl;
+    return pass ? 0 : 1;
+}
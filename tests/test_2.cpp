@@ -1,8 +1,10 @@
 /**
- * g++ -I./include tests/test_2.cpp src/cellular_automaton.cpp src/ac_hash.cpp -o ./build/test_2.exe ; ./build/test_2.exe
+ * g++ -I./include tests/test_2.cpp src/cellular_automaton.cpp src/radius2_automaton.cpp src/ac_hash.cpp -o ./build/test_2.exe ; ./build/test_2.exe
  */
 
 #include "ac_hash.h"
+#include "ac_hash_fixed.h"
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 
@@ -115,6 +117,105 @@ void test_text_to_bits_conversion() {
     std::cout << "Conversion correct: " << (correct ? "PASS" : "FAIL") << std::endl;
 }
 
+void test_radius2_mode() {
+    print_test_header("Test: Radius-2 (5-cell neighborhood) Hash Mode");
+
+    //one live cell spreads two cells per generation
+    Radius2Automaton ca(256, AC_HASH_R2_DEFAULT_RULE);
+    std::vector<uint64_t> single(4, 0);
+    single[2] = 1; //cell 128
+    ca.init_packed(single);
+    ca.evolve();
+    bool reach = ca.get_cell(126) == 1 && ca.get_cell(130) == 1 && ca.get_cell(125) == 0 && ca.get_cell(131) == 0;
+    std::cout << "One generation reaches cells 126..130: " << (reach ? "PASS" : "FAIL") << std::endl;
+
+    //rule 30 written as a radius-2 rule reproduces ac_hash bit for bit (inputs up to 32 bytes,
+    //longer ones get a grid rounded up to whole words)
+    const char* inputs[] = {"", "Test message", "Alice->Bob: 50;Bob->Charlie: 30;"};
+    size_t stepValues[] = {1, 17, 128};
+    bool same = true;
+    for (const char* input : inputs) {
+        for (size_t steps : stepValues) {
+            same = same && ac_hash_r2(input, AC_HASH_R2_RULE_30, steps) == ac_hash(input, 30, steps);
+        }
+    }
+    std::cout << "Radius-2 encoding of rule 30 matches ac_hash: " << (same ? "PASS" : "FAIL") << std::endl;
+
+    std::string hash1 = ac_hash_r2("Test message", AC_HASH_R2_DEFAULT_RULE, AC_HASH_R2_DEFAULT_STEPS);
+    std::string hash2 = ac_hash_r2("Test message", AC_HASH_R2_DEFAULT_RULE, AC_HASH_R2_DEFAULT_STEPS);
+    std::string hash3 = ac_hash_r2("Test messagf", AC_HASH_R2_DEFAULT_RULE, AC_HASH_R2_DEFAULT_STEPS);
+    std::cout << "Default rule " << AC_HASH_R2_DEFAULT_RULE << ", " << AC_HASH_R2_DEFAULT_STEPS
+              << " steps: " << hash1 << std::endl;
+    std::cout << "Reproducible, 64 hex chars, sensitive to input: "
+              << (hash1 == hash2 && hash1.size() == 64 && hash1 != hash3 ? "PASS" : "FAIL") << std::endl;
+}
+
+void test_sponge_mode() {
+    print_test_header("Test: Fixed-Width Sponge Hash Mode");
+
+    std::string hash1 = ac_hash_sponge("Test message", AC_HASH_R2_DEFAULT_RULE, AC_HASH_SPONGE_DEFAULT_ROUNDS);
+    std::string hash2 = ac_hash_sponge("Test message", AC_HASH_R2_DEFAULT_RULE, AC_HASH_SPONGE_DEFAULT_ROUNDS);
+    std::string hash3 = ac_hash_sponge("Test messagf", AC_HASH_R2_DEFAULT_RULE, AC_HASH_SPONGE_DEFAULT_ROUNDS);
+    std::cout << "Default rule, " << AC_HASH_SPONGE_DEFAULT_ROUNDS << " rounds: " << hash1 << std::endl;
+    std::cout << "Reproducible, 64 hex chars, sensitive to input: "
+              << (hash1 == hash2 && hash1.size() == 64 && hash1 != hash3 ? "PASS" : "FAIL") << std::endl;
+
+    //padding keeps inputs that differ only in trailing zero bytes or block boundaries apart
+    std::string zero15(15, '\0'), zero16(16, '\0'), zero17(17, '\0');
+    uint32_t rule = AC_HASH_R2_DEFAULT_RULE;
+    size_t rounds = AC_HASH_SPONGE_DEFAULT_ROUNDS;
+    std::string h0 = ac_hash_sponge("", rule, rounds);
+    std::string h15 = ac_hash_sponge(zero15, rule, rounds);
+    std::string h16 = ac_hash_sponge(zero16, rule, rounds);
+    std::string h17 = ac_hash_sponge(zero17, rule, rounds);
+    bool distinct = h0 != h15 && h15 != h16 && h16 != h17 && h0 != h16;
+    std::cout << "Empty, 15, 16 and 17 zero bytes hash differently: " << (distinct ? "PASS" : "FAIL") << std::endl;
+
+    //a change at the start of a long payload reaches the digest, and the workspace is reusable
+    std::string longInput(64 * 1024, 'x');
+    std::string changed = longInput;
+    changed[0] = 'y';
+    AcHashWorkspace workspace;
+    const uint8_t* a = reinterpret_cast<const uint8_t*>(longInput.data());
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(changed.data());
+    std::string longHash = ac_hash_sponge(a, longInput.size(), rule, rounds, workspace);
+    bool longOk = longHash != ac_hash_sponge(b, changed.size(), rule, rounds, workspace) &&
+                  longHash == ac_hash_sponge(longInput, rule, rounds) &&
+                  ac_hash_sponge("Test message", rule, rounds) == hash1;
+    std::cout << "64 KB input: first-byte change propagates, workspace reuse matches: "
+              << (longOk ? "PASS" : "FAIL") << std::endl;
+}
+
+void test_fixed_specialization() {
+    print_test_header("Test: Compile-Time Specialized ac_hash (rule 30, 128 steps)");
+
+    //every input length up to the 112-byte header: 256, 800 and 896 cells are specialized,
+    //the other widths fall back to the generic path; both must agree with it
+    AcHashWorkspace workspace;
+    bool same = true;
+    for (size_t length = 0; length <= 112; length++) {
+        std::vector<uint8_t> input(length);
+        for (size_t i = 0; i < length; i++) {
+            input[i] = static_cast<uint8_t>(i * 37 + length);
+        }
+        uint8_t dispatched[32];
+        uint8_t generic[32];
+        ac_hash_digest(input.data(), length, 30, 128, workspace, dispatched);
+        ac_hash_generic_digest(input.data(), length, 30, 128, workspace, generic);
+        same = same && std::equal(dispatched, dispatched + 32, generic);
+    }
+    std::cout << "Dispatched ac_hash matches the generic path for 0-112 byte inputs: "
+              << (same ? "PASS" : "FAIL") << std::endl;
+
+    bool direct = ac_hash_fixed<30, 128, 256>("Test message") == ac_hash("Test message", 30, 128);
+    std::cout << "ac_hash_fixed<30, 128, 256> called directly: " << (direct ? "PASS" : "FAIL") << std::endl;
+
+    uint8_t fallback[32];
+    bool other = !ac_hash_fixed_dispatch(reinterpret_cast<const uint8_t*>("x"), 1, 30, 64, fallback) &&
+                 !ac_hash_fixed_dispatch(reinterpret_cast<const uint8_t*>("x"), 1, 110, 128, fallback);
+    std::cout << "Other rules and step counts take the generic path: " << (other ? "PASS" : "FAIL") << std::endl;
+}
+
 int main() {
     std::cout << "\n";
     std::cout << "==============================================================\n";
@@ -126,6 +227,9 @@ int main() {
     test_different_inputs();
     test_same_input_reproducible();
     test_empty_input();
+    test_radius2_mode();
+    test_sponge_mode();
+    test_fixed_specialization();
     
     std::cout << "\n" << std::string(60, '=') << std::endl;
     std::cout << "All tests completed!" << std::endl;
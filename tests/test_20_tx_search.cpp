@@ -0,0 +1,269 @@
+/**
+ * Test 20 - Transaction search with per-block Bloom filters
+ * 20.1. Filter sizing: no false negatives, measured vs configured false-positive rate, exact payload match
+ * 20.2. scanTransaction, filterTransaction and TransactionIndex agree, across a false-positive rate change
+ * 20.3. Lookup time: payload scan vs per-block filters vs the bit-sliced index
+ *
+ * Usage: test_20_tx_search [--blocks N] [--tx T] [--rate P]
+ *
+ * g++ -std=c++11 -O2 -pthread -I./include src/[a-z]*.cpp tests/test_20_tx_search.cpp -lssl -lcrypto -o ./build/test_20_tx_search.exe
+ */
+
+#include "benchmark.h"
+#include "blockchain_pow.h"
+#include "bloom_filter.h"
+#include "tx_index.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+std::string transaction(size_t height, size_t j) {
+    return "user" + std::to_string((height * 31 + j) % 997) + "->user" + std::to_string((height + j * 7) % 991) +
+           ": " + std::to_string(height % 500 + j) + " #" + std::to_string(height) + "." + std::to_string(j);
+}
+
+void buildChain(BlockchainPow& chain, size_t first, size_t blocks, size_t txPerBlock) {
+    ScopedSilence silence;
+    std::vector<std::string> transactions(txPerBlock);
+    for (size_t h = first; h < first + blocks; h++) {
+        for (size_t j = 0; j < txPerBlock; j++) {
+            transactions[j] = transaction(h, j);
+        }
+        chain.addBlock(transactions);
+    }
+}
+
+bool test_filter(double rate, size_t txPerBlock) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "20.1: Filter sizing" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    std::cout << std::left
+              << std::setw(12) << "Rate"
+              << std::setw(10) << "Bits"
+              << std::setw(10) << "Hashes"
+              << std::setw(14) << "Expected"
+              << std::setw(14) << "Measured"
+              << "Misses" << std::endl;
+    std::cout << std::string(70, '-') << std::endl;
+
+    bool pass = true;
+    double rates[] = {0.1, rate, 0.001};
+    const size_t filters = 2000;
+    const size_t probes = 50;
+    for (double r : rates) {
+        BloomGeometry geometry = BloomGeometry::forRate(r, txPerBlock);
+        size_t misses = 0, positives = 0;
+        for (size_t f = 0; f < filters; f++) {
+            BloomFilter filter(geometry);
+            for (size_t j = 0; j < txPerBlock; j++) {
+                filter.add(transaction(f, j));
+            }
+            for (size_t j = 0; j < txPerBlock; j++) {
+                misses += filter.mayContain(transaction(f, j)) ? 0 : 1;
+            }
+            for (size_t j = 0; j < probes; j++) {
+                positives += filter.mayContain("absent " + std::to_string(f) + "." + std::to_string(j)) ? 1 : 0;
+            }
+        }
+        double measured = static_cast<double>(positives) / (filters * probes);
+        double expected = geometry.falsePositiveRate(txPerBlock);
+        std::cout << std::left
+                  << std::setw(12) << r
+                  << std::setw(10) << geometry.bits
+                  << std::setw(10) << geometry.hashes
+                  << std::setw(14) << std::fixed << std::setprecision(5) << expected
+                  << std::setw(14) << std::fixed << std::setprecision(5) << measured
+                  << misses << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+        //within 2x of the requested rate (the rounding to 64-bit words only lowers it)
+        pass = pass && misses == 0 && expected <= r && measured < 2 * r;
+    }
+
+    bool exact = blockHasTransaction("Alice->Bob: 50;Bob->Charlie: 5;", "Alice->Bob: 50") &&
+                 !blockHasTransaction("Alice->Bob: 50;Bob->Charlie: 5;", "Alice->Bob: 5") &&
+                 !blockHasTransaction("Alice->Bob: 500;", "Alice->Bob: 50") &&
+                 blockHasTransaction("Genesis Block", "Genesis Block");
+    std::cout << "Payload check matches whole transactions only: " << (exact ? "YES" : "NO") << std::endl;
+
+    bool rejects = false;
+    try {
+        BloomGeometry::forRate(1.5, txPerBlock);
+    } catch (const std::invalid_argument&) {
+        rejects = true;
+    }
+    std::cout << "Rate outside (0, 1) rejected: " << (rejects ? "YES" : "NO") << std::endl;
+    pass = pass && exact && rejects;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Filters have no false negatives and the configured rate" << std::endl;
+    return pass;
+}
+
+bool sameResult(const TxSearchResult& a, const TxSearchResult& b) {
+    return a.heights == b.heights;
+}
+
+bool test_agreement(size_t txPerBlock) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "20.2: Search methods agree" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    //the rate changes at block 150, so groups 2 and 3 mix geometries; 300 blocks leave a partial tail
+    BlockchainPow chain(0, SHA256_MODE);
+    buildChain(chain, 1, 149, txPerBlock);
+    chain.setBloomFalsePositiveRate(0.001, txPerBlock);
+    buildChain(chain, 150, 150, txPerBlock);
+    //a transaction repeated in two blocks, and one sharing a prefix with another
+    {
+        ScopedSilence silence;
+        chain.addBlock({"Alice->Bob: 50", transaction(7, 0)});
+        chain.addBlock({"Alice->Bob: 5"});
+    }
+
+    ChainSnapshot snapshot = chain.getChain();
+    TransactionIndex index;
+    std::vector<std::string> queries = {"Genesis Block", "Alice->Bob: 50", "Alice->Bob: 5", transaction(7, 0),
+                                        "nobody->nobody: 0"};
+    for (size_t h = 1; h < 300; h += 13) {
+        queries.push_back(transaction(h, h % txPerBlock));
+    }
+    bool agree = true;
+    size_t found = 0;
+    for (const std::string& tx : queries) {
+        TxSearchResult scan = scanTransaction(snapshot, tx);
+        TxSearchResult filtered = filterTransaction(snapshot, tx);
+        TxSearchResult indexed = index.find(snapshot, tx);
+        agree = agree && sameResult(scan, filtered) && sameResult(scan, indexed);
+        found += scan.heights.size();
+    }
+    bool repeated = index.find(snapshot, transaction(7, 0)).heights == std::vector<size_t>({7, 300}) &&
+                    index.find(snapshot, "Alice->Bob: 5").heights == std::vector<size_t>({301}) &&
+                    index.find(snapshot, "nobody->nobody: 0").heights.empty();
+    std::cout << queries.size() << " queries over " << snapshot.size() << " blocks (" << index.indexedBlocks()
+              << " indexed): " << found << " hits, methods agree: " << (agree ? "YES" : "NO") << std::endl;
+    std::cout << "Repeated, prefix and absent transactions resolved exactly: " << (repeated ? "YES" : "NO")
+              << std::endl;
+    bool geometries = snapshot[100]->getFilter().geometry() != snapshot[200]->getFilter().geometry();
+    std::cout << "Blocks after setBloomFalsePositiveRate use the new geometry: " << (geometries ? "YES" : "NO")
+              << std::endl;
+
+    bool pass = agree && repeated && geometries;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Filter and index searches match the payload scan" << std::endl;
+    return pass;
+}
+
+template<typename F>
+double microsPerCall(size_t calls, F body) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < calls; i++) {
+        body(i);
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / calls;
+}
+
+bool test_timing(size_t blocks, size_t txPerBlock, double rate) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "20.3: Lookup time (" << blocks << " blocks, " << txPerBlock << " tx each, rate " << rate << ")"
+              << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    BlockchainPow chain(0, SHA256_MODE);
+    chain.setBloomFalsePositiveRate(rate, txPerBlock);
+    auto buildStart = std::chrono::steady_clock::now();
+    buildChain(chain, 1, blocks, txPerBlock);
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+    ChainSnapshot snapshot = chain.getChain();
+
+    TransactionIndex index(chain.getBloomGeometry());
+    auto indexStart = std::chrono::steady_clock::now();
+    index.update(snapshot);
+    double indexMillis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - indexStart).count();
+    std::cout << "Chain built in " << std::fixed << std::setprecision(1) << buildSeconds << " s; index of "
+              << index.indexedBlocks() << " blocks (" << index.memoryBytes() / 1024 << " KB) built in "
+              << std::setprecision(1) << indexMillis << " ms" << std::endl;
+
+    std::mt19937_64 rng(20);
+    std::vector<std::string> queries;
+    for (size_t i = 0; i < 64; i++) {
+        size_t h = 1 + rng() % blocks;
+        queries.push_back(i % 4 == 3 ? "ghost->nobody: " + std::to_string(i) : transaction(h, rng() % txPerBlock));
+    }
+
+    std::cout << "\n" << std::left
+              << std::setw(22) << "Method"
+              << std::setw(12) << "Queries"
+              << std::setw(16) << "us/query"
+              << std::setw(16) << "Payloads read"
+              << "Speedup" << std::endl;
+    std::cout << std::string(70, '-') << std::endl;
+
+    std::vector<TxSearchResult> expected(queries.size());
+    size_t scanCalls = std::max<size_t>(4, std::min<size_t>(queries.size(), 2000000 / blocks));
+    double scanMicros = microsPerCall(scanCalls, [&](size_t i) { expected[i] = scanTransaction(snapshot, queries[i]); });
+    bool agree = true;
+    size_t filterReads = 0, indexReads = 0;
+    double filterMicros = microsPerCall(queries.size(), [&](size_t i) {
+        TxSearchResult r = filterTransaction(snapshot, queries[i]);
+        filterReads += r.candidates;
+        agree = agree && (i >= scanCalls || sameResult(r, expected[i]));
+    });
+    double indexMicros = microsPerCall(queries.size(), [&](size_t i) {
+        TxSearchResult r = index.find(snapshot, queries[i]);
+        indexReads += r.candidates;
+        agree = agree && (i >= scanCalls || sameResult(r, expected[i]));
+    });
+    struct Row { const char* name; size_t calls; double micros; double reads; };
+    Row rows[] = {{"Payload scan", scanCalls, scanMicros, static_cast<double>(snapshot.size())},
+                  {"Per-block filters", queries.size(), filterMicros, static_cast<double>(filterReads) / queries.size()},
+                  {"Bit-sliced index", queries.size(), indexMicros, static_cast<double>(indexReads) / queries.size()}};
+    for (const Row& row : rows) {
+        std::cout << std::left
+                  << std::setw(22) << row.name
+                  << std::setw(12) << row.calls
+                  << std::setw(16) << std::fixed << std::setprecision(2) << row.micros
+                  << std::setw(16) << std::fixed << std::setprecision(1) << row.reads
+                  << std::fixed << std::setprecision(1) << scanMicros / row.micros << "x" << std::endl;
+    }
+    std::cout << "\nPayloads read beyond the true hits are false positives (" << std::setprecision(2)
+              << 100.0 * chain.getBloomGeometry().falsePositiveRate(txPerBlock)
+              << "% of blocks expected per query); a lower --rate trades filter bits for fewer reads." << std::endl;
+
+    bool pass = agree && indexMicros < filterMicros && filterMicros < scanMicros;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Index lookups agree and beat both scans" << std::endl;
+    return pass;
+}
+
+int main(int argc, char** argv) {
+    size_t blocks = 100000;
+    size_t txPerBlock = BLOOM_DEFAULT_EXPECTED_TRANSACTIONS;
+    double rate = BLOOM_DEFAULT_FALSE_POSITIVE_RATE;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--blocks") == 0 && i + 1 < argc) {
+            blocks = std::max<size_t>(64, std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--tx") == 0 && i + 1 < argc) {
+            txPerBlock = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            rate = std::atof(argv[++i]);
+        }
+    }
+
+    std::cout << "\n";
+    std::cout << "==============================================================\n";
+    std::cout << "=        TEST 20: TRANSACTION SEARCH WITH BLOOM FILTERS      =\n";
+    std::cout << "==============================================================\n";
+
+    bool filter = test_filter(rate, txPerBlock);
+    bool agreement = test_agreement(txPerBlock);
+    bool timing = test_timing(blocks, txPerBlock, rate);
+
+    bool pass = filter && agreement && timing;
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << (pass ? "ALL CHECKS PASSED" : "SOME CHECKS FAILED") << std::endl;
+    std::cout << std::string(70, '=') << "\n" << std::endl;
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,287 @@
+/**
+ * Test 21 - Account balance state engine
+ * 21.1. Transfers are parsed as blocks are appended; malformed and overspending ones are rejected before mining
+ * 21.2. Balances match a full replay of the chain; rebuilds start from the latest snapshot
+ * 21.3. Balance query time, and rebuild time with snapshots vs from genesis
+ *
+ * Usage: test_21_balances [--blocks N] [--accounts A] [--tx T] [--interval I]
+ *
+ * g++ -std=c++11 -O2 -pthread -I./include src/[a-z]*.cpp tests/test_21_balances.cpp -lssl -lcrypto -o ./build/test_21_balances.exe
+ */
+
+#include "account_state.h"
+#include "benchmark.h"
+#include "blockchain_pow.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+std::string accountName(size_t i) {
+    return "acct" + std::to_string(i);
+}
+
+//random valid transfers: a sender is only picked while it has funds
+class TransferGenerator {
+public:
+    TransferGenerator(size_t accounts, uint64_t funds) : balances(accounts, funds), rng(21) {}
+
+    Balances allocation() const {
+        Balances result;
+        for (size_t i = 0; i < balances.size(); i++) {
+            result.push_back(std::make_pair(accountName(i), balances[i]));
+        }
+        return result;
+    }
+
+    std::vector<std::string> block(size_t count) {
+        std::vector<std::string> transactions;
+        for (size_t j = 0; j < count; j++) {
+            size_t from = rng() % balances.size();
+            while (balances[from] == 0) {
+                from = (from + 1) % balances.size();
+            }
+            size_t to = rng() % balances.size();
+            uint64_t amount = 1 + rng() % std::min<uint64_t>(balances[from], 50);
+            balances[from] -= amount;
+            balances[to] += amount;
+            transactions.push_back(accountName(from) + "->" + accountName(to) + ": " + std::to_string(amount));
+        }
+        return transactions;
+    }
+
+private:
+    std::vector<uint64_t> balances;
+    std::mt19937_64 rng;
+};
+
+//the naive way: parse every block from genesis into an ordered map
+std::map<std::string, uint64_t> replay(const ChainSnapshot& chain, const Balances& allocation, size_t height) {
+    std::map<std::string, uint64_t> balances(allocation.begin(), allocation.end());
+    Transfer transfer;
+    for (size_t i = 1; i < height; i++) {
+        forEachTransaction(chain[i]->getData(), [&](const char* tx, size_t length) {
+            if (parseTransfer(tx, length, transfer)) {
+                balances[transfer.from] -= transfer.amount;
+                balances[transfer.to] += transfer.amount;
+            }
+            return true;
+        });
+    }
+    return balances;
+}
+
+bool sameBalances(const BalanceTable& table, const std::map<std::string, uint64_t>& expected) {
+    Balances accounts = table.accounts();
+    return accounts == Balances(expected.begin(), expected.end());
+}
+
+template<typename F>
+bool throwsInvalid(F body) {
+    try {
+        body();
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+bool test_rejection() {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "21.1: Transfers and overspending" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    Transfer t;
+    bool parses = parseTransfer("Alice->Bob: 50", t) && t.from == "Alice" && t.to == "Bob" && t.amount == 50 &&
+                  !parseTransfer("Alice->Bob: 0", t) && !parseTransfer("Alice->Bob: -5", t) &&
+                  !parseTransfer("->Bob: 5", t) && !parseTransfer("Alice->: 5", t) &&
+                  !parseTransfer("Alice->Bob: 5x", t) && !parseTransfer("Alice pays Bob 5", t) &&
+                  !parseTransfer("Alice->Bob: 99999999999999999999", t) && !parseTransfer("Alice->Bob;x: 5", t) &&
+                  !parseTransfer("Alice;x->Bob: 5", t);
+    std::cout << "Transfer parsing (amounts, names, garbage): " << (parses ? "OK" : "FAIL") << std::endl;
+
+    ScopedSilence silence;
+    BlockchainPow chain(1, SHA256_MODE);
+    chain.trackBalances({{"Alice", 100}});
+    chain.addBlock({"Alice->Bob: 50", "Bob->Charlie: 30"});
+    //Charlie spends what the first transfer of the same block gives
+    chain.addBlock({"Alice->Charlie: 10", "Charlie->Dave: 40"});
+    bool applied = chain.getBalance("Alice") == 40 && chain.getBalance("Bob") == 20 &&
+                   chain.getBalance("Charlie") == 0 && chain.getBalance("Dave") == 40 &&
+                   chain.getBalance("Nobody") == 0;
+
+    size_t before = chain.getChain().size();
+    bool overspend = throwsInvalid([&]() { chain.addBlock({"Bob->Alice: 5", "Bob->Dave: 16"}); });
+    bool malformed = throwsInvalid([&]() { chain.addBlock({"Alice gives Bob 5"}); }) &&
+                     throwsInvalid([&]() { chain.addBlock({"Alice->Bob;x: 5"}); }); //would re-split as 2 transactions
+    bool unchanged = chain.getChain().size() == before && chain.getBalance("Bob") == 20 &&
+                     chain.getBalance("Alice") == 40 && chain.getBalance("Bob;x") == 0;
+    std::string message;
+    try {
+        chain.addBlock({"Dave->Eve: 41"});
+    } catch (const std::invalid_argument& e) {
+        message = e.what();
+    }
+    std::cout << "Balances after 2 blocks: Alice " << chain.getBalance("Alice") << ", Bob " << chain.getBalance("Bob")
+              << ", Charlie " << chain.getBalance("Charlie") << ", Dave " << chain.getBalance("Dave") << std::endl;
+    std::cout << "Overspend and malformed blocks rejected before mining, chain unchanged: "
+              << (overspend && malformed && unchanged ? "YES" : "NO") << std::endl;
+    std::cout << "Error: " << message << std::endl;
+
+    //a peer's block that overspends is not accepted by a tracking replica
+    BlockchainPow source(1, SHA256_MODE);
+    source.addBlock({"Alice->Bob: 60"});
+    source.addBlock({"Alice->Bob: 60"});
+    ChainSnapshot blocks = source.getChain();
+    BlockchainPow replica(std::unique_ptr<BlockPow>(new BlockPow(*blocks[0])));
+    replica.trackBalances({{"Alice", 100}});
+    bool first = replica.acceptBlock(std::unique_ptr<BlockPow>(new BlockPow(*blocks[1])));
+    bool second = replica.acceptBlock(std::unique_ptr<BlockPow>(new BlockPow(*blocks[2])));
+    bool replicated = first && !second && replica.getBalance("Alice") == 40 && replica.getChain().size() == 2;
+    std::cout << "Replica accepts the funded block and drops the overspending one: " << (replicated ? "YES" : "NO")
+              << std::endl;
+
+    //tracking a chain that already overspent fails and leaves it untracked
+    bool replayRejects = throwsInvalid([&]() { source.trackBalances({{"Alice", 100}}); }) && !source.tracksBalances();
+    std::cout << "trackBalances on an existing overspent chain throws: " << (replayRejects ? "YES" : "NO") << std::endl;
+
+    bool pass = parses && applied && overspend && malformed && unchanged && !message.empty() && replicated &&
+                replayRejects;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Invalid transfers never reach the chain" << std::endl;
+    return pass;
+}
+
+bool test_replay(BlockchainPow& chain, const Balances& allocation, size_t interval) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "21.2: Incremental state vs full replay" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    ChainSnapshot snapshot = chain.getChain();
+    StateEngine& state = *chain.getState();
+    bool tip = state.height() == snapshot.size() && sameBalances(state.balances(), replay(snapshot, allocation, snapshot.size()));
+    std::cout << "State after " << snapshot.size() << " blocks (" << state.balances().size() << " accounts, "
+              << state.snapshots() << " snapshots) matches full replay: " << (tip ? "YES" : "NO") << std::endl;
+
+    //rewind a few intervals (within the kept snapshots), then back to the tip
+    size_t middle = snapshot.size() > 4 * interval ? snapshot.size() - 3 * interval - 7 : snapshot.size() / 2;
+    size_t rewound = state.rebuild(snapshot, middle);
+    bool atMiddle = state.height() == middle && sameBalances(state.balances(), replay(snapshot, allocation, middle));
+    size_t forward = state.rebuild(snapshot, snapshot.size());
+    bool backAtTip = state.height() == snapshot.size() &&
+                     sameBalances(state.balances(), replay(snapshot, allocation, snapshot.size()));
+    bool bounded = rewound < interval;
+    std::cout << "Rebuild at height " << middle << " replayed " << rewound << " blocks (interval " << interval
+              << "), matches: " << (atMiddle ? "YES" : "NO") << std::endl;
+    std::cout << "Rebuild back to the tip replayed " << forward << " blocks, matches: " << (backAtTip ? "YES" : "NO")
+              << std::endl;
+
+    bool pass = tip && atMiddle && backAtTip && bounded;
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Incremental balances equal the replayed chain" << std::endl;
+    return pass;
+}
+
+template<typename F>
+double microsOf(F body) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool test_timing(BlockchainPow& chain, const Balances& allocation, size_t accounts, size_t interval) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "21.3: Query and rebuild time" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    ChainSnapshot snapshot = chain.getChain();
+    StateEngine& state = *chain.getState();
+    const size_t queries = 200000;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < 1024; i++) {
+        names.push_back(accountName((i * 7919) % accounts));
+    }
+    uint64_t total = 0;
+    double queryMicros = microsOf([&]() {
+        for (size_t i = 0; i < queries; i++) {
+            total += state.balance(names[i % names.size()]);
+        }
+    });
+    std::map<std::string, uint64_t> replayed;
+    double replayMicros = microsOf([&]() { replayed = replay(snapshot, allocation, snapshot.size()); });
+    size_t replayedBlocks = 0;
+    double snapshotMicros = microsOf([&]() { replayedBlocks = state.rebuild(snapshot, snapshot.size() - 1); });
+    StateEngine fresh(allocation, snapshot.size() + 1);
+    size_t freshBlocks = 0;
+    double freshMicros = microsOf([&]() { freshBlocks = fresh.rebuild(snapshot, snapshot.size() - 1); });
+    state.rebuild(snapshot, snapshot.size());
+
+    std::cout << std::left
+              << std::setw(34) << "Operation"
+              << std::setw(16) << "Blocks read"
+              << "Time" << std::endl;
+    std::cout << std::string(70, '-') << std::endl;
+    std::cout << std::left << std::setw(34) << "balance(account)" << std::setw(16) << 0
+              << std::fixed << std::setprecision(1) << 1000.0 * queryMicros / queries << " ns" << std::endl;
+    std::cout << std::left << std::setw(34) << "Full replay into std::map" << std::setw(16) << snapshot.size() - 1
+              << std::fixed << std::setprecision(1) << replayMicros / 1000.0 << " ms" << std::endl;
+    std::cout << std::left << std::setw(34) << "rebuild(tip - 1), from genesis" << std::setw(16) << freshBlocks
+              << std::fixed << std::setprecision(1) << freshMicros / 1000.0 << " ms" << std::endl;
+    std::cout << std::left << std::setw(34) << "rebuild(tip - 1), from snapshot" << std::setw(16) << replayedBlocks
+              << std::fixed << std::setprecision(1) << snapshotMicros / 1000.0 << " ms" << std::endl;
+    std::cout << "\nBalance table: " << state.balances().size() << " accounts in "
+              << state.balances().memoryBytes() / 1024 << " KB; snapshot interval " << interval << " blocks" << std::endl;
+
+    bool pass = total > 0 && replayedBlocks < interval && snapshotMicros < freshMicros &&
+                sameBalances(fresh.balances(), replay(snapshot, allocation, snapshot.size() - 1));
+    std::cout << (pass ? "[PASS]" : "[FAIL]") << " Rebuilds from a snapshot replay only the recent blocks" << std::endl;
+    return pass;
+}
+
+int main(int argc, char** argv) {
+    size_t blocks = 20000;
+    size_t accounts = 10000;
+    size_t txPerBlock = 16;
+    size_t interval = STATE_DEFAULT_SNAPSHOT_INTERVAL;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--blocks") == 0 && i + 1 < argc) {
+            blocks = std::max<size_t>(16, std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--accounts") == 0 && i + 1 < argc) {
+            accounts = std::max<size_t>(2, std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--tx") == 0 && i + 1 < argc) {
+            txPerBlock = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        }
+    }
+
+    std::cout << "\n";
+    std::cout << "==============================================================\n";
+    std::cout << "=          TEST 21: ACCOUNT BALANCE STATE ENGINE             =\n";
+    std::cout << "==============================================================\n";
+
+    bool rejection = test_rejection();
+
+    TransferGenerator generator(accounts, 1000);
+    Balances allocation = generator.allocation();
+    BlockchainPow chain(0, SHA256_MODE);
+    chain.trackBalances(allocation, interval);
+    {
+        ScopedSilence silence;
+        for (size_t i = 1; i <= blocks; i++) {
+            chain.addBlock(generator.block(txPerBlock));
+        }
+    }
+    bool replayed = test_replay(chain, allocation, interval);
+    bool timing = test_timing(chain, allocation, accounts, interval);
+
+    bool pass = rejection && replayed && timing;
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << (pass ? "ALL CHECKS PASSED" : "SOME CHECKS FAILED") << std::endl;
+    std::cout << std::string(70, '=') << "\n" << std::endl;
+    return pass ? 0 : 1;
+}
@@ -4,15 +4,28 @@
  * 3.3 - Validates blocks work correctly with both modes
  * Bonus - Tests mixed hash modes in same chain
  * Bonus - Compares different CA rules (30, 90, 110)
+ * 3.4 - Binary block header: encode/decode round trip, stored timestamp, calculateHash
+ * 3.5 - Bit-granular 256-bit targets and the retargeting controller
+ * 3.6 - 64-bit nonces, extra-nonce rollover and older header versions
+ * 3.9 - Block access through the static Block<Derived> interface, without copies
+ * 3.10 - Asynchronous structured logging: JSON block events, silent mode, producer cost
  * 
  * run & compile (MSYS2 MinGW64):
  * g++ -std=c++11 -I./include -IC:\msys64\mingw64\include src/cellular_automaton.cpp src/ac_hash.cpp src/utils.cpp src/pow.cpp src/block_pow.cpp src/blockchain_pow.cpp tests/test_3.cpp -LC:\msys64\mingw64\lib -lssl -lcrypto -o test_3.exe
  * 
  */
 
+#include "ac_hash.h"
 #include "blockchain_pow.h"
+#include "logger.h"
+#include "pow.h"
 #include "utils.h"
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
 void printSeparator(const std::string& title) {
@@ -105,6 +118,7 @@ void test_mixed_hash_modes() {
     
     std::cout << "Adding block 2 using AC_HASH..." << std::endl;
     chain.addBlock(transactions);
+    Logger::instance().flush(); //block_mined records are queued; write them before our own lines
     
     std::cout << "\nDisplaying mixed chain:" << std::endl;
     chain.displayChain();
@@ -139,6 +153,330 @@ void test_different_rules() {
     std::cout << "\n[INFO] All rules produce valid blocks" << std::endl;
 }
 
+void test_binary_header() {
+    printSeparator("TEST 3.4: Canonical Binary Block Header");
+
+    BlockHeader header = BlockHeader::create(7, 1700000000123ULL, sha256("previous"), "Alice->Bob: 50;",
+                                             2, AC_HASH_MODE, 30, 128);
+    header.nonce = 12345;
+    uint8_t encoded[BlockHeader::MAX_ENCODED_SIZE];
+    size_t size = header.encode(encoded);
+    BlockHeader decoded;
+    bool roundTrip = BlockHeader::decode(encoded, size, decoded) && decoded == header;
+    std::cout << "Encoded size: " << size << " bytes" << std::endl;
+    std::cout << "Encode/decode round trip: " << (roundTrip ? "OK" : "MISMATCH") << std::endl;
+
+    //an unknown hash mode is rejected, never hashed as some other mode
+    BlockHeader unknown = header;
+    unknown.hashMode = static_cast<HashMode>(7);
+    unknown.encode(encoded);
+    bool unknownRejected = !BlockHeader::decode(encoded, size, decoded) &&
+                           !ProofOfWork::verifyHeader(unknown, ProofOfWork::hashHeader(header));
+    try {
+        ProofOfWork::hashHeader(unknown);
+        unknownRejected = false;
+    } catch (const std::invalid_argument&) {
+    }
+    std::cout << "Unknown hash mode rejected: " << (unknownRejected ? "YES" : "NO") << std::endl;
+
+    bool stable = true;
+    bool hashMatches = true;
+    HashMode modes[] = {SHA256_MODE, AC_HASH_MODE};
+    for (HashMode mode : modes) {
+        BlockchainPow chain(2, mode, 30, 128);
+        chain.addBlock({"Alice->Bob: 50", "Bob->Charlie: 30"});
+        const BlockPow* block = chain.getChain().back();
+        std::string first = block->calculateHash();
+        //the timestamp is stored, so recomputing later gives the same hash
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        stable = stable && block->calculateHash() == first;
+        hashMatches = hashMatches && first == block->getHash();
+        std::cout << hashModeToString(mode) << " block timestamp: "
+                  << formatTimestamp(block->getTimestamp()) << std::endl;
+    }
+    std::cout << "calculateHash() stable over time: " << (stable ? "YES" : "NO") << std::endl;
+    std::cout << "calculateHash() == mined hash: " << (hashMatches ? "YES" : "NO") << std::endl;
+
+    BlockPow legacy(1, sha256("previous"), "", "legacy data;", 0, 0);
+    std::cout << "Legacy block hash: " << legacy.calculateHash().substr(0, 16) << "..." << std::endl;
+    bool legacyMatches = legacy.calculateHash() == sha256("legacy data;" + sha256("previous") + "0");
+
+    if (roundTrip && unknownRejected && stable && hashMatches && legacyMatches) {
+        std::cout << "\n[PASS] Binary header hashing is canonical and stable" << std::endl;
+    } else {
+        std::cout << "\n[FAIL] Binary header hashing mismatch" << std::endl;
+    }
+}
+
+void test_targets_and_retargeting() {
+    printSeparator("TEST 3.5: 256-bit Targets and Retargeting");
+
+    //nibble difficulty d is exactly 4d leading zero bits
+    bool nibblesMatch = true;
+    for (int d = 0; d <= 4; d++) {
+        Target target = Target::fromNibbles(d);
+        for (int i = 0; i < 2000; i++) {
+            std::string hash = sha256("nibble " + std::to_string(i));
+            bool legacy = hash.compare(0, d, std::string(d, '0')) == 0;
+            nibblesMatch = nibblesMatch && legacy == target.isMetBy(hash);
+        }
+        nibblesMatch = nibblesMatch && Target::fromCompact(target.toCompact()) == target;
+    }
+    std::cout << "Nibble difficulty == 4x zero-bit target: " << (nibblesMatch ? "YES" : "NO") << std::endl;
+
+    //finer steps: 9 zero bits sits between difficulty 2 (8 bits) and 3 (12 bits)
+    Target nine = Target::fromLeadingZeroBits(9);
+    Target between = Target::fromNibbles(2).scaled(0.75);
+    std::cout << "9 zero bits: " << nine.toHex().substr(0, 8) << "..., expected hashes "
+              << nine.expectedHashes() << std::endl;
+    std::cout << "Difficulty 2 x 4/3 work: " << between.toHex().substr(0, 8) << "..., expected hashes "
+              << between.expectedHashes() << std::endl;
+    bool fullCompare = true;
+    for (int i = 0; i < 2000; i++) {
+        std::string hash = sha256("full " + std::to_string(i));
+        fullCompare = fullCompare && between.isMetBy(hash) == (hash <= between.toHex());
+    }
+    std::cout << "Full-target comparison matches hex ordering: " << (fullCompare ? "YES" : "NO") << std::endl;
+
+    //a non-hex character never meets a target, on either comparison path
+    std::string notHex = "00g" + std::string(61, '0');
+    bool rejectsNonHex = !nine.isMetBy(notHex) && !between.isMetBy(notHex);
+    std::cout << "Non-hex hash rejected: " << (rejectsNonHex ? "YES" : "NO") << std::endl;
+
+    //controller on synthetic timings: blocks 4x too fast -> 4x the work
+    RetargetController controller(100.0, 4);
+    Target start = Target::fromLeadingZeroBits(8);
+    for (int i = 0; i < 4; i++) {
+        controller.record(25.0, start);
+    }
+    Target next = controller.retarget(start);
+    std::cout << "Blocks at 25 ms, want 100 ms: " << start.difficultyBits() << " -> "
+              << next.difficultyBits() << " bits" << std::endl;
+    bool controllerOk = std::abs(next.difficultyBits() - 10.0) < 0.01;
+
+    //live: hold ~5 ms blocks starting from a far too easy target
+    BlockchainPow chain(1, SHA256_MODE);
+    chain.enableRetargeting(5.0, 8);
+    {
+        LogLevel saved = Logger::instance().level();
+        Logger::instance().set_level(LOG_SILENT);
+        for (int i = 0; i < 30; i++) {
+            chain.addBlock({"tick " + std::to_string(i)});
+        }
+        Logger::instance().set_level(saved);
+    }
+    std::cout << "Live retargeting: target after 30 blocks ~" << chain.getTarget().difficultyBits()
+              << " zero bits (started at 4)" << std::endl;
+    bool valid = chain.isChainValid();
+    std::cout << "Retargeted chain valid: " << (valid ? "YES" : "NO") << std::endl;
+
+    if (nibblesMatch && fullCompare && rejectsNonHex && controllerOk && valid &&
+        chain.getTarget().difficultyBits() > 4.0) {
+        std::cout << "\n[PASS] Targets and retargeting working" << std::endl;
+    } else {
+        std::cout << "\n[FAIL] Target or retargeting mismatch" << std::endl;
+    }
+}
+
+void test_nonce_space() {
+    printSeparator("TEST 3.6: 64-bit Nonce and Extra Nonce");
+
+    //nonces past 2^32 survive encoding and hashing
+    BlockHeader wide = BlockHeader::create(1, 1700000000000ULL, sha256("prev"), "wide nonce",
+                                           Target::fromLeadingZeroBits(0), SHA256_MODE, 30, 128);
+    wide.nonce = (1ULL << 40) + 7;
+    wide.extraNonce = 3;
+    uint8_t encoded[BlockHeader::MAX_ENCODED_SIZE];
+    size_t size = wide.encode(encoded);
+    BlockHeader decoded;
+    bool wideOk = BlockHeader::decode(encoded, size, decoded) && decoded == wide &&
+                  ProofOfWork::verifyHeader(wide, ProofOfWork::hashHeader(wide));
+    std::cout << "Nonce 2^40+7 round trip (" << size << " bytes): " << (wideOk ? "OK" : "MISMATCH") << std::endl;
+
+    //a 16-nonce space forces the extra nonce to roll over (256 expected hashes)
+    BlockHeader small = BlockHeader::create(1, 1700000000000ULL, sha256("prev"), "small space",
+                                            Target::fromLeadingZeroBits(8), SHA256_MODE, 30, 128);
+    std::string hash = ProofOfWork::mineHeader(small, 16);
+    bool rolled = small.extraNonce > 0 && small.nonce < 16 && ProofOfWork::verifyHeader(small, hash);
+    std::cout << "Mined with 16 nonces per template: extra nonce " << small.extraNonce
+              << ", nonce " << small.nonce << " -> " << (rolled ? "valid" : "INVALID") << std::endl;
+
+    //a second miner starting at a disjoint extra nonce finds a different, valid block
+    BlockHeader other = BlockHeader::create(1, 1700000000000ULL, sha256("prev"), "small space",
+                                            Target::fromLeadingZeroBits(8), SHA256_MODE, 30, 128);
+    other.extraNonce = 1ULL << 32;
+    std::string otherHash = ProofOfWork::mineHeader(other, 16);
+    bool disjoint = otherHash != hash && ProofOfWork::verifyHeader(other, otherHash);
+    std::cout << "Miner at extra nonce 2^32: extra nonce " << other.extraNonce
+              << " -> " << (disjoint ? "valid, different block" : "INVALID") << std::endl;
+
+    //version 1 headers (32-bit nonce, nibble difficulty) still mine and verify
+    BlockHeader old = BlockHeader::create(1, 1700000000000ULL, sha256("prev"), "old", 2, AC_HASH_MODE, 30, 128);
+    std::string oldHash = ProofOfWork::mineHeader(old);
+    bool oldOk = old.encodedSize() == BlockHeader::LEGACY_ENCODED_SIZE && ProofOfWork::verifyHeader(old, oldHash);
+    std::cout << "Version 1 header (" << old.encodedSize() << " bytes): " << (oldOk ? "valid" : "INVALID") << std::endl;
+
+    if (wideOk && rolled && disjoint && oldOk) {
+        std::cout << "\n[PASS] 64-bit nonce space and extra nonce working" << std::endl;
+    } else {
+        std::cout << "\n[FAIL] Nonce space handling broken" << std::endl;
+    }
+}
+
+void test_radius2_mode() {
+    printSeparator("TEST 3.7: Radius-2 AC_HASH Mode");
+
+    BlockchainPow chain(2, AC_HASH_R2_MODE, AC_HASH_R2_DEFAULT_RULE, AC_HASH_R2_DEFAULT_STEPS);
+    chain.addBlock({"Alice->Bob: 50", "Bob->Charlie: 30"});
+    chain.addBlock({"Charlie->Alice: 5"});
+    bool chainValid = chain.isChainValid();
+    std::cout << "Chain of " << chain.getChain().size() << " radius-2 blocks valid: "
+              << (chainValid ? "YES" : "NO") << std::endl;
+
+    //the header commits to the mode: the same header hashed as AC_HASH differs
+    BlockHeader header = BlockHeader::create(1, 1700000000000ULL, sha256("prev"), "r2",
+                                             Target::fromLeadingZeroBits(4), AC_HASH_R2_MODE,
+                                             AC_HASH_R2_DEFAULT_RULE, AC_HASH_R2_DEFAULT_STEPS);
+    std::string hash = ProofOfWork::mineHeader(header);
+    BlockHeader asAcHash = header;
+    asAcHash.hashMode = AC_HASH_MODE;
+    asAcHash.rule = 30;
+    bool headerOk = ProofOfWork::verifyHeader(header, hash) && !ProofOfWork::verifyHeader(asAcHash, hash);
+    std::cout << "Mined header verifies only in its own mode: " << (headerOk ? "YES" : "NO") << std::endl;
+
+    //legacy string path
+    uint64_t nonce = 0;
+    std::string legacyHash = ProofOfWork::mineBlock("r2 legacy", sha256("prev"), 1, nonce, AC_HASH_R2_MODE,
+                                                    AC_HASH_R2_DEFAULT_RULE, AC_HASH_R2_DEFAULT_STEPS);
+    bool legacyOk = ProofOfWork::verifyBlock("r2 legacy", sha256("prev"), legacyHash, 1, nonce, AC_HASH_R2_MODE,
+                                             AC_HASH_R2_DEFAULT_RULE, AC_HASH_R2_DEFAULT_STEPS);
+    std::cout << "Legacy mineBlock / verifyBlock: " << (legacyOk ? "YES" : "NO") << std::endl;
+
+    if (chainValid && headerOk && legacyOk) {
+        std::cout << "\n[PASS] Radius-2 hash mode working" << std::endl;
+    } else {
+        std::cout << "\n[FAIL] Radius-2 hash mode broken" << std::endl;
+    }
+}
+
+void test_sponge_mode() {
+    printSeparator("TEST 3.8: Sponge AC_HASH Mode (long payloads)");
+
+    BlockchainPow chain(2, AC_HASH_SPONGE_MODE, AC_HASH_R2_DEFAULT_RULE, AC_HASH_SPONGE_DEFAULT_ROUNDS);
+    std::vector<std::string> bulk;
+    for (int i = 0; i < 200; i++) {
+        bulk.push_back("Payer" + std::to_string(i) + "->Payee" + std::to_string(i) + ": " + std::to_string(i));
+    }
+    chain.addBlock(bulk);
+    chain.addBlock({"Charlie->Alice: 5"});
+    bool chainValid = chain.isChainValid();
+    std::cout << "Chain with a " << bulk.size() << "-transaction sponge block valid: "
+              << (chainValid ? "YES" : "NO") << std::endl;
+
+    BlockHeader header = BlockHeader::create(1, 1700000000000ULL, sha256("prev"), "sponge",
+                                             Target::fromLeadingZeroBits(4), AC_HASH_SPONGE_MODE,
+                                             AC_HASH_R2_DEFAULT_RULE, AC_HASH_SPONGE_DEFAULT_ROUNDS);
+    std::string hash = ProofOfWork::mineHeader(header);
+    BlockHeader asR2 = header;
+    asR2.hashMode = AC_HASH_R2_MODE;
+    bool headerOk = ProofOfWork::verifyHeader(header, hash) && !ProofOfWork::verifyHeader(asR2, hash);
+    std::cout << "Mined header verifies only in its own mode: " << (headerOk ? "YES" : "NO") << std::endl;
+
+    if (chainValid && headerOk) {
+        std::cout << "\n[PASS] Sponge hash mode working" << std::endl;
+    } else {
+        std::cout << "\n[FAIL] Sponge hash mode broken" << std::endl;
+    }
+}
+
+//generic over any block type, resolved at compile time
+template<typename B>
+size_t hashPrefixLength(const Block<B>& block, const std::string& prefix) {
+    const std::string& hash = block.getHash();
+    size_t n = 0;
+    while (n < hash.size() && n < prefix.size() && hash[n] == prefix[n]) n++;
+    return n;
+}
+
+void test_block_view() {
+    printSeparator("TEST 3.9: Zero-copy Block Access");
+
+    BlockchainPow chain(1, SHA256_MODE);
+    chain.addBlock({"Alice->Bob: 50", "Bob->Charlie: 30"});
+    const BlockPow& block = *chain.getChain().back();
+    const Block<BlockPow>& view = block;
+    //accessors return references to the stored strings
+    bool aliased = &chain.getChain().back()->getData() == &block.getData() && &view.getHash() == &block.getHash() &&
+                   &view.getPreviousHash() == &block.getPreviousHash();
+    bool dataOk = block.getData() == "Alice->Bob: 50;Bob->Charlie: 30;";
+    bool linked = view.linksTo(*chain.getChain().front());
+    bool generic = hashPrefixLength(view, block.getHash()) == block.getHash().size();
+    std::cout << "Accessors alias the block: " << (aliased ? "YES" : "NO") << std::endl;
+    std::cout << "Payload joined as tx;tx;: " << (dataOk ? "YES" : "NO") << std::endl;
+    std::cout << "Static interface (linksTo, generic caller): " << (linked && generic ? "YES" : "NO") << std::endl;
+
+    //the payload buffer is moved into the block, not copied
+    std::string payload(4096, 'x');
+    const char* buffer = payload.data();
+    BlockPow moved(1, "prev", "hash", std::move(payload), 0, 0);
+    bool movedIn = moved.getData().data() == buffer;
+    std::cout << "Payload moved in without a copy: " << (movedIn ? "YES" : "NO") << std::endl;
+
+    if (aliased && dataOk && linked && generic && movedIn) {
+        std::cout << "\n[PASS] Block access copies no payload bytes" << std::endl;
+    } else {
+        std::cout << "\n[FAIL] Block access copies" << std::endl;
+    }
+}
+
+void test_async_logging() {
+    printSeparator("TEST 3.10: Asynchronous Structured Logging");
+
+    Logger& logger = Logger::instance();
+    std::ostringstream captured;
+    logger.set_output(&captured);
+    logger.set_format(LOG_JSON);
+
+    BlockchainPow chain(1, SHA256_MODE);
+    chain.addBlock({"Alice->Bob: 50"});
+    logger.log(LOG_WARN, "quote \" and newline \n");
+    logger.flush();
+    std::string json = captured.str();
+    bool structured = json.find("\"event\": \"block_mined\", \"index\": 1, \"nonce\": ") != std::string::npos &&
+                      json.find("\"mode\": \"SHA-256\"") != std::string::npos &&
+                      json.find("\"text\": \"quote \\\" and newline \\n\"") != std::string::npos;
+    std::cout << "Block event as JSON: " << (structured ? "YES" : "NO") << std::endl;
+
+    //silent mode drops records before they reach the ring
+    captured.str("");
+    logger.set_level(LOG_SILENT);
+    chain.addBlock({"Bob->Charlie: 30"});
+    logger.flush();
+    bool silent = captured.str().empty();
+    std::cout << "Silent mode writes nothing: " << (silent ? "YES" : "NO") << std::endl;
+
+    //producer cost: a record is moved into the ring, formatting and I/O happen on the writer
+    logger.set_level(LOG_INFO);
+    const int records = 2000;
+    long long us = measureTime([&]() {
+        for (int i = 0; i < records; i++) {
+            logger.block_mined(i, i, 0, 1.0, SHA256_MODE, 30, 128);
+        }
+    });
+    logger.flush();
+    std::cout << "block_mined() producer cost: " << (us * 1000.0 / records) << " ns/record, "
+              << logger.dropped() << " dropped" << std::endl;
+
+    logger.set_format(LOG_TEXT);
+    logger.set_output(&std::cout);
+
+    if (structured && silent) {
+        std::cout << "\n[PASS] Mining events logged asynchronously as structured records" << std::endl;
+    } else {
+        std::cout << "\n[FAIL] Logging" << std::endl;
+    }
+}
+
 int main() {
     std::cout << "\n";
     std::cout << "==============================================================\n";
@@ -151,6 +489,13 @@ int main() {
         test_validation_with_both_modes();
         test_mixed_hash_modes();
         test_different_rules();
+        test_binary_header();
+        test_targets_and_retargeting();
+        test_nonce_space();
+        test_radius2_mode();
+        test_sponge_mode();
+        test_block_view();
+        test_async_logging();
         
         printSeparator("ALL TESTS COMPLETED SUCCESSFULLY");
         std::cout << "\n Exercise 3.1 - Hash mode selection: WORKING" << std::endl;
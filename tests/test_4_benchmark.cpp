@@ -1,210 +1,298 @@
 /**
- * g++ -std=c++11 -I./include -IC:\msys64\mingw64\include src/cellular_automaton.cpp src/ac_hash.cpp src/utils.cpp src/pow.cpp src/block_pow.cpp src/blockchain_pow.cpp tests/test_4_benchmark.cpp -LC:\msys64\mingw64\lib -lssl -lcrypto -o test_4_benchmark.exe
- * 
+ * Test 4 - Performance benchmarking (SHA-256 vs AC_HASH)
+ *
+ * Every benchmark is warmed up and repeated over many trials (see
+ * tests/benchmark.h); results report median / p95 / p99 ns per operation,
+ * a 95% confidence interval of the mean and operations per second.
+ * Blockchains used for validation are built outside the timed regions,
+ * with the Logger in silent mode.
+ *
+ * Usage: test_4_benchmark [--quick] [--csv results.csv] [--json results.json]
+ * (make bench writes build/bench.csv and build/bench.json)
+ *
+ * g++ -std=c++11 -O2 -pthread -I./include src/[a-z]*.cpp tests/test_4_benchmark.cpp -lssl -lcrypto -o ./build/test_4_benchmark.exe
  */
 
+#include "benchmark.h"
+#include "ac_hash.h"
 #include "blockchain_pow.h"
+#include "cellular_automaton.h"
+#include "pow.h"
 #include "utils.h"
+#include <cstring>
 #include <iostream>
 #include <vector>
-#include <iomanip>
-#include <chrono>
-
-struct BenchmarkResult {
-    std::string hashMethod;
-    int difficulty;
-    long long totalTime_ms;
-    double avgTime_ms;
-    long long totalIterations;
-    double avgIterations;
-    int blocksCount;
-};
-
-void printTableHeader() {
-    std::cout << "\n" << std::string(90, '=') << std::endl;
-    std::cout << std::left 
-              << std::setw(15) << "Hash Method"
-              << std::setw(12) << "Difficulty"
-              << std::setw(15) << "Total Time(ms)"
-              << std::setw(15) << "Avg Time(ms)"
-              << std::setw(18) << "Total Iterations"
-              << std::setw(15) << "Avg Iterations"
-              << std::endl;
-    std::cout << std::string(90, '-') << std::endl;
+
+std::vector<BenchmarkStats> results;
+
+void report(const BenchmarkStats& stats) {
+    printStatsRow(stats);
+    results.push_back(stats);
 }
 
-void printTableRow(const BenchmarkResult& result) {
-    std::cout << std::left 
-              << std::setw(15) << result.hashMethod
-              << std::setw(12) << result.difficulty
-              << std::setw(15) << result.totalTime_ms
-              << std::setw(15) << std::fixed << std::setprecision(2) << result.avgTime_ms
-              << std::setw(18) << result.totalIterations
-              << std::setw(15) << std::fixed << std::setprecision(2) << result.avgIterations
-              << std::endl;
+void printSection(const std::string& title) {
+    std::cout << "\n" << std::string(122, '=') << std::endl;
+    std::cout << title << std::endl;
+    std::cout << std::string(122, '=') << std::endl;
+    printStatsHeader();
 }
 
-BenchmarkResult benchmarkHashMethod(HashMode mode, int difficulty, int numBlocks, 
-                                     uint32_t rule = 30, size_t steps = 128) {
-    BenchmarkResult result;
-    result.hashMethod = hashModeToString(mode);
-    result.difficulty = difficulty;
-    result.blocksCount = numBlocks;
-    result.totalTime_ms = 0;
-    result.totalIterations = 0;
-    
-    std::vector<std::string> transactions = {
-        "Alice->Bob: 50",
-        "Bob->Charlie: 30",
-        "Charlie->Dave: 20"
-    };
-    
-    BlockchainPow chain(difficulty, mode, rule, steps);
-    
-    //mine
-    for (int i = 0; i < numBlocks; i++) {
-        auto start = std::chrono::high_resolution_clock::now();
-        
-        // Get state before adding block
-        int initialChainSize = chain.getChain().size();
-        
-        chain.addBlock(transactions);
-        
-        auto end = std::chrono::high_resolution_clock::now();
-        long long duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-        
-        // Get the nonce from the last added block
-        const BlockPow* lastBlock = chain.getChain().back();
-        int nonce = lastBlock->getNonce();
-        
-        result.totalTime_ms += duration;
-        result.totalIterations += nonce;
-    }
-    
-    result.avgTime_ms = static_cast<double>(result.totalTime_ms) / numBlocks;
-    result.avgIterations = static_cast<double>(result.totalIterations) / numBlocks;
-    
-    return result;
+const BenchmarkStats* findResult(const std::string& name, const std::string& params) {
+    for (const BenchmarkStats& s : results) {
+        if (s.name == name && s.params == params) return &s;
+    }
+    return nullptr;
 }
 
-void test_MiningTime(int numBlocks = 10, int difficulty = 2) {
-    std::cout << "\n==============================================================";
-    std::cout << "\n=            Mining Time and Iterations Comparison           =";
-    std::cout << "\n==============================================================";
-    
-    std::cout << "\nMining " << numBlocks << " blocks with difficulty " << difficulty << "...\n";
-    
-    //SHA256
-    std::cout << "\n--- Benchmarking SHA256 ---" << std::endl;
-    BenchmarkResult sha_result = benchmarkHashMethod(SHA256_MODE, difficulty, numBlocks);
-    
-    //AC_HASH
-    std::cout << "\n--- Benchmarking AC_HASH (Rule 30, 128 steps) ---" << std::endl;
-    BenchmarkResult ac_result = benchmarkHashMethod(AC_HASH_MODE, difficulty, numBlocks, 30, 128);
-    
-    printTableHeader();
-    printTableRow(sha_result);
-    printTableRow(ac_result);
-    std::cout << std::string(90, '=') << std::endl;
-    
-    // Analysis
-    std::cout << "\n--- Analysis ---" << std::endl;
-    double timeRatio = static_cast<double>(ac_result.totalTime_ms) / sha_result.totalTime_ms;
-    std::cout << "AC_HASH is " << std::fixed << std::setprecision(2) << timeRatio << "x " 
-              << (timeRatio > 1 ? "SLOWER" : "FASTER") << " than SHA256" << std::endl;
-    
-    double iterRatio = ac_result.avgIterations / sha_result.avgIterations;
-    std::cout << "AC_HASH requires " << std::fixed << std::setprecision(2) << iterRatio << "x " 
-              << (iterRatio > 1 ? "MORE" : "FEWER") << " iterations on average" << std::endl;
+void bench_hashes(const BenchmarkConfig& config) {
+    printSection("4.1: Hash functions (ns/hash)");
+    std::string message = "Alice->Bob: 50;Bob->Charlie: 30;0000abcdef12345";
+    volatile size_t sink = 0;
+
+    report(runBenchmark("sha256", "msg=" + std::to_string(message.size()) + "B", config, 1, [&]() {
+        sink += sha256(message).size();
+    }));
+
+    uint32_t rules[] = {30, 90, 110};
+    size_t stepValues[] = {32, 64, 128, 256};
+    AcHashWorkspace workspace;
+    for (uint32_t rule : rules) {
+        for (size_t steps : stepValues) {
+            std::string params = "rule=" + std::to_string(rule) + " steps=" + std::to_string(steps);
+            report(runBenchmark("ac_hash", params, config, 1, [&]() {
+                sink += ac_hash(message, rule, steps, workspace).size();
+            }));
+        }
+    }
+
+    //compile-time specialized rule 30 / 128 steps on the 112-byte header vs the generic path
+    std::vector<uint8_t> header(BlockHeader::MAX_ENCODED_SIZE);
+    for (size_t i = 0; i < header.size(); i++) {
+        header[i] = static_cast<uint8_t>(i * 131);
+    }
+    uint8_t digest[32];
+    std::string headerParams = "rule=30 steps=128 " + std::to_string(header.size()) + "B";
+    report(runBenchmark("ac_hash_generic", headerParams, config, 1, [&]() {
+        ac_hash_generic_digest(header.data(), header.size(), 30, 128, workspace, digest);
+        sink += digest[0];
+    }));
+    report(runBenchmark("ac_hash_fixed", headerParams, config, 1, [&]() {
+        ac_hash_digest(header.data(), header.size(), 30, 128, workspace, digest);
+        sink += digest[0];
+    }));
+
+    //radius-2 mode: the default rule, and rule 30 lifted to radius 2 (same hashes as ac_hash rule 30)
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(message.data());
+    size_t r2Steps[] = {32, 64, 128};
+    for (size_t steps : r2Steps) {
+        report(runBenchmark("ac_hash_r2", "rule=default steps=" + std::to_string(steps), config, 1, [&]() {
+            sink += ac_hash_r2(bytes, message.size(), AC_HASH_R2_DEFAULT_RULE, steps, workspace).size();
+        }));
+    }
+    report(runBenchmark("ac_hash_r2", "rule=30(r2) steps=128", config, 1, [&]() {
+        sink += ac_hash_r2(bytes, message.size(), AC_HASH_R2_RULE_30, 128, workspace).size();
+    }));
 }
 
-void comparison_table() {
-    std::cout << "\n\n=========================================================\n";
-    std::cout << "=                   Complete Comparison Table               =\n";
-    std::cout << "=============================================================\n";
-    
-    int numBlocks = 10;
-    std::vector<int> difficulties = {2, 3};
-    std::vector<BenchmarkResult> allResults;
-    
-    for (int diff : difficulties) {
-        std::cout << "\n=== Testing with Difficulty " << diff << " ===" << std::endl;
-        
-        std::cout << "Mining with SHA256..." << std::endl;
-        BenchmarkResult sha_result = benchmarkHashMethod(SHA256_MODE, diff, numBlocks);
-        allResults.push_back(sha_result);
-        
-        std::cout << "Mining with AC_HASH..." << std::endl;
-        BenchmarkResult ac_result = benchmarkHashMethod(AC_HASH_MODE, diff, numBlocks, 30, 128);
-        allResults.push_back(ac_result);
-    }
-    
-    std::cout << "\n\n";
-    std::cout << "====================================================\n";
-    std::cout << "=              FINAL COMPARISON RESULTS            =\n";
-    std::cout << "====================================================\n";
-    
-    printTableHeader();
-    for (const auto& result : allResults) {
-        printTableRow(result);
-    }
-    std::cout << std::string(90, '=') << std::endl;
-    
-    // Summary
-    std::cout << "\n--- Summary ---" << std::endl;
-    std::cout << "SHA256: Fast per hash, but requires many iterations to find valid hash" << std::endl;
-    std::cout << "AC_HASH: Slower per hash due to CA evolution, but similar iteration count" << std::endl;
-    std::cout << "For blockchain: SHA256 is generally faster due to hardware optimization" << std::endl;
-    std::cout << "AC_HASH provides alternative security model based on CA complexity" << std::endl;
+void bench_long_payloads(const BenchmarkConfig& config) {
+    printSection("4.2: Long payloads, ac_hash rule 30 / 128 steps vs sponge (ns/hash)");
+    size_t lengths[] = {1024, 16384};
+    volatile size_t sink = 0;
+    AcHashWorkspace workspace;
+    for (size_t length : lengths) {
+        std::string payload(length, 'a');
+        for (size_t i = 0; i < length; i++) {
+            payload[i] = static_cast<char>('a' + (i * 7) % 26);
+        }
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(payload.data());
+        std::string params = "bytes=" + std::to_string(length);
+        report(runBenchmark("sha256", params, config, 1, [&]() {
+            sink += sha256(payload).size();
+        }));
+        report(runBenchmark("ac_hash", params, config, 1, [&]() {
+            sink += ac_hash(bytes, length, 30, 128, workspace).size();
+        }));
+        report(runBenchmark("ac_hash_sponge", params, config, 1, [&]() {
+            sink += ac_hash_sponge(bytes, length, AC_HASH_R2_DEFAULT_RULE, AC_HASH_SPONGE_DEFAULT_ROUNDS,
+                                   workspace).size();
+        }));
+    }
 }
 
-void test_different_difficulties() {
-    std::cout << "\n\n==========================================================\n";
-    std::cout << "=         Additional Test: Different Difficulty Levels       =\n";
-    std::cout << "==============================================================\n";
-    
-    std::vector<int> difficulties = {1, 2, 3, 4};
-    int numBlocks = 5;
-    
-    printTableHeader();
-    
-    for (int diff : difficulties) {
-        std::cout << "\nTesting difficulty " << diff << "..." << std::endl;
-        
-        BenchmarkResult sha_result = benchmarkHashMethod(SHA256_MODE, diff, numBlocks);
-        printTableRow(sha_result);
-        
-        BenchmarkResult ac_result = benchmarkHashMethod(AC_HASH_MODE, diff, numBlocks, 30, 128);
-        printTableRow(ac_result);
-        
-        std::cout << std::string(90, '-') << std::endl;
+void bench_evolve(const BenchmarkConfig& config) {
+    printSection("4.3: CellularAutomaton::evolve (ns/generation)");
+    size_t sizes[] = {256, 4096};
+    for (size_t size : sizes) {
+        CellularAutomaton ca(size, 30);
+        ca.init_single_center();
+        report(runBenchmark("ca_evolve", "rule=30 cells=" + std::to_string(size), config, 1, [&]() {
+            ca.evolve();
+        }));
+    }
+
+    //temporal blocking on a grid far past the cache: the state is streamed once per
+    //CA_TILE_DEPTH generations instead of once per generation
+    const size_t bigCells = 1 << 22;
+    const size_t generations = 32;
+    std::vector<int> initial(bigCells);
+    for (size_t i = 0; i < bigCells; i++) {
+        initial[i] = static_cast<int>((i * 2654435761u >> 9) & 1);
+    }
+    CellularAutomaton big(bigCells, 30);
+    big.init_state(initial);
+    std::string params = "rule=30 cells=" + std::to_string(bigCells);
+    report(runBenchmark("ca_untiled", params, config, generations, [&]() {
+        for (size_t g = 0; g < generations; g++) {
+            big.evolve();
+        }
+    }));
+    report(runBenchmark("ca_tiled", params, config, generations, [&]() {
+        big.evolve_tiled(generations);
+    }));
+}
+
+void bench_mining(const BenchmarkConfig& config) {
+    printSection("4.4: ProofOfWork::mineBlock (wall ns per nonce up to the solution, parallel search)");
+    struct MiningCase { HashMode mode; int difficulty; };
+    MiningCase cases[] = {{SHA256_MODE, 2}, {SHA256_MODE, 3}, {AC_HASH_MODE, 1}, {AC_HASH_MODE, 2}};
+    for (const MiningCase& c : cases) {
+        int block = 0;
+        std::string params = hashModeToString(c.mode) + " diff=" + std::to_string(c.difficulty);
+        report(runCountedBenchmark("mineBlock", params, config, [&]() {
+            //new data every call so trials average over the nonce distribution
+            uint64_t nonce = 0;
+            std::string prev = sha256("previous block " + std::to_string(block++));
+            ProofOfWork::mineBlock("Alice->Bob: 50;", prev, c.difficulty, nonce, c.mode, 30, 128);
+            return static_cast<double>(nonce + 1);
+        }));
+    }
+}
+
+void bench_validation(const BenchmarkConfig& config) {
+    printSection("4.5: BlockchainPow::isChainValid (ns/block)");
+    HashMode modes[] = {SHA256_MODE, AC_HASH_MODE};
+    const int numBlocks = 20;
+    for (HashMode mode : modes) {
+        BlockchainPow chain(1, mode, 30, 128);
+        {
+            ScopedSilence silence;
+            for (int i = 0; i < numBlocks; i++) {
+                chain.addBlock({"Alice->Bob: " + std::to_string(i)});
+            }
+        }
+        volatile bool valid = true;
+        report(runBenchmark("isChainValid", hashModeToString(mode) + " blocks=" + std::to_string(numBlocks),
+                            config, numBlocks, [&]() {
+            valid = valid && chain.isChainValid();
+        }));
+        if (!valid) {
+            std::cout << "[FAIL] chain did not validate" << std::endl;
+        }
     }
 }
 
-int main() {
+void printComparison() {
+    std::cout << "\n--- Analysis ---" << std::endl;
+    const BenchmarkStats* sha = findResult("sha256", results.front().params);
+    const BenchmarkStats* ac = findResult("ac_hash", "rule=30 steps=128");
+    if (sha && ac && sha->median_ns > 0) {
+        std::cout << "AC_HASH (rule 30, 128 steps) is " << std::fixed << std::setprecision(1)
+                  << ac->median_ns / sha->median_ns << "x slower per hash than SHA256" << std::endl;
+    }
+    const BenchmarkStats* r2 = findResult("ac_hash_r2", "rule=default steps=" +
+                                          std::to_string(AC_HASH_R2_DEFAULT_STEPS));
+    const BenchmarkStats* r2Rule30 = findResult("ac_hash_r2", "rule=30(r2) steps=128");
+    if (ac && r2 && r2Rule30 && r2->median_ns > 0 && r2Rule30->median_ns > 0) {
+        std::cout << "AC_HASH_R2 (default rule, " << AC_HASH_R2_DEFAULT_STEPS << " steps) is " << std::fixed
+                  << std::setprecision(1) << ac->median_ns / r2->median_ns
+                  << "x faster per hash than AC_HASH rule 30 / 128 steps;"
+                  << " bit packing alone (rule 30 as radius 2, identical hashes) gives "
+                  << ac->median_ns / r2Rule30->median_ns << "x" << std::endl;
+    }
+    size_t lengths[] = {1024, 16384};
+    for (size_t length : lengths) {
+        std::string params = "bytes=" + std::to_string(length);
+        const BenchmarkStats* acLong = findResult("ac_hash", params);
+        const BenchmarkStats* sponge = findResult("ac_hash_sponge", params);
+        if (acLong && sponge && sponge->median_ns > 0) {
+            std::cout << length << "-byte payload: sponge is " << std::fixed << std::setprecision(1)
+                      << acLong->median_ns / sponge->median_ns << "x faster than AC_HASH rule 30 / 128 steps ("
+                      << sponge->median_ns / length << " ns/byte)" << std::endl;
+        }
+    }
+    std::string bigParams = "rule=30 cells=" + std::to_string(1 << 22);
+    const BenchmarkStats* untiled = findResult("ca_untiled", bigParams);
+    const BenchmarkStats* tiled = findResult("ca_tiled", bigParams);
+    if (untiled && tiled && tiled->median_ns > 0) {
+        std::cout << "Tiled evolution (" << CA_TILE_CELLS << "-cell tiles, depth " << CA_TILE_DEPTH << ") on "
+                  << (1 << 22) << " cells is " << std::fixed << std::setprecision(1)
+                  << untiled->median_ns / tiled->median_ns << "x faster per generation; state traffic drops from "
+                  << 2 * sizeof(int) << " to " << std::setprecision(2) << 2.0 * sizeof(int) / CA_TILE_DEPTH
+                  << " bytes per cell per generation" << std::endl;
+    }
+    std::string headerParams = "rule=30 steps=128 " + std::to_string(BlockHeader::MAX_ENCODED_SIZE) + "B";
+    const BenchmarkStats* generic = findResult("ac_hash_generic", headerParams);
+    const BenchmarkStats* fixed = findResult("ac_hash_fixed", headerParams);
+    if (generic && fixed && fixed->median_ns > 0) {
+        std::cout << "ac_hash_fixed<30, 128, 896> (binary header) is " << std::fixed << std::setprecision(1)
+                  << generic->median_ns / fixed->median_ns << "x faster than the generic path" << std::endl;
+    }
+    const BenchmarkStats* shaMine = findResult("mineBlock", "SHA-256 diff=2");
+    const BenchmarkStats* acMine = findResult("mineBlock", "AC HASH diff=2");
+    if (shaMine && acMine && shaMine->median_ns > 0) {
+        std::cout << "Mining at difficulty 2: AC_HASH costs " << std::fixed << std::setprecision(1)
+                  << acMine->median_ns / shaMine->median_ns << "x more per attempt;"
+                  << " both need ~256 attempts per block on average" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchmarkConfig config = {3, 30, 20.0};
+    std::string csvPath;
+    std::string jsonPath;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            config.trials = 10;
+            config.min_trial_ms = 5.0;
+        } else if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        }
+    }
+
     std::cout << "\n";
     std::cout << "==============================================================\n";
     std::cout << "=            EXERCISE 4: PERFORMANCE BENCHMARKING            =\n";
     std::cout << "==============================================================\n";
-    
+    std::cout << "Warmup: " << config.warmup << " calls, trials: " << config.trials
+              << ", min trial: " << config.min_trial_ms << " ms" << std::endl;
+
     try {
-        //question 4.1 and 4.2
-        test_MiningTime(10, 2);
-        
-        //question 4.3
-        comparison_table();
-        
-        //Test different difficulties
-        test_different_difficulties();
-        
+        bench_hashes(config);
+        bench_long_payloads(config);
+        bench_evolve(config);
+        bench_mining(config);
+        bench_validation(config);
+        printComparison();
+
+        if (!csvPath.empty()) {
+            std::cout << (writeCsv(csvPath, results) ? "\nCSV written to " : "\n[ERROR] cannot write ")
+                      << csvPath << std::endl;
+        }
+        if (!jsonPath.empty()) {
+            std::cout << (writeJson(jsonPath, results) ? "JSON written to " : "[ERROR] cannot write ")
+                      << jsonPath << std::endl;
+        }
+
         std::cout << "\n\n==========================================================\n";
         std::cout << "=              BENCHMARK COMPLETED SUCCESSFULLY              =\n";
         std::cout << "==============================================================\n\n";
-        
+
     } catch (const std::exception& e) {
         std::cerr << "\n[ERROR] Benchmark failed: " << e.what() << std::endl;
         return 1;
     }
-    
+
     return 0;
-}
\ No newline at end of file
+}
@@ -12,12 +12,14 @@
  * 
  * 
  * # Compile and run
- * g++ -std=c++11 -I./include src/cellular_automaton.cpp src/ac_hash.cpp tests/test_5.cpp -o ./build/test_5.exe ; .\build\test_5.exe
+ * g++ -std=c++11 -pthread -I./include src/cellular_automaton.cpp src/ac_hash.cpp src/thread_pool.cpp tests/test_5.cpp -o ./build/test_5.exe ; .\build\test_5.exe
  * 
  */
 
 #include "ac_hash.h"
+#include "thread_pool.h"
 #include <iostream>
+#include <vector>
 #include <iomanip>
 
 /**
@@ -76,15 +78,19 @@ void testAvalancheEffect(int numTests = 100) {
     int totalDiffBits = 0;
     int totalBits = 256;
     
-    for (int i = 0; i < numTests; i++) {
+    //hash the message pairs on the shared pool, then sum sequentially
+    std::vector<int> diffBits(numTests);
+    ThreadPool::instance().parallel_for(0, numTests, [&](size_t i) {
 
         std::string message = "Test message number " + std::to_string(i);
         std::string flippedMessage = flipBit(message, i % (message.length() * 8));
         std::string hash1 = ac_hash(message, 30, 128);
         std::string hash2 = ac_hash(flippedMessage, 30, 128);
         
-        int diffBits = countDifferentBits(hash1, hash2);
-        totalDiffBits += diffBits;
+        diffBits[i] = countDifferentBits(hash1, hash2);
+    });
+    for (int diff : diffBits) {
+        totalDiffBits += diff;
     }
     
     double avgDiffBits = static_cast<double>(totalDiffBits) / numTests;
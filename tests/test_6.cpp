@@ -4,10 +4,11 @@
  * 6.2. Indique si la distribution est équilibrée (≈50 % de 1).
  * 
  * Compile and run:
- * g++ -std=c++11 -I./include src/cellular_automaton.cpp src/ac_hash.cpp tests/test_6.cpp -o ./build/test_6.exe ; .\build\test_6.exe
+ * g++ -std=c++11 -pthread -I./include src/cellular_automaton.cpp src/ac_hash.cpp src/thread_pool.cpp tests/test_6.cpp -o ./build/test_6.exe ; .\build\test_6.exe
  */
 
 #include "ac_hash.h"
+#include "thread_pool.h"
 #include <iostream>
 #include <iomanip>
 #include <vector>
@@ -58,11 +59,15 @@ void testBitDistribution(int numSamples) {
     uint32_t rule = 30;
     size_t steps = 128;
     
-    for (int i = 0; i < numSamples; i++) {
+    //hash the samples on the shared pool, then tally sequentially
+    std::vector<std::string> hashes(numSamples);
+    ThreadPool::instance().parallel_for(0, numSamples, [&](size_t i) {
         std::string input = "Sample message number " + std::to_string(i);
-        std::string hash = ac_hash(input, rule, steps);
-        
-        int oneBits = countOneBits(hash);
+        hashes[i] = ac_hash(input, rule, steps);
+    });
+    
+    for (int i = 0; i < numSamples; i++) {
+        int oneBits = countOneBits(hashes[i]);
         totalOneBits += oneBits;
         totalBits += 256; // each hash is 256 bits
         
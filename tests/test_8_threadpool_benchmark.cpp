@@ -0,0 +1,105 @@
+/**
+ * Test 8 - ThreadPool microbenchmark
+ * 8.1. Task-dispatch overhead (submit + future, parallel_for iterations)
+ * 8.2. Scaling efficiency of an ac_hash batch from 1 thread up to all hardware threads
+ *
+ * Compile and run:
+ * g++ -std=c++11 -pthread -I./include src/cellular_automaton.cpp src/ac_hash.cpp src/thread_pool.cpp tests/test_8_threadpool_benchmark.cpp -o ./build/test_8_threadpool_benchmark.exe ; ./build/test_8_threadpool_benchmark.exe
+ */
+
+#include "ac_hash.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include <iostream>
+#include <iomanip>
+#include <future>
+#include <thread>
+#include <vector>
+
+void test_dispatch_overhead(size_t numTasks) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "8.1: Task-dispatch overhead (" << numTasks << " empty tasks)" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    ThreadPool& pool = ThreadPool::instance();
+
+    long long submit_us = measureTime([&]() {
+        std::vector<std::future<void>> futures;
+        futures.reserve(numTasks);
+        for (size_t i = 0; i < numTasks; i++) {
+            futures.push_back(pool.submit([]() {}));
+        }
+        for (auto& f : futures) {
+            f.get();
+        }
+    });
+
+    long long for_us = measureTime([&]() {
+        pool.parallel_for(0, numTasks, [](size_t) {}, 1);
+    });
+
+    std::cout << std::left << std::setw(35) << "submit() + future::get()"
+              << std::fixed << std::setprecision(1)
+              << (submit_us * 1000.0 / numTasks) << " ns/task" << std::endl;
+    std::cout << std::left << std::setw(35) << "parallel_for (grain 1)"
+              << std::fixed << std::setprecision(1)
+              << (for_us * 1000.0 / numTasks) << " ns/task" << std::endl;
+}
+
+void test_scaling(size_t numHashes) {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "8.2: Scaling efficiency (" << numHashes << " x ac_hash rule 30, 128 steps)" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts;
+    for (unsigned t = 1; t < hw; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(hw);
+
+    std::cout << std::left
+              << std::setw(10) << "Threads"
+              << std::setw(15) << "Time(us)"
+              << std::setw(15) << "Hashes/s"
+              << std::setw(12) << "Speedup"
+              << std::setw(12) << "Efficiency" << std::endl;
+    std::cout << std::string(70, '-') << std::endl;
+
+    std::vector<std::string> hashes(numHashes);
+    long long baseline = 0;
+    for (unsigned t : threadCounts) {
+        ThreadPool pool(t, PIN_COMPACT);
+        long long us = measureTime([&]() {
+            pool.parallel_for(0, numHashes, [&](size_t i) {
+                hashes[i] = ac_hash("Scaling message " + std::to_string(i), 30, 128);
+            });
+        });
+        if (us == 0) us = 1;
+        if (baseline == 0) baseline = us;
+        double speedup = static_cast<double>(baseline) / us;
+        std::cout << std::left
+                  << std::setw(10) << t
+                  << std::setw(15) << us
+                  << std::setw(15) << std::fixed << std::setprecision(0) << (numHashes * 1e6 / us)
+                  << std::setw(12) << std::fixed << std::setprecision(2) << speedup
+                  << std::setw(12) << std::fixed << std::setprecision(2) << (speedup / t * 100.0)
+                  << std::endl;
+    }
+    std::cout << "\nNOTE: the calling thread helps in parallel_for, so T threads use up to T+1 cores." << std::endl;
+}
+
+int main() {
+    std::cout << "\n";
+    std::cout << "==============================================================\n";
+    std::cout << "=             TEST 8: THREAD POOL MICROBENCHMARK             =\n";
+    std::cout << "==============================================================\n";
+
+    test_dispatch_overhead(100000);
+    test_scaling(256);
+
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "BENCHMARK COMPLETE" << std::endl;
+    std::cout << std::string(70, '=') << "\n" << std::endl;
+    return 0;
+}
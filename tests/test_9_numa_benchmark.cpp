@@ -0,0 +1,157 @@
+/**
+ * Test 9 - NUMA placement benchmark
+ * 9.1. Prints the discovered NUMA topology (/sys/devices/system/node)
+ * 9.2. Memory streaming per worker: interleaved vs node-local buffers
+ * 9.3. AC_HASH mining workspaces: interleaved vs node-local
+ *
+ * Workers are pinned per node (PIN_PER_NODE). On a single-node machine both
+ * placements are the same memory, so the numbers should match.
+ *
+ * Compile and run:
+ * g++ -std=c++11 -pthread -I./include src/cellular_automaton.cpp src/ac_hash.cpp src/thread_pool.cpp src/numa_topology.cpp tests/test_9_numa_benchmark.cpp -o ./build/test_9_numa_benchmark.exe ; ./build/test_9_numa_benchmark.exe
+ */
+
+#include "ac_hash.h"
+#include "numa_topology.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+enum Placement { INTERLEAVED, NODE_LOCAL };
+
+std::string placementToString(Placement placement) {
+    return (placement == INTERLEAVED) ? "interleaved" : "node-local";
+}
+
+/**
+ * Runs job(worker) exactly once on every worker of the pool. Each task
+ * waits until all of them have started, so no worker can pick up two.
+ */
+void runOnEveryWorker(ThreadPool& pool, const std::function<void(size_t)>& job) {
+    std::atomic<size_t> started(0);
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0; i < pool.size(); i++) {
+        futures.push_back(pool.submit([&]() {
+            started.fetch_add(1);
+            while (started.load() < pool.size()) {
+                std::this_thread::yield();
+            }
+            job(static_cast<size_t>(ThreadPool::current_worker()));
+        }));
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+}
+
+void printTopology() {
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "9.1: NUMA topology" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+
+    const NumaTopology& topology = NumaTopology::system();
+    for (const NumaNode& node : topology.get_nodes()) {
+        std::cout << "Node " << node.id << ": " << node.cpus.size() << " CPUs (";
+        for (size_t i = 0; i < node.cpus.size() && i < 8; i++) {
+            std::cout << (i ? "," : "") << node.cpus[i];
+        }
+        std::cout << (node.cpus.size() > 8 ? ",...)" : ")") << std::endl;
+    }
+    if (!topology.is_numa()) {
+        std::cout << "\nSingle-node machine: interleaved and node-local placement are identical." << std::endl;
+    }
+}
+
+double streamBandwidth(ThreadPool& pool, Placement placement, size_t bytesPerWorker, int passes) {
+    std::vector<double> seconds(pool.size());
+    std::vector<unsigned long long> sums(pool.size());
+    runOnEveryWorker(pool, [&](size_t worker) {
+        void* memory = (placement == INTERLEAVED)
+            ? NumaTopology::allocate_interleaved(bytesPerWorker)
+            : NumaTopology::allocate_on_node(bytesPerWorker, pool.worker_node(worker));
+        uint64_t* words = static_cast<uint64_t*>(memory);
+        size_t count = bytesPerWorker / sizeof(uint64_t);
+        std::memset(words, 1, bytesPerWorker); //fault the pages in
+
+        unsigned long long sum = 0;
+        long long us = measureTime([&]() {
+            for (int p = 0; p < passes; p++) {
+                for (size_t i = 0; i < count; i++) {
+                    sum += words[i];
+                }
+            }
+        });
+        sums[worker] = sum;
+        seconds[worker] = us / 1e6;
+        NumaTopology::release(memory, bytesPerWorker);
+    });
+
+    double slowest = 0;
+    for (double s : seconds) slowest = std::max(slowest, s);
+    return (static_cast<double>(bytesPerWorker) * passes * pool.size()) / (slowest * 1e9);
+}
+
+double hashThroughput(ThreadPool& pool, Placement placement, int hashesPerWorker) {
+    std::vector<double> seconds(pool.size());
+    runOnEveryWorker(pool, [&](size_t worker) {
+        //build and warm the workspace under the requested page policy
+        if (placement == INTERLEAVED) NumaTopology::set_thread_interleaved(true);
+        AcHashWorkspace* workspace = new AcHashWorkspace();
+        std::string message = "NUMA benchmark worker " + std::to_string(worker) + " nonce ";
+        ac_hash(message + "0", 30, 128, *workspace);
+        if (placement == INTERLEAVED) NumaTopology::set_thread_interleaved(false);
+
+        long long us = measureTime([&]() {
+            for (int i = 0; i < hashesPerWorker; i++) {
+                ac_hash(message + std::to_string(i), 30, 128, *workspace);
+            }
+        });
+        seconds[worker] = us / 1e6;
+        delete workspace;
+    });
+
+    double slowest = 0;
+    for (double s : seconds) slowest = std::max(slowest, s);
+    return (hashesPerWorker * pool.size()) / slowest;
+}
+
+int main() {
+    std::cout << "\n";
+    std::cout << "==============================================================\n";
+    std::cout << "=              TEST 9: NUMA PLACEMENT BENCHMARK              =\n";
+    std::cout << "==============================================================\n";
+
+    printTopology();
+
+    ThreadPool pool(0, PIN_PER_NODE);
+    Placement placements[] = {INTERLEAVED, NODE_LOCAL};
+
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "9.2: Memory streaming (" << pool.size() << " workers, 64 MB each)" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+    for (Placement placement : placements) {
+        double gbps = streamBandwidth(pool, placement, 64u << 20, 4);
+        std::cout << std::left << std::setw(15) << placementToString(placement)
+                  << std::fixed << std::setprecision(2) << gbps << " GB/s" << std::endl;
+    }
+
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "9.3: AC_HASH workspaces (rule 30, 128 steps)" << std::endl;
+    std::cout << std::string(70, '=') << std::endl;
+    for (Placement placement : placements) {
+        double hps = hashThroughput(pool, placement, 200);
+        std::cout << std::left << std::setw(15) << placementToString(placement)
+                  << std::fixed << std::setprecision(0) << hps << " hashes/s" << std::endl;
+    }
+
+    std::cout << "\n" << std::string(70, '=') << std::endl;
+    std::cout << "BENCHMARK COMPLETE" << std::endl;
+    std::cout << std::string(70, '=') << "\n" << std::endl;
+    return 0;
+}